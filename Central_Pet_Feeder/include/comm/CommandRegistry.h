@@ -0,0 +1,355 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <stddef.h>
+
+// Registro único dos comandos MQTT (mesmo arquivo na Central, na remota e na
+// remota 2): cada comando é declarado uma vez, com verbo, struct de argumentos
+// e faixa válida de cada campo. Os dois lados decodificam e codificam pela
+// mesma tabela, então não há como divergirem sobre o protocolo.
+//
+// O verbo é resolvido por hash perfeito: a semente que deixa todos os verbos
+// em posições distintas da tabela é procurada na compilação, e find() custa
+// um hash e um strcmp, independente do número de comandos.
+//
+// Header-only e em C++11 (o padrão do arduino-esp32 2.x): as tabelas são
+// constexpr de escopo de namespace, com uma cópia por unidade de compilação.
+
+enum class CommandId : uint8_t {
+    // Central -> remota
+    LOG_ACK = 0,
+    FEED,
+    CONFIG_MEAL,    // Também Dashboard -> Central (com remote_id)
+    SYNC,
+    STATUS,         // Também Central -> remota 2
+    CALIBRATE,
+    // Dashboard -> Central
+    FEED_NOW,
+    GET_STATE,
+    // Central -> remota 2
+    PING,
+    STOP,
+    ALIMENTAR,
+    // Ferramenta de deploy -> remota
+    OTA,
+    COUNT,
+    UNKNOWN = COUNT
+};
+
+// ========== ARGUMENTOS ==========
+
+struct LogAckArgs {
+    uint32_t jid;
+    uint32_t seq;           // Todos os logs com seq menor foram recebidos
+};
+
+struct FeedArgs {
+    uint16_t quantity;      // Gramas
+    uint32_t reqId;         // Devolvido no FEED_ACK (0 = sem id)
+    uint8_t channel;        // Reservatório (remota com vários)
+};
+
+struct MealConfigArgs {
+    uint8_t remoteId;       // Só no comando do Dashboard (0 = ausente)
+    uint8_t meal;
+    uint8_t hour;
+    uint8_t minute;
+    uint16_t quantity;
+    uint8_t days;           // Bit 0 = domingo ... bit 6 = sábado
+    uint8_t channel;
+};
+
+struct CalibrateArgs {
+    char step[8];           // "run", "record", "clear", "show"
+    uint32_t ms;
+    uint16_t grams;         // 0 = ausente
+    uint8_t channel;
+};
+
+struct FeedNowArgs {
+    uint8_t remoteId;
+    uint16_t quantity;
+    uint8_t channel;
+};
+
+struct AlimentarArgs {
+    uint8_t seconds;
+    uint8_t remoteId;
+};
+
+struct OtaArgs {
+    char url[128];          // Patch (core/delta_patch) via HTTP(S)
+    char sha256[65];        // Hex da imagem nova: o patch precisa produzir exatamente ela
+};
+
+// ========== TABELA ==========
+
+struct CommandField {
+    enum Type : uint8_t { UINT, TEXT };
+
+    const char* key;
+    uint8_t offset;         // offsetof() no struct de argumentos
+    uint8_t size;           // UINT: 1, 2 ou 4 bytes; TEXT: tamanho do buffer
+    Type type;
+    bool required;          // Ausente = inválido (senão vale o padrão)
+    uint32_t min;
+    uint32_t max;
+    uint32_t def;
+    const char* defText;    // Padrão de TEXT
+};
+
+struct CommandSpec {
+    const char* verb;
+    const CommandField* fields;
+    uint8_t fieldCount;
+};
+
+namespace CommandTable {
+
+// Limites do protocolo (os mesmos validados antes por cada lado)
+constexpr uint16_t FEED_MIN_G = 10;
+constexpr uint16_t FEED_MAX_G = 500;
+constexpr uint16_t FEED_DEFAULT_G = 100;
+constexpr uint8_t MEALS = 3;
+constexpr uint8_t ALL_DAYS = 0x7F;
+constexpr uint32_t CALIBRATE_MAX_MS = 20000;
+constexpr uint8_t ALIMENTAR_MAX_S = 60;
+constexpr uint8_t CHANNELS = 8;         // Reservatórios por remota (3 bits no FeedLogCodec)
+
+#define CMD_FIELD(Args, member, key, required, min, max, def) \
+    { key, offsetof(Args, member), sizeof(Args::member), CommandField::UINT, required, min, max, def, nullptr }
+#define CMD_TEXT(Args, member, key, def) \
+    { key, offsetof(Args, member), sizeof(Args::member), CommandField::TEXT, false, 0, 0, 0, def }
+
+constexpr CommandField LOG_ACK_FIELDS[] = {
+    CMD_FIELD(LogAckArgs, jid, "jid", true, 0, 0xFFFFFFFF, 0),
+    CMD_FIELD(LogAckArgs, seq, "seq", true, 0, 0xFFFFFFFF, 0),
+};
+
+constexpr CommandField FEED_FIELDS[] = {
+    CMD_FIELD(FeedArgs, quantity, "quantity", false, FEED_MIN_G, FEED_MAX_G, FEED_DEFAULT_G),
+    CMD_FIELD(FeedArgs, reqId, "req_id", false, 0, 0xFFFFFFFF, 0),
+    CMD_FIELD(FeedArgs, channel, "channel", false, 0, CHANNELS - 1, 0),
+};
+
+constexpr CommandField CONFIG_MEAL_FIELDS[] = {
+    CMD_FIELD(MealConfigArgs, remoteId, "remote_id", false, 1, 255, 0),
+    CMD_FIELD(MealConfigArgs, meal, "meal", true, 0, MEALS - 1, 0),
+    CMD_FIELD(MealConfigArgs, hour, "hour", true, 0, 23, 0),
+    CMD_FIELD(MealConfigArgs, minute, "minute", true, 0, 59, 0),
+    CMD_FIELD(MealConfigArgs, quantity, "quantity", true, FEED_MIN_G, FEED_MAX_G, 0),
+    CMD_FIELD(MealConfigArgs, days, "days", false, 0, ALL_DAYS, ALL_DAYS),
+    CMD_FIELD(MealConfigArgs, channel, "channel", false, 0, CHANNELS - 1, 0),
+};
+
+constexpr CommandField CALIBRATE_FIELDS[] = {
+    CMD_TEXT(CalibrateArgs, step, "step", "show"),
+    CMD_FIELD(CalibrateArgs, ms, "ms", false, 1, CALIBRATE_MAX_MS, 3000),
+    CMD_FIELD(CalibrateArgs, grams, "grams", false, 1, 65535, 0),
+    CMD_FIELD(CalibrateArgs, channel, "channel", false, 0, CHANNELS - 1, 0),
+};
+
+constexpr CommandField FEED_NOW_FIELDS[] = {
+    CMD_FIELD(FeedNowArgs, remoteId, "remote_id", true, 1, 255, 0),
+    CMD_FIELD(FeedNowArgs, quantity, "quantity", false, FEED_MIN_G, FEED_MAX_G, FEED_DEFAULT_G),
+    CMD_FIELD(FeedNowArgs, channel, "channel", false, 0, CHANNELS - 1, 0),
+};
+
+constexpr CommandField ALIMENTAR_FIELDS[] = {
+    CMD_FIELD(AlimentarArgs, seconds, "tempo", false, 1, ALIMENTAR_MAX_S, 5),
+    CMD_FIELD(AlimentarArgs, remoteId, "remota_id", false, 1, 255, 1),
+};
+
+constexpr CommandField OTA_FIELDS[] = {
+    CMD_TEXT(OtaArgs, url, "url", ""),
+    CMD_TEXT(OtaArgs, sha256, "sha256", ""),
+};
+
+#undef CMD_FIELD
+#undef CMD_TEXT
+
+template <size_t N>
+constexpr uint8_t countOf(const CommandField (&)[N]) { return N; }
+
+// Na ordem de CommandId
+constexpr CommandSpec SPECS[] = {
+    { "LOG_ACK",     LOG_ACK_FIELDS,     countOf(LOG_ACK_FIELDS) },
+    { "FEED",        FEED_FIELDS,        countOf(FEED_FIELDS) },
+    { "CONFIG_MEAL", CONFIG_MEAL_FIELDS, countOf(CONFIG_MEAL_FIELDS) },
+    { "SYNC",        nullptr,            0 },
+    { "STATUS",      nullptr,            0 },
+    { "CALIBRATE",   CALIBRATE_FIELDS,   countOf(CALIBRATE_FIELDS) },
+    { "FEED_NOW",    FEED_NOW_FIELDS,    countOf(FEED_NOW_FIELDS) },
+    { "GET_STATE",   nullptr,            0 },
+    { "PING",        nullptr,            0 },
+    { "STOP",        nullptr,            0 },
+    { "ALIMENTAR",   ALIMENTAR_FIELDS,   countOf(ALIMENTAR_FIELDS) },
+    { "OTA",         OTA_FIELDS,         countOf(OTA_FIELDS) },
+};
+
+constexpr uint8_t COUNT = (uint8_t)CommandId::COUNT;
+static_assert(sizeof(SPECS) / sizeof(SPECS[0]) == COUNT, "SPECS fora da ordem de CommandId");
+
+// ========== HASH PERFEITO ==========
+
+constexpr uint8_t SLOTS = 32;   // Potência de 2, > 2x o número de verbos
+
+// FNV-1a com semente variável
+constexpr uint32_t hashVerb(const char* s, uint32_t h) {
+    return *s ? hashVerb(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+}
+
+constexpr uint8_t slotOf(const char* verb, uint32_t seed) {
+    return hashVerb(verb, seed) & (SLOTS - 1);
+}
+
+constexpr bool slotsDistinct(uint32_t seed, uint8_t i, uint8_t j) {
+    return i >= COUNT ? true
+         : j >= COUNT ? slotsDistinct(seed, i + 1, i + 2)
+         : slotOf(SPECS[i].verb, seed) == slotOf(SPECS[j].verb, seed) ? false
+         : slotsDistinct(seed, i, j + 1);
+}
+
+constexpr uint32_t findSeed(uint32_t seed) {
+    return slotsDistinct(seed, 0, 1) ? seed : findSeed(seed + 1);
+}
+
+constexpr uint32_t SEED = findSeed(2166136261u);
+
+constexpr uint8_t idForSlot(uint8_t slot, uint8_t i) {
+    return i >= COUNT ? COUNT
+         : slotOf(SPECS[i].verb, SEED) == slot ? i
+         : idForSlot(slot, i + 1);
+}
+
+constexpr uint8_t SLOT_IDS[SLOTS] = {
+    idForSlot(0, 0),  idForSlot(1, 0),  idForSlot(2, 0),  idForSlot(3, 0),
+    idForSlot(4, 0),  idForSlot(5, 0),  idForSlot(6, 0),  idForSlot(7, 0),
+    idForSlot(8, 0),  idForSlot(9, 0),  idForSlot(10, 0), idForSlot(11, 0),
+    idForSlot(12, 0), idForSlot(13, 0), idForSlot(14, 0), idForSlot(15, 0),
+    idForSlot(16, 0), idForSlot(17, 0), idForSlot(18, 0), idForSlot(19, 0),
+    idForSlot(20, 0), idForSlot(21, 0), idForSlot(22, 0), idForSlot(23, 0),
+    idForSlot(24, 0), idForSlot(25, 0), idForSlot(26, 0), idForSlot(27, 0),
+    idForSlot(28, 0), idForSlot(29, 0), idForSlot(30, 0), idForSlot(31, 0),
+};
+
+} // namespace CommandTable
+
+// Struct de argumentos -> comando (codificação/decodificação tipadas)
+template <class Args> struct CommandOf;
+template <> struct CommandOf<LogAckArgs>     { static constexpr CommandId id = CommandId::LOG_ACK; };
+template <> struct CommandOf<FeedArgs>       { static constexpr CommandId id = CommandId::FEED; };
+template <> struct CommandOf<MealConfigArgs> { static constexpr CommandId id = CommandId::CONFIG_MEAL; };
+template <> struct CommandOf<CalibrateArgs>  { static constexpr CommandId id = CommandId::CALIBRATE; };
+template <> struct CommandOf<FeedNowArgs>    { static constexpr CommandId id = CommandId::FEED_NOW; };
+template <> struct CommandOf<AlimentarArgs>  { static constexpr CommandId id = CommandId::ALIMENTAR; };
+template <> struct CommandOf<OtaArgs>        { static constexpr CommandId id = CommandId::OTA; };
+
+class CommandRegistry {
+public:
+    static const uint8_t COUNT = CommandTable::COUNT;
+
+    static CommandId find(const char* verb) {
+        if (!verb) return CommandId::UNKNOWN;
+        uint8_t id = CommandTable::SLOT_IDS[CommandTable::slotOf(verb, CommandTable::SEED)];
+        if (id < COUNT && strcmp(CommandTable::SPECS[id].verb, verb) == 0) {
+            return (CommandId)id;
+        }
+        return CommandId::UNKNOWN;
+    }
+
+    static const CommandSpec& spec(CommandId id) {
+        return CommandTable::SPECS[(uint8_t)id];
+    }
+
+    static const char* verb(CommandId id) {
+        return id < CommandId::COUNT ? spec(id).verb : "?";
+    }
+
+    // Preenche args com os padrões e com os campos presentes. Falha no
+    // primeiro campo obrigatório ausente, de tipo errado ou fora da faixa
+    // (devolvido em bad, para o log).
+    static bool decode(CommandId id, JsonVariantConst json, void* args,
+                       const CommandField** bad = nullptr) {
+        const CommandSpec& s = spec(id);
+        for (uint8_t i = 0; i < s.fieldCount; i++) {
+            const CommandField& f = s.fields[i];
+            uint8_t* out = (uint8_t*)args + f.offset;
+            JsonVariantConst v = json[f.key];
+
+            if (f.type == CommandField::TEXT) {
+                const char* text = v.isNull() ? f.defText : v.as<const char*>();
+                if (!text || strlen(text) >= f.size) return fail(f, bad);
+                strcpy((char*)out, text);
+                continue;
+            }
+
+            uint32_t value = f.def;
+            if (v.isNull()) {
+                if (f.required) return fail(f, bad);
+            } else {
+                if (!v.is<uint32_t>()) return fail(f, bad);
+                value = v.as<uint32_t>();
+                if (value < f.min || value > f.max) return fail(f, bad);
+            }
+            storeUint(out, f.size, value);
+        }
+        return true;
+    }
+
+    template <class Args>
+    static bool decode(JsonVariantConst json, Args& args, const CommandField** bad = nullptr) {
+        return decode(CommandOf<Args>::id, json, &args, bad);
+    }
+
+    // {"cmd": verbo, campos...}; campos opcionais iguais ao padrão são omitidos
+    static void encode(CommandId id, const void* args, JsonDocument& doc) {
+        const CommandSpec& s = spec(id);
+        doc["cmd"] = s.verb;
+        for (uint8_t i = 0; i < s.fieldCount; i++) {
+            const CommandField& f = s.fields[i];
+            const uint8_t* in = (const uint8_t*)args + f.offset;
+
+            if (f.type == CommandField::TEXT) {
+                if (f.required || strcmp((const char*)in, f.defText) != 0) {
+                    doc[f.key] = (const char*)in;
+                }
+                continue;
+            }
+
+            uint32_t value = loadUint(in, f.size);
+            if (!f.required && value == f.def) continue;
+            doc[f.key] = value;
+        }
+    }
+
+    template <class Args>
+    static void encode(const Args& args, JsonDocument& doc) {
+        encode(CommandOf<Args>::id, &args, doc);
+    }
+
+    // Comandos sem argumentos
+    static void encode(CommandId id, JsonDocument& doc) {
+        doc["cmd"] = spec(id).verb;
+    }
+
+private:
+    static bool fail(const CommandField& f, const CommandField** bad) {
+        if (bad) *bad = &f;
+        return false;
+    }
+
+    static void storeUint(uint8_t* out, uint8_t size, uint32_t value) {
+        if (size == 1) { uint8_t v = value; memcpy(out, &v, 1); }
+        else if (size == 2) { uint16_t v = value; memcpy(out, &v, 2); }
+        else memcpy(out, &value, 4);
+    }
+
+    static uint32_t loadUint(const uint8_t* in, uint8_t size) {
+        if (size == 1) return *in;
+        if (size == 2) { uint16_t v; memcpy(&v, in, 2); return v; }
+        uint32_t v;
+        memcpy(&v, in, 4);
+        return v;
+    }
+};
@@ -1,13 +1,16 @@
 #pragma once
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include "comm/CommandRegistry.h"
 
 class PayloadBuilder {
 public:
     // Comandos para remotas
     static String buildCommand(const String& command, int value = 0);
-    static String buildFeedCommand(int quantity);
-    static String buildMealConfig(int mealIndex, int hour, int minute, int quantity);
+    static String buildFeedCommand(int quantity, uint8_t channel = 0);
+    static String buildMealConfig(int mealIndex, int hour, int minute, int quantity, uint8_t channel = 0,
+                                  uint8_t days = CommandTable::ALL_DAYS);
+    static String buildLogAck(uint32_t journalId, uint32_t seq);
 
     // Status da central
     static String buildCentralStatus(bool online, int remotesOnline, int remotesTotal);
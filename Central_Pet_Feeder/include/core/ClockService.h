@@ -7,14 +7,47 @@ private:
     bool initialized;
     unsigned long lastNTPUpdate;
 
-    int currentHour;
-    int currentMinute;
-    int currentSecond;
-    int currentDay;
-    int currentMonth;
-    int currentYear;
+    // Base de tempo: epoch UTC capturado na última sincronização SNTP mais
+    // o tempo monotônico (esp_timer) decorrido desde então. As leituras são
+    // apenas aritmética, sem chamadas à libc e sem bloqueio.
+    int64_t baseMicros;     // µs UTC na sincronização
+    int64_t monoBase;       // esp_timer_get_time() (µs) na sincronização
+    int32_t tzOffset;       // fuso + horário de verão (segundos)
+
+    // Disciplina do relógio: correções pequenas são aplicadas aos poucos
+    // (slew) para o tempo nunca saltar nem voltar; o drift medido do cristal
+    // é compensado e define o intervalo de ressincronização.
+    static const int64_t SLEW_RATE_PPM = 5000;                 // 0,5% -> 1s a cada 200s
+    static const int64_t STEP_THRESHOLD_US = 60LL * 1000000;   // Acima disso, salta
+    static const int64_t MAX_ERROR_US = 250000;                // Erro tolerado entre sincronizações
+    static const int64_t MIN_DRIFT_WINDOW_US = 15LL * 60 * 1000000;
+    static const int32_t MAX_DRIFT_PPB = 500000;               // ±500 ppm
+    static const unsigned long MIN_RESYNC_INTERVAL = 15UL * 60 * 1000;
+    static const unsigned long MAX_RESYNC_INTERVAL = 24UL * 3600 * 1000;
+
+    int64_t slewMicros;     // Correção pendente a partir de monoBase
+    int32_t driftPpb;       // Compensação de frequência aplicada
+    int32_t residualPpb;    // Erro de frequência medido na última sincronização
+    int32_t lastCorrectionMs;
+    unsigned long timeToReady;
+    unsigned long resyncInterval;
+
+    // Data em cache, recalculada apenas quando o dia local muda
+    mutable int32_t cachedEpochDay;
+    mutable int cachedDay;
+    mutable int cachedMonth;
+    mutable int cachedYear;
+
+    static ClockService* instance;
+    static volatile bool syncPending;
+    static void onSNTPSync(struct timeval* tv);
 
     void syncWithNTP();
+    void applySync();
+    int64_t microsAt(int64_t mono) const;
+    int64_t localSeconds() const;
+    void refreshDate() const;
+    static void civilFromDays(int32_t days, int& year, int& month, int& day);
 
 public:
     ClockService();
@@ -23,12 +56,12 @@ public:
     void update();
 
     // Getters
-    int getHour() const { return currentHour; }
-    int getMinute() const { return currentMinute; }
-    int getSecond() const { return currentSecond; }
-    int getDay() const { return currentDay; }
-    int getMonth() const { return currentMonth; }
-    int getYear() const { return currentYear; }
+    int getHour() const;
+    int getMinute() const;
+    int getSecond() const;
+    int getDay() const;
+    int getMonth() const;
+    int getYear() const;
 
     // Formatação
     String getTimeFormatted();      // HH:MM:SS
@@ -39,4 +72,10 @@ public:
     unsigned long getTimestamp() const;
 
     bool isInitialized() const { return initialized; }
+
+    // Diagnóstico da sincronização
+    unsigned long getTimeToReady() const { return timeToReady; }        // ms do boot até a 1ª sincronização
+    int32_t getLastCorrectionMs() const { return lastCorrectionMs; }    // Última correção (+ adianta)
+    float getDriftPpm() const { return driftPpb / 1000.0f; }
+    unsigned long getResyncInterval() const { return resyncInterval; }
 };
@@ -0,0 +1,95 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "hal/ScreenBacklight.h"
+#include "comm/MQTTClient.h"
+
+// Valores padrão (podem ser sobrescritos no config.h)
+#ifndef POWER_IDLE_TIMEOUT
+#define POWER_IDLE_TIMEOUT 60000        // Apagar backlight após 60s sem botões
+#endif
+#ifndef POWER_LATENCY_TARGET_MS
+#define POWER_LATENCY_TARGET_MS 300     // Latência MQTT máxima aceitável (ida e volta)
+#endif
+#ifndef WIFI_LISTEN_INTERVAL
+#define WIFI_LISTEN_INTERVAL 3          // Beacons entre despertares no modem sleep máximo
+#endif
+#ifndef MQTT_TOPIC_CENTRAL_PROBE
+#define MQTT_TOPIC_CENTRAL_PROBE MQTT_TOPIC_PREFIX "/central/probe"
+#endif
+
+enum class PowerState {
+    ACTIVE,   // Usuário no LCD: backlight ligado, CPU no máximo
+    IDLE      // Sem interação: backlight desligado, CPU reduzida
+};
+
+// Níveis de modem sleep (mesma ordem de wifi_ps_type_t)
+enum class ModemSleep {
+    NONE = 0,
+    MIN_MODEM = 1,   // Acorda a cada DTIM
+    MAX_MODEM = 2    // Acorda a cada WIFI_LISTEN_INTERVAL beacons
+};
+
+class PowerManager {
+private:
+    ScreenBacklight* backlight;
+    MQTTClient* mqtt;
+
+    static const uint32_t CPU_ACTIVE_MHZ = 240;
+    static const uint32_t CPU_IDLE_MHZ = 80;              // Mínimo com WiFi ligado
+    static const unsigned long PROBE_INTERVAL = 60000;    // Medir latência a cada 1 min
+    static const unsigned long PROBE_TIMEOUT = 5000;
+    static const int MODEM_LEVELS = 3;
+    static const uint32_t MIN_SAMPLES_TO_RELAX = 3;       // Amostras boas antes de dormir mais
+
+    PowerState state;
+    unsigned long lastActivity;
+    unsigned long stateSince;
+    unsigned long timeInState[2];
+
+    ModemSleep modemSleep;
+    bool wifiReady;
+    unsigned long modemSince;
+    unsigned long timeInModem[MODEM_LEVELS];
+
+    // Medição de latência (publica no próprio tópico e mede o eco do broker)
+    bool probePending;
+    unsigned long probeSentAt;
+    unsigned long lastProbe;
+    uint32_t latencyEma;
+    uint32_t samplesAtLevel;
+    uint32_t latencySamples[MODEM_LEVELS];
+    uint32_t latencySum[MODEM_LEVELS];
+    uint32_t latencyMax[MODEM_LEVELS];
+
+    void enterState(PowerState newState);
+    void applyModemSleep(ModemSleep level);
+    void recordLatency(uint32_t rttMs);
+    void sendProbe();
+
+public:
+    PowerManager(ScreenBacklight* bl, MQTTClient* mq);
+
+    void init();
+    void update();
+
+    // Chamado a cada evento de botão. Retorna true se apenas acordou a tela
+    // (o evento deve ser descartado pela UI).
+    bool notifyActivity();
+
+    // WiFi/MQTT
+    void onWiFiConnected();
+    void onProbeEcho(unsigned long sentAt);
+
+    // Estatísticas
+    PowerState getState() const { return state; }
+    ModemSleep getModemSleep() const { return modemSleep; }
+    unsigned long getTimeInState(PowerState s) const;
+    unsigned long getTimeInModem(ModemSleep level) const;
+    uint32_t getLatencySamples(ModemSleep level) const { return latencySamples[(int)level]; }
+    uint32_t getLatencyAvg(ModemSleep level) const;
+    uint32_t getLatencyMax(ModemSleep level) const { return latencyMax[(int)level]; }
+
+    static const char* stateName(PowerState s);
+    static const char* modemName(ModemSleep level);
+};
@@ -1,14 +1,17 @@
 #pragma once
 #include <Arduino.h>
 #include "config.h"
+#include "comm/CommandRegistry.h"
 
 struct MealSchedule {
     int hour;
     int minute;
     int quantity;  // gramas
     bool enabled;
+    uint8_t channel;  // Reservatório da remota
+    uint8_t days;     // Bit 0 = domingo ... bit 6 = sábado
 
-    MealSchedule() : hour(0), minute(0), quantity(0), enabled(false) {}
+    MealSchedule() : hour(0), minute(0), quantity(0), enabled(false), channel(0), days(CommandTable::ALL_DAYS) {}
 };
 
 struct RemoteState {
@@ -19,8 +22,23 @@ struct RemoteState {
     String feedLevel;  // "OK", "LOW", "EMPTY"
     MealSchedule meals[3];  // Até 3 refeições por dia
 
-    RemoteState() : id(0), name(""), online(false), lastSeen(0), feedLevel("OK") {}
-    RemoteState(int _id) : id(_id), name("Remota " + String(_id)), online(false), lastSeen(0), feedLevel("OK") {}
+    bool active;        // Sinal recebido dentro de REMOTE_TIMEOUT (mantido pelo RemoteManager)
+    uint16_t revision;  // Incrementado a cada mudança visível (invalida caches da UI)
+
+    // Logs offline: journal atual da remota e próximo seq esperado
+    // (tudo abaixo de logNextSeq já foi repassado ao Dashboard)
+    uint32_t logJournalId;
+    uint32_t logNextSeq;
+
+    RemoteState() : id(0), name(""), online(false), lastSeen(0), feedLevel("OK"), active(false), revision(0), logJournalId(0), logNextSeq(0) {}
+    RemoteState(int _id) : id(_id), name("Remota " + String(_id)), online(false), lastSeen(0), feedLevel("OK"), active(false), revision(0), logJournalId(0), logNextSeq(0) {}
+};
+
+// Visões filtradas da lista de remotas
+enum class RemoteFilter {
+    ALL,
+    OFFLINE,
+    LOW_FEED
 };
 
 class RemoteManager {
@@ -28,6 +46,29 @@ private:
     RemoteState remotes[MAX_REMOTAS];
     int remoteCount;
 
+    // Remotas ativas em lista duplamente encadeada ordenada por lastSeen
+    // (mais antiga na cabeça): expirar é O(1) por remota que cai.
+    int16_t activePrev[MAX_REMOTAS];
+    int16_t activeNext[MAX_REMOTAS];
+    int16_t activeHead;
+    int16_t activeTail;
+    int activeCount;
+
+    // Índices ordenados (por índice de remota) das visões filtradas
+    uint16_t offlineIndex[MAX_REMOTAS];
+    int offlineCount;
+    uint16_t lowFeedIndex[MAX_REMOTAS];
+    int lowFeedCount;
+
+    int findIndex(int id);
+    void touch(int index);
+    void expireInactive();
+    void unlinkActive(int index);
+
+    static bool isLowLevel(const String& level);
+    static void indexInsert(uint16_t* index, int& count, int remoteIndex);
+    static void indexRemove(uint16_t* index, int& count, int remoteIndex);
+
 public:
     RemoteManager();
 
@@ -42,11 +83,22 @@ public:
     void updateFeedLevel(int id, const String& level);
     void updateLastSeen(int id);
     bool isRemoteActive(int id);  // Verifica se teve sinal nos últimos 10min
+    bool isRemoteActiveByIndex(int index);
+
+    // Visões filtradas (posição -> índice da remota), sem varrer a lista
+    int getFilteredCount(RemoteFilter filter);
+    int getFilteredIndex(RemoteFilter filter, int position);
 
     // Configuração de refeições
-    bool setMealSchedule(int remoteId, int mealIndex, int hour, int minute, int quantity);
+    bool setMealSchedule(int remoteId, int mealIndex, int hour, int minute, int quantity, uint8_t channel = 0,
+                         uint8_t days = CommandTable::ALL_DAYS);
     MealSchedule* getMealSchedule(int remoteId, int mealIndex);
 
+    // Logs offline: retorna quantos logs do início do lote já foram recebidos
+    // (pular), ou -1 se o lote está fora de ordem. ackSeq = próximo seq esperado
+    int acceptLogBatch(int remoteId, uint32_t journalId, uint32_t tail, uint32_t firstSeq,
+                       int count, uint32_t& ackSeq);
+
     // Contadores
     int getOnlineCount();
     bool hasLowFeed();
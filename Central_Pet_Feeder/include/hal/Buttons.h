@@ -5,12 +5,16 @@ enum class ButtonEvent {
     NONE,
     UP,
     DOWN,
-    OK
+    OK,
+    UP_LONG,    // Repetido enquanto UP estiver pressionado
+    DOWN_LONG   // Repetido enquanto DOWN estiver pressionado
 };
 
 class Buttons {
 private:
     static const unsigned long DEBOUNCE_DELAY = 50;
+    static const unsigned long LONG_PRESS_DELAY = 700;   // Segurar para gerar *_LONG
+    static const unsigned long LONG_PRESS_REPEAT = 300;  // Intervalo de repetição
 
     struct ButtonState {
         int pin;
@@ -18,13 +22,17 @@ private:
         bool currentState;
         unsigned long lastDebounceTime;
         bool pressed;
+        bool repeatable;
+        unsigned long pressedSince;
+        unsigned long lastRepeat;
+        bool longPressed;
     };
 
     ButtonState btnUp;
     ButtonState btnDown;
     ButtonState btnOk;
 
-    void initButton(ButtonState& btn, int pin);
+    void initButton(ButtonState& btn, int pin, bool repeatable);
     bool updateButton(ButtonState& btn);
 
 public:
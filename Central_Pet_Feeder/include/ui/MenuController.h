@@ -27,9 +27,24 @@ private:
     int editField;  // 0 = hora, 1 = minuto
     bool isEditing;
 
+    // Lista de remotas paginada: opção 0 = filtro, 1..N = remotas, N+1 = Voltar
+    static const int LIST_ROWS = 3;
+
+    struct ListRowCache {
+        int remoteIndex;    // -1 = linha vazia
+        uint16_t revision;  // RemoteState::revision quando o texto foi formatado
+        String text;
+    };
+
+    RemoteFilter listFilter;
+    ListRowCache listCache[LIST_ROWS];
+
     // Callback para enviar configuração via MQTT
     void (*onMealConfigCallback)(int remoteId, int mealIndex, int hour, int minute, int quantity);
 
+    // Callback de atividade do usuário (retorna true para descartar o evento)
+    bool (*onActivityCallback)();
+
     // Métodos de renderização por estado
     void renderStatusGateway();
     void renderRemoteList();
@@ -46,6 +61,9 @@ private:
 
     // Utilidades
     String formatTime(int hour, int minute);
+    int getRemoteListOptions();
+    const String& getRemoteRowText(int row, int remoteIndex);
+    const char* getFilterLabel(RemoteFilter filter);
     void changeState(MenuState newState);
 
 public:
@@ -55,4 +73,5 @@ public:
     void update();
 
     void setMealConfigCallback(void (*callback)(int, int, int, int, int));
+    void setActivityCallback(bool (*callback)());
 };
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "comm/PayloadBuilder.h"
+#include "comm/CommandRegistry.h"
 
 String PayloadBuilder::buildCommand(const String& command, int value) {
     JsonDocument doc;
@@ -13,10 +14,12 @@ String PayloadBuilder::buildCommand(const String& command, int value) {
     return output;
 }
 
-String PayloadBuilder::buildFeedCommand(int quantity) {
+String PayloadBuilder::buildFeedCommand(int quantity, uint8_t channel) {
+    FeedArgs args = {};
+    args.quantity = quantity;
+    args.channel = channel;
     JsonDocument doc;
-    doc["cmd"] = "FEED";
-    doc["quantity"] = quantity;
+    CommandRegistry::encode(args, doc);
     doc["timestamp"] = millis();
 
     String output;
@@ -24,13 +27,18 @@ String PayloadBuilder::buildFeedCommand(int quantity) {
     return output;
 }
 
-String PayloadBuilder::buildMealConfig(int mealIndex, int hour, int minute, int quantity) {
+String PayloadBuilder::buildMealConfig(int mealIndex, int hour, int minute, int quantity, uint8_t channel,
+                                       uint8_t days) {
+    MealConfigArgs args = {};
+    args.meal = mealIndex;
+    args.hour = hour;
+    args.minute = minute;
+    args.quantity = quantity;
+    args.days = days;
+    args.channel = channel;
+
     JsonDocument doc;
-    doc["cmd"] = "CONFIG_MEAL";
-    doc["meal"] = mealIndex;
-    doc["hour"] = hour;
-    doc["minute"] = minute;
-    doc["quantity"] = quantity;
+    CommandRegistry::encode(args, doc);
     doc["timestamp"] = millis();
 
     String output;
@@ -38,6 +46,16 @@ String PayloadBuilder::buildMealConfig(int mealIndex, int hour, int minute, int
     return output;
 }
 
+String PayloadBuilder::buildLogAck(uint32_t journalId, uint32_t seq) {
+    LogAckArgs args = { journalId, seq };  // Todos os logs com seq menor foram recebidos
+    JsonDocument doc;
+    CommandRegistry::encode(args, doc);
+
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
 String PayloadBuilder::buildCentralStatus(bool online, int remotesOnline, int remotesTotal) {
     JsonDocument doc;
     doc["status"] = online ? "ONLINE" : "OFFLINE";
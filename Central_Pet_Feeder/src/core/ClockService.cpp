@@ -1,103 +1,219 @@
 #include "core/ClockService.h"
 #include "config.h"
+#include <sys/time.h>
+#include <esp_timer.h>
+#include <esp_sntp.h>
+
+ClockService* ClockService::instance = nullptr;
+volatile bool ClockService::syncPending = false;
 
 ClockService::ClockService()
     : initialized(false),
       lastNTPUpdate(0),
-      currentHour(0), currentMinute(0), currentSecond(0),
-      currentDay(1), currentMonth(1), currentYear(2025) {
+      baseMicros(0), monoBase(0),
+      tzOffset(NTP_TIMEZONE_OFFSET * 3600 + NTP_DAYLIGHT_OFFSET),
+      slewMicros(0), driftPpb(0), residualPpb(0), lastCorrectionMs(0),
+      timeToReady(0), resyncInterval(NTP_UPDATE_INTERVAL),
+      cachedEpochDay(-1),
+      cachedDay(1), cachedMonth(1), cachedYear(2025) {
+    instance = this;
+}
+
+// Chamado pela tarefa do SNTP: apenas sinaliza, o update() aplica
+void ClockService::onSNTPSync(struct timeval* tv) {
+    syncPending = true;
 }
 
 bool ClockService::init() {
     Serial.println("[ClockService] Inicializando NTP...");
 
-    // Configurar NTP
+    // Registrar callback antes de iniciar o SNTP para não perder a 1ª sincronização
+    sntp_set_time_sync_notification_cb(onSNTPSync);
+
+    // Configurar NTP (a sincronização acontece em segundo plano)
     configTime(NTP_TIMEZONE_OFFSET * 3600, NTP_DAYLIGHT_OFFSET, NTP_SERVER);
+    sntp_set_sync_interval(resyncInterval);
 
-    Serial.println("[ClockService] Aguardando sincronização NTP...");
+    Serial.println("[ClockService] SNTP iniciado, sincronização em segundo plano");
+    return true;
+}
 
-    // Aguardar até 10 segundos para sincronização
-    int attempts = 0;
-    struct tm timeinfo;
-    while (!getLocalTime(&timeinfo) && attempts < 20) {
-        delay(500);
-        Serial.print(".");
-        attempts++;
+void ClockService::applySync() {
+    // Única leitura da libc: só acontece quando o SNTP sincroniza
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    int64_t mono = esp_timer_get_time();
+    int64_t ntpMicros = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+
+    if (!initialized) {
+        baseMicros = ntpMicros;
+        monoBase = mono;
+        slewMicros = 0;
+        initialized = true;
+        timeToReady = millis();
+        lastNTPUpdate = millis();
+        cachedEpochDay = -1;
+
+        Serial.printf("[ClockService] NTP sincronizado em %lums: %s %s\n",
+                      timeToReady, getDateFormatted().c_str(), getTimeFormatted().c_str());
+        return;
     }
-    Serial.println();
 
-    if (attempts >= 20) {
-        Serial.println("[ClockService] AVISO: Timeout na sincronização NTP, usando horário local");
-        initialized = false;
-        return false;
+    int64_t predicted = microsAt(mono);
+    int64_t offset = ntpMicros - predicted;
+    int64_t elapsed = mono - monoBase;
+
+    // Parte do erro que não vem do slew ainda pendente = drift do cristal
+    int64_t maxSlew = elapsed * SLEW_RATE_PPM / 1000000;
+    int64_t applied = (slewMicros > 0) ? min(slewMicros, maxSlew) : max(slewMicros, -maxSlew);
+    int64_t driftError = offset - (slewMicros - applied);
+
+    if (elapsed >= MIN_DRIFT_WINDOW_US) {
+        residualPpb = (int32_t)(driftError * 1000000000LL / elapsed);
+        driftPpb = constrain(driftPpb + residualPpb / 2, -MAX_DRIFT_PPB, MAX_DRIFT_PPB);
+
+        // Intervalo para o erro residual chegar a MAX_ERROR_US
+        int64_t absResidual = residualPpb < 0 ? -(int64_t)residualPpb : residualPpb;
+        int64_t interval = absResidual > 0
+            ? MAX_ERROR_US * 1000000LL / absResidual   // ms
+            : (int64_t)MAX_RESYNC_INTERVAL;
+        resyncInterval = (unsigned long)constrain(interval, (int64_t)MIN_RESYNC_INTERVAL, (int64_t)MAX_RESYNC_INTERVAL);
+        sntp_set_sync_interval(resyncInterval);
     }
 
-    initialized = true;
+    lastCorrectionMs = (int32_t)(offset / 1000);
+
+    int64_t absOffset = offset < 0 ? -offset : offset;
+    if (absOffset > STEP_THRESHOLD_US) {
+        // Erro grande demais para slew: saltar
+        baseMicros = ntpMicros;
+        slewMicros = 0;
+        cachedEpochDay = -1;
+        Serial.printf("[ClockService] ⚠️ Correção em salto: %ldms\n", (long)lastCorrectionMs);
+    } else {
+        // Continuar do tempo atual e absorver o erro aos poucos
+        baseMicros = predicted;
+        slewMicros = offset;
+    }
+    monoBase = mono;
     lastNTPUpdate = millis();
-    update();  // Primeira leitura
 
-    Serial.printf("[ClockService] NTP sincronizado: %s %s\n",
-                  getDateFormatted().c_str(), getTimeFormatted().c_str());
-    return true;
+    Serial.printf("[ClockService] NTP ressincronizado: correção %ldms, drift %.1fppm, próxima em %lumin\n",
+                  (long)lastCorrectionMs, getDriftPpm(), resyncInterval / 60000);
 }
 
 void ClockService::syncWithNTP() {
+    // Sem sincronização dentro do intervalo: pedir uma nova ao SNTP (não bloqueia)
     Serial.println("[ClockService] Ressincronizando com NTP...");
-    struct tm timeinfo;
-    if (getLocalTime(&timeinfo)) {
-        lastNTPUpdate = millis();
-        Serial.println("[ClockService] NTP ressincronizado com sucesso");
-    } else {
-        Serial.println("[ClockService] Falha ao ressincronizar NTP");
-    }
+    sntp_restart();
+    lastNTPUpdate = millis();
 }
 
 void ClockService::update() {
-    struct tm timeinfo;
-    if (!getLocalTime(&timeinfo)) {
-        // Se não conseguir obter o horário, manter valores anteriores
-        if (!initialized) {
-            // Usar valores padrão se nunca foi inicializado
-            return;
-        }
-        return;
+    if (syncPending) {
+        syncPending = false;
+        applySync();
     }
 
-    currentHour = timeinfo.tm_hour;
-    currentMinute = timeinfo.tm_min;
-    currentSecond = timeinfo.tm_sec;
-    currentDay = timeinfo.tm_mday;
-    currentMonth = timeinfo.tm_mon + 1;  // tm_mon é 0-11
-    currentYear = timeinfo.tm_year + 1900;  // tm_year é anos desde 1900
-
     // Ressincronizar periodicamente com NTP
-    if (initialized && (millis() - lastNTPUpdate >= NTP_UPDATE_INTERVAL)) {
+    if (initialized && (millis() - lastNTPUpdate >= resyncInterval)) {
         syncWithNTP();
     }
 }
 
+// ========== LEITURAS (O(1), SEM LIBC) ==========
+
+int64_t ClockService::microsAt(int64_t mono) const {
+    int64_t elapsed = mono - monoBase;
+    int64_t us = baseMicros + elapsed + elapsed * driftPpb / 1000000000LL;
+
+    // Slew limitado a SLEW_RATE_PPM: o tempo continua monotônico
+    if (slewMicros != 0) {
+        int64_t maxSlew = elapsed * SLEW_RATE_PPM / 1000000;
+        us += (slewMicros > 0) ? min(slewMicros, maxSlew) : max(slewMicros, -maxSlew);
+    }
+    return us;
+}
+
+int64_t ClockService::localSeconds() const {
+    return microsAt(esp_timer_get_time()) / 1000000 + tzOffset;
+}
+
+int ClockService::getHour() const {
+    if (!initialized) return 0;
+    return (int)((localSeconds() % 86400) / 3600);
+}
+
+int ClockService::getMinute() const {
+    if (!initialized) return 0;
+    return (int)((localSeconds() % 3600) / 60);
+}
+
+int ClockService::getSecond() const {
+    if (!initialized) return 0;
+    return (int)(localSeconds() % 60);
+}
+
+int ClockService::getDay() const {
+    refreshDate();
+    return cachedDay;
+}
+
+int ClockService::getMonth() const {
+    refreshDate();
+    return cachedMonth;
+}
+
+int ClockService::getYear() const {
+    refreshDate();
+    return cachedYear;
+}
+
+void ClockService::refreshDate() const {
+    if (!initialized) return;
+
+    int32_t epochDay = (int32_t)(localSeconds() / 86400);
+    if (epochDay == cachedEpochDay) return;
+
+    cachedEpochDay = epochDay;
+    civilFromDays(epochDay, cachedYear, cachedMonth, cachedDay);
+}
+
+// Dias desde 1970-01-01 -> data civil (algoritmo de H. Hinnant)
+void ClockService::civilFromDays(int32_t days, int& year, int& month, int& day) {
+    days += 719468;
+    int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+    uint32_t doe = (uint32_t)(days - era * 146097);
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+
+    day = (int)(doy - (153 * mp + 2) / 5 + 1);
+    month = (int)(mp < 10 ? mp + 3 : mp - 9);
+    year = (int)(yoe + era * 400 + (month <= 2 ? 1 : 0));
+}
+
 String ClockService::getTimeFormatted() {
     char buffer[9];
-    snprintf(buffer, sizeof(buffer), "%02d:%02d:%02d", currentHour, currentMinute, currentSecond);
+    snprintf(buffer, sizeof(buffer), "%02d:%02d:%02d", getHour(), getMinute(), getSecond());
     return String(buffer);
 }
 
 String ClockService::getDateFormatted() {
     char buffer[11];
-    snprintf(buffer, sizeof(buffer), "%02d/%02d/%04d", currentDay, currentMonth, currentYear);
+    snprintf(buffer, sizeof(buffer), "%02d/%02d/%04d", getDay(), getMonth(), getYear());
     return String(buffer);
 }
 
 String ClockService::getTimeShort() {
     char buffer[6];
-    snprintf(buffer, sizeof(buffer), "%02d:%02d", currentHour, currentMinute);
+    snprintf(buffer, sizeof(buffer), "%02d:%02d", getHour(), getMinute());
     return String(buffer);
 }
 
 unsigned long ClockService::getTimestamp() const {
-    struct tm timeinfo;
-    if (!getLocalTime(&timeinfo)) {
+    if (!initialized) {
         return 0;
     }
-    return mktime(&timeinfo);
+    return (unsigned long)(microsAt(esp_timer_get_time()) / 1000000);
 }
@@ -89,6 +89,12 @@ bool ConfigManager::saveRemoteConfig(int remoteId) {
 
         snprintf(key, sizeof(key), "r%d_m%d_e", remoteId, i);
         prefs.putBool(key, remote->meals[i].enabled);
+
+        snprintf(key, sizeof(key), "r%d_m%d_c", remoteId, i);
+        prefs.putUChar(key, remote->meals[i].channel);
+
+        snprintf(key, sizeof(key), "r%d_m%d_d", remoteId, i);
+        prefs.putUChar(key, remote->meals[i].days);
     }
 
     Serial.printf("[ConfigManager] Configuração da Remota %d salva\n", remoteId);
@@ -117,6 +123,13 @@ bool ConfigManager::loadRemoteConfig(int remoteId) {
 
         snprintf(key, sizeof(key), "r%d_m%d_e", remoteId, i);
         remote->meals[i].enabled = prefs.getBool(key, false);
+
+        snprintf(key, sizeof(key), "r%d_m%d_c", remoteId, i);
+        remote->meals[i].channel = prefs.getUChar(key, 0);
+
+        // Configuração salva antes dos dias da semana: todos os dias
+        snprintf(key, sizeof(key), "r%d_m%d_d", remoteId, i);
+        remote->meals[i].days = prefs.getUChar(key, CommandTable::ALL_DAYS);
     }
 
     Serial.printf("[ConfigManager] Configuração da Remota %d carregada\n", remoteId);
@@ -0,0 +1,186 @@
+#include "core/PowerManager.h"
+#include <WiFi.h>
+#include <esp_wifi.h>
+
+PowerManager::PowerManager(ScreenBacklight* bl, MQTTClient* mq)
+    : backlight(bl), mqtt(mq),
+      state(PowerState::ACTIVE), lastActivity(0), stateSince(0),
+      modemSleep(ModemSleep::NONE), wifiReady(false), modemSince(0),
+      probePending(false), probeSentAt(0), lastProbe(0),
+      latencyEma(0), samplesAtLevel(0) {
+    timeInState[0] = timeInState[1] = 0;
+    for (int i = 0; i < MODEM_LEVELS; i++) {
+        timeInModem[i] = 0;
+        latencySamples[i] = 0;
+        latencySum[i] = 0;
+        latencyMax[i] = 0;
+    }
+}
+
+void PowerManager::init() {
+    unsigned long now = millis();
+    lastActivity = now;
+    stateSince = now;
+    modemSince = now;
+
+    setCpuFrequencyMhz(CPU_ACTIVE_MHZ);
+    if (backlight) backlight->on();
+    state = PowerState::ACTIVE;
+
+    Serial.printf("[PowerManager] Inicializado (apagar tela após %lus, alvo de latência %dms)\n",
+                  (unsigned long)(POWER_IDLE_TIMEOUT / 1000), POWER_LATENCY_TARGET_MS);
+}
+
+// ========== UI ==========
+
+bool PowerManager::notifyActivity() {
+    lastActivity = millis();
+
+    if (state == PowerState::IDLE) {
+        enterState(PowerState::ACTIVE);
+        return true;  // Primeiro toque só acende a tela
+    }
+    return false;
+}
+
+void PowerManager::enterState(PowerState newState) {
+    if (newState == state) return;
+
+    unsigned long now = millis();
+    timeInState[(int)state] += now - stateSince;
+    stateSince = now;
+    state = newState;
+
+    if (state == PowerState::ACTIVE) {
+        setCpuFrequencyMhz(CPU_ACTIVE_MHZ);
+        if (backlight) backlight->on();
+    } else {
+        if (backlight) backlight->off();
+        setCpuFrequencyMhz(CPU_IDLE_MHZ);
+    }
+
+    Serial.printf("[PowerManager] Estado: %s (CPU %luMHz)\n",
+                  stateName(state), (unsigned long)getCpuFrequencyMhz());
+}
+
+void PowerManager::update() {
+    unsigned long now = millis();
+
+    if (state == PowerState::ACTIVE && (now - lastActivity) >= POWER_IDLE_TIMEOUT) {
+        enterState(PowerState::IDLE);
+    }
+
+    if (!wifiReady || !mqtt || !mqtt->isConnected()) return;
+
+    // Eco não chegou: contar como latência máxima
+    if (probePending && (now - probeSentAt) >= PROBE_TIMEOUT) {
+        probePending = false;
+        Serial.println("[PowerManager] ⚠️ Sonda de latência sem resposta");
+        recordLatency(PROBE_TIMEOUT);
+    }
+
+    if (!probePending && (now - lastProbe) >= PROBE_INTERVAL) {
+        sendProbe();
+    }
+}
+
+// ========== WIFI / LATÊNCIA ==========
+
+void PowerManager::onWiFiConnected() {
+    // O listen interval só vale a partir da próxima associação com o AP
+    wifi_config_t conf;
+    if (esp_wifi_get_config(WIFI_IF_STA, &conf) == ESP_OK &&
+        conf.sta.listen_interval != WIFI_LISTEN_INTERVAL) {
+        conf.sta.listen_interval = WIFI_LISTEN_INTERVAL;
+        esp_wifi_set_config(WIFI_IF_STA, &conf);
+    }
+
+    wifiReady = true;
+    applyModemSleep(ModemSleep::MIN_MODEM);
+}
+
+void PowerManager::applyModemSleep(ModemSleep level) {
+    unsigned long now = millis();
+    timeInModem[(int)modemSleep] += now - modemSince;
+    modemSince = now;
+
+    modemSleep = level;
+    samplesAtLevel = 0;
+    latencyEma = 0;
+    esp_wifi_set_ps((wifi_ps_type_t)level);
+
+    Serial.printf("[PowerManager] Modem sleep: %s\n", modemName(level));
+}
+
+void PowerManager::sendProbe() {
+    unsigned long now = millis();
+    lastProbe = now;
+
+    String payload = "{\"t\":" + String(now) + "}";
+    if (mqtt->publish(MQTT_TOPIC_CENTRAL_PROBE, payload)) {
+        probePending = true;
+        probeSentAt = now;
+    }
+}
+
+void PowerManager::onProbeEcho(unsigned long sentAt) {
+    // Ignorar ecos atrasados de sondas que já expiraram
+    if (!probePending || sentAt != probeSentAt) return;
+
+    probePending = false;
+    recordLatency(millis() - sentAt);
+}
+
+void PowerManager::recordLatency(uint32_t rttMs) {
+    int level = (int)modemSleep;
+    latencySamples[level]++;
+    latencySum[level] += rttMs;
+    if (rttMs > latencyMax[level]) latencyMax[level] = rttMs;
+
+    latencyEma = (samplesAtLevel == 0) ? rttMs : (latencyEma * 3 + rttMs) / 4;
+    samplesAtLevel++;
+
+    Serial.printf("[PowerManager] Latência MQTT: %lums (média %lums, %s)\n",
+                  (unsigned long)rttMs, (unsigned long)latencyEma, modemName(modemSleep));
+
+    // Acima do alvo: dormir menos. Bem abaixo do alvo por um tempo: dormir mais.
+    if (latencyEma > POWER_LATENCY_TARGET_MS && modemSleep != ModemSleep::NONE) {
+        applyModemSleep((ModemSleep)(level - 1));
+    } else if (latencyEma < POWER_LATENCY_TARGET_MS / 2 &&
+               samplesAtLevel >= MIN_SAMPLES_TO_RELAX &&
+               modemSleep != ModemSleep::MAX_MODEM) {
+        applyModemSleep((ModemSleep)(level + 1));
+    }
+}
+
+// ========== ESTATÍSTICAS ==========
+
+unsigned long PowerManager::getTimeInState(PowerState s) const {
+    unsigned long total = timeInState[(int)s];
+    if (s == state) total += millis() - stateSince;
+    return total;
+}
+
+unsigned long PowerManager::getTimeInModem(ModemSleep level) const {
+    unsigned long total = timeInModem[(int)level];
+    if (level == modemSleep) total += millis() - modemSince;
+    return total;
+}
+
+uint32_t PowerManager::getLatencyAvg(ModemSleep level) const {
+    int i = (int)level;
+    return latencySamples[i] > 0 ? latencySum[i] / latencySamples[i] : 0;
+}
+
+const char* PowerManager::stateName(PowerState s) {
+    return s == PowerState::ACTIVE ? "ACTIVE" : "IDLE";
+}
+
+const char* PowerManager::modemName(ModemSleep level) {
+    switch (level) {
+        case ModemSleep::MIN_MODEM: return "MIN_MODEM";
+        case ModemSleep::MAX_MODEM: return "MAX_MODEM";
+        case ModemSleep::NONE:
+        default:                    return "NONE";
+    }
+}
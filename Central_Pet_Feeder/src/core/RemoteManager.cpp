@@ -1,9 +1,13 @@
 #include "core/RemoteManager.h"
 
-RemoteManager::RemoteManager() : remoteCount(0) {
+RemoteManager::RemoteManager()
+    : remoteCount(0), activeHead(-1), activeTail(-1), activeCount(0),
+      offlineCount(0), lowFeedCount(0) {
     // Inicializar array
     for (int i = 0; i < MAX_REMOTAS; i++) {
         remotes[i] = RemoteState();
+        activePrev[i] = -1;
+        activeNext[i] = -1;
     }
 }
 
@@ -22,17 +26,23 @@ void RemoteManager::addRemote(int id) {
     }
 
     remotes[remoteCount] = RemoteState(id);
+    indexInsert(offlineIndex, offlineCount, remoteCount);  // Sem sinal até a primeira mensagem
     remoteCount++;
     Serial.printf("[RemoteManager] Remota %d adicionada (%d/%d)\n", id, remoteCount, MAX_REMOTAS);
 }
 
-RemoteState* RemoteManager::getRemote(int id) {
+int RemoteManager::findIndex(int id) {
     for (int i = 0; i < remoteCount; i++) {
         if (remotes[i].id == id) {
-            return &remotes[i];
+            return i;
         }
     }
-    return nullptr;
+    return -1;
+}
+
+RemoteState* RemoteManager::getRemote(int id) {
+    int index = findIndex(id);
+    return index >= 0 ? &remotes[index] : nullptr;
 }
 
 RemoteState* RemoteManager::getRemoteByIndex(int index) {
@@ -43,40 +53,172 @@ RemoteState* RemoteManager::getRemoteByIndex(int index) {
 }
 
 void RemoteManager::updateRemoteStatus(int id, bool online) {
-    RemoteState* remote = getRemote(id);
-    if (remote) {
+    int index = findIndex(id);
+    if (index < 0) return;
+
+    RemoteState* remote = &remotes[index];
+    if (remote->online != online) {
         remote->online = online;
-        if (online) {
-            remote->lastSeen = millis();
-        }
-        Serial.printf("[RemoteManager] Remota %d: %s\n", id, online ? "ONLINE" : "OFFLINE");
+        remote->revision++;
     }
+    if (online) {
+        touch(index);
+    }
+    Serial.printf("[RemoteManager] Remota %d: %s\n", id, online ? "ONLINE" : "OFFLINE");
 }
 
 void RemoteManager::updateFeedLevel(int id, const String& level) {
-    RemoteState* remote = getRemote(id);
-    if (remote) {
-        remote->feedLevel = level;
-        Serial.printf("[RemoteManager] Remota %d: Nível de ração = %s\n", id, level.c_str());
+    int index = findIndex(id);
+    if (index < 0) return;
+
+    RemoteState* remote = &remotes[index];
+    if (remote->feedLevel == level) return;
+
+    bool wasLow = isLowLevel(remote->feedLevel);
+    bool isLow = isLowLevel(level);
+    if (isLow && !wasLow) {
+        indexInsert(lowFeedIndex, lowFeedCount, index);
+    } else if (!isLow && wasLow) {
+        indexRemove(lowFeedIndex, lowFeedCount, index);
     }
+
+    remote->feedLevel = level;
+    remote->revision++;
+    Serial.printf("[RemoteManager] Remota %d: Nível de ração = %s\n", id, level.c_str());
 }
 
 void RemoteManager::updateLastSeen(int id) {
-    RemoteState* remote = getRemote(id);
-    if (remote) {
-        remote->lastSeen = millis();
+    int index = findIndex(id);
+    if (index >= 0) {
+        touch(index);
     }
 }
 
 bool RemoteManager::isRemoteActive(int id) {
-    RemoteState* remote = getRemote(id);
-    if (!remote) return false;
+    return isRemoteActiveByIndex(findIndex(id));
+}
 
+bool RemoteManager::isRemoteActiveByIndex(int index) {
+    if (index < 0 || index >= remoteCount) return false;
+
+    expireInactive();
+    return remotes[index].active;
+}
+
+// ========== Índices incrementais ==========
+
+void RemoteManager::touch(int index) {
+    RemoteState* remote = &remotes[index];
+    remote->lastSeen = millis();
+
+    if (remote->active) {
+        // Já ativa: mover para o fim da lista (mais recente)
+        unlinkActive(index);
+    } else {
+        remote->active = true;
+        remote->revision++;
+        activeCount++;
+        indexRemove(offlineIndex, offlineCount, index);
+    }
+
+    activePrev[index] = activeTail;
+    activeNext[index] = -1;
+    if (activeTail >= 0) {
+        activeNext[activeTail] = index;
+    } else {
+        activeHead = index;
+    }
+    activeTail = index;
+}
+
+void RemoteManager::unlinkActive(int index) {
+    int16_t prev = activePrev[index];
+    int16_t next = activeNext[index];
+
+    if (prev >= 0) activeNext[prev] = next; else activeHead = next;
+    if (next >= 0) activePrev[next] = prev; else activeTail = prev;
+
+    activePrev[index] = -1;
+    activeNext[index] = -1;
+}
+
+void RemoteManager::expireInactive() {
     unsigned long now = millis();
-    return (remote->lastSeen > 0 && (now - remote->lastSeen) < REMOTE_TIMEOUT);
+
+    // A cabeça é sempre a remota com sinal mais antigo
+    while (activeHead >= 0 && (now - remotes[activeHead].lastSeen) >= REMOTE_TIMEOUT) {
+        int index = activeHead;
+        unlinkActive(index);
+
+        remotes[index].active = false;
+        remotes[index].revision++;
+        activeCount--;
+        indexInsert(offlineIndex, offlineCount, index);
+    }
+}
+
+bool RemoteManager::isLowLevel(const String& level) {
+    return level == "LOW" || level == "EMPTY";
+}
+
+void RemoteManager::indexInsert(uint16_t* index, int& count, int remoteIndex) {
+    // Busca binária da posição de inserção
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (index[mid] < remoteIndex) lo = mid + 1; else hi = mid;
+    }
+    if (lo < count && index[lo] == remoteIndex) return;
+
+    memmove(&index[lo + 1], &index[lo], (count - lo) * sizeof(uint16_t));
+    index[lo] = remoteIndex;
+    count++;
 }
 
-bool RemoteManager::setMealSchedule(int remoteId, int mealIndex, int hour, int minute, int quantity) {
+void RemoteManager::indexRemove(uint16_t* index, int& count, int remoteIndex) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (index[mid] < remoteIndex) lo = mid + 1; else hi = mid;
+    }
+    if (lo >= count || index[lo] != remoteIndex) return;
+
+    memmove(&index[lo], &index[lo + 1], (count - lo - 1) * sizeof(uint16_t));
+    count--;
+}
+
+int RemoteManager::getFilteredCount(RemoteFilter filter) {
+    switch (filter) {
+        case RemoteFilter::OFFLINE:
+            expireInactive();
+            return offlineCount;
+        case RemoteFilter::LOW_FEED:
+            return lowFeedCount;
+        case RemoteFilter::ALL:
+        default:
+            return remoteCount;
+    }
+}
+
+int RemoteManager::getFilteredIndex(RemoteFilter filter, int position) {
+    if (position < 0) return -1;
+
+    switch (filter) {
+        case RemoteFilter::OFFLINE:
+            expireInactive();
+            return position < offlineCount ? offlineIndex[position] : -1;
+        case RemoteFilter::LOW_FEED:
+            return position < lowFeedCount ? lowFeedIndex[position] : -1;
+        case RemoteFilter::ALL:
+        default:
+            return position < remoteCount ? position : -1;
+    }
+}
+
+// ========== Refeições ==========
+
+bool RemoteManager::setMealSchedule(int remoteId, int mealIndex, int hour, int minute, int quantity,
+                                    uint8_t channel, uint8_t days) {
     if (mealIndex < 0 || mealIndex >= 3) {
         Serial.println("[RemoteManager] Índice de refeição inválido!");
         return false;
@@ -92,9 +234,11 @@ bool RemoteManager::setMealSchedule(int remoteId, int mealIndex, int hour, int m
     remote->meals[mealIndex].minute = minute;
     remote->meals[mealIndex].quantity = quantity;
     remote->meals[mealIndex].enabled = (quantity > 0);
+    remote->meals[mealIndex].channel = channel;
+    remote->meals[mealIndex].days = days;
 
-    Serial.printf("[RemoteManager] Refeição configurada: Remota %d, R%d = %02d:%02d (%dg)\n",
-                  remoteId, mealIndex + 1, hour, minute, quantity);
+    Serial.printf("[RemoteManager] Refeição configurada: Remota %d, R%d = %02d:%02d (%dg, dias 0x%02X)\n",
+                  remoteId, mealIndex + 1, hour, minute, quantity, days);
     return true;
 }
 
@@ -107,21 +251,52 @@ MealSchedule* RemoteManager::getMealSchedule(int remoteId, int mealIndex) {
     return &remote->meals[mealIndex];
 }
 
-int RemoteManager::getOnlineCount() {
-    int count = 0;
-    for (int i = 0; i < remoteCount; i++) {
-        if (isRemoteActive(remotes[i].id)) {
-            count++;
-        }
+// ========== Logs offline ==========
+
+int RemoteManager::acceptLogBatch(int remoteId, uint32_t journalId, uint32_t tail, uint32_t firstSeq,
+                                  int count, uint32_t& ackSeq) {
+    RemoteState* remote = getRemote(remoteId);
+    if (!remote) {
+        // Remota não cadastrada: repassa tudo, sem deduplicar
+        ackSeq = firstSeq + count;
+        return 0;
+    }
+
+    // Journal novo na remota (ou central reiniciada): recomeça do tail dela
+    if (remote->logJournalId != journalId) {
+        Serial.printf("[RemoteManager] Remota %d: journal de logs %lu (seq %lu)\n",
+                      remoteId, (unsigned long)journalId, (unsigned long)tail);
+        remote->logJournalId = journalId;
+        remote->logNextSeq = tail;
+    }
+
+    // A remota já descartou logs abaixo do tail (buffer cheio): não há o que esperar
+    if ((int32_t)(tail - remote->logNextSeq) > 0) {
+        remote->logNextSeq = tail;
     }
-    return count;
+
+    ackSeq = remote->logNextSeq;
+
+    int32_t skip = (int32_t)(remote->logNextSeq - firstSeq);
+    if (skip < 0) {
+        Serial.printf("[RemoteManager] Remota %d: lote fora de ordem (seq %lu, esperado %lu)\n",
+                      remoteId, (unsigned long)firstSeq, (unsigned long)remote->logNextSeq);
+        return -1;
+    }
+
+    if (skip < count) {
+        remote->logNextSeq = firstSeq + count;
+        ackSeq = remote->logNextSeq;
+    }
+
+    return skip < count ? skip : count;
+}
+
+int RemoteManager::getOnlineCount() {
+    expireInactive();
+    return activeCount;
 }
 
 bool RemoteManager::hasLowFeed() {
-    for (int i = 0; i < remoteCount; i++) {
-        if (remotes[i].feedLevel == "LOW" || remotes[i].feedLevel == "EMPTY") {
-            return true;
-        }
-    }
-    return false;
+    return lowFeedCount > 0;
 }
@@ -4,12 +4,16 @@
 Buttons::Buttons() {
 }
 
-void Buttons::initButton(ButtonState& btn, int pin) {
+void Buttons::initButton(ButtonState& btn, int pin, bool repeatable) {
     btn.pin = pin;
     btn.lastState = HIGH;
     btn.currentState = HIGH;
     btn.lastDebounceTime = 0;
     btn.pressed = false;
+    btn.repeatable = repeatable;
+    btn.pressedSince = 0;
+    btn.lastRepeat = 0;
+    btn.longPressed = false;
 
     pinMode(pin, INPUT_PULLUP);
 }
@@ -17,9 +21,9 @@ void Buttons::initButton(ButtonState& btn, int pin) {
 void Buttons::init() {
     Serial.println("[Buttons] Inicializando botões...");
 
-    initButton(btnUp, BTN_UP_PIN);
-    initButton(btnDown, BTN_DOWN_PIN);
-    initButton(btnOk, BTN_OK_PIN);
+    initButton(btnUp, BTN_UP_PIN, true);
+    initButton(btnDown, BTN_DOWN_PIN, true);
+    initButton(btnOk, BTN_OK_PIN, false);
 
     Serial.println("[Buttons] Botões inicializados (UP, DOWN, OK)");
 }
@@ -42,13 +46,27 @@ bool Buttons::updateButton(ButtonState& btn) {
             // Detectar pressionamento (transição HIGH → LOW)
             if (btn.currentState == LOW) {
                 btn.pressed = true;
+                btn.pressedSince = millis();
+                btn.lastRepeat = btn.pressedSince;
                 eventDetected = true;
             } else {
                 btn.pressed = false;
+                btn.longPressed = false;
             }
         }
     }
 
+    // Pressionamento longo: repete enquanto o botão estiver segurado
+    if (btn.repeatable && btn.currentState == LOW) {
+        unsigned long now = millis();
+        if ((now - btn.pressedSince) >= LONG_PRESS_DELAY &&
+            (now - btn.lastRepeat) >= LONG_PRESS_REPEAT) {
+            btn.lastRepeat = now;
+            btn.longPressed = true;
+            eventDetected = true;
+        }
+    }
+
     btn.lastState = reading;
     return eventDetected;
 }
@@ -62,6 +80,14 @@ void Buttons::update() {
 ButtonEvent Buttons::getEvent() {
     update();
 
+    if (btnUp.longPressed) {
+        btnUp.longPressed = false;
+        return ButtonEvent::UP_LONG;
+    }
+    if (btnDown.longPressed) {
+        btnDown.longPressed = false;
+        return ButtonEvent::DOWN_LONG;
+    }
     if (btnUp.pressed) {
         btnUp.pressed = false;
         return ButtonEvent::UP;
@@ -1,5 +1,6 @@
 #include <Arduino.h>
 #include <WiFi.h>
+#include <mbedtls/base64.h>
 #include "config.h"
 #include "mqtt_cert.h"  // Certificado TLS do Mosquitto
 
@@ -7,10 +8,13 @@
 #include "core/RemoteManager.h"
 #include "core/ClockService.h"
 #include "core/ConfigManager.h"
+#include "core/PowerManager.h"
+#include "core/FeedLogCodec.h"
 
 // Communication
 #include "comm/MQTTClient.h"
 #include "comm/PayloadBuilder.h"
+#include "comm/CommandRegistry.h"
 
 // UI
 #include "ui/LCDRenderer.h"
@@ -36,6 +40,9 @@ Buttons buttons;
 MenuController menuController(&lcdRenderer, &remoteManager, &clockService, &buttons);
 ScreenBacklight screenBacklight(lcdRenderer.getLCD());
 
+// Energia
+PowerManager powerManager(&screenBacklight, &mqttClient);
+
 // ========== VARIÁVEIS DE CONTROLE ==========
 unsigned long lastClockUpdate = 0;
 unsigned long lastMQTTStatusPublish = 0;
@@ -56,6 +63,32 @@ void publishCentralStateToDA() {
     doc["remotes_count"] = remoteManager.getRemoteCount();
     doc["remotes_online"] = remoteManager.getOnlineCount();
 
+    // Sincronização do relógio
+    JsonObject clock = doc["clock"].to<JsonObject>();
+    clock["synced"] = clockService.isInitialized();
+    clock["time_to_ready_ms"] = clockService.getTimeToReady();
+    clock["last_correction_ms"] = clockService.getLastCorrectionMs();
+    clock["drift_ppm"] = clockService.getDriftPpm();
+    clock["resync_interval_ms"] = clockService.getResyncInterval();
+
+    // Tempo em cada estado de energia e latência MQTT por nível de modem sleep
+    JsonObject power = doc["power"].to<JsonObject>();
+    power["state"] = PowerManager::stateName(powerManager.getState());
+    power["modem_sleep"] = PowerManager::modemName(powerManager.getModemSleep());
+    power["active_ms"] = powerManager.getTimeInState(PowerState::ACTIVE);
+    power["idle_ms"] = powerManager.getTimeInState(PowerState::IDLE);
+
+    JsonArray modemArray = power["modem"].to<JsonArray>();
+    const ModemSleep levels[] = { ModemSleep::NONE, ModemSleep::MIN_MODEM, ModemSleep::MAX_MODEM };
+    for (ModemSleep level : levels) {
+        JsonObject modemObj = modemArray.add<JsonObject>();
+        modemObj["mode"] = PowerManager::modemName(level);
+        modemObj["time_ms"] = powerManager.getTimeInModem(level);
+        modemObj["latency_samples"] = powerManager.getLatencySamples(level);
+        modemObj["latency_avg_ms"] = powerManager.getLatencyAvg(level);
+        modemObj["latency_max_ms"] = powerManager.getLatencyMax(level);
+    }
+
     // Array de remotas com todas as informações
     JsonArray remotesArray = doc["remotes"].to<JsonArray>();
 
@@ -78,6 +111,8 @@ void publishCentralStateToDA() {
             mealObj["minute"] = remote->meals[j].minute;
             mealObj["quantity"] = remote->meals[j].quantity;
             mealObj["enabled"] = remote->meals[j].enabled;
+            mealObj["channel"] = remote->meals[j].channel;
+            mealObj["days"] = remote->meals[j].days;
         }
     }
 
@@ -88,6 +123,29 @@ void publishCentralStateToDA() {
     Serial.println("[DASHBOARD] Estado completo publicado");
 }
 
+// ========== LOGS OFFLINE ==========
+
+// Repassa um log de remota ao Dashboard, sempre no formato de um log por mensagem
+void forwardRemoteLog(const String& deviceId, long timestamp, int quantity, bool delivered,
+                      const char* source, uint8_t channel) {
+    Serial.printf("   %s | ts=%ld | %dg | %s | %s | reservatório %u\n", deviceId.c_str(), timestamp, quantity,
+                  delivered ? "✅ Sucesso" : "❌ Falha", source, channel);
+
+    JsonDocument out;
+    out["deviceId"] = deviceId;
+    out["timestamp"] = timestamp;
+    out["qty"] = quantity;
+    out["delivered"] = delivered;
+    out["source"] = source;
+    out["channel"] = channel;
+
+    String payload;
+    serializeJson(out, payload);
+
+    // Repassa para Dashboard (tópico separado para histórico)
+    mqttClient.publish("petfeeder/dashboard/history", payload, false);
+}
+
 // ========== CALLBACK MQTT ==========
 
 void onMQTTMessage(const String& topic, const String& payload) {
@@ -102,77 +160,128 @@ void onMQTTMessage(const String& topic, const String& payload) {
         return;
     }
 
+    // ========== SONDA DE LATÊNCIA (eco da própria central) ==========
+    if (topic == MQTT_TOPIC_CENTRAL_PROBE) {
+        powerManager.onProbeEcho(doc["t"] | 0UL);
+        return;
+    }
+
     // ========== LOGS OFFLINE DAS REMOTAS ==========
     // Tópico: petfeeder/logs
+    // Formato em lote: {"deviceId", "remoteId", "jid", "tail", "seq", "base", "data"}
+    // com "data" = logs compactos (FeedLogCodec, 6 B cada) em base64
+    // (o formato antigo, um log JSON por mensagem, continua aceito)
     if (topic == MQTT_TOPIC_LOGS) {
-        Serial.println("📥 Log offline recebido da remota:");
-
-        // Extrair informações do log
         String deviceId = doc["deviceId"] | "";
-        long timestamp = doc["timestamp"] | 0;
-        int quantity = doc["qty"] | 0;
-        bool delivered = doc["delivered"] | false;
-        String source = doc["source"] | "";
-
-        // Log detalhado no Serial
-        Serial.printf("   Device: %s\n", deviceId.c_str());
-        Serial.printf("   Timestamp: %ld\n", timestamp);
-        Serial.printf("   Quantidade: %dg\n", quantity);
-        Serial.printf("   Status: %s\n", delivered ? "✅ Sucesso" : "❌ Falha");
-        Serial.printf("   Origem: %s\n", source.c_str());
-
-        // Repassa para Dashboard (tópico separado para histórico)
-        mqttClient.publish("petfeeder/dashboard/history", payload, false);
-
-        Serial.println("   ↳ Log repassado para Dashboard");
+        const char* data = doc["data"];
+
+        if (!data) {
+            forwardRemoteLog(deviceId, doc["timestamp"] | 0L, doc["qty"] | 0, doc["delivered"] | false,
+                             doc["source"] | "", doc["channel"] | 0);
+            return;
+        }
+
+        static uint8_t raw[1536];  // base64 decodificado de um payload de até 2048 B (buffer MQTT)
+        size_t rawLen = 0;
+        if (mbedtls_base64_decode(raw, sizeof(raw), &rawLen, (const unsigned char*)data, strlen(data)) != 0) {
+            Serial.println("[MQTT] Lote de logs com base64 inválido");
+            return;
+        }
+
+        int remoteId = doc["remoteId"] | 0;
+        uint32_t journalId = doc["jid"] | 0UL;
+        uint32_t firstSeq = doc["seq"] | 0UL;
+        uint32_t base = doc["base"] | 0UL;
+        int count = rawLen / FeedLogCodec::ENTRY_SIZE;
+
+        // Repassa só o que ainda não foi recebido (reenvios são descartados)
+        uint32_t ackSeq = 0;
+        int skip = remoteManager.acceptLogBatch(remoteId, journalId, doc["tail"] | firstSeq,
+                                                firstSeq, count, ackSeq);
+
+        Serial.printf("📥 Lote de %d logs offline de %s (seq %lu, novos %d)\n", count, deviceId.c_str(),
+                      (unsigned long)firstSeq, skip < 0 ? 0 : count - skip);
+
+        for (int i = skip < 0 ? count : skip; i < count; i++) {
+            uint32_t timestamp;
+            uint16_t quantity;
+            bool delivered;
+            FeedSource source;
+            uint8_t channel;
+            FeedLogCodec::decode(raw + i * FeedLogCodec::ENTRY_SIZE, base, timestamp, quantity,
+                                 delivered, source, channel);
+            forwardRemoteLog(deviceId, timestamp, quantity, delivered, FeedLogCodec::sourceName(source), channel);
+        }
+
+        // Confirma o maior seq contíguo recebido; a remota libera até ali
+        char remoteTopic[64];
+        snprintf(remoteTopic, sizeof(remoteTopic), MQTT_TOPIC_REMOTE_CMD, remoteId);
+        mqttClient.publish(remoteTopic, PayloadBuilder::buildLogAck(journalId, ackSeq));
         return;
     }
 
     // ========== COMANDOS DO DASHBOARD ==========
     // Tópico: petfeeder/central/cmd
     if (topic == MQTT_TOPIC_CENTRAL_CMD) {
-        String cmd = doc["cmd"] | "";
-
-        if (cmd == "CONFIG_MEAL") {
-            // Dashboard enviou configuração de refeição
-            int remoteId = doc["remote_id"] | 0;
-            int mealIndex = doc["meal"] | 0;
-            int hour = doc["hour"] | 0;
-            int minute = doc["minute"] | 0;
-            int quantity = doc["quantity"] | 0;
-
-            Serial.printf("[DASHBOARD] Configurar refeição: Remota %d, R%d = %02d:%02d (%dg)\n",
-                          remoteId, mealIndex + 1, hour, minute, quantity);
-
-            // Atualizar na central
-            remoteManager.setMealSchedule(remoteId, mealIndex, hour, minute, quantity);
-            configManager.saveRemoteConfig(remoteId);
-
-            // Enviar para a remota
-            String remoteCmdPayload = PayloadBuilder::buildMealConfig(mealIndex, hour, minute, quantity);
-            char remoteTopic[64];
-            snprintf(remoteTopic, sizeof(remoteTopic), MQTT_TOPIC_REMOTE_CMD, remoteId);
-            mqttClient.publish(remoteTopic, remoteCmdPayload);
-
-            // Publicar estado atualizado de volta para o Dashboard
-            publishCentralStateToDA();
-        }
-        else if (cmd == "FEED_NOW") {
-            // Dashboard solicitou alimentação manual
-            int remoteId = doc["remote_id"] | 0;
-            int quantity = doc["quantity"] | 100;
+        CommandId id = CommandRegistry::find(doc["cmd"] | "");
+        const CommandField* bad = nullptr;
+
+        switch (id) {
+            case CommandId::CONFIG_MEAL: {
+                // Dashboard enviou configuração de refeição
+                MealConfigArgs args;
+                if (!CommandRegistry::decode(doc.as<JsonVariantConst>(), args, &bad) || args.remoteId == 0) {
+                    Serial.printf("[DASHBOARD] CONFIG_MEAL inválido (campo %s)\n", bad ? bad->key : "remote_id");
+                    break;
+                }
+
+                Serial.printf("[DASHBOARD] Configurar refeição: Remota %d, R%d = %02d:%02d (%dg, reservatório %d, dias 0x%02X)\n",
+                              args.remoteId, args.meal + 1, args.hour, args.minute, args.quantity, args.channel, args.days);
+
+                // Atualizar na central
+                remoteManager.setMealSchedule(args.remoteId, args.meal, args.hour, args.minute, args.quantity,
+                                              args.channel, args.days);
+                configManager.saveRemoteConfig(args.remoteId);
+
+                // Enviar para a remota
+                String remoteCmdPayload = PayloadBuilder::buildMealConfig(args.meal, args.hour, args.minute,
+                                                                          args.quantity, args.channel, args.days);
+                char remoteTopic[64];
+                snprintf(remoteTopic, sizeof(remoteTopic), MQTT_TOPIC_REMOTE_CMD, args.remoteId);
+                mqttClient.publish(remoteTopic, remoteCmdPayload);
+
+                // Publicar estado atualizado de volta para o Dashboard
+                publishCentralStateToDA();
+                break;
+            }
 
-            Serial.printf("[DASHBOARD] Alimentação manual: Remota %d (%dg)\n", remoteId, quantity);
+            case CommandId::FEED_NOW: {
+                // Dashboard solicitou alimentação manual
+                FeedNowArgs args;
+                if (!CommandRegistry::decode(doc.as<JsonVariantConst>(), args, &bad)) {
+                    Serial.printf("[DASHBOARD] FEED_NOW inválido (campo %s)\n", bad->key);
+                    break;
+                }
+
+                Serial.printf("[DASHBOARD] Alimentação manual: Remota %d (%dg, reservatório %d)\n",
+                              args.remoteId, args.quantity, args.channel);
+
+                String feedPayload = PayloadBuilder::buildFeedCommand(args.quantity, args.channel);
+                char remoteTopic[64];
+                snprintf(remoteTopic, sizeof(remoteTopic), MQTT_TOPIC_REMOTE_CMD, args.remoteId);
+                mqttClient.publish(remoteTopic, feedPayload);
+                break;
+            }
 
-            String feedPayload = PayloadBuilder::buildFeedCommand(quantity);
-            char remoteTopic[64];
-            snprintf(remoteTopic, sizeof(remoteTopic), MQTT_TOPIC_REMOTE_CMD, remoteId);
-            mqttClient.publish(remoteTopic, feedPayload);
-        }
-        else if (cmd == "GET_STATE") {
-            // Dashboard solicitou estado completo
-            Serial.println("[DASHBOARD] Solicitação de estado completo");
-            publishCentralStateToDA();
+            case CommandId::GET_STATE:
+                // Dashboard solicitou estado completo
+                Serial.println("[DASHBOARD] Solicitação de estado completo");
+                publishCentralStateToDA();
+                break;
+
+            default:
+                Serial.printf("[DASHBOARD] Comando desconhecido: %s\n", (const char*)(doc["cmd"] | ""));
+                break;
         }
 
         return;
@@ -228,8 +337,10 @@ void onMealConfigChanged(int remoteId, int mealIndex, int hour, int minute, int
     // Salvar na configuração
     configManager.saveRemoteConfig(remoteId);
 
-    // Enviar via MQTT para a remota
-    String payload = PayloadBuilder::buildMealConfig(mealIndex, hour, minute, quantity);
+    // Enviar via MQTT para a remota (o menu não muda o reservatório nem os dias da refeição)
+    MealSchedule* meal = remoteManager.getMealSchedule(remoteId, mealIndex);
+    String payload = PayloadBuilder::buildMealConfig(mealIndex, hour, minute, quantity, meal ? meal->channel : 0,
+                                                     meal ? meal->days : CommandTable::ALL_DAYS);
 
     char topic[64];
     snprintf(topic, sizeof(topic), MQTT_TOPIC_REMOTE_CMD, remoteId);
@@ -242,6 +353,12 @@ void onMealConfigChanged(int remoteId, int mealIndex, int hour, int minute, int
     Serial.println("[LCD] Configuração enviada via MQTT e Dashboard atualizado");
 }
 
+// ========== CALLBACK DE ATIVIDADE (ENERGIA) ==========
+
+bool onUserActivity() {
+    return powerManager.notifyActivity();
+}
+
 // ========== INICIALIZAÇÃO DO WIFI ==========
 
 void initWiFi() {
@@ -263,6 +380,8 @@ void initWiFi() {
         Serial.println("\n✅ WiFi conectado!");
         Serial.printf("IP: %s\n", WiFi.localIP().toString().c_str());
         Serial.printf("RSSI: %d dBm\n", WiFi.RSSI());
+
+        powerManager.onWiFiConnected();
     } else {
         Serial.println("\n❌ Falha ao conectar WiFi!");
     }
@@ -314,6 +433,9 @@ void initMQTT() {
         // Inscrever em logs offline das remotas
         mqttClient.subscribe(MQTT_TOPIC_LOGS);
 
+        // Sonda de latência usada pela política de energia
+        mqttClient.subscribe(MQTT_TOPIC_CENTRAL_PROBE);
+
         // Publicar estado completo inicial para o Dashboard
         publishCentralStateToDA();
 
@@ -356,13 +478,14 @@ void setup() {
 
     Serial.println("[HAL] Inicializando LCD...");
     lcdRenderer.init();
-    screenBacklight.on();
+    powerManager.init();  // Liga backlight e CPU no máximo
 
     // ===== INICIALIZAR UI =====
 
     Serial.println("[UI] Inicializando MenuController...");
     menuController.init();
     menuController.setMealConfigCallback(onMealConfigChanged);
+    menuController.setActivityCallback(onUserActivity);
 
     // ===== INICIALIZAR NETWORK =====
 
@@ -376,6 +499,15 @@ void setup() {
             Serial.println("[CORE] ⚠️ NTP não inicializado, continuando sem sincronização de hora");
         }
 
+        #if MQTT_USE_TLS && MQTT_VALIDATE_CERT
+            // Validação do certificado precisa da hora certa: aguardar o SNTP (limitado)
+            unsigned long waitStart = millis();
+            while (!clockService.isInitialized() && millis() - waitStart < 10000) {
+                clockService.update();
+                delay(100);
+            }
+        #endif
+
         initMQTT();
     } else {
         Serial.println("[CORE] ⚠️ WiFi desconectado, pulando inicialização de NTP e MQTT");
@@ -404,6 +536,9 @@ void loop() {
     // Loop MQTT
     mqttClient.loop();
 
+    // Política de energia (backlight, CPU, modem sleep)
+    powerManager.update();
+
     // Publicar estado completo da central periodicamente (30s) para Dashboard
     if (mqttClient.isConnected() && (now - lastMQTTStatusPublish >= MQTT_STATUS_INTERVAL)) {
         lastMQTTStatusPublish = now;
@@ -4,7 +4,12 @@ MenuController::MenuController(LCDRenderer* r, RemoteManager* rm, ClockService*
     : renderer(r), remoteManager(rm), clockService(cs), buttons(b),
       currentState(MenuState::STATUS_GATEWAY),
       selectedOption(0), selectedRemoteIndex(0), selectedMealIndex(0),
-      editField(0), isEditing(false), onMealConfigCallback(nullptr) {
+      editField(0), isEditing(false), listFilter(RemoteFilter::ALL),
+      onMealConfigCallback(nullptr), onActivityCallback(nullptr) {
+    for (int i = 0; i < LIST_ROWS; i++) {
+        listCache[i].remoteIndex = -1;
+        listCache[i].revision = 0;
+    }
 }
 
 void MenuController::init() {
@@ -16,6 +21,11 @@ void MenuController::update() {
     // Obter evento dos botões
     ButtonEvent event = buttons->getEvent();
 
+    // Toque que apenas acorda a tela não navega
+    if (event != ButtonEvent::NONE && onActivityCallback && onActivityCallback()) {
+        event = ButtonEvent::NONE;
+    }
+
     // Renderizar estado atual
     switch (currentState) {
         case MenuState::STATUS_GATEWAY:
@@ -49,6 +59,10 @@ void MenuController::setMealConfigCallback(void (*callback)(int, int, int, int,
     onMealConfigCallback = callback;
 }
 
+void MenuController::setActivityCallback(bool (*callback)()) {
+    onActivityCallback = callback;
+}
+
 // ========== RENDERIZAÇÃO ==========
 
 void MenuController::renderStatusGateway() {
@@ -61,38 +75,44 @@ void MenuController::renderStatusGateway() {
 }
 
 void MenuController::renderRemoteList() {
-    String line0 = renderer->center("Remotas", 20);
+    int filteredCount = remoteManager->getFilteredCount(listFilter);
+    int totalOptions = filteredCount + 2;  // +1 filtro, +1 Voltar
 
-    int totalOptions = remoteManager->getRemoteCount() + 1;  // +1 para Voltar
+    // A visão pode encolher enquanto está aberta (ex.: remota voltou a ficar online)
+    if (selectedOption >= totalOptions) {
+        selectedOption = totalOptions - 1;
+    }
 
-    String line1 = "";
-    String line2 = "";
-    String line3 = "";
+    // Cabeçalho: filtro ativo e posição na lista
+    int position = (selectedOption >= 1 && selectedOption <= filteredCount) ? selectedOption : 0;
+    String line0 = renderer->padRight(getFilterLabel(listFilter), 12) +
+                   renderer->padLeft(String(position) + "/" + String(filteredCount), 8);
 
-    // Mostrar 3 opções de cada vez
-    int startIdx = selectedOption >= 3 ? selectedOption - 2 : 0;
+    String lines[LIST_ROWS];
 
-    for (int i = 0; i < 3; i++) {
+    // Página fixa de LIST_ROWS linhas: só as linhas visíveis são formatadas
+    int startIdx = (selectedOption / LIST_ROWS) * LIST_ROWS;
+
+    for (int i = 0; i < LIST_ROWS; i++) {
         int idx = startIdx + i;
-        String* targetLine = (i == 0) ? &line1 : (i == 1) ? &line2 : &line3;
 
         if (idx >= totalOptions) {
-            *targetLine = "";
             continue;
         }
 
         String prefix = (idx == selectedOption) ? "> " : "  ";
 
-        if (idx < remoteManager->getRemoteCount()) {
-            RemoteState* remote = remoteManager->getRemoteByIndex(idx);
-            String status = remoteManager->isRemoteActive(remote->id) ? "OK " : "OFF";
-            *targetLine = prefix + remote->name + ": " + status;
+        if (idx == 0) {
+            lines[i] = prefix + "Filtro: " + getFilterLabel(listFilter);
+        } else if (idx <= filteredCount) {
+            int remoteIndex = remoteManager->getFilteredIndex(listFilter, idx - 1);
+            lines[i] = prefix + getRemoteRowText(i, remoteIndex);
         } else {
-            *targetLine = prefix + "Voltar";
+            lines[i] = prefix + "Voltar";
         }
     }
 
-    renderer->render(line0, line1, line2, line3);
+    renderer->render(line0, lines[0], lines[1], lines[2]);
 }
 
 void MenuController::renderMealConfig() {
@@ -196,15 +216,28 @@ void MenuController::handleStatusGateway(ButtonEvent event) {
 }
 
 void MenuController::handleRemoteList(ButtonEvent event) {
-    int totalOptions = remoteManager->getRemoteCount() + 1;
+    int totalOptions = getRemoteListOptions();
+    int filteredCount = totalOptions - 2;
 
     if (event == ButtonEvent::UP) {
         selectedOption = (selectedOption - 1 + totalOptions) % totalOptions;
     } else if (event == ButtonEvent::DOWN) {
         selectedOption = (selectedOption + 1) % totalOptions;
+    } else if (event == ButtonEvent::UP_LONG) {
+        // Pular uma página inteira (sem dar a volta)
+        selectedOption = max(selectedOption - LIST_ROWS, 0);
+    } else if (event == ButtonEvent::DOWN_LONG) {
+        selectedOption = min(selectedOption + LIST_ROWS, totalOptions - 1);
     } else if (event == ButtonEvent::OK) {
-        if (selectedOption < remoteManager->getRemoteCount()) {
-            selectedRemoteIndex = selectedOption;
+        if (selectedOption == 0) {
+            // Alternar visão: Todas -> Offline -> Ração baixa
+            switch (listFilter) {
+                case RemoteFilter::ALL:      listFilter = RemoteFilter::OFFLINE; break;
+                case RemoteFilter::OFFLINE:  listFilter = RemoteFilter::LOW_FEED; break;
+                case RemoteFilter::LOW_FEED: listFilter = RemoteFilter::ALL; break;
+            }
+        } else if (selectedOption <= filteredCount) {
+            selectedRemoteIndex = remoteManager->getFilteredIndex(listFilter, selectedOption - 1);
             selectedOption = 0;
             changeState(MenuState::MEAL_CONFIG);
         } else {
@@ -309,6 +342,44 @@ String MenuController::formatTime(int hour, int minute) {
     return String(buffer);
 }
 
+int MenuController::getRemoteListOptions() {
+    return remoteManager->getFilteredCount(listFilter) + 2;  // +1 filtro, +1 Voltar
+}
+
+const String& MenuController::getRemoteRowText(int row, int remoteIndex) {
+    ListRowCache& cache = listCache[row];
+    RemoteState* remote = remoteManager->getRemoteByIndex(remoteIndex);
+
+    if (!remote) {
+        cache.remoteIndex = -1;
+        cache.text = "";
+        return cache.text;
+    }
+
+    // isRemoteActiveByIndex expira remotas vencidas (pode mudar a revisão)
+    bool active = remoteManager->isRemoteActiveByIndex(remoteIndex);
+
+    // Reformatar apenas se a linha passou a mostrar outra remota ou se ela mudou
+    if (cache.remoteIndex != remoteIndex || cache.revision != remote->revision) {
+        String status = active ? "OK " : "OFF";
+        String level = (remote->feedLevel == "OK") ? "" : " " + remote->feedLevel;
+        cache.text = remote->name + ": " + status + level;
+        cache.remoteIndex = remoteIndex;
+        cache.revision = remote->revision;
+    }
+
+    return cache.text;
+}
+
+const char* MenuController::getFilterLabel(RemoteFilter filter) {
+    switch (filter) {
+        case RemoteFilter::OFFLINE:  return "Offline";
+        case RemoteFilter::LOW_FEED: return "Racao baixa";
+        case RemoteFilter::ALL:
+        default:                     return "Todas";
+    }
+}
+
 void MenuController::changeState(MenuState newState) {
     currentState = newState;
     selectedOption = 0;
@@ -0,0 +1,34 @@
+#ifndef JSON_POOL_H
+#define JSON_POOL_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Alocador do ArduinoJson sobre um buffer fixo: nenhum malloc ao decodificar
+// comandos e um teto de memória conhecido. Alocação sequencial (bump); cada
+// bloco guarda o tamanho para reallocate() poder crescer/copiar. A memória só
+// volta com reset(), chamado antes de cada documento.
+class JsonPoolAllocator : public ArduinoJson::Allocator {
+public:
+    JsonPoolAllocator(uint8_t* buffer, size_t capacity);
+
+    void* allocate(size_t size) override;
+    void deallocate(void* ptr) override;
+    void* reallocate(void* ptr, size_t newSize) override;
+
+    void reset();
+    size_t used() const { return top; }
+    size_t peak() const { return peakUsed; }       // Desde o último reset()
+    size_t capacity() const { return size; }
+
+private:
+    uint8_t* base;
+    size_t size;
+    size_t top;
+    size_t last;         // Início do último bloco (cresce no lugar)
+    size_t peakUsed;
+
+    static size_t align(size_t n) { return (n + 3) & ~(size_t)3; }
+};
+
+#endif
@@ -7,26 +7,173 @@
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
 #include "config.h"
+#include "comm/json_pool.h"
+#include "comm/CommandRegistry.h"
+
+// Buffer do PubSubClient (o padrão de 256 B não comporta os lotes de logs)
+#ifndef MQTT_BUFFER_SIZE
+#define MQTT_BUFFER_SIZE 1024
+#endif
+
+// Associação WiFi: tempo máximo antes de recuar e tentar de novo
+#ifndef MQTT_WIFI_JOIN_MS
+#define MQTT_WIFI_JOIN_MS 15000
+#endif
+
+// DNS + TCP + TLS + CONNACK na tarefa de conexão (s, por etapa)
+#ifndef MQTT_CONNECT_TIMEOUT_S
+#define MQTT_CONNECT_TIMEOUT_S 10
+#endif
+
+// Leitura/escrita com a conexão pronta: roda no loop, precisa ser curto (s)
+#ifndef MQTT_IO_TIMEOUT_S
+#define MQTT_IO_TIMEOUT_S 2
+#endif
+
+// Espera entre tentativas: dobra a cada falha, volta ao mínimo ao conectar
+#ifndef MQTT_BACKOFF_MIN_MS
+#define MQTT_BACKOFF_MIN_MS 2000
+#endif
+
+#ifndef MQTT_BACKOFF_MAX_MS
+#define MQTT_BACKOFF_MAX_MS 60000
+#endif
+
+// Uma chamada de loop() acima disso é registrada no log
+#ifndef MQTT_LOOP_BUDGET_MS
+#define MQTT_LOOP_BUDGET_MS 20
+#endif
+
+#ifndef MQTT_CONNECT_STACK
+#define MQTT_CONNECT_STACK 8192
+#endif
+
+// Telemetria de nível: publicada na mudança; sem mudança, só neste intervalo
+#ifndef MQTT_DATA_HEARTBEAT_MS
+#define MQTT_DATA_HEARTBEAT_MS 3600000
+#endif
+
+// Consulta do estado da conexão (WiFi associando) e espera máxima de cada
+// select() da tarefa que vigia o socket
+#ifndef MQTT_LINK_POLL_MS
+#define MQTT_LINK_POLL_MS 100
+#endif
+
+// Online sem tráfego: verificação dos heartbeats e do keepalive
+#ifndef MQTT_ONLINE_POLL_MS
+#define MQTT_ONLINE_POLL_MS 1000
+#endif
+
+// Maior comando aceito: acima disso é descartado e contado, sem decodificar
+#ifndef MQTT_CMD_MAX_BYTES
+#define MQTT_CMD_MAX_BYTES 256
+#endif
+
+// Slot do ArduinoJson 7 pela versão da biblioteca: até a 7.2 guarda valor de
+// 8 B, tipo, id do próximo e ponteiro da chave (16 B no ESP32); da 7.3 em
+// diante a chave ocupa outro slot e ele cai para 8 B
+#if ARDUINOJSON_VERSION_MAJOR == 7 && ARDUINOJSON_VERSION_MINOR < 3
+#define MQTT_CMD_SLOT_BYTES (2 * sizeof(void*) + 8)
+#else
+#define MQTT_CMD_SLOT_BYTES (2 * sizeof(void*))
+#endif
+
+// Página de slots: ARDUINOJSON_POOL_CAPACITY slots pedidos de uma vez (+ o
+// cabeçalho do JsonPoolAllocator)
+#define MQTT_CMD_SLOT_PAGE_BYTES (ARDUINOJSON_POOL_CAPACITY * MQTT_CMD_SLOT_BYTES + 8)
+
+// Pior comando de MQTT_CMD_MAX_BYTES: um valor ou chave a cada 2 B de JSON
+// (0,) e uma string a cada 4 ("a",), cada uma com o cabeçalho do
+// ArduinoJson (ponteiro, tamanho, referências, '\0') e o do pool, mais a
+// folga da string em construção (começa com 31 B)
+#define MQTT_CMD_WORST_SLOTS (MQTT_CMD_MAX_BYTES / 2)
+#define MQTT_CMD_WORST_PAGES ((MQTT_CMD_WORST_SLOTS + ARDUINOJSON_POOL_CAPACITY - 1) / ARDUINOJSON_POOL_CAPACITY)
+#define MQTT_CMD_WORST_STRING_BYTES (MQTT_CMD_MAX_BYTES + MQTT_CMD_MAX_BYTES / 4 * (2 * sizeof(void*) + 8) + 32)
+#define MQTT_CMD_WORST_BYTES (MQTT_CMD_WORST_PAGES * MQTT_CMD_SLOT_PAGE_BYTES + MQTT_CMD_WORST_STRING_BYTES)
+
+// Memória fixa do documento JSON de um comando (sem malloc na decodificação)
+#ifndef MQTT_CMD_DOC_BYTES
+#define MQTT_CMD_DOC_BYTES MQTT_CMD_WORST_BYTES
+#endif
+
+#ifndef MQTT_CMD_MAX_DEPTH
+#define MQTT_CMD_MAX_DEPTH 3
+#endif
+
+// Modem sleep com a estação associada (WIFI_PS_NONE, _MIN_MODEM ou _MAX_MODEM).
+// Em MAX o rádio só acorda a cada MQTT_WIFI_LISTEN_INTERVAL beacons (102,4 ms)
+// para buscar o que o AP guardou: um comando chega com até esse atraso
+#ifndef MQTT_WIFI_PS
+#define MQTT_WIFI_PS WIFI_PS_MAX_MODEM
+#endif
+
+#ifndef MQTT_WIFI_LISTEN_INTERVAL
+#define MQTT_WIFI_LISTEN_INTERVAL 3
+#endif
+
+// Keepalive: o cliente manda PINGREQ com a entrada parada por esse tempo e
+// desiste se o PINGRESP não vier em outro tanto; o broker derruba a sessão
+// depois de 1,5x sem nada do cliente. Uma queda muda é notada em até 2x
+#ifndef MQTT_KEEPALIVE_S
+#define MQTT_KEEPALIVE_S 60
+#endif
+
+// O payload é terminado em '\0' no próprio buffer do PubSubClient: precisa
+// sobrar pelo menos o cabeçalho MQTT + tópico + 1 byte depois do maior comando
+static_assert(MQTT_CMD_MAX_BYTES + 128 <= MQTT_BUFFER_SIZE,
+              "MQTT_CMD_MAX_BYTES não cabe em MQTT_BUFFER_SIZE");
 
 class ClockService;
 class LogService;
 
+// Medições por comando: pico de memória do documento e de pilha
+struct CommandStats {
+    uint32_t count;
+    uint16_t peakDocBytes;
+    uint16_t peakStackBytes;   // Pilha da loopTask no pior caso observado
+};
+
 class MQTTService {
 public:
+    // Estados da conexão; cada passo do loop() só consulta e avança
+    enum class LinkState : uint8_t {
+        IDLE,             // Antes do begin() / após shutdown()
+        WIFI_JOIN,        // Aguardando associação
+        BROKER_CONNECT,   // Tarefa de conexão em andamento (DNS/TLS/MQTT)
+        ONLINE,
+        BACKOFF           // Espera antes da próxima tentativa
+    };
+
     MQTTService();
 
     // Novo begin com ClockService e LogService
     bool begin(ClockService* clock, LogService* log);
 
-    void loop();
+    uint32_t loop();    // ms até a próxima verificação (dados no socket acordam antes)
     bool isConnected();
 
     void publishStatus(bool online);
-    void publishData(const char* feedLevel);
-    void publishLog(const char* logData);
-    void publishFeedAck(uint16_t quantity, bool success, const char* source);
+    void publishData();   // Nível atual do LevelSensor e fila de alimentação
+    bool publishLog(const char* logData);
+    void publishFeedAck(uint16_t quantity, bool success, const char* source,
+                        uint32_t durationMs = 0, int32_t delivered = -1,
+                        uint32_t reqId = 0, uint32_t waitMs = 0, uint8_t channel = 0);
+    void publishOtaStatus(const char* status, uint32_t written, uint32_t total, const char* detail = nullptr);
 
-    void reconnect();
+    void shutdown();   // Publica offline e desliga MQTT/WiFi (antes do deep sleep)
+
+    static const uint8_t CMD_SPEC_COUNT = CommandRegistry::COUNT + 1;   // + "desconhecido"
+    uint32_t getRejectedCommands() const { return rejectedCommands; }
+    const CommandStats& getCommandStats(uint8_t index) const { return cmdStats[index]; }
+
+    LinkState getLinkState() const { return linkState; }
+    uint32_t getStatusPublished() const { return statusPublished; }
+    uint32_t getDataPublished() const { return dataPublished; }
+    uint32_t getMaxLoopMicros() const { return maxLoopUs; }   // Pior loop() desde o boot
+
+    // Latência de comando: dados no socket até o despacho (servo já acionado no FEED)
+    uint32_t getLastLatencyMicros() const { return lastLatencyUs; }
+    uint32_t getMaxLatencyMicros() const { return maxLatencyUs; }
 
 private:
     WiFiClientSecure wifiClient;
@@ -35,19 +182,57 @@ private:
     ClockService* clock;
     LogService* log;
 
-    bool connected;
-    unsigned long lastReconnectAttempt;
-    unsigned long lastStatusPublish;
-    unsigned long lastDataPublish;
+    volatile LinkState linkState;   // Lido também pela tarefa de conexão
+    uint32_t stateSince;
+    unsigned long backoffMs;
+    bool wifiStarted;
+    uint32_t lastStatusPublish;
+    uint32_t lastDataPublish;
+    uint32_t statusPublished;
+    uint32_t dataPublished;
+    uint8_t reportedQueueDepth;   // Fila de alimentação no último data
+    uint32_t maxLoopUs;
+
+    // Tarefa de conexão: o handshake TLS bloqueia, então sai do loop
+    TaskHandle_t connectTask;
+    char clientId[48];
+    volatile int8_t connectResult;   // CONNECT_PENDING / _OK / _FAILED
+    volatile int connectError;       // mqttClient.state() da tentativa
+
+    // Online, a mesma tarefa vigia o socket com select() e acorda o loop
+    int8_t task;                     // TaskScheduler
+    volatile bool rxPending;         // Sinalizado e ainda não lido pelo loop
+    volatile uint32_t rxReadyUs;     // micros() em que os dados chegaram
+    uint32_t lastLatencyUs;
+    uint32_t maxLatencyUs;
+    uint32_t latencyCount;
+    uint64_t latencySumUs;
+
+    void enterState(LinkState next);
+    void startWiFiJoin();
+    void startBrokerConnect();
+    void onBrokerConnected();
+    void enterBackoff();
+    void configurePowerSave();
+    void connectBroker();
+    void watchSocket();
+    static void connectTaskMain(void* arg);
+    static uint32_t runTask(void* arg);
 
-    void setupWiFi();
     void setupTLS();
     void mqttCallback(char* topic, byte* payload, unsigned int length);
-    void handleCommand(const char* topic, const char* payload);
+    void handleCommand(const char* payload, size_t length);
+    void dispatchCommand(CommandId id, JsonDocument& doc, const char* cmd);
+    bool decodeArgs(CommandId id, JsonDocument& doc, void* args);
+    void buildCommandFilters();
+    void recordLatency();
+    void recordCommandStats(uint8_t index, size_t docBytes, uint32_t stackFreeBefore);
 
-    bool validateFeedQuantity(int qty);
-    bool validateMealIndex(int meal);
-    bool validateTime(int hour, int minute);
+    // Decodificação: filtro por comando (campos do CommandRegistry) sobre um pool fixo
+    JsonDocument verbFilter;
+    JsonDocument cmdFilters[CMD_SPEC_COUNT];
+    CommandStats cmdStats[CMD_SPEC_COUNT];
+    uint32_t rejectedCommands;
 };
 
 extern MQTTService mqttService;
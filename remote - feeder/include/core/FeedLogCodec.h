@@ -0,0 +1,43 @@
+#pragma once
+#include <Arduino.h>
+
+// Codificação compacta de FeedLog: 6 bytes por log, usada no journal da
+// remota e nos lotes MQTT (mesmo arquivo na Central e na remota).
+//
+// Cada log é relativo a uma base de bloco (epoch UTC em segundos):
+//   bytes 0-2  delta do timestamp para a base (24 bits, little-endian;
+//              0xFFFFFF = sem horário válido)
+//   bytes 3-4  quantidade em gramas (bits 0-11) | reservatório (bits 12-14)
+//              | entregue (bit 15)
+//   byte  5    origem (FeedSource)
+// O delta de 24 bits cobre ~194 dias; fora disso começa um novo bloco.
+
+enum class FeedSource : uint8_t {
+    UNKNOWN = 0,
+    SCHEDULE,
+    MANUAL,
+    TIMEOUT,
+    MQTT,
+    RTC_AUTO,
+    COUNT
+};
+
+class FeedLogCodec {
+public:
+    static const size_t ENTRY_SIZE = 6;
+    static const uint32_t DELTA_NONE = 0xFFFFFF;
+    static const uint32_t DELTA_MAX = 0xFFFFFE;
+    static const uint16_t QTY_MAX = 0x0FFF;
+    static const uint8_t CHANNEL_MAX = 7;   // Logs anteriores aos reservatórios: 0
+
+    static const char* sourceName(FeedSource source);
+    static FeedSource sourceFromName(const char* name);
+
+    // true se o timestamp pode ser codificado contra esta base
+    static bool fits(uint32_t base, uint32_t timestamp);
+
+    static void encode(uint8_t* out, uint32_t base, uint32_t timestamp,
+                       uint16_t qty, bool delivered, FeedSource source, uint8_t channel = 0);
+    static void decode(const uint8_t* in, uint32_t base, uint32_t& timestamp,
+                       uint16_t& qty, bool& delivered, FeedSource& source, uint8_t& channel);
+};
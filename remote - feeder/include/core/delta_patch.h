@@ -0,0 +1,146 @@
+#ifndef DELTA_PATCH_H
+#define DELTA_PATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#if defined(ESP_PLATFORM)
+#include <mbedtls/sha256.h>
+#endif
+
+// Patch binário entre duas imagens de firmware, aplicado em fluxo: os bytes
+// do patch chegam em pedaços de qualquer tamanho (HTTP), a imagem base é lida
+// sob demanda (partição em execução) e a nova sai em ordem (partição OTA).
+// Memória fixa (~500 B, sem malloc) e sem Arduino: o mesmo código roda no
+// host (tools/delta) para gerar, conferir e medir patches.
+//
+// Formato (inteiros little-endian; varint = LEB128 sem sinal):
+//   cabeçalho (76 B): "FDP1" | tamanho base | tamanho novo
+//                     | SHA-256 da base | SHA-256 da imagem nova
+//   operações, até completar o tamanho novo:
+//     0x01 COPY:   varint zigzag do deslocamento na base (relativo ao fim da
+//                  COPY anterior) | varint tamanho | segmentos até o tamanho:
+//                  varint iguais (copiados da base) | varint n | n deltas
+//                  (somados byte a byte à base, como no bsdiff)
+//     0x02 INSERT: varint tamanho | bytes literais
+// Código que só mudou de endereço vira COPY com poucos deltas esparsos
+// (ponteiros nos literal pools). Tamanho base 0 = imagem completa, sem base.
+//
+// Dois trabalhos não dependem de bytes novos do patch e podem ser longos: o
+// SHA-256 da base inteira (~1 MB, logo depois do cabeçalho) e o trecho igual
+// de uma COPY (até a imagem inteira num varint). Quem não pode parar tanto
+// tempo passa `used` ao write(), que para no byte que deixa trabalho
+// pendente, e chama resume() em fatias enquanto pending(). Sem `used`, o
+// write() faz tudo de uma vez.
+class DeltaPatch {
+public:
+    enum class Result : uint8_t {
+        OK,             // Aguardando mais bytes
+        DONE,           // Imagem completa e SHA-256 confere
+        BAD_HEADER,
+        WRONG_SOURCE,   // Base diferente da imagem em execução
+        CORRUPT,        // Operação inválida ou além dos limites
+        READ_ERROR,
+        WRITE_ERROR,
+        HASH_MISMATCH,
+        TRUNCATED       // finish() antes do fim
+    };
+
+    // Leitura da base e escrita da imagem nova (false = falha de E/S)
+    typedef bool (*ReadFn)(void* ctx, uint32_t offset, uint8_t* buf, size_t len);
+    typedef bool (*WriteFn)(void* ctx, const uint8_t* data, size_t len);
+
+    static const size_t HEADER_SIZE = 76;
+    static const size_t HASH_SIZE = 32;
+    static const uint8_t OP_COPY = 0x01;
+    static const uint8_t OP_INSERT = 0x02;
+
+    DeltaPatch(ReadFn read, WriteFn write, void* ctx);
+
+    void reset();
+    Result write(const uint8_t* data, size_t len, size_t* used = nullptr);
+    Result resume(uint32_t maxBytes);   // Próxima fatia do trabalho pendente
+    Result finish();    // Fim do patch: confere o tamanho e o SHA-256
+
+    bool headerReady() const { return state > State::HEADER; }
+    bool pending() const { return state == State::SOURCE || state == State::SAME_DATA; }
+    uint32_t getSourceVerified() const { return sourceHashed; }
+    uint32_t getSourceSize() const { return sourceSize; }
+    uint32_t getTargetSize() const { return targetSize; }
+    uint32_t getWritten() const { return written; }
+    uint32_t getPatchBytes() const { return consumed; }
+    const uint8_t* getTargetHash() const { return targetHash; }
+
+    static const char* resultName(Result result);
+
+    // SHA-256 incremental (mbedtls no ESP32, implementação própria no host)
+    class Sha256 {
+    public:
+        Sha256();
+        ~Sha256();
+        void begin();
+        void update(const uint8_t* data, size_t len);
+        void finish(uint8_t out[HASH_SIZE]);
+    private:
+#if defined(ESP_PLATFORM)
+        mbedtls_sha256_context ctx;     // Acelerador de SHA do ESP32
+#else
+        uint32_t h[8];
+        uint64_t total;
+        uint8_t block[64];
+        void compress(const uint8_t* p);
+#endif
+    };
+
+private:
+    enum class State : uint8_t {
+        HEADER, SOURCE, OP,
+        COPY_OFFSET, COPY_LEN, SEG_SAME, SAME_DATA, SEG_COUNT, SEG_DIFF,
+        INSERT_LEN, INSERT_DATA,
+        DONE, FAILED
+    };
+
+    static const size_t CHUNK = 128;    // Leitura da base e saída
+
+    ReadFn readFn;
+    WriteFn writeFn;
+    void* ctx;
+
+    State state;
+    Result error;
+    uint8_t header[HEADER_SIZE];
+    uint32_t consumed;
+
+    uint32_t sourceSize;
+    uint32_t targetSize;
+    uint8_t targetHash[HASH_SIZE];
+    Sha256 sha;                 // Da base até conferi-la, depois da imagem nova
+    uint32_t sourceHashed;
+
+    uint32_t written;
+    uint32_t srcPos;            // Próximo byte da base na COPY atual
+    uint32_t remaining;         // Bytes da operação atual ainda não produzidos
+    uint32_t segLeft;           // Iguais ou deltas do segmento atual
+
+    uint32_t varint;            // Varint em leitura
+    uint8_t varintShift;
+
+    uint8_t src[CHUNK];         // Base lida para os deltas (janela atual)
+    uint32_t srcBufPos;
+    uint8_t srcBufLen;
+    uint8_t out[CHUNK];
+    uint8_t outLen;
+
+    Result fail(Result result);
+    bool readVarint(uint8_t byte, bool& done);
+    Result parseHeader();
+    Result verifySource(uint32_t maxBytes);
+    Result startOp(uint8_t op);
+    Result copySame(uint32_t maxBytes);
+    bool sourceByte(uint32_t pos, uint8_t& value);
+    Result emit(uint8_t byte);
+    bool flush();
+    Result endOfOp();
+    Result endOfSegment();
+};
+
+#endif
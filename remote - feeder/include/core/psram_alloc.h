@@ -0,0 +1,28 @@
+#ifndef PSRAM_ALLOC_H
+#define PSRAM_ALLOC_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Memória grande que não precisa de DMA (ring de logs, lotes de envio,
+// documentos JSON) vai para a PSRAM quando a placa tem (env esp32s3, com
+// -DBOARD_HAS_PSRAM). A RAM interna fica para Wi-Fi, TLS e DMA. Sem PSRAM
+// (esp32dev) tudo cai no heap interno, como antes.
+class PsramAllocator : public ArduinoJson::Allocator {
+public:
+    void* allocate(size_t size) override;
+    void deallocate(void* ptr) override;
+    void* reallocate(void* ptr, size_t newSize) override;
+
+    static bool available();
+    // PSRAM se houver; senão (ou se faltar espaço) RAM interna.
+    // inPsram (opcional) diz onde o bloco ficou
+    static void* alloc(size_t size, bool* inPsram = nullptr);
+
+    // Livre agora e mínimo livre desde o boot (marca d'água) da RAM interna e da PSRAM
+    static void printStats();
+};
+
+extern PsramAllocator psramAllocator;
+
+#endif
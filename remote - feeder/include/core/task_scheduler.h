@@ -0,0 +1,86 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <Arduino.h>
+
+#ifndef SCHED_MAX_TASKS
+#define SCHED_MAX_TASKS 10
+#endif
+
+// Espera máxima sem nenhum prazo (só limita o pior caso de um evento perdido)
+#ifndef SCHED_MAX_IDLE_MS
+#define SCHED_MAX_IDLE_MS 1000
+#endif
+
+// > 0: ignora os prazos e roda todas as tarefas a cada N ms, como o antigo
+// delay(50) do loop (para comparar latência e ocupação da CPU)
+#ifndef SCHED_FIXED_TICK_MS
+#define SCHED_FIXED_TICK_MS 0
+#endif
+
+// Tempo de execução de uma tarefa desde o boot
+struct TaskStats {
+    uint32_t runs;
+    uint32_t wakeups;       // Execuções antecipadas por evento (wake)
+    uint32_t maxUs;
+    uint64_t totalUs;
+};
+
+// Agendador cooperativo sem tick fixo para a loopTask. Cada serviço registra
+// uma tarefa que roda no loop e devolve em quantos ms precisa rodar de novo
+// (IDLE = só por evento). Entre execuções a loopTask fica bloqueada até o
+// prazo mais próximo ou até um wake() (ISR, timer, outra tarefa do RTOS).
+class TaskScheduler {
+public:
+    typedef uint32_t (*TaskFn)(void* arg);
+
+    static const uint32_t IDLE = UINT32_MAX;
+    static const int8_t NONE = -1;
+
+    TaskScheduler();
+
+    bool begin();   // Na loopTask (setup): é ela que bloqueia em run()
+
+    // Primeira execução em firstMs; NONE se a tabela estiver cheia
+    int8_t add(const char* name, TaskFn fn, void* arg = nullptr, uint32_t firstMs = 0);
+
+    // Roda a tarefa na próxima volta do loop. Seguro em qualquer tarefa do RTOS
+    void wake(int8_t id);
+    void IRAM_ATTR wakeFromISR(int8_t id);
+
+    // Executa o que venceu e bloqueia até o próximo prazo
+    void run();
+
+    uint8_t getTaskCount() const { return count; }
+    const char* getTaskName(uint8_t id) const { return tasks[id].name; }
+    const TaskStats& getStats(uint8_t id) const { return tasks[id].stats; }
+    float getBusyPercent() const;      // Fração do tempo com a loopTask acordada
+    void printStats() const;
+
+private:
+    struct Task {
+        const char* name;
+        TaskFn fn;
+        void* arg;
+        uint32_t due;       // millis() da próxima execução
+        bool armed;         // false = aguardando wake()
+        TaskStats stats;
+    };
+
+    Task tasks[SCHED_MAX_TASKS];
+    uint8_t count;
+
+    TaskHandle_t loopTask;
+    portMUX_TYPE mux;
+    volatile uint32_t pending;   // Bit por tarefa acordada por evento
+
+    uint64_t idleUs;             // Bloqueada esperando prazo/evento
+    uint64_t startUs;            // esp_timer (64 bits: não dá a volta como micros())
+
+    void runTask(Task& task, bool byEvent);
+    void sleepUntilDue();
+};
+
+extern TaskScheduler scheduler;
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef FEED_CALIBRATION_H
+#define FEED_CALIBRATION_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+// Pontos medidos na calibração (tempo de acionamento -> gramas)
+#ifndef FEED_CAL_POINTS
+#define FEED_CAL_POINTS 8
+#endif
+
+// Vazão assumida enquanto o dispositivo não foi calibrado (g/s); com 33 g/s
+// 100g levam ~3s, o tempo fixo usado antes do modelo
+#ifndef FEED_DEFAULT_GRAMS_PER_SEC
+#define FEED_DEFAULT_GRAMS_PER_SEC 33
+#endif
+
+#ifndef NVS_FEED_CAL_NAMESPACE
+#define NVS_FEED_CAL_NAMESPACE "feedcal"
+#endif
+
+// Modelo gramas <-> tempo de acionamento por dispositivo: curva linear por
+// partes passando por (0, 0) e pelos pontos medidos, extrapolada com a
+// inclinação do último trecho. Com sensor de pulsos, guarda também os pulsos
+// de cada medição para estimar gramas por pulso. Cada reservatório tem a sua,
+// num namespace NVS próprio.
+class FeedCalibration {
+public:
+    struct Point {
+        uint32_t ms;
+        uint16_t grams;
+        uint16_t pulses;   // 0 = sem sensor na medição
+    };
+
+    FeedCalibration();
+
+    void setNamespace(const char* ns) { nvsNamespace = ns; }   // Literal; antes de load()
+    bool load();
+    bool save();
+    void clear();
+
+    // Insere (ou substitui, mesmo tempo) um ponto e mantém a tabela ordenada
+    bool addPoint(uint32_t ms, uint16_t grams, uint16_t pulses);
+
+    uint32_t msForGrams(uint16_t grams) const;
+    uint16_t gramsForMs(uint32_t ms) const;
+
+    // Miligramas por pulso (0 se nenhuma medição teve pulsos)
+    uint32_t mgPerPulse() const;
+
+    bool isCalibrated() const { return count > 0; }
+    uint8_t getCount() const { return count; }
+    const Point& getPoint(uint8_t i) const { return points[i]; }
+    void print() const;
+
+private:
+    Preferences prefs;
+    const char* nvsNamespace;
+    Point points[FEED_CAL_POINTS];
+    uint8_t count;
+};
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef FEEDER_CHANNEL_H
+#define FEEDER_CHANNEL_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "hardware/feed_calibration.h"
+#include "hardware/servo_motion.h"
+
+// Com sensor, limite de acionamento em % do tempo previsto pelo modelo
+#ifndef FEEDER_FEEDBACK_MAX_PCT
+#define FEEDER_FEEDBACK_MAX_PCT 150
+#endif
+
+// Erro aceito entre pedido e entregue (medido) para considerar sucesso
+#ifndef FEEDER_TOLERANCE_PCT
+#define FEEDER_TOLERANCE_PCT 15
+#endif
+
+// Com sensor, intervalo de consulta dos pulsos durante a dispensação
+#ifndef FEEDER_FEEDBACK_POLL_MS
+#define FEEDER_FEEDBACK_POLL_MS 10
+#endif
+
+// Duração da rampa do servo ao abrir/fechar a saída (poupa a caixa de redução)
+#ifndef FEEDER_SERVO_RAMP_MS
+#define FEEDER_SERVO_RAMP_MS 250
+#endif
+
+// Maior acionamento aceito numa rodada de calibração
+#ifndef FEEDER_CAL_MAX_MS
+#define FEEDER_CAL_MAX_MS 20000
+#endif
+
+// Pedidos aguardando enquanto outra dispensação roda (por reservatório)
+#ifndef FEEDER_QUEUE_SIZE
+#define FEEDER_QUEUE_SIZE 4
+#endif
+
+// Pedidos da mesma fonte que chegam dentro deste intervalo viram uma só
+// dispensação (até MAX_FEED_QUANTITY e FEEDER_MERGE_MAX pedidos)
+#ifndef FEEDER_COALESCE_MS
+#define FEEDER_COALESCE_MS 10000
+#endif
+
+#ifndef FEEDER_MERGE_MAX
+#define FEEDER_MERGE_MAX 4
+#endif
+
+class ClockService;
+class LogService;
+
+// Prioridade na fila: refeição agendada passa à frente dos pedidos manuais
+enum class FeedPriority : uint8_t {
+    NORMAL,
+    URGENT      // HIGH é macro do Arduino
+};
+
+// Um pedido na fila; pedidos fundidos guardam cada parte para o ACK
+struct FeedRequest {
+    struct Part {
+        uint32_t reqId;         // Devolvido no FEED_ACK (0 = sem id)
+        uint16_t quantity;
+        uint32_t queuedAt;      // millis() da chegada
+    };
+
+    uint16_t quantity;          // Soma das partes
+    FeedPriority priority;
+    const char* source;         // Literal ("manual", "schedule", ...)
+    uint32_t seq;               // Ordem de chegada (FIFO na mesma prioridade)
+    uint32_t lastMergeAt;
+    uint8_t partCount;
+    Part parts[FEEDER_MERGE_MAX];
+};
+
+// Contadores da fila desde o boot
+struct FeedQueueStats {
+    uint32_t queued;            // Pedidos que esperaram outra dispensação
+    uint32_t merged;            // Pedidos fundidos a outro já na fila
+    uint32_t rejected;          // Fila cheia
+    uint32_t lastWaitMs;
+    uint32_t maxWaitMs;
+};
+
+// Um reservatório: servo próprio (canal LEDC e esp_timer da rampa), sensor
+// de pulsos, calibração na NVS, fila e máquina de estados. Não bloqueia:
+// loop() devolve o prazo do próximo passo e o FeederService roda todos os
+// reservatórios na mesma tarefa, então eles dispensam ao mesmo tempo.
+class FeederChannel {
+public:
+    FeederChannel();
+
+    // wake: chamada pelo timer do servo ao fim de cada movimento
+    bool begin(uint8_t index, int8_t servoPin, int8_t hallPin,
+               ClockService* clock, LogService* log, ServoMotion::WakeFn wake, void* wakeArg);
+
+    // Enfileira (ou inicia, se livre); false só com quantidade inválida ou fila cheia
+    bool dispense(uint16_t quantity, const char* source, uint32_t reqId, FeedPriority priority);
+    bool isBusy() const { return dispensing || testing || queueCount > 0; }
+    uint32_t loop();    // ms até precisar rodar de novo (TaskScheduler::IDLE = só por evento)
+    void testServo();
+
+    bool startCalibrationRun(uint32_t ms);
+    bool recordCalibration(uint16_t grams);
+    void clearCalibration();
+    void printCalibration() const { calibration.print(); }
+    bool hasFeedback() const { return hallPin >= 0 && calibration.mgPerPulse() > 0; }
+
+    uint8_t getIndex() const { return index; }
+    uint32_t getLastDurationMs() const { return lastDurationMs; }
+    uint16_t getLastDeliveredGrams() const { return lastDeliveredGrams; }
+    int16_t getLastErrorPct() const { return lastErrorPct; }
+
+    uint8_t getQueueDepth() const { return queueCount; }
+    uint32_t getOldestWaitMs() const;
+    const FeedQueueStats& getQueueStats() const { return queueStats; }
+
+private:
+    void moveServo(uint16_t quantity);
+    bool checkSensor(uint16_t delivered);
+    bool enqueue(uint16_t quantity, const char* source, uint32_t reqId, FeedPriority priority);
+    void startNext(bool servoOpen);
+    uint32_t nextDeadline(uint32_t elapsed) const;
+    void finishDispense(uint32_t elapsed, uint32_t pulses);
+    void finishCalibrationRun(uint32_t elapsed, uint32_t pulses);
+
+    uint8_t index;
+    int8_t hallPin;
+    LedcPwm pwm;
+    ServoMotion motion;
+    bool testing;
+
+    volatile uint32_t pulseCount;
+    static void IRAM_ATTR onPulse(void* arg);
+
+    // Dependências
+    ClockService* clock;
+    LogService* log;
+
+    FeedCalibration calibration;
+
+    bool dispensing;
+    bool calibrating;           // Rodada de calibração (sem log nem ACK)
+    uint32_t dispenseStartTime;
+    uint32_t targetMs;          // Tempo previsto pelo modelo
+    uint32_t limitMs;           // Parada forçada (com sensor, acima do previsto)
+    FeedRequest current;
+
+    FeedRequest queue[FEEDER_QUEUE_SIZE];
+    uint8_t queueCount;
+    uint32_t queueSeq;
+    FeedQueueStats queueStats;
+
+    uint32_t calRunMs;          // Última rodada de calibração, aguardando o peso
+    uint32_t calRunPulses;
+
+    uint32_t lastDurationMs;
+    uint16_t lastDeliveredGrams;
+    int16_t lastErrorPct;
+};
+
+#endif
@@ -2,11 +2,39 @@
 #define FEEDER_SERVICE_H
 
 #include <Arduino.h>
+#include "config.h"
+#include "hardware/feeder_channel.h"
+
+// Sensor de pulsos (hall) no rotor: com ele a dispensação para pela
+// quantidade medida em vez do tempo do modelo. -1 = sem sensor
+#ifndef FEEDER_HALL_PIN
+#define FEEDER_HALL_PIN -1
+#endif
+
+// Reservatórios na remota, cada um com servo (e sensor de pulsos) próprio.
+// Os pinos são listas na ordem dos reservatórios, ex.:
+//   -DFEEDER_CHANNELS=2 -DFEEDER_SERVO_PINS="{9, 12}" -DFEEDER_HALL_PINS="{-1, -1}"
+#ifndef FEEDER_CHANNELS
+#define FEEDER_CHANNELS 1
+#endif
+
+#ifndef FEEDER_SERVO_PINS
+#define FEEDER_SERVO_PINS { SERVO_PIN }
+#endif
+
+#ifndef FEEDER_HALL_PINS
+#define FEEDER_HALL_PINS { FEEDER_HALL_PIN }
+#endif
+
+static_assert(FEEDER_CHANNELS >= 1 && FEEDER_CHANNELS <= 8, "FEEDER_CHANNELS entre 1 e 8 (3 bits no FeedLogCodec)");
 
 class ClockService;
 class LogService;
 class MQTTService;
 
+// Alimentador: os reservatórios rodam numa única tarefa do TaskScheduler,
+// que acorda no menor prazo entre eles. Uma refeição em vários reservatórios
+// leva o tempo do mais lento, não a soma.
 class FeederService {
 public:
     FeederService();
@@ -14,23 +42,36 @@ public:
     // Novo begin() com injeção de dependências
     bool begin(ClockService* clock, LogService* log);
 
-    bool dispense(uint16_t quantity, const char* source = "manual");
-    bool isDispensing();
-    void loop();
-    void testServo();
+    // Enfileira no reservatório (ou inicia, se livre); false com reservatório
+    // ou quantidade inválidos, ou fila cheia
+    bool dispense(uint16_t quantity, const char* source = "manual", uint32_t reqId = 0,
+                  FeedPriority priority = FeedPriority::NORMAL, uint8_t channel = 0);
+    bool isDispensing();    // Algum reservatório dispensando ou com pedidos na fila
+    uint32_t loop();    // ms até precisar rodar de novo (TaskScheduler::IDLE = só por evento)
+    void testServo(uint8_t channel = 0);   // Percorre as posições sem bloquear o loop
 
-private:
-    void moveServo(uint16_t quantity);
-    bool checkSensor();
+    // Calibração guiada (por reservatório): aciona por um tempo, o usuário pesa e registra
+    bool startCalibrationRun(uint32_t ms, uint8_t channel = 0);
+    bool recordCalibration(uint16_t grams, uint8_t channel = 0);
+    void clearCalibration(uint8_t channel = 0);
+    void printCalibration(uint8_t channel = 0) const;
 
-    // Dependências
-    ClockService* clock;
-    LogService* log;
+    uint8_t getChannelCount() const { return FEEDER_CHANNELS; }
+    const FeederChannel& getChannel(uint8_t channel) const { return channels[channel]; }
+    bool isValidChannel(uint8_t channel) const;   // Registra o erro se inválido
+
+    // Fila somada de todos os reservatórios
+    uint8_t getQueueDepth() const;
+    uint32_t getOldestWaitMs() const;   // Há quanto tempo o pedido mais antigo espera
+    FeedQueueStats getQueueStats() const;
+
+private:
+    FeederChannel channels[FEEDER_CHANNELS];
 
-    bool dispensing;
-    uint32_t dispenseStartTime;
-    uint16_t currentQuantity;
-    String feedSource;
+    // Tarefa no TaskScheduler: menor prazo entre os reservatórios, acordada pelos servos
+    int8_t task;
+    static uint32_t runTask(void* arg);
+    static void wakeTask(void* arg);
 };
 
 extern FeederService feederService;
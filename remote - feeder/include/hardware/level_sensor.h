@@ -0,0 +1,145 @@
+#ifndef LEVEL_SENSOR_H
+#define LEVEL_SENSOR_H
+
+#include <Arduino.h>
+
+// HC-SR04 no topo do reservatório. -1 = sem sensor (nível sempre "OK")
+#ifndef LEVEL_TRIG_PIN
+#define LEVEL_TRIG_PIN -1
+#endif
+
+#ifndef LEVEL_ECHO_PIN
+#define LEVEL_ECHO_PIN -1
+#endif
+
+// Intervalo entre medições (cada uma leva até ~25 ms de eco, sem bloquear)
+#ifndef LEVEL_SAMPLE_MS
+#define LEVEL_SAMPLE_MS 2000
+#endif
+
+// Distância do sensor à ração com o reservatório cheio e vazio (cm)
+#ifndef LEVEL_FULL_CM
+#define LEVEL_FULL_CM 5
+#endif
+
+#ifndef LEVEL_EMPTY_CM
+#define LEVEL_EMPTY_CM 30
+#endif
+
+// Mediana das últimas N medições (descarta ecos isolados), depois média
+// exponencial com peso de LEVEL_EMA_PCT % para a medição nova
+#ifndef LEVEL_MEDIAN_WINDOW
+#define LEVEL_MEDIAN_WINDOW 5
+#endif
+
+#ifndef LEVEL_EMA_PCT
+#define LEVEL_EMA_PCT 10
+#endif
+
+// Maior distância entre a mediana e o nível filtrado aceita por medição: três
+// ecos espúrios do mesmo lado na janela (algumas vezes por dia com 5% de ecos
+// ruins) movem o nível no máximo isso × LEVEL_EMA_PCT. A ração cai ~1,6 cm por
+// refeição; uma recarga sobe em alguns minutos
+#ifndef LEVEL_MAX_STEP_CM
+#define LEVEL_MAX_STEP_CM 2
+#endif
+
+// Faixas do nível (%) e histerese para não oscilar na fronteira
+#ifndef LEVEL_LOW_PCT
+#define LEVEL_LOW_PCT 30
+#endif
+
+#ifndef LEVEL_EMPTY_PCT
+#define LEVEL_EMPTY_PCT 10
+#endif
+
+#ifndef LEVEL_HYSTERESIS_PCT
+#define LEVEL_HYSTERESIS_PCT 8
+#endif
+
+// Medições filtradas seguidas na nova faixa antes de trocar
+#ifndef LEVEL_CONFIRM_SAMPLES
+#define LEVEL_CONFIRM_SAMPLES 5
+#endif
+
+// Variação do percentual que justifica uma nova publicação
+#ifndef LEVEL_REPORT_STEP_PCT
+#define LEVEL_REPORT_STEP_PCT 10
+#endif
+
+enum class FeedLevel : uint8_t {
+    UNKNOWN,    // Sem sensor ou ainda sem medição válida
+    OK,
+    LOW_FEED,
+    EMPTY
+};
+
+// Nível de ração: dispara o HC-SR04 e mede o eco por interrupção (sem
+// pulseIn), filtra (mediana + EMA), converte para % e classifica em
+// OK/LOW/EMPTY com histerese. takeChange() sinaliza só mudanças relevantes.
+class LevelSensor {
+public:
+    LevelSensor();
+
+    bool begin();
+    uint32_t loop();    // ms até a próxima medição (o eco acorda a tarefa pela ISR)
+
+    // Uma medição em cm (NAN = eco perdido); pública para simulação
+    void addSample(float cm, uint32_t nowMs);
+
+    bool isPresent() const { return LEVEL_TRIG_PIN >= 0 && LEVEL_ECHO_PIN >= 0; }
+    FeedLevel getLevel() const { return level; }
+    uint8_t getPercent() const { return percent; }
+    float getDistanceCm() const { return filteredCm; }
+
+    // true uma vez após mudança de faixa ou de LEVEL_REPORT_STEP_PCT no %
+    bool takeChange();
+
+    // Nome no protocolo da Central ("OK", "LOW", "EMPTY")
+    static const char* levelName(FeedLevel level);
+
+    uint32_t getSampleCount() const { return samples; }
+    uint32_t getInvalidCount() const { return invalid; }
+    uint32_t getLastDetectMs() const { return lastDetectMs; }   // Da 1ª medição na nova faixa até a troca
+
+private:
+    static void IRAM_ATTR onEcho(void* arg);
+    static uint32_t runTask(void* arg);
+
+    FeedLevel classify(uint8_t pct, FeedLevel current) const;
+    static uint8_t percentFor(float cm);
+    float median() const;
+
+    // Eco (ISR)
+    volatile uint32_t echoRiseUs;
+    volatile uint32_t echoFallUs;
+    volatile bool echoDone;
+    bool waiting;
+    uint32_t triggerUs;
+    uint32_t lastSample;
+    int8_t task;
+
+    // Filtro
+    float window[LEVEL_MEDIAN_WINDOW];
+    uint8_t windowCount;
+    uint8_t windowIndex;
+    float filteredCm;
+    bool filterReady;
+
+    // Classificação
+    FeedLevel level;
+    uint8_t percent;
+    uint8_t reportedPercent;
+    FeedLevel reportedLevel;
+    bool changed;
+    uint8_t confirmCount;
+    uint32_t crossSince;        // 1ª medição bruta fora da faixa atual (0 = nenhuma)
+    uint32_t lastDetectMs;
+
+    uint32_t samples;
+    uint32_t invalid;
+};
+
+extern LevelSensor levelSensor;
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef RTC_SOURCE_H
+#define RTC_SOURCE_H
+
+#include <Arduino.h>
+
+// Fonte de hora persistente (RTC com bateria). Guarda sempre UTC.
+// Interface separada para permitir um RTC simulado fora do ESP32.
+class RtcSource {
+public:
+    virtual ~RtcSource() {}
+
+    virtual bool begin() = 0;
+    virtual bool read(uint32_t& utcSeconds) = 0;   // false se o RTC perdeu a hora
+    virtual bool write(uint32_t utcSeconds) = 0;
+    virtual const char* name() const = 0;
+};
+
+// RTC DS3231 (padrão) ou DS1307 (-DRTC_MODEL_DS1307) via RTClib
+class HardwareRtc : public RtcSource {
+public:
+    HardwareRtc();
+
+    bool begin() override;
+    bool read(uint32_t& utcSeconds) override;
+    bool write(uint32_t utcSeconds) override;
+    const char* name() const override;
+
+private:
+    bool present;
+};
+
+#endif
@@ -2,25 +2,32 @@
 #define MODELS_H
 
 #include <Arduino.h>
+#include "core/FeedLogCodec.h"
+
+// Dias da semana da refeição: bit 0 = domingo ... bit 6 = sábado
+#define MEAL_ALL_DAYS 0x7F
 
 struct Meal {
     uint8_t hour;
     uint8_t minute;
     uint16_t qty;
     bool enabled;
-    
-    Meal() : hour(8), minute(0), qty(100), enabled(true) {}
+    uint8_t days;
+    uint8_t channel;    // Reservatório que serve a refeição
+
+    Meal() : hour(8), minute(0), qty(100), enabled(true), days(MEAL_ALL_DAYS), channel(0) {}
 };
 
+// 8 bytes em RAM (antes 20); no journal e no MQTT vai codificado em 6 bytes
+// pelo FeedLogCodec
 struct FeedLog {
     uint32_t timestamp;
     uint16_t qty;
-    bool delivered;
-    char source[12]; // "mqtt", "rtc_auto", "manual"
-    
-    FeedLog() : timestamp(0), qty(0), delivered(false) {
-        strcpy(source, "unknown");
-    }
+    uint8_t delivered : 1;
+    uint8_t channel : 3;    // Reservatório (até FeedLogCodec::CHANNEL_MAX)
+    FeedSource source;  // SCHEDULE, MANUAL, TIMEOUT, MQTT, RTC_AUTO
+
+    FeedLog() : timestamp(0), qty(0), delivered(false), channel(0), source(FeedSource::UNKNOWN) {}
 };
 
 #endif
\ No newline at end of file
@@ -3,11 +3,95 @@
 
 #include <Arduino.h>
 #include <Preferences.h>
+#include <LittleFS.h>
 #include "config.h"
 #include "models.h"
 
+// Journal em LittleFS: registros binários de tamanho fixo, só anexados
+#ifndef LOG_JOURNAL_PATH
+#define LOG_JOURNAL_PATH "/feedlog.jnl"
+#endif
+
+// Tamanho a partir do qual o journal é compactado (reescrito só com pendentes)
+#ifndef LOG_JOURNAL_COMPACT_BYTES
+#define LOG_JOURNAL_COMPACT_BYTES 16384
+#endif
+
+// A compactação roda na tarefa do log, em fatias de LOG_COMPACT_SLICE_BYTES
+// até LOG_COMPACT_BUDGET_MS por chamada: com o ring da PSRAM cheio são ~260 KB
+// de flash, que dentro de addLog travariam o loop (e os outros reservatórios)
+#ifndef LOG_COMPACT_BUDGET_MS
+#define LOG_COMPACT_BUDGET_MS 10
+#endif
+
+#ifndef LOG_COMPACT_SLICE_BYTES
+#define LOG_COMPACT_SLICE_BYTES 256
+#endif
+
+// Payload máximo de um lote de logs (JSON); precisa caber em MQTT_BUFFER_SIZE
+#ifndef LOG_BATCH_MAX_BYTES
+#define LOG_BATCH_MAX_BYTES 896
+#endif
+
+// Tempo máximo gasto enviando lotes a cada chamada de loop()
+#ifndef LOG_DRAIN_BUDGET_MS
+#define LOG_DRAIN_BUDGET_MS 20
+#endif
+
+// Logs enviados e ainda não confirmados pela Central (janela de envio)
+#ifndef LOG_ACK_WINDOW
+#define LOG_ACK_WINDOW 64
+#endif
+
+// Sem ACK nesse tempo, reenvia a partir do último seq confirmado
+#ifndef LOG_ACK_TIMEOUT_MS
+#define LOG_ACK_TIMEOUT_MS 5000
+#endif
+
+#ifndef LOG_ACK_MAX_RETRIES
+#define LOG_ACK_MAX_RETRIES 3
+#endif
+
+// Central sem confirmar depois de LOG_ACK_MAX_RETRIES: cada nova tentativa
+// espera o dobro da anterior (a partir de LOG_SEND_RETRY_INTERVAL) até este
+// teto; o primeiro ACK válido volta ao intervalo normal
+#ifndef LOG_RETRY_BACKOFF_MAX_MS
+#define LOG_RETRY_BACKOFF_MAX_MS 3600000UL
+#endif
+
+// Logs guardados sem PSRAM. Com 8 B por log (eram 20 B na RAM e 32 B no
+// journal) cabem 3x os MAX_LOGS de antes; MAX_LOGS segue sendo o limite do
+// formato antigo nas migrações
+#ifndef LOG_RING_LOGS
+#define LOG_RING_LOGS (MAX_LOGS * 3)
+#endif
+
+// Com PSRAM, o ring de logs tem esta capacidade (potência de 2; 8 B por log)
+// em vez de LOG_RING_LOGS: a remota guarda semanas de eventos sem a Central
+#ifndef LOG_RING_PSRAM_LOGS
+#define LOG_RING_PSRAM_LOGS 32768
+#endif
+
+static_assert((LOG_RING_PSRAM_LOGS & (LOG_RING_PSRAM_LOGS - 1)) == 0, "LOG_RING_PSRAM_LOGS precisa ser potência de 2");
+
 class ClockService;
 
+// Registros do journal (little-endian, tamanho fixo por tipo):
+//   ENTRY (8 B):  tag | log compacto (FeedLogCodec, 6 B) | CRC8
+//   BASE (16 B):  tag | 3 B zero | seq | base | CRC32
+//                 seq do próximo ENTRY (os seguintes são consecutivos) e base
+//                 dos timestamps do bloco
+//   ACK  (20 B):  tag | 3 B zero | seq | overflow | id do journal | CRC32
+//                 move o tail: tudo com seq < ack.seq já foi consumido
+// Um journal do firmware anterior (registros de 32 B com magic "LF") é
+// convertido no boot e regravado neste formato
+
+// Capacidade do buffer circular sem PSRAM: LOG_RING_LOGS arredondado para potência
+// de 2, assim o índice é só (contador & máscara) e addLog é O(1) com qualquer capacidade
+constexpr uint16_t logRingCapacity(uint16_t n, uint16_t p = 1) {
+    return p >= n ? p : logRingCapacity(n, p << 1);
+}
+
 class LogService {
 public:
     LogService();
@@ -15,21 +99,126 @@ public:
     // begin atualizado com ClockService*
     bool begin(ClockService* clock);
 
-    void addLog(uint32_t timestamp, uint16_t qty, bool delivered, const char* source);
-    void saveLogs();
+    void addLog(uint32_t timestamp, uint16_t qty, bool delivered, const char* source, uint8_t channel = 0);
     void loadLogs();
     void sendPendingLogsMQTT();
+    void onAck(uint32_t journalId, uint32_t seq);  // Central recebeu tudo com seq < seq
     void clearLogs();
-    void loop();
+    uint32_t loop();    // ms até o próximo lote/tentativa (TaskScheduler::IDLE = nada pendente)
     int getPendingLogsCount();
+    bool isDraining() const { return draining; }
+    bool isBackingOff() const { return retryInterval > LOG_SEND_RETRY_INTERVAL; }
+    bool isCompacting() const { return compactDue; }
+    uint32_t getOverflowCount() const { return overflowCount; }
+    uint32_t getJournalBytes() const { return journalBytes; }
+    uint32_t getLastWriteMicros() const { return lastWriteMicros; }
+    uint32_t getResentLogs() const { return resentLogs; }
+    uint32_t getResentBytes() const { return resentBytes; }
+    uint32_t getLastDrainMs() const { return lastDrainMs; }
+    uint32_t getCapacity() const { return maxLogs; }
+    uint32_t getPeakPendingLogs() const { return peakPending; }   // Marca d'água desde o boot
+    bool isRingInPsram() const { return ringInPsram; }
 
 private:
     Preferences prefs;
     ClockService* clock;       // dependência
 
-    FeedLog logs[MAX_LOGS];
-    int logCount;
+    static const uint8_t TAG_ENTRY = 0xE1;
+    static const uint8_t TAG_BASE = 0xB1;
+    static const uint8_t TAG_ACK = 0xA1;
+    static const size_t ENTRY_RECORD_SIZE = 1 + FeedLogCodec::ENTRY_SIZE + 1;
+    static const size_t BASE_RECORD_SIZE = 16;
+    static const size_t ACK_RECORD_SIZE = 20;
+
+    bool fsReady;
+    uint32_t journalBytes;     // Tamanho atual do arquivo
+    uint32_t lastWriteMicros;  // Duração da última escrita (abrir+gravar+fechar)
+    uint32_t journalId;        // Aleatório, gravado nos ACKs; muda quando a sequência recomeça
+    uint32_t compactedBytes;   // Tamanho logo após a última compactação
+
+    // Bloco atual de um arquivo do journal (o próximo ENTRY usa esta base)
+    struct JournalBlock {
+        bool hasBase;
+        uint32_t base;
+        uint32_t seq;          // seq do próximo ENTRY no arquivo
+    };
+    JournalBlock journalBlock;
+
+    // Compactação em andamento (ver compactStep()): o .tmp fica aberto entre
+    // as fatias e recebe os pendentes de compactSeq até alcançar o head
+    bool compactDue;           // Pedida por addLog/ACK, ou com o .tmp aberto
+    File compactFile;
+    JournalBlock compactBlock;
+    uint32_t compactSeq;       // Próximo seq a copiar
+    uint32_t compactTail;      // tail e overflow do último ACK no .tmp
+    uint32_t compactOverflow;
+
+    bool appendBytes(const uint8_t* data, size_t size);
+    void appendAck();
+    bool compactJournal();
+    bool compactStep();
+    bool beginCompaction();
+    bool copyPending();
+    bool finishCompaction();
+    void abortCompaction();
+    bool needsCompaction() const;
+    size_t encodeEntry(uint8_t* out, uint32_t seq, JournalBlock& block);
+    size_t encodeAck(uint8_t* out);
+    static size_t recordSize(uint8_t tag);
+    uint32_t loadLegacyJournal(File& file);
+    void migrateFromNVS();
+    void ensureJournalId();
+
+    // Envio incremental em lotes (ver loop())
+    bool draining;
+    uint32_t drainStartMs;
+    uint32_t drainSent;
+    uint16_t drainBatches;
+    uint32_t sendSeq;          // Próximo seq a enviar (tail <= sendSeq <= head)
+    uint32_t sentHigh;         // Maior seq já enviado (abaixo disso é reenvio)
+    uint32_t lastAckMs;
+    uint8_t ackRetries;
+    uint32_t resentLogs;
+    uint32_t resentBytes;
+    uint32_t lastDrainMs;      // Duração do último envio completo (início até o último ACK)
+
+    uint16_t publishBatch();
+    void drainStep();
+    uint32_t drainLoop();
+
+    // Buffers de um lote (no heap: PSRAM quando houver)
+    static const uint16_t BATCH_MAX_ENTRIES = LOG_BATCH_MAX_BYTES / 8;  // 6 B -> 8 caracteres
+    struct BatchBuffers {
+        uint8_t raw[BATCH_MAX_ENTRIES * FeedLogCodec::ENTRY_SIZE];
+        char encoded[BATCH_MAX_ENTRIES * 8 + 1];
+        char payload[LOG_BATCH_MAX_BYTES + 1];
+    };
+    BatchBuffers* batch;
+
+    uint32_t lastTryMs;        // Última tentativa de iniciar o envio
+    uint32_t retryInterval;    // Espera até a próxima tentativa (cresce sem ACK)
+    int8_t task;               // TaskScheduler: acordada por addLog/ACK/conexão
+    static uint32_t runTask(void* arg);
+
+    static const uint16_t LOG_RING_SIZE = logRingCapacity(LOG_RING_LOGS);
+
+    // Buffer circular: head = próximo a escrever, tail = mais antigo não confirmado.
+    // Contadores livres (sem wrap manual); ocupação = head - tail.
+    // A posição no ring é também o número de sequência do log no journal.
+    // begin() troca o ring interno por um de LOG_RING_PSRAM_LOGS na PSRAM
+    FeedLog* logs;
+    FeedLog internalLogs[LOG_RING_SIZE];
+    uint32_t ringMask;
+    uint32_t maxLogs;         // Ocupação máxima antes de descartar o mais antigo
+    bool ringInPsram;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t overflowCount;   // Logs descartados por buffer cheio
+    uint32_t peakPending;
     bool hasPendingLogs;
+
+    FeedLog& logAt(uint32_t pos) { return logs[pos & ringMask]; }
+    void allocateBuffers();
 };
 
 extern LogService logService;
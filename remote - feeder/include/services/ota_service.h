@@ -0,0 +1,126 @@
+#ifndef OTA_SERVICE_H
+#define OTA_SERVICE_H
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <esp_ota_ops.h>
+#include "config.h"
+#include "core/delta_patch.h"
+
+// Progresso e resultado das atualizações
+#ifndef TOPIC_OTA
+#define OTA_STR_(x) #x
+#define OTA_STR(x) OTA_STR_(x)
+#define TOPIC_OTA "petfeeder/remote/" OTA_STR(REMOTE_ID) "/ota"
+#endif
+
+// Tempo aplicando o patch a cada execução da tarefa (feeder e MQTT seguem rodando)
+#ifndef OTA_STEP_BUDGET_MS
+#define OTA_STEP_BUDGET_MS 20
+#endif
+
+// Fatia do trabalho do patch sem bytes novos (SHA-256 da base, trecho igual
+// de uma COPY): o orçamento é conferido entre fatias. 1 KB gravado ~ 6 ms
+#ifndef OTA_SLICE_BYTES
+#define OTA_SLICE_BYTES 1024
+#endif
+
+// Tarefa do GET do patch (DNS, TCP, TLS e cabeçalhos bloqueiam por segundos)
+#ifndef OTA_CONNECT_STACK
+#define OTA_CONNECT_STACK 8192
+#endif
+
+// Sem bytes do servidor nesse tempo, a atualização é abortada
+#ifndef OTA_STALL_TIMEOUT_MS
+#define OTA_STALL_TIMEOUT_MS 15000
+#endif
+
+// A imagem nova precisa chegar ao broker nesse prazo; senão o bootloader
+// volta para a anterior
+#ifndef OTA_CONFIRM_TIMEOUT_MS
+#define OTA_CONFIRM_TIMEOUT_MS 300000
+#endif
+
+class FeederService;
+
+// Atualização A/B por patch binário (core/delta_patch): o patch vem por
+// HTTP(S) (pedido numa tarefa própria, criada na primeira atualização) e é
+// aplicado em fluxo pelo loop, lendo a base da partição em execução e
+// gravando a imagem nova na outra partição OTA. Só troca a partição de boot
+// depois de o SHA-256 da imagem inteira bater com o do comando, então o
+// transporte não precisa ser confiável. A imagem nova fica "em teste" até
+// conectar ao broker (confirm()); se travar ou reiniciar antes, o bootloader
+// volta para a anterior.
+class OtaService {
+public:
+    enum class State : uint8_t {
+        IDLE,
+        CONNECTING,         // GET na tarefa de download
+        DOWNLOADING,
+        REBOOT_PENDING      // Imagem nova pronta: reinicia quando o feeder parar
+    };
+
+    OtaService();
+
+    bool begin(FeederService* feeder);
+
+    // Comando OTA: url do patch e SHA-256 (hex) da imagem resultante. Retorna
+    // na hora; falha do download sai depois, em report()
+    bool start(const char* url, const char* sha256Hex);
+    void confirm();         // Conectou ao broker: imagem em teste vira a definitiva
+    bool isBusy() const { return state != State::IDLE; }
+    bool isPendingVerify() const { return pendingVerify; }
+    uint32_t loop();        // ms até o próximo passo (TaskScheduler::IDLE = nada a fazer)
+
+    const char* getRunningHash() const { return runningHash; }
+
+private:
+    FeederService* feeder;
+    State state;
+    int8_t task;
+    static uint32_t runTask(void* arg);
+
+    char runningHash[DeltaPatch::HASH_SIZE * 2 + 1];    // Base para gerar o próximo patch
+    bool pendingVerify;     // Primeira execução de uma imagem nova
+    uint32_t bootMs;
+
+    // Download: a tarefa só mexe no http até connectDone; depois é do loop
+    TaskHandle_t connectTask;
+    char url[128];
+    volatile int httpCode;      // 0 = URL inválida
+    volatile bool connectDone;
+    static void connectTaskMain(void* arg);
+    void connect();
+    uint32_t onConnected();
+
+    // Atualização em andamento
+    HTTPClient http;
+    WiFiClient plainClient;
+    WiFiClientSecure tlsClient;
+    WiFiClient* stream;
+    uint8_t rxBuf[512];         // Lido do servidor e ainda não aplicado
+    uint16_t rxPos;
+    uint16_t rxLen;
+    DeltaPatch patch;
+    uint8_t expectedHash[DeltaPatch::HASH_SIZE];
+    const esp_partition_t* running;
+    const esp_partition_t* target;
+    esp_ota_handle_t handle;
+    bool otaStarted;
+    uint32_t startMs;
+    uint32_t lastDataMs;
+    uint8_t reportedPct;
+
+    uint32_t step();
+    void finishUpdate();
+    void abort(const char* reason);
+    void report(const char* status, const char* detail = nullptr);
+
+    static bool readBase(void* ctx, uint32_t offset, uint8_t* buf, size_t len);
+    static bool writeImage(void* ctx, const uint8_t* data, size_t len);
+};
+
+extern OtaService otaService;
+
+#endif
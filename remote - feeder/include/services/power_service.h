@@ -0,0 +1,120 @@
+#ifndef POWER_SERVICE_H
+#define POWER_SERVICE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Modo de baixo consumo: deep sleep entre refeições (desligado por padrão).
+// Acorda pouco antes do horário, dispensa com a rede desligada e só então
+// abre uma janela curta de WiFi/MQTT para enviar logs e receber config
+#ifndef REMOTE_LOW_POWER
+#define REMOTE_LOW_POWER 0
+#endif
+
+// Antecedência do despertar em relação à refeição (cobre o boot e o erro
+// do oscilador RTC do chip durante o sono)
+#ifndef POWER_WAKE_LEAD_SEC
+#define POWER_WAKE_LEAD_SEC 60
+#endif
+
+// Com a próxima refeição mais perto que isso (além da antecedência), fica acordado
+#ifndef POWER_MIN_SLEEP_SEC
+#define POWER_MIN_SLEEP_SEC 300
+#endif
+
+// Sono máximo: acorda ao menos nesse intervalo para sincronizar (config, NTP)
+#ifndef POWER_MAX_SLEEP_SEC
+#define POWER_MAX_SLEEP_SEC (6UL * 3600)
+#endif
+
+// Janela de conectividade após a refeição; encerra antes se os logs foram
+// confirmados e já passou POWER_SYNC_MIN_MS (comandos pendentes da Central)
+#ifndef POWER_SYNC_WINDOW_MS
+#define POWER_SYNC_WINDOW_MS 60000UL
+#endif
+
+#ifndef POWER_SYNC_MIN_MS
+#define POWER_SYNC_MIN_MS 5000UL
+#endif
+
+// Após um boot completo (energia, reset) fica acordado para configuração
+#ifndef POWER_BOOT_AWAKE_MS
+#define POWER_BOOT_AWAKE_MS (5UL * 60 * 1000)
+#endif
+
+// Intervalo entre verificações de fase (refeição servida, logs confirmados)
+#ifndef POWER_POLL_MS
+#define POWER_POLL_MS 500
+#endif
+
+// Estimativa de autonomia (bateria e consumo médio acordado/dormindo)
+#ifndef POWER_BATTERY_MAH
+#define POWER_BATTERY_MAH 2600
+#endif
+
+#ifndef POWER_AWAKE_MA
+#define POWER_AWAKE_MA 110
+#endif
+
+#ifndef POWER_SLEEP_UA
+#define POWER_SLEEP_UA 150
+#endif
+
+class ClockService;
+class ScheduleService;
+class FeederService;
+class LogService;
+
+class PowerService {
+public:
+    enum class Phase : uint8_t {
+        BOOT,       // Boot completo: rede ativa por POWER_BOOT_AWAKE_MS
+        WAIT_MEAL,  // Aguardando a refeição que motivou o despertar
+        SYNC,       // Janela de conectividade
+        AWAKE       // Sem modo de baixo consumo (ou sem hora válida)
+    };
+
+    PowerService();
+
+    // Sobe a rede, exceto ao acordar do deep sleep (adiada para após a refeição)
+    bool begin(ClockService* clock, ScheduleService* schedule,
+               FeederService* feeder, LogService* log);
+    uint32_t loop();    // ms até a próxima verificação de fase
+
+    // Acordou de um deep sleep deste serviço (estado válido na memória RTC)
+    static bool isWarmWake();
+
+    bool isNetworkUp() const { return networkUp; }
+    Phase getPhase() const { return phase; }
+
+    // Contabilidade desde o último boot completo
+    uint32_t getWakeCount() const;
+    uint64_t getAwakeMs() const;        // Inclui o ciclo atual
+    uint64_t getSleepMs() const;
+    float getDutyCyclePercent() const;
+    float getAverageCurrentMa() const;
+    float getEstimatedBatteryDays() const;
+
+private:
+    ClockService* clock;
+    ScheduleService* schedule;
+    FeederService* feeder;
+    LogService* log;
+
+    Phase phase;
+    bool networkUp;
+    uint32_t phaseStart;        // millis() de entrada na fase atual
+    uint32_t targetDeadline;    // Refeição esperada (epoch local); 0 = nenhuma
+
+    static uint32_t runTask(void* arg);
+
+    void startNetwork();
+    void enterPhase(Phase next);
+    void trySleep();
+    void enterSleep(uint32_t seconds, uint32_t deadline);
+    void reportStats();
+};
+
+extern PowerService powerService;
+
+#endif
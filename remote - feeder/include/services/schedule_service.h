@@ -3,8 +3,28 @@
 
 #include <Arduino.h>
 #include <Preferences.h>
+#include "config.h"
 #include "models.h"
 
+// Quantidade de horários configuráveis (o bitmap de disparos comporta até 32)
+#ifndef SCHEDULE_SLOTS
+#define SCHEDULE_SLOTS MAX_MEALS
+#endif
+
+// Refeição perdida (loop travado, reboot, feeder ocupado) ainda é servida
+// se estiver no máximo este tempo atrasada
+#ifndef SCHEDULE_CATCHUP_SEC
+#define SCHEDULE_CATCHUP_SEC (15 * 60)
+#endif
+
+// Intervalo máximo entre verificações mesmo com o próximo horário distante
+// (absorve ajustes do relógio pelo NTP)
+#ifndef SCHEDULE_MAX_SLEEP_MS
+#define SCHEDULE_MAX_SLEEP_MS 60000UL
+#endif
+
+static_assert(SCHEDULE_SLOTS <= 32, "SCHEDULE_SLOTS acima do bitmap de disparos (32)");
+
 class ClockService;
 class FeederService;
 class LogService;
@@ -18,16 +38,20 @@ public:
 
     bool load();
     bool save();
-    void loop();
+    uint32_t loop();    // ms até o próximo horário (ou SCHEDULE_MAX_SLEEP_MS)
     bool checkMeals();
-    bool shouldFeedNow(uint8_t hour, uint8_t minute);
 
     bool setMeal(uint8_t index, uint8_t hour, uint8_t minute,
-                 uint16_t qty, bool enabled);
+                 uint16_t qty, bool enabled, uint8_t days = MEAL_ALL_DAYS, uint8_t channel = 0);
 
     Meal getMeal(uint8_t index);
     void printMeals();
 
+    // Próximo horário (epoch local, segundos) e refeição; 0 se não houver
+    uint32_t getNextDeadline();
+    int getNextSlot();
+    uint32_t getSecondsToNextMeal();
+
 private:
     Preferences prefs;
 
@@ -35,9 +59,36 @@ private:
     FeederService* feeder;
     LogService* log;
 
-    Meal meals[3];
-    uint32_t lastFeedDay;
-    uint8_t lastFeedIndex;
+    Meal meals[SCHEDULE_SLOTS];
+
+    // Refeições ativas ordenadas por minuto do dia; a busca do próximo
+    // horário é binária sobre orderMinute
+    uint8_t order[SCHEDULE_SLOTS];
+    uint16_t orderMinute[SCHEDULE_SLOTS];
+    uint8_t orderCount;
+
+    // Disparos do dia local firedDay (bit por refeição), persistidos na NVS
+    uint32_t firedDay;
+    uint32_t firedMask;
+
+    uint32_t nextDeadline;     // 0 = recalcular
+    uint8_t nextSlot;
+    uint32_t lastLocalNow;     // Detecta o relógio voltando
+    uint32_t wakeAt;           // millis() da próxima verificação
+    bool ready;  // Já teve hora válida (registra o tempo até ficar pronto)
+    int8_t task;               // TaskScheduler: acordada quando a agenda muda
+
+    static uint32_t runTask(void* arg);
+
+    void rebuildOrder();
+    uint32_t findNextDeadline(uint32_t now, uint8_t& slot);
+    bool isFired(uint32_t day, uint8_t slot) const;
+    void markFired(uint32_t day, uint8_t slot);
+    void scheduleWake(uint32_t now);
+
+    // Cópia da agenda na memória RTC: acordar do deep sleep não relê a NVS
+    bool restoreSnapshot();
+    void storeSnapshot();
 };
 
 extern ScheduleService scheduleService;
@@ -0,0 +1,67 @@
+// json_pool.cpp
+#include "comm/json_pool.h"
+
+// Cabeçalho de cada bloco: tamanho pedido (para reallocate copiar)
+static const size_t HEADER = sizeof(uint32_t);
+
+JsonPoolAllocator::JsonPoolAllocator(uint8_t* buffer, size_t capacity) :
+    base(buffer),
+    size(capacity),
+    top(0),
+    last(SIZE_MAX),
+    peakUsed(0) {}
+
+void JsonPoolAllocator::reset() {
+    top = 0;
+    last = SIZE_MAX;
+    peakUsed = 0;
+}
+
+void* JsonPoolAllocator::allocate(size_t n) {
+    size_t need = HEADER + align(n);
+    if (need > size - top) {
+        return nullptr;  // ArduinoJson reporta NoMemory / overflowed()
+    }
+
+    uint8_t* block = base + top;
+    *(uint32_t*)block = (uint32_t)n;
+    last = top;
+    top += need;
+    if (top > peakUsed) peakUsed = top;
+    return block + HEADER;
+}
+
+void JsonPoolAllocator::deallocate(void* ptr) {
+    // Último bloco devolvido volta para o pool; os demais só no reset()
+    if (ptr && (uint8_t*)ptr - HEADER == base + last) {
+        top = last;
+        last = SIZE_MAX;
+    }
+}
+
+void* JsonPoolAllocator::reallocate(void* ptr, size_t newSize) {
+    if (!ptr) return allocate(newSize);
+
+    uint8_t* block = (uint8_t*)ptr - HEADER;
+    size_t offset = block - base;
+
+    // Último bloco: cresce/encolhe no lugar
+    if (offset == last) {
+        size_t need = HEADER + align(newSize);
+        if (need > size - offset) return nullptr;
+        *(uint32_t*)block = (uint32_t)newSize;
+        top = offset + need;
+        if (top > peakUsed) peakUsed = top;
+        return ptr;
+    }
+
+    uint32_t oldSize = *(uint32_t*)block;
+    if (newSize <= oldSize) {
+        *(uint32_t*)block = (uint32_t)newSize;
+        return ptr;
+    }
+
+    void* moved = allocate(newSize);
+    if (moved) memcpy(moved, ptr, oldSize);
+    return moved;
+}
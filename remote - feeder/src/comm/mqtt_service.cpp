@@ -5,22 +5,67 @@
 #include "hardware/feeder_service.h"
 #include "services/schedule_service.h"
 #include "core/ClockService.h"
+#include "hardware/level_sensor.h"
+#include "services/ota_service.h"
+#include "core/task_scheduler.h"
+#include "core/psram_alloc.h"
+#include <lwip/sockets.h>
+#include <esp_wifi.h>
 
 MQTTService mqttService;
 
+static const int8_t CONNECT_PENDING = -1;
+static const int8_t CONNECT_FAILED = 0;
+static const int8_t CONNECT_OK = 1;
+
+// Documento dos comandos recebidos: memória estática, sem malloc
+static uint8_t cmdPoolBuffer[MQTT_CMD_DOC_BYTES];
+static JsonPoolAllocator cmdPool(cmdPoolBuffer, sizeof(cmdPoolBuffer));
+
+// Slot e página seguem o layout do ArduinoJson 7; abaixo do pior caso um
+// comando válido falha com NoMemory (tools/sim/tests/command_test mede)
+static_assert(ARDUINOJSON_VERSION_MAJOR == 7, "MQTT_CMD_SLOT_BYTES segue o ArduinoJson 7");
+static_assert(MQTT_CMD_DOC_BYTES >= MQTT_CMD_WORST_BYTES,
+              "MQTT_CMD_DOC_BYTES não comporta o pior comando de MQTT_CMD_MAX_BYTES");
+
+// Limites do protocolo (CommandRegistry) e da remota precisam ser os mesmos
+static_assert(CommandTable::FEED_MIN_G == MIN_FEED_QUANTITY && CommandTable::FEED_MAX_G == MAX_FEED_QUANTITY,
+              "Faixa de quantidade do CommandRegistry difere do config.h");
+static_assert(CommandTable::MEALS == MAX_MEALS, "Número de refeições do CommandRegistry difere do config.h");
+static_assert(CommandTable::ALL_DAYS == MEAL_ALL_DAYS, "Máscara de dias do CommandRegistry difere de models.h");
+
 MQTTService::MQTTService() :
     mqttClient(wifiClient),
-    connected(false),
-    lastReconnectAttempt(0),
+    linkState(LinkState::IDLE),
+    stateSince(0),
+    backoffMs(0),
+    wifiStarted(false),
     lastStatusPublish(0),
-    lastDataPublish(0)
+    lastDataPublish(0),
+    statusPublished(0),
+    dataPublished(0),
+    reportedQueueDepth(0),
+    maxLoopUs(0),
+    connectTask(nullptr),
+    clientId(),
+    connectResult(CONNECT_PENDING),
+    connectError(0),
+    task(TaskScheduler::NONE),
+    rxPending(false),
+    rxReadyUs(0),
+    lastLatencyUs(0),
+    maxLatencyUs(0),
+    latencyCount(0),
+    latencySumUs(0),
+    cmdStats(),
+    rejectedCommands(0)
 {}
 
 bool MQTTService::begin(ClockService* clockSvc, LogService* logSvc) {
     this->clock = clockSvc;
     this->log = logSvc;
 
-    setupWiFi();
+    buildCommandFilters();
     setupTLS();
 
     mqttClient.setServer(MQTT_BROKER, MQTT_PORT);
@@ -28,37 +73,40 @@ bool MQTTService::begin(ClockService* clockSvc, LogService* logSvc) {
         this->mqttCallback(topic, payload, length);
     });
 
-    // Configurar timeout maior para TLS
-    mqttClient.setSocketTimeout(30);
-    mqttClient.setKeepAlive(60);
+    mqttClient.setSocketTimeout(MQTT_IO_TIMEOUT_S);
+    mqttClient.setKeepAlive(MQTT_KEEPALIVE_S);
+    mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
+
+    // Prioridade 1 no núcleo 0 (o do WiFi): o loop no núcleo 1 não perde ciclo
+    if (!connectTask &&
+        xTaskCreatePinnedToCore(connectTaskMain, "mqtt_conn", MQTT_CONNECT_STACK, this, 1,
+                                &connectTask, 0) != pdPASS) {
+        LOG_ERROR("Falha ao criar a tarefa de conexão MQTT");
+        return false;
+    }
+
+    if (task == TaskScheduler::NONE) {
+        task = scheduler.add("mqtt", runTask, this);
+    }
+
+    // A associação segue em segundo plano; loop() acompanha cada etapa
+    startWiFiJoin();
 
     LOG("✅ MQTT Service inicializado com TLS");
     return true;
 }
 
-void MQTTService::setupWiFi() {
-    LOG_START("Conexão WiFi");
-    LOG_KV("SSID", WIFI_SSID);
-
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-
-    LOG_INFO("Aguardando conexão WiFi");
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 30) {
-        delay(1000);
-        LOG_NO_NL(".");
-        attempts++;
-        if (attempts % 10 == 0) Serial.println();
-    }
-    Serial.println();
+void MQTTService::buildCommandFilters() {
+    // Montados uma vez: a decodificação de cada comando só lê os filtros
+    verbFilter.clear();
+    verbFilter["cmd"] = true;
 
-    if (WiFi.status() == WL_CONNECTED) {
-        LOG_SUCCESS("WiFi conectado");
-        LOG_KV("IP", WiFi.localIP().toString());
-        LOG_KV("RSSI", String(WiFi.RSSI()) + " dBm");
-        LOG_KV("Tentativas", String(attempts));
-    } else {
-        LOG_ERROR("Falha na conexão WiFi após " + String(attempts) + " tentativas");
+    for (uint8_t i = 0; i < CommandRegistry::COUNT; i++) {
+        const CommandSpec& spec = CommandRegistry::spec((CommandId)i);
+        cmdFilters[i].clear();
+        for (uint8_t f = 0; f < spec.fieldCount; f++) {
+            cmdFilters[i][spec.fields[f].key] = true;
+        }
     }
 }
 
@@ -67,42 +115,54 @@ void MQTTService::setupTLS() {
 
     #if MQTT_VALIDATE_CERT
         wifiClient.setCACert(MQTT_ROOT_CA);
-        wifiClient.setTimeout(30);
         LOG_SUCCESS("TLS configurado com validação de certificado");
         LOG_KV("Modo", "Seguro (valida certificado)");
     #else
         wifiClient.setInsecure();  // Aceita qualquer certificado
-        wifiClient.setTimeout(30);
         LOG_SUCCESS("TLS configurado sem validação de certificado");
         LOG_KV("Modo", "Inseguro (aceita qualquer certificado)");
     #endif
 
-    LOG_KV("Timeout", "30s");
+    wifiClient.setHandshakeTimeout(MQTT_CONNECT_TIMEOUT_S);
+    LOG_KV("Timeout", String(MQTT_CONNECT_TIMEOUT_S) + "s por etapa (fora do loop)");
 }
 
 void MQTTService::mqttCallback(char* topic, byte* payload, unsigned int length) {
-    // Converter payload para string
-    char message[length + 1];
-    memcpy(message, payload, length);
-    message[length] = '\0';
+    // Limite rígido antes de qualquer decodificação (nada é copiado para a pilha)
+    if (length > MQTT_CMD_MAX_BYTES) {
+        rejectedCommands++;
+        LOG_WARN("Mensagem de " + String(length) + " B descartada (limite " +
+                 String(MQTT_CMD_MAX_BYTES) + " B, " + String(rejectedCommands) + " rejeitadas)");
+        return;
+    }
+
+    // Termina a string no próprio buffer do PubSubClient: o payload é o fim
+    // do pacote e, abaixo do limite, sobra espaço no buffer (ver static_assert)
+    payload[length] = '\0';
+    const char* message = (const char*)payload;
 
     LOG_MQTT_IN(topic, message);
 
     // Processar apenas comandos do tópico correto
-    if (String(topic) == TOPIC_CMD) {
-        handleCommand(topic, message);
+    if (strcmp(topic, TOPIC_CMD) == 0) {
+        handleCommand(message, length);
     } else {
         LOG_WARN("Tópico ignorado: " + String(topic));
     }
 }
 
-void MQTTService::handleCommand(const char* topic, const char* payload) {
+void MQTTService::handleCommand(const char* payload, size_t length) {
     LOG_SEPARATOR();
     LOG_INFO("Processando comando MQTT");
 
-    // Parse JSON usando ArduinoJson
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, payload);
+    uint32_t stackFreeBefore = uxTaskGetStackHighWaterMark(nullptr);
+
+    // 1ª passada: só o verbo, no pool fixo
+    cmdPool.reset();
+    JsonDocument doc(&cmdPool);
+    DeserializationError error = deserializeJson(doc, payload, length,
+                                                 DeserializationOption::Filter(verbFilter),
+                                                 DeserializationOption::NestingLimit(MQTT_CMD_MAX_DEPTH));
 
     if (error) {
         LOG_ERROR("Falha ao parsear JSON: " + String(error.c_str()));
@@ -112,9 +172,10 @@ void MQTTService::handleCommand(const char* topic, const char* payload) {
     }
 
     // Extrair comando
-    String cmd = doc["cmd"] | "";
+    char cmd[16];
+    strlcpy(cmd, doc["cmd"] | "", sizeof(cmd));
 
-    if (cmd.isEmpty()) {
+    if (cmd[0] == '\0') {
         LOG_ERROR("Campo 'cmd' não encontrado no JSON");
         LOG_SEPARATOR();
         return;
@@ -122,283 +183,650 @@ void MQTTService::handleCommand(const char* topic, const char* payload) {
 
     LOG_KV("Comando", cmd);
 
-    // ========== COMANDO: FEED (Alimentação Manual) ==========
-    if (cmd == "FEED") {
-        int quantity = doc["quantity"] | 100;
-        LOG_KV("Quantidade", String(quantity) + "g");
-
-        // Validar quantidade
-        if (!validateFeedQuantity(quantity)) {
-            LOG_ERROR("Quantidade inválida: " + String(quantity) + "g (min: " +
-                     String(MIN_FEED_QUANTITY) + "g, max: " + String(MAX_FEED_QUANTITY) + "g)");
+    // 2ª passada: só os campos do comando (o resto do JSON é descartado no parse)
+    CommandId id = CommandRegistry::find(cmd);
+    uint8_t index = (uint8_t)id;
+    size_t docBytes = cmdPool.peak();
+    doc.clear();
+    cmdPool.reset();
+
+    if (id != CommandId::UNKNOWN) {
+        error = deserializeJson(doc, payload, length,
+                                DeserializationOption::Filter(cmdFilters[index]),
+                                DeserializationOption::NestingLimit(MQTT_CMD_MAX_DEPTH));
+        if (cmdPool.peak() > docBytes) docBytes = cmdPool.peak();
+
+        if (error) {
+            LOG_ERROR("Falha ao parsear " + String(cmd) + ": " + String(error.c_str()));
             publishStatus(true);
             LOG_SEPARATOR();
             return;
         }
+    }
 
-        LOG_START("Alimentação manual");
+    recordLatency();
+    dispatchCommand(id, doc, cmd);
+    recordCommandStats(index, docBytes, stackFreeBefore);
+}
 
-        // Executar alimentação
-        bool success = feederService.dispense(quantity);
+void MQTTService::recordLatency() {
+    // Um aviso do socket por rajada: só o 1º comando dela tem o instante de chegada
+    uint32_t readyUs = rxReadyUs;
+    if (readyUs == 0) return;
+    rxReadyUs = 0;
+
+    lastLatencyUs = micros() - readyUs;
+    if (lastLatencyUs > maxLatencyUs) maxLatencyUs = lastLatencyUs;
+    latencySumUs += lastLatencyUs;
+    latencyCount++;
+    LOG_DEBUG("⏱ Latência do comando: " + String(lastLatencyUs) + "µs");
+}
 
-        // Publicar status de confirmação
-        publishStatus(true);
+void MQTTService::recordCommandStats(uint8_t index, size_t docBytes, uint32_t stackFreeBefore) {
+    CommandStats& stats = cmdStats[index];
+    stats.count++;
 
-        if (success) {
-            LOG_COMPLETE("Alimentação manual");
-        } else {
-            LOG_WARN("Alimentação com possíveis problemas");
+    bool newPeak = false;
+    if (docBytes > stats.peakDocBytes) {
+        stats.peakDocBytes = docBytes;
+        newPeak = true;
+    }
+
+    // O mínimo de pilha livre da loopTask só cai se este comando foi o mais fundo
+    uint32_t stackFreeAfter = uxTaskGetStackHighWaterMark(nullptr);
+    if (stackFreeAfter < stackFreeBefore) {
+        uint16_t used = getArduinoLoopTaskStackSize() - stackFreeAfter;
+        if (used > stats.peakStackBytes) {
+            stats.peakStackBytes = used;
+            newPeak = true;
         }
-        LOG_SEPARATOR();
     }
 
-    // ========== COMANDO: CONFIG_MEAL (Configurar Refeição) ==========
-    else if (cmd == "CONFIG_MEAL") {
-        int meal = doc["meal"] | 0;
-        int hour = doc["hour"] | 0;
-        int minute = doc["minute"] | 0;
-        int quantity = doc["quantity"] | 0;
+    if (newPeak) {
+        LOG_DEBUG("📏 " + String(CommandRegistry::verb((CommandId)index)) + ": documento " + String(stats.peakDocBytes) +
+                  "/" + String(MQTT_CMD_DOC_BYTES) + " B, pilha " + String(stats.peakStackBytes) + " B");
+    }
+}
+
+// Projeção para 24h do que foi publicado desde o boot
+static uint32_t messagesPerDay(uint32_t count) {
+    uint32_t uptimeMin = millis() / 60000;
+    return uptimeMin == 0 ? count : (uint32_t)((uint64_t)count * 1440 / uptimeMin);
+}
+
+bool MQTTService::decodeArgs(CommandId id, JsonDocument& doc, void* args) {
+    const CommandField* bad = nullptr;
+    if (CommandRegistry::decode(id, doc.as<JsonVariantConst>(), args, &bad)) {
+        return true;
+    }
+
+    if (bad->type == CommandField::UINT) {
+        LOG_ERROR("Campo inválido ou ausente: " + String(bad->key) + " (" +
+                  String(bad->min) + "-" + String(bad->max) + ")");
+    } else {
+        LOG_ERROR("Campo inválido: " + String(bad->key));
+    }
+    publishStatus(true);
+    LOG_SEPARATOR();
+    return false;
+}
 
-        LOG_KV("Refeição", String(meal));
-        LOG_KV("Horário", String(hour) + ":" + (minute < 10 ? "0" : "") + String(minute));
-        LOG_KV("Quantidade", String(quantity) + "g");
+void MQTTService::dispatchCommand(CommandId id, JsonDocument& doc, const char* cmd) {
+    switch (id) {
+        // ========== COMANDO: LOG_ACK (Central recebeu os logs) ==========
+        case CommandId::LOG_ACK: {
+            LogAckArgs args;
+            if (!decodeArgs(id, doc, &args)) return;
 
-        // Validações
-        if (!validateMealIndex(meal)) {
-            LOG_ERROR("Índice de refeição inválido: " + String(meal) + " (válido: 0-" + String(MAX_MEALS-1) + ")");
+            logService.onAck(args.jid, args.seq);
+            LOG_SEPARATOR();
+            break;
+        }
+
+        // ========== COMANDO: FEED (Alimentação Manual) ==========
+        case CommandId::FEED: {
+            FeedArgs args;
+            if (!decodeArgs(id, doc, &args)) return;
+            LOG_KV("Quantidade", String(args.quantity) + "g");
+            LOG_KV("Reservatório", String(args.channel));
+            if (args.reqId != 0) {
+                LOG_KV("Pedido", String(args.reqId));
+            }
+
+            // Inicia ou entra na fila do reservatório; o FEED_ACK sai ao concluir (com req_id)
+            if (!feederService.dispense(args.quantity, "manual", args.reqId, FeedPriority::NORMAL, args.channel)) {
+                publishFeedAck(args.quantity, false, "manual", 0, -1, args.reqId, 0, args.channel);
+            }
+            LOG_SEPARATOR();
+            break;
+        }
+
+        // ========== COMANDO: CONFIG_MEAL (Configurar Refeição) ==========
+        case CommandId::CONFIG_MEAL: {
+            MealConfigArgs args;
+            if (!decodeArgs(id, doc, &args)) return;
+
+            LOG_KV("Refeição", String(args.meal));
+            LOG_KV("Horário", String(args.hour) + ":" + (args.minute < 10 ? "0" : "") + String(args.minute));
+            LOG_KV("Quantidade", String(args.quantity) + "g");
+            LOG_KV("Reservatório", String(args.channel));
+            if (!feederService.isValidChannel(args.channel)) {
+                LOG_SEPARATOR();
+                return;
+            }
+
+            LOG_START("Configuração de refeição");
+
+            // Configurar refeição no ScheduleService (enabled = true por padrão)
+            scheduleService.setMeal(args.meal, args.hour, args.minute, args.quantity, true, args.days,
+                                    args.channel);
+
+            // Confirmar execução
             publishStatus(true);
+            LOG_COMPLETE("Refeição configurada");
             LOG_SEPARATOR();
-            return;
+            break;
+        }
+
+        // ========== COMANDO: SYNC (Sincronizar Logs) ==========
+        case CommandId::SYNC: {
+            LOG_START("Sincronização de logs");
+            publishStatus(true);
+
+            int pendingLogs = logService.getPendingLogsCount();
+            LOG_KV("Logs pendentes", String(pendingLogs));
+
+            if (pendingLogs > 0) {
+                logService.sendPendingLogsMQTT();
+                LOG_INFO("Logs sendo enviados em lotes");
+            } else {
+                LOG_INFO("Nenhum log pendente para enviar");
+            }
+            LOG_SEPARATOR();
+            break;
         }
 
-        if (!validateTime(hour, minute)) {
-            LOG_ERROR("Horário inválido: " + String(hour) + ":" + String(minute));
+        // ========== COMANDO: CALIBRATE (Calibração do Dispensador) ==========
+        case CommandId::CALIBRATE: {
+            // Passos: "run" (aciona por "ms"), "record" (peso em "grams"), "clear", "show"
+            CalibrateArgs args;
+            if (!decodeArgs(id, doc, &args)) return;
+            LOG_KV("Passo", args.step);
+            LOG_KV("Reservatório", String(args.channel));
+
+            if (strcmp(args.step, "run") == 0) {
+                feederService.startCalibrationRun(args.ms, args.channel);
+            } else if (strcmp(args.step, "record") == 0) {
+                if (args.grams == 0) {
+                    LOG_ERROR("Peso não informado");
+                } else {
+                    feederService.recordCalibration(args.grams, args.channel);
+                }
+            } else if (strcmp(args.step, "clear") == 0) {
+                feederService.clearCalibration(args.channel);
+            } else {
+                feederService.printCalibration(args.channel);
+            }
+
             publishStatus(true);
             LOG_SEPARATOR();
-            return;
+            break;
         }
 
-        if (!validateFeedQuantity(quantity)) {
-            LOG_ERROR("Quantidade inválida: " + String(quantity) + "g");
+        // ========== COMANDO: STATUS (Solicitar Status) ==========
+        case CommandId::STATUS: {
+            LOG_START("Envio de status");
             publishStatus(true);
+            publishData();  // Publicar telemetria também
+            LOG_KV("Mensagens/dia", String(messagesPerDay(statusPublished + dataPublished)));
+            if (latencyCount > 0) {
+                LOG_KV("Latência de comando", "média " + String((uint32_t)(latencySumUs / latencyCount)) +
+                       "µs, máx " + String(maxLatencyUs) + "µs (" + String(latencyCount) + " cmds)");
+            }
+            scheduler.printStats();
+
+            const FeedQueueStats& queue = feederService.getQueueStats();
+            LOG_KV("Fila de alimentação", String(feederService.getQueueDepth()) + " agora, " +
+                   String(queue.queued) + " esperaram (máx " + String(queue.maxWaitMs) + "ms), " +
+                   String(queue.merged) + " unidos, " + String(queue.rejected) + " recusados");
+            if (rejectedCommands > 0) {
+                LOG_KV("Comandos descartados", String(rejectedCommands));
+            }
+
+            PsramAllocator::printStats();
+            LOG_KV("Logs em RAM", String(logService.getPendingLogsCount()) + " de " +
+                   String(logService.getCapacity()) + " (pico " + String(logService.getPeakPendingLogs()) +
+                   (logService.isRingInPsram() ? ", PSRAM)" : ", interna)"));
+            LOG_COMPLETE("Status enviado");
             LOG_SEPARATOR();
-            return;
+            break;
         }
 
-        LOG_START("Configuração de refeição");
+        // ========== COMANDO: OTA (Atualização por patch) ==========
+        case CommandId::OTA: {
+            OtaArgs args;
+            if (!decodeArgs(id, doc, &args)) return;
+            LOG_KV("URL", args.url);
 
-        // Configurar refeição no ScheduleService
-        scheduleService.setMeal(meal, hour, minute, quantity, true);  // enabled = true por padrão
+            if (!otaService.start(args.url, args.sha256)) {
+                publishOtaStatus("failed", 0, 0, "rejected");
+            }
+            LOG_SEPARATOR();
+            break;
+        }
 
-        // Confirmar execução
-        publishStatus(true);
-        LOG_COMPLETE("Refeição configurada");
-        LOG_SEPARATOR();
+        // ========== COMANDO DESCONHECIDO (ou de outro destino) ==========
+        default:
+            LOG_ERROR("Comando desconhecido: " + String(cmd));
+            publishStatus(true);
+            LOG_SEPARATOR();
+            break;
     }
+}
 
-    // ========== COMANDO: SYNC (Sincronizar Logs) ==========
-    else if (cmd == "SYNC") {
-        LOG_START("Sincronização de logs");
-        publishStatus(true);
+// ========== LOOP PRINCIPAL ==========
 
-        int pendingLogs = logService.getPendingLogsCount();
-        LOG_KV("Logs pendentes", String(pendingLogs));
+uint32_t MQTTService::runTask(void* arg) {
+    return static_cast<MQTTService*>(arg)->loop();
+}
 
-        if (pendingLogs > 0) {
-            logService.sendPendingLogsMQTT();
-            LOG_COMPLETE("Sincronização de logs");
-        } else {
-            LOG_INFO("Nenhum log pendente para enviar");
+uint32_t MQTTService::loop() {
+    uint32_t startUs = micros();
+    uint32_t now = millis();
+    uint32_t inState = now - stateSince;
+    uint32_t next = TaskScheduler::IDLE;   // IDLE e BROKER_CONNECT: a tarefa de conexão acorda
+
+    switch (linkState) {
+        case LinkState::IDLE:
+            break;
+
+        case LinkState::WIFI_JOIN:
+            if (WiFi.status() == WL_CONNECTED) {
+                LOG_SUCCESS("WiFi conectado");
+                LOG_KV("IP", WiFi.localIP().toString());
+                LOG_KV("RSSI", String(WiFi.RSSI()) + " dBm");
+                LOG_KV("Tempo", String(inState) + " ms");
+                startBrokerConnect();
+            } else if (inState >= MQTT_WIFI_JOIN_MS) {
+                LOG_WARN("WiFi não conectou em " + String(MQTT_WIFI_JOIN_MS / 1000) + "s");
+                enterBackoff();
+            }
+            next = MQTT_LINK_POLL_MS;
+            break;
+
+        case LinkState::BROKER_CONNECT: {
+            int8_t result = connectResult;
+            if (result == CONNECT_PENDING) break;
+
+            if (result == CONNECT_OK) {
+                onBrokerConnected();
+                next = MQTT_ONLINE_POLL_MS;   // Sem isso só um pacote recebido acordaria o loop
+                break;
+            }
+
+            int state = connectError;
+            LOG_ERROR("Falha na conexão MQTT");
+            LOG_KV("Código de erro", String(state));
+
+            String errorMsg = "";
+            switch(state) {
+                case -4: errorMsg = "Problema com TLS/Certificado"; break;
+                case -2: errorMsg = "Problema de autenticação"; break;
+                case -1: errorMsg = "Não conseguiu conectar no broker"; break;
+                case 1: errorMsg = "Protocolo incorreto"; break;
+                case 2: errorMsg = "Client ID rejeitado"; break;
+                case 4: errorMsg = "Usuário/senha inválidos"; break;
+                case 5: errorMsg = "Não autorizado"; break;
+                default: errorMsg = "Erro desconhecido";
+            }
+            LOG_KV("Diagnóstico", errorMsg);
+            enterBackoff();
+            next = backoffMs;
+            break;
         }
-        LOG_SEPARATOR();
-    }
 
-    // ========== COMANDO: STATUS (Solicitar Status) ==========
-    else if (cmd == "STATUS") {
-        LOG_START("Envio de status");
-        publishStatus(true);
-        publishData("OK");  // Publicar telemetria também
-        LOG_COMPLETE("Status enviado");
-        LOG_SEPARATOR();
+        case LinkState::ONLINE:
+            if (!mqttClient.loop()) {
+                LOG_WARN(WiFi.status() == WL_CONNECTED ? "Conexão MQTT perdida" : "WiFi desconectado");
+                enterBackoff();
+                next = backoffMs;
+                break;
+            }
+
+            // Nível ou fila: na mudança relevante ou no heartbeat lento
+            if (levelSensor.takeChange() || feederService.getQueueDepth() != reportedQueueDepth ||
+                now - lastDataPublish >= MQTT_DATA_HEARTBEAT_MS) {
+                publishData();
+            }
+
+            // Sinal de vida: só se nada chegou à Central no intervalo (data também conta)
+            if (now - lastStatusPublish >= STATUS_PUBLISH_INTERVAL &&
+                now - lastDataPublish >= STATUS_PUBLISH_INTERVAL) {
+                publishStatus(true);
+            }
+
+            // loop() lê um pacote por vez: o resto da rajada já está no cliente
+            if (wifiClient.available() > 0) {
+                next = 0;
+            } else {
+                next = MQTT_ONLINE_POLL_MS;
+                rxReadyUs = 0;   // Rajada sem comando (ex.: PINGRESP)
+                if (rxPending) {
+                    rxPending = false;
+                    xTaskNotifyGive(connectTask);   // Socket lido: volta a vigiar
+                }
+            }
+            break;
+
+        case LinkState::BACKOFF:
+            if (inState >= backoffMs) {
+                if (WiFi.status() == WL_CONNECTED) {
+                    startBrokerConnect();
+                } else {
+                    startWiFiJoin();
+                    next = MQTT_LINK_POLL_MS;
+                }
+            } else {
+                next = backoffMs - inState;
+            }
+            break;
     }
 
-    // ========== COMANDO DESCONHECIDO ==========
-    else {
-        LOG_ERROR("Comando desconhecido: " + cmd);
-        publishStatus(true);
-        LOG_SEPARATOR();
+    uint32_t elapsed = micros() - startUs;
+    if (elapsed > maxLoopUs) {
+        maxLoopUs = elapsed;
+        if (elapsed > MQTT_LOOP_BUDGET_MS * 1000UL) {
+            LOG_WARN("MQTT loop levou " + String(elapsed / 1000) + " ms (orçamento " +
+                     String(MQTT_LOOP_BUDGET_MS) + " ms)");
+        }
     }
+    return next;
 }
 
-// ========== VALIDAÇÕES ==========
-
-bool MQTTService::validateFeedQuantity(int qty) {
-    return (qty >= MIN_FEED_QUANTITY && qty <= MAX_FEED_QUANTITY);
+bool MQTTService::isConnected() {
+    return linkState == LinkState::ONLINE;
 }
 
-bool MQTTService::validateMealIndex(int meal) {
-    return (meal >= 0 && meal < MAX_MEALS);
-}
+// ========== CONEXÃO (MÁQUINA DE ESTADOS) ==========
 
-bool MQTTService::validateTime(int hour, int minute) {
-    return (hour >= 0 && hour <= 23 && minute >= 0 && minute <= 59);
+void MQTTService::enterState(LinkState next) {
+    linkState = next;
+    stateSince = millis();
 }
 
-// ========== LOOP PRINCIPAL ==========
-
-void MQTTService::loop() {
-    unsigned long now = millis();
+void MQTTService::startWiFiJoin() {
+    LOG_START("Conexão WiFi");
+    LOG_KV("SSID", WIFI_SSID);
 
-    // Reconnect se necessário
-    if (!mqttClient.connected()) {
-        reconnect();
+    if (!wifiStarted) {
+        // Só configura: o listen interval vai no pedido de associação
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD, 0, nullptr, false);
+        configurePowerSave();
+        esp_wifi_connect();
+        wifiStarted = true;
     } else {
-        mqttClient.loop();
-
-        // Publicar status periodicamente
-        if (now - lastStatusPublish >= STATUS_PUBLISH_INTERVAL) {
-            lastStatusPublish = now;
-            publishStatus(true);
-        }
+        WiFi.reconnect();
+    }
+    enterState(LinkState::WIFI_JOIN);
+}
 
-        // Publicar telemetria periodicamente
-        if (now - lastDataPublish >= DATA_PUBLISH_INTERVAL) {
-            lastDataPublish = now;
-            // TODO: Integrar com sensor HC-SR04 real
-            publishData("OK");  // Por enquanto sempre OK
-        }
+void MQTTService::configurePowerSave() {
+    wifi_config_t conf;
+    if (esp_wifi_get_config(WIFI_IF_STA, &conf) == ESP_OK) {
+        conf.sta.listen_interval = MQTT_WIFI_LISTEN_INTERVAL;
+        esp_wifi_set_config(WIFI_IF_STA, &conf);
     }
+    WiFi.setSleep((wifi_ps_type_t)MQTT_WIFI_PS);
+
+    static const char* const modes[] = { "desligado", "a cada DTIM", "a cada " };
+    String mode = modes[MQTT_WIFI_PS];
+    if (MQTT_WIFI_PS == WIFI_PS_MAX_MODEM) mode += String(MQTT_WIFI_LISTEN_INTERVAL) + " beacons";
+    LOG_KV("Modem sleep", mode);
 }
 
-bool MQTTService::isConnected() {
-    return connected && mqttClient.connected();
+void MQTTService::startBrokerConnect() {
+    LOG_START("Conexão MQTT");
+    LOG_KV("Broker", String(MQTT_BROKER) + ":" + String(MQTT_PORT));
+    LOG_KV("Usuário", MQTT_USER);
+
+    snprintf(clientId, sizeof(clientId), "ESP32-S3-%s-%lx", DEVICE_ID, (unsigned long)random(0xffff));
+    LOG_KV("Client ID", clientId);
+
+    // Daqui até o resultado o mqttClient pertence à tarefa de conexão
+    connectResult = CONNECT_PENDING;
+    enterState(LinkState::BROKER_CONNECT);
+    xTaskNotifyGive(connectTask);
 }
 
-// ========== RECONNECT ==========
+void MQTTService::connectTaskMain(void* arg) {
+    // Guiada pelo estado: a notificação só avisa que ele mudou
+    MQTTService* self = static_cast<MQTTService*>(arg);
+    for (;;) {
+        LinkState state = self->linkState;
+        if (state == LinkState::ONLINE) {
+            self->watchSocket();
+        } else if (state == LinkState::BROKER_CONNECT && self->connectResult == CONNECT_PENDING) {
+            self->connectBroker();
+            scheduler.wake(self->task);
+        } else {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+    }
+}
 
-void MQTTService::reconnect() {
-    unsigned long now = millis();
-    if (now - lastReconnectAttempt < 15000) {
+void MQTTService::watchSocket() {
+    // Aviso dado e o loop ainda não leu: espera (senão o select repete o aviso)
+    if (rxPending) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MQTT_LINK_POLL_MS));
         return;
     }
-    lastReconnectAttempt = now;
 
-    if (WiFi.status() != WL_CONNECTED) {
-        LOG_WARN("WiFi desconectado, tentando reconectar");
-        setupWiFi();
+    // Só o select() sobre o descritor: leitura e TLS continuam no loop
+    int fd = wifiClient.fd();
+    if (fd < 0) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MQTT_LINK_POLL_MS));
         return;
     }
 
-    LOG_SEPARATOR();
-    LOG_START("Conexão MQTT");
-    LOG_KV("Broker", String(MQTT_BROKER) + ":" + String(MQTT_PORT));
-    LOG_KV("Usuário", MQTT_USER);
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(fd, &readable);
+    timeval timeout = { 0, MQTT_LINK_POLL_MS * 1000 };
 
-    String clientId = "ESP32-S3-" + String(DEVICE_ID) + "-" + String(random(0xffff), HEX);
-    LOG_KV("Client ID", clientId);
+    int ready = select(fd + 1, &readable, nullptr, nullptr, &timeout);
+    if (ready < 0) {
+        // Socket fechado pelo loop (queda/backoff): o estado muda em seguida
+        vTaskDelay(pdMS_TO_TICKS(MQTT_LINK_POLL_MS));
+        return;
+    }
+    if (ready == 0 || linkState != LinkState::ONLINE) return;
 
-    if (mqttClient.connect(clientId.c_str(), MQTT_USER, MQTT_PASSWORD)) {
-        connected = true;
-        LOG_SUCCESS("MQTT conectado com TLS!");
+    if (rxReadyUs == 0) rxReadyUs = micros();
+    rxPending = true;
+    scheduler.wake(task);
+}
 
-        // Inscrever no tópico de comandos
-        mqttClient.subscribe(TOPIC_CMD);
-        LOG_KV("Inscrito", TOPIC_CMD);
+void MQTTService::connectBroker() {
+    // Tarefa de conexão: DNS, TCP, handshake TLS e CONNACK podem bloquear
+    wifiClient.setTimeout(MQTT_CONNECT_TIMEOUT_S);
+    mqttClient.setSocketTimeout(MQTT_CONNECT_TIMEOUT_S);
 
-        // Publicar status online
-        publishStatus(true);
+    bool ok = mqttClient.connect(clientId, MQTT_USER, MQTT_PASSWORD);
 
-        // Enviar logs pendentes
-        int pendingLogs = logService.getPendingLogsCount();
-        if (pendingLogs > 0) {
-            LOG_INFO("Enviando " + String(pendingLogs) + " logs pendentes");
-            logService.sendPendingLogsMQTT();
-        } else {
-            LOG_DEBUG("Nenhum log pendente");
-        }
-        LOG_SEPARATOR();
+    // Conectado, o socket passa a ser usado pelo loop: timeouts curtos
+    mqttClient.setSocketTimeout(MQTT_IO_TIMEOUT_S);
+    if (ok) wifiClient.setTimeout(MQTT_IO_TIMEOUT_S);
+
+    connectError = mqttClient.state();
+    connectResult = ok ? CONNECT_OK : CONNECT_FAILED;
+}
 
+void MQTTService::onBrokerConnected() {
+    enterState(LinkState::ONLINE);
+    backoffMs = 0;
+    rxPending = false;
+    xTaskNotifyGive(connectTask);   // Passa a vigiar o socket
+    LOG_SUCCESS("MQTT conectado com TLS!");
+
+    // Chegou ao broker: imagem nova (se em teste) está funcionando
+    otaService.confirm();
+
+    // Inscrever no tópico de comandos
+    mqttClient.subscribe(TOPIC_CMD);
+    LOG_KV("Inscrito", TOPIC_CMD);
+
+    // Publicar status online e o nível atual
+    publishStatus(true);
+    levelSensor.takeChange();
+    publishData();
+
+    // Enviar logs pendentes (a Central sem confirmar: espera o backoff do LogService)
+    int pendingLogs = logService.getPendingLogsCount();
+    if (pendingLogs > 0 && logService.isBackingOff()) {
+        LOG_INFO(String(pendingLogs) + " logs pendentes aguardando o ACK da Central");
+    } else if (pendingLogs > 0) {
+        LOG_INFO("Enviando " + String(pendingLogs) + " logs pendentes");
+        logService.sendPendingLogsMQTT();
     } else {
-        connected = false;
-        int state = mqttClient.state();
-        LOG_ERROR("Falha na conexão MQTT");
-        LOG_KV("Código de erro", String(state));
-
-        String errorMsg = "";
-        switch(state) {
-            case -4: errorMsg = "Problema com TLS/Certificado"; break;
-            case -2: errorMsg = "Problema de autenticação"; break;
-            case -1: errorMsg = "Não conseguiu conectar no broker"; break;
-            case 1: errorMsg = "Protocolo incorreto"; break;
-            case 2: errorMsg = "Client ID rejeitado"; break;
-            case 4: errorMsg = "Usuário/senha inválidos"; break;
-            case 5: errorMsg = "Não autorizado"; break;
-            default: errorMsg = "Erro desconhecido";
-        }
-        LOG_KV("Diagnóstico", errorMsg);
-        LOG_SEPARATOR();
+        LOG_DEBUG("Nenhum log pendente");
+    }
+    LOG_SEPARATOR();
+}
+
+void MQTTService::enterBackoff() {
+    if (linkState == LinkState::ONLINE) {
+        mqttClient.disconnect();
+    }
+
+    backoffMs = backoffMs == 0 ? MQTT_BACKOFF_MIN_MS : backoffMs * 2;
+    if (backoffMs > MQTT_BACKOFF_MAX_MS) backoffMs = MQTT_BACKOFF_MAX_MS;
+
+    LOG_INFO("Nova tentativa em " + String(backoffMs / 1000) + "s");
+    LOG_SEPARATOR();
+    enterState(LinkState::BACKOFF);
+}
+
+void MQTTService::shutdown() {
+    // Durante BROKER_CONNECT o cliente é da tarefa: só o WiFi desligado a encerra
+    if (linkState == LinkState::ONLINE) {
+        publishStatus(false);
+        mqttClient.disconnect();
     }
+    enterState(LinkState::IDLE);
+
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+    LOG_INFO("MQTT e WiFi desligados");
 }
 
 // ========== PUBLICAÇÕES (COMPATÍVEL COM PROTOCOLO DA CENTRAL) ==========
 
 void MQTTService::publishStatus(bool online) {
-    if (!mqttClient.connected()) return;
+    if (!isConnected()) return;
 
     // Formato esperado pela Central: {"online": true/false, "timestamp": 12345}
-    JsonDocument doc;
+    JsonDocument doc(&psramAllocator);
     doc["online"] = online;
     doc["timestamp"] = clock ? clock->getTimestamp() : 0;
 
     String payload;
     serializeJson(doc, payload);
 
+    lastStatusPublish = millis();
     if (mqttClient.publish(TOPIC_STATUS, payload.c_str())) {
+        statusPublished++;
         LOG_MQTT_OUT("STATUS", String(online ? "ONLINE" : "OFFLINE"));
     } else {
         LOG_ERROR("Falha ao publicar status");
     }
 }
 
-void MQTTService::publishData(const char* feedLevel) {
-    if (!mqttClient.connected()) return;
+void MQTTService::publishData() {
+    if (!isConnected()) return;
 
     // Formato esperado pela Central: {"feed_level": "OK/LOW/EMPTY", "timestamp": 12345}
-    JsonDocument doc;
+    // Com sensor e medição válida: "level_pct" (0-100)
+    const char* feedLevel = LevelSensor::levelName(levelSensor.getLevel());
+    JsonDocument doc(&psramAllocator);
     doc["feed_level"] = feedLevel;
+    if (levelSensor.getLevel() != FeedLevel::UNKNOWN) {
+        doc["level_pct"] = levelSensor.getPercent();
+    }
+    reportedQueueDepth = feederService.getQueueDepth();
+    if (reportedQueueDepth > 0) {
+        doc["queue_depth"] = reportedQueueDepth;
+        doc["queue_wait_ms"] = feederService.getOldestWaitMs();
+    }
     doc["timestamp"] = clock ? clock->getTimestamp() : 0;
 
     String payload;
     serializeJson(doc, payload);
 
+    lastDataPublish = millis();
     if (mqttClient.publish(TOPIC_DATA, payload.c_str())) {
+        dataPublished++;
         LOG_MQTT_OUT("DATA", "feed_level=" + String(feedLevel));
     } else {
         LOG_ERROR("Falha ao publicar telemetria");
     }
 }
 
-void MQTTService::publishLog(const char* logData) {
-    if (!mqttClient.connected()) return;
+bool MQTTService::publishLog(const char* logData) {
+    if (!isConnected()) return false;
 
     // LogData já vem no formato JSON correto do LogService
     if (mqttClient.publish(TOPIC_LOGS, logData)) {
         LOG_MQTT_OUT("LOGS", "Log enviado");
+        return true;
+    }
+
+    LOG_ERROR("Falha ao publicar log");
+    return false;
+}
+
+void MQTTService::publishOtaStatus(const char* status, uint32_t written, uint32_t total, const char* detail) {
+    if (!isConnected()) return;
+
+    // Formato: {"device_id": "remote1", "status": "downloading/applied/confirmed/failed",
+    // "written": 524288, "total": 1048576, "running": "<sha256 da imagem em execução>"}
+    // Opcional: "detail" (motivo da falha)
+    JsonDocument doc(&psramAllocator);
+    doc["device_id"] = DEVICE_ID;
+    doc["status"] = status;
+    doc["written"] = written;
+    doc["total"] = total;
+    doc["running"] = otaService.getRunningHash();
+    if (detail) doc["detail"] = detail;
+
+    String payload;
+    serializeJson(doc, payload);
+
+    if (mqttClient.publish(TOPIC_OTA, payload.c_str())) {
+        LOG_MQTT_OUT("OTA", String(status));
     } else {
-        LOG_ERROR("Falha ao publicar log");
+        LOG_ERROR("Falha ao publicar status da atualização");
     }
 }
 
-void MQTTService::publishFeedAck(uint16_t quantity, bool success, const char* source) {
-    if (!mqttClient.connected()) return;
+void MQTTService::publishFeedAck(uint16_t quantity, bool success, const char* source,
+                                 uint32_t durationMs, int32_t delivered, uint32_t reqId, uint32_t waitMs,
+                                 uint8_t channel) {
+    if (!isConnected()) return;
 
     // Formato: {"device_id": "remote1", "quantity": 100, "success": true, "source": "manual/schedule", "timestamp": 12345}
-    JsonDocument doc;
+    // Opcionais: "duration_ms" (acionamento), "delivered" (gramas medidas ou pelo modelo),
+    // "req_id" (do comando FEED), "wait_ms" (espera na fila) e "channel" (remota com vários reservatórios)
+    JsonDocument doc(&psramAllocator);
     doc["device_id"] = DEVICE_ID;
     doc["quantity"] = quantity;
     doc["success"] = success;
     doc["source"] = source;
     doc["timestamp"] = clock ? clock->getTimestamp() : 0;
+    if (durationMs > 0) doc["duration_ms"] = durationMs;
+    if (delivered >= 0) doc["delivered"] = delivered;
+    if (reqId != 0) doc["req_id"] = reqId;
+    if (waitMs > 0) doc["wait_ms"] = waitMs;
+    if (FEEDER_CHANNELS > 1) doc["channel"] = channel;
 
     String payload;
     serializeJson(doc, payload);
@@ -0,0 +1,51 @@
+#include "core/FeedLogCodec.h"
+
+static const char* const SOURCE_NAMES[] = {
+    "unknown", "schedule", "manual", "timeout", "mqtt", "rtc_auto"
+};
+
+const char* FeedLogCodec::sourceName(FeedSource source) {
+    uint8_t index = static_cast<uint8_t>(source);
+    return index < static_cast<uint8_t>(FeedSource::COUNT) ? SOURCE_NAMES[index] : SOURCE_NAMES[0];
+}
+
+FeedSource FeedLogCodec::sourceFromName(const char* name) {
+    if (!name) return FeedSource::UNKNOWN;
+
+    for (uint8_t i = 1; i < static_cast<uint8_t>(FeedSource::COUNT); i++) {
+        if (strcmp(name, SOURCE_NAMES[i]) == 0) return static_cast<FeedSource>(i);
+    }
+    return FeedSource::UNKNOWN;
+}
+
+bool FeedLogCodec::fits(uint32_t base, uint32_t timestamp) {
+    // Sem horário (ts=0) sempre cabe; o restante precisa estar à frente da base
+    return timestamp == 0 || (timestamp >= base && timestamp - base <= DELTA_MAX);
+}
+
+void FeedLogCodec::encode(uint8_t* out, uint32_t base, uint32_t timestamp,
+                          uint16_t qty, bool delivered, FeedSource source, uint8_t channel) {
+    uint32_t delta = fits(base, timestamp) && timestamp != 0 ? timestamp - base : DELTA_NONE;
+    uint16_t word = (qty > QTY_MAX ? QTY_MAX : qty) | ((channel & CHANNEL_MAX) << 12) |
+                    (delivered ? 0x8000 : 0);
+
+    out[0] = delta & 0xFF;
+    out[1] = (delta >> 8) & 0xFF;
+    out[2] = (delta >> 16) & 0xFF;
+    out[3] = word & 0xFF;
+    out[4] = word >> 8;
+    out[5] = static_cast<uint8_t>(source);
+}
+
+void FeedLogCodec::decode(const uint8_t* in, uint32_t base, uint32_t& timestamp,
+                          uint16_t& qty, bool& delivered, FeedSource& source, uint8_t& channel) {
+    uint32_t delta = in[0] | (in[1] << 8) | ((uint32_t)in[2] << 16);
+    uint16_t word = in[3] | (in[4] << 8);
+
+    timestamp = delta == DELTA_NONE ? 0 : base + delta;
+    qty = word & QTY_MAX;
+    channel = (word >> 12) & CHANNEL_MAX;
+    delivered = (word & 0x8000) != 0;
+    source = in[5] < static_cast<uint8_t>(FeedSource::COUNT) ? static_cast<FeedSource>(in[5])
+                                                             : FeedSource::UNKNOWN;
+}
@@ -0,0 +1,410 @@
+// delta_patch.cpp
+#include "core/delta_patch.h"
+#include <string.h>
+
+static const uint8_t MAGIC[4] = { 'F', 'D', 'P', '1' };
+
+static uint32_t get32(const uint8_t* in) {
+    return in[0] | (in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+DeltaPatch::DeltaPatch(ReadFn read, WriteFn write, void* ctx) :
+    readFn(read),
+    writeFn(write),
+    ctx(ctx) {
+    reset();
+}
+
+void DeltaPatch::reset() {
+    state = State::HEADER;
+    error = Result::OK;
+    consumed = 0;
+    sourceSize = 0;
+    targetSize = 0;
+    sourceHashed = 0;
+    written = 0;
+    srcPos = 0;
+    remaining = 0;
+    segLeft = 0;
+    varint = 0;
+    varintShift = 0;
+    srcBufPos = 0;
+    srcBufLen = 0;
+    outLen = 0;
+    sha.begin();
+}
+
+DeltaPatch::Result DeltaPatch::fail(Result result) {
+    state = State::FAILED;
+    error = result;
+    return result;
+}
+
+const char* DeltaPatch::resultName(Result result) {
+    switch (result) {
+        case Result::OK:            return "ok";
+        case Result::DONE:          return "done";
+        case Result::BAD_HEADER:    return "bad_header";
+        case Result::WRONG_SOURCE:  return "wrong_source";
+        case Result::CORRUPT:       return "corrupt";
+        case Result::READ_ERROR:    return "read_error";
+        case Result::WRITE_ERROR:   return "write_error";
+        case Result::HASH_MISMATCH: return "hash_mismatch";
+        case Result::TRUNCATED:     return "truncated";
+    }
+    return "?";
+}
+
+DeltaPatch::Result DeltaPatch::write(const uint8_t* data, size_t len, size_t* used) {
+    for (size_t i = 0; i < len; i++) {
+        if (state == State::FAILED) return error;
+        if (state == State::DONE) return fail(Result::CORRUPT);  // Bytes além do fim
+        if (pending()) {
+            if (used) {
+                *used = i;      // O resto depois dos resume()
+                return Result::OK;
+            }
+            Result resumed = resume(UINT32_MAX);
+            if (resumed != Result::OK) return resumed;
+        }
+
+        uint8_t byte = data[i];
+        bool done = false;
+        Result result = Result::OK;
+        consumed++;
+
+        switch (state) {
+            case State::HEADER:
+                header[consumed - 1] = byte;
+                if (consumed == HEADER_SIZE) result = parseHeader();
+                break;
+
+            case State::OP:
+                result = startOp(byte);
+                break;
+
+            case State::COPY_OFFSET:
+                if (!readVarint(byte, done)) return fail(Result::CORRUPT);
+                if (done) {
+                    // zigzag: deslocamentos pequenos para os dois lados ocupam 1-2 bytes
+                    srcPos += (uint32_t)((varint >> 1) ^ (0u - (varint & 1)));
+                    state = State::COPY_LEN;
+                }
+                break;
+
+            case State::COPY_LEN:
+                if (!readVarint(byte, done)) return fail(Result::CORRUPT);
+                if (done) {
+                    remaining = varint;
+                    if (remaining == 0 || remaining > targetSize - written ||
+                        srcPos > sourceSize || remaining > sourceSize - srcPos) {
+                        return fail(Result::CORRUPT);
+                    }
+                    state = State::SEG_SAME;
+                }
+                break;
+
+            case State::SEG_SAME:
+                if (!readVarint(byte, done)) return fail(Result::CORRUPT);
+                if (done) {
+                    if (varint > remaining) return fail(Result::CORRUPT);
+                    remaining -= varint;
+                    segLeft = varint;
+                    state = State::SAME_DATA;
+                }
+                break;
+
+            case State::SEG_COUNT:
+                if (!readVarint(byte, done)) return fail(Result::CORRUPT);
+                if (done) {
+                    if (varint > remaining) return fail(Result::CORRUPT);
+                    segLeft = varint;
+                    state = State::SEG_DIFF;
+                    if (segLeft == 0) result = endOfSegment();
+                }
+                break;
+
+            case State::SEG_DIFF: {
+                uint8_t base;
+                if (!sourceByte(srcPos, base)) return fail(Result::READ_ERROR);
+                srcPos++;
+                remaining--;
+                result = emit((uint8_t)(base + byte));
+                if (result == Result::OK && --segLeft == 0) result = endOfSegment();
+                break;
+            }
+
+            case State::INSERT_LEN:
+                if (!readVarint(byte, done)) return fail(Result::CORRUPT);
+                if (done) {
+                    remaining = varint;
+                    if (remaining == 0 || remaining > targetSize - written) return fail(Result::CORRUPT);
+                    state = State::INSERT_DATA;
+                }
+                break;
+
+            case State::INSERT_DATA:
+                remaining--;
+                result = emit(byte);
+                if (result == Result::OK && remaining == 0) result = endOfOp();
+                break;
+
+            default:
+                break;
+        }
+
+        if (result != Result::OK && result != Result::DONE) return result;
+    }
+
+    if (used) *used = len;
+    return state == State::DONE ? Result::DONE : Result::OK;
+}
+
+DeltaPatch::Result DeltaPatch::resume(uint32_t maxBytes) {
+    switch (state) {
+        case State::SOURCE:    return verifySource(maxBytes);
+        case State::SAME_DATA: return copySame(maxBytes);
+        case State::FAILED:    return error;
+        default:               return Result::OK;
+    }
+}
+
+DeltaPatch::Result DeltaPatch::finish() {
+    if (state == State::DONE) return Result::DONE;
+    if (state == State::FAILED) return error;
+    return fail(Result::TRUNCATED);
+}
+
+bool DeltaPatch::readVarint(uint8_t byte, bool& done) {
+    if (varintShift == 0) varint = 0;
+    if (varintShift == 28 && (byte & 0xF0)) return false;  // Mais de 32 bits
+
+    varint |= (uint32_t)(byte & 0x7F) << varintShift;
+    varintShift += 7;
+    done = !(byte & 0x80);
+    if (done) varintShift = 0;
+    return true;
+}
+
+DeltaPatch::Result DeltaPatch::parseHeader() {
+    if (memcmp(header, MAGIC, sizeof(MAGIC)) != 0) return fail(Result::BAD_HEADER);
+
+    sourceSize = get32(header + 4);
+    targetSize = get32(header + 8);
+    memcpy(targetHash, header + 44, HASH_SIZE);
+    if (targetSize == 0) return fail(Result::BAD_HEADER);
+
+    // Confere a base inteira antes de escrever qualquer byte (verifySource)
+    state = sourceSize > 0 ? State::SOURCE : State::OP;
+    return Result::OK;
+}
+
+DeltaPatch::Result DeltaPatch::verifySource(uint32_t maxBytes) {
+    uint32_t end = sourceSize - sourceHashed > maxBytes ? sourceHashed + maxBytes : sourceSize;
+    while (sourceHashed < end) {
+        size_t n = end - sourceHashed < CHUNK ? end - sourceHashed : CHUNK;
+        if (!readFn(ctx, sourceHashed, src, n)) return fail(Result::READ_ERROR);
+        sha.update(src, n);
+        sourceHashed += n;
+    }
+    if (sourceHashed < sourceSize) return Result::OK;
+
+    uint8_t hash[HASH_SIZE];
+    sha.finish(hash);
+    if (memcmp(hash, header + 12, HASH_SIZE) != 0) return fail(Result::WRONG_SOURCE);
+
+    sha.begin();
+    state = State::OP;
+    return Result::OK;
+}
+
+DeltaPatch::Result DeltaPatch::startOp(uint8_t op) {
+    if (op == OP_COPY && sourceSize > 0) {
+        state = State::COPY_OFFSET;
+    } else if (op == OP_INSERT) {
+        state = State::INSERT_LEN;
+    } else {
+        return fail(Result::CORRUPT);
+    }
+    return Result::OK;
+}
+
+DeltaPatch::Result DeltaPatch::copySame(uint32_t maxBytes) {
+    // Trechos iguais vão da base direto para o buffer de saída
+    uint32_t count = segLeft < maxBytes ? segLeft : maxBytes;
+    segLeft -= count;
+    while (count > 0) {
+        size_t n = CHUNK - outLen;
+        if (n > count) n = count;
+        if (!readFn(ctx, srcPos, out + outLen, n)) return fail(Result::READ_ERROR);
+
+        outLen += n;
+        written += n;
+        srcPos += n;
+        count -= n;
+        if (outLen == CHUNK && !flush()) return fail(Result::WRITE_ERROR);
+    }
+    if (segLeft == 0) state = State::SEG_COUNT;
+    return Result::OK;
+}
+
+bool DeltaPatch::sourceByte(uint32_t pos, uint8_t& value) {
+    if (pos < srcBufPos || pos >= srcBufPos + srcBufLen) {
+        size_t n = sourceSize - pos < CHUNK ? sourceSize - pos : CHUNK;
+        if (!readFn(ctx, pos, src, n)) return false;
+        srcBufPos = pos;
+        srcBufLen = n;
+    }
+    value = src[pos - srcBufPos];
+    return true;
+}
+
+DeltaPatch::Result DeltaPatch::emit(uint8_t byte) {
+    out[outLen++] = byte;
+    written++;
+    if (outLen == CHUNK && !flush()) return fail(Result::WRITE_ERROR);
+    return Result::OK;
+}
+
+bool DeltaPatch::flush() {
+    if (outLen == 0) return true;
+    sha.update(out, outLen);
+    bool ok = writeFn(ctx, out, outLen);
+    outLen = 0;
+    return ok;
+}
+
+DeltaPatch::Result DeltaPatch::endOfSegment() {
+    if (remaining == 0) return endOfOp();
+
+    state = State::SEG_SAME;
+    return Result::OK;
+}
+
+DeltaPatch::Result DeltaPatch::endOfOp() {
+    if (written < targetSize) {
+        state = State::OP;
+        return Result::OK;
+    }
+
+    if (!flush()) return fail(Result::WRITE_ERROR);
+
+    uint8_t hash[HASH_SIZE];
+    sha.finish(hash);
+    if (memcmp(hash, targetHash, HASH_SIZE) != 0) return fail(Result::HASH_MISMATCH);
+
+    state = State::DONE;
+    return Result::DONE;
+}
+
+// ========== SHA-256 ==========
+
+#if defined(ESP_PLATFORM)
+
+DeltaPatch::Sha256::Sha256() {
+    mbedtls_sha256_init(&ctx);
+    begin();
+}
+
+DeltaPatch::Sha256::~Sha256() {
+    mbedtls_sha256_free(&ctx);
+}
+
+void DeltaPatch::Sha256::begin() {
+    mbedtls_sha256_starts(&ctx, 0);
+}
+
+void DeltaPatch::Sha256::update(const uint8_t* data, size_t len) {
+    mbedtls_sha256_update(&ctx, data, len);
+}
+
+void DeltaPatch::Sha256::finish(uint8_t out[HASH_SIZE]) {
+    mbedtls_sha256_finish(&ctx, out);
+}
+
+#else
+
+// Host (tools/delta): FIPS 180-4, sem dependências
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t ror(uint32_t x, uint8_t n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+DeltaPatch::Sha256::Sha256() {
+    begin();
+}
+
+DeltaPatch::Sha256::~Sha256() {}
+
+void DeltaPatch::Sha256::begin() {
+    static const uint32_t H0[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(h, H0, sizeof(h));
+    total = 0;
+}
+
+void DeltaPatch::Sha256::compress(const uint8_t* p) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)p[i * 4] << 24) | ((uint32_t)p[i * 4 + 1] << 16) | (p[i * 4 + 2] << 8) | p[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = k + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+void DeltaPatch::Sha256::update(const uint8_t* data, size_t len) {
+    size_t used = total % 64;
+    total += len;
+
+    if (used > 0) {
+        size_t n = 64 - used < len ? 64 - used : len;
+        memcpy(block + used, data, n);
+        data += n;
+        len -= n;
+        if (used + n < 64) return;
+        compress(block);
+    }
+    for (; len >= 64; data += 64, len -= 64) compress(data);
+    memcpy(block, data, len);
+}
+
+void DeltaPatch::Sha256::finish(uint8_t out[HASH_SIZE]) {
+    uint64_t bits = total * 8;
+    uint8_t pad[72] = { 0x80 };
+    size_t padLen = (total % 64 < 56 ? 56 : 120) - total % 64;
+    for (int i = 0; i < 8; i++) pad[padLen + i] = (uint8_t)(bits >> (56 - i * 8));
+    update(pad, padLen + 8);
+
+    for (int i = 0; i < 8; i++) {
+        out[i * 4] = h[i] >> 24;
+        out[i * 4 + 1] = h[i] >> 16;
+        out[i * 4 + 2] = h[i] >> 8;
+        out[i * 4 + 3] = h[i];
+    }
+}
+
+#endif
@@ -0,0 +1,50 @@
+// psram_alloc.cpp
+#include "core/psram_alloc.h"
+#include "config.h"
+#include <esp_heap_caps.h>
+
+PsramAllocator psramAllocator;
+
+static const uint32_t PSRAM_CAPS = MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+static const uint32_t INTERNAL_CAPS = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+
+bool PsramAllocator::available() {
+    return psramFound();
+}
+
+void* PsramAllocator::alloc(size_t size, bool* inPsram) {
+    void* ptr = available() ? heap_caps_malloc(size, PSRAM_CAPS) : nullptr;
+    if (inPsram) *inPsram = (ptr != nullptr);
+    if (!ptr) ptr = heap_caps_malloc(size, INTERNAL_CAPS);
+    return ptr;
+}
+
+void* PsramAllocator::allocate(size_t size) {
+    return alloc(size);
+}
+
+void PsramAllocator::deallocate(void* ptr) {
+    heap_caps_free(ptr);  // Serve para os dois heaps
+}
+
+void* PsramAllocator::reallocate(void* ptr, size_t newSize) {
+    if (!ptr) return alloc(newSize);
+
+    void* moved = available() ? heap_caps_realloc(ptr, newSize, PSRAM_CAPS) : nullptr;
+    return moved ? moved : heap_caps_realloc(ptr, newSize, INTERNAL_CAPS);
+}
+
+void PsramAllocator::printStats() {
+    LOG_KV("RAM interna", String(heap_caps_get_free_size(INTERNAL_CAPS) / 1024) + " KB livres, mín " +
+           String(heap_caps_get_minimum_free_size(INTERNAL_CAPS) / 1024) + " KB, maior bloco " +
+           String(heap_caps_get_largest_free_block(INTERNAL_CAPS) / 1024) + " KB");
+
+    if (!available()) {
+        LOG_KV("PSRAM", "ausente");
+        return;
+    }
+
+    LOG_KV("PSRAM", String(heap_caps_get_free_size(PSRAM_CAPS) / 1024) + " de " +
+           String(heap_caps_get_total_size(PSRAM_CAPS) / 1024) + " KB livres, mín " +
+           String(heap_caps_get_minimum_free_size(PSRAM_CAPS) / 1024) + " KB");
+}
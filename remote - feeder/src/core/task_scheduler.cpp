@@ -0,0 +1,140 @@
+// task_scheduler.cpp
+#include "core/task_scheduler.h"
+#include "config.h"
+#include <esp_timer.h>
+
+TaskScheduler scheduler;
+
+static_assert(SCHED_MAX_TASKS <= 32, "pending usa um bit por tarefa");
+
+TaskScheduler::TaskScheduler() :
+    tasks(),
+    count(0),
+    loopTask(nullptr),
+    mux(portMUX_INITIALIZER_UNLOCKED),
+    pending(0),
+    idleUs(0),
+    startUs(0) {}
+
+bool TaskScheduler::begin() {
+    loopTask = xTaskGetCurrentTaskHandle();
+    startUs = esp_timer_get_time();
+    return loopTask != nullptr;
+}
+
+int8_t TaskScheduler::add(const char* name, TaskFn fn, void* arg, uint32_t firstMs) {
+    if (count >= SCHED_MAX_TASKS) {
+        LOG_ERROR("Agendador cheio - tarefa " + String(name) + " não registrada");
+        return NONE;
+    }
+
+    Task& task = tasks[count];
+    task.name = name;
+    task.fn = fn;
+    task.arg = arg;
+    task.due = millis() + firstMs;
+    task.armed = firstMs != IDLE;
+    task.stats = TaskStats();
+    return (int8_t)count++;
+}
+
+void TaskScheduler::wake(int8_t id) {
+    if (id < 0 || id >= count) return;
+
+    portENTER_CRITICAL(&mux);
+    pending |= 1UL << id;
+    portEXIT_CRITICAL(&mux);
+
+    if (loopTask) xTaskNotifyGive(loopTask);
+}
+
+void IRAM_ATTR TaskScheduler::wakeFromISR(int8_t id) {
+    if (id < 0) return;
+
+    portENTER_CRITICAL_ISR(&mux);
+    pending |= 1UL << id;
+    portEXIT_CRITICAL_ISR(&mux);
+
+    BaseType_t woken = pdFALSE;
+    if (loopTask) vTaskNotifyGiveFromISR(loopTask, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
+void TaskScheduler::run() {
+    portENTER_CRITICAL(&mux);
+    uint32_t events = pending;
+    pending = 0;
+    portEXIT_CRITICAL(&mux);
+
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < count; i++) {
+        Task& task = tasks[i];
+        bool byEvent = events & (1UL << i);
+
+#if SCHED_FIXED_TICK_MS > 0
+        bool due = true;
+#else
+        bool due = task.armed && (int32_t)(now - task.due) >= 0;
+#endif
+        if (byEvent || due) runTask(task, byEvent && !due);
+    }
+
+    sleepUntilDue();
+}
+
+void TaskScheduler::runTask(Task& task, bool byEvent) {
+    uint32_t start = micros();
+    uint32_t next = task.fn(task.arg);
+    uint32_t elapsed = micros() - start;
+
+    task.stats.runs++;
+    if (byEvent) task.stats.wakeups++;
+    task.stats.totalUs += elapsed;
+    if (elapsed > task.stats.maxUs) task.stats.maxUs = elapsed;
+
+    task.armed = next != IDLE;
+    if (task.armed) task.due = millis() + next;
+}
+
+void TaskScheduler::sleepUntilDue() {
+#if SCHED_FIXED_TICK_MS > 0
+    uint32_t waitMs = SCHED_FIXED_TICK_MS;
+#else
+    uint32_t now = millis();
+    uint32_t waitMs = SCHED_MAX_IDLE_MS;
+    for (uint8_t i = 0; i < count; i++) {
+        if (!tasks[i].armed) continue;
+
+        int32_t left = (int32_t)(tasks[i].due - now);
+        if (left <= 0) return;   // Já venceu: outra volta sem bloquear
+        if ((uint32_t)left < waitMs) waitMs = left;
+    }
+#endif
+
+    // Um wake() durante as tarefas deixa a notificação pendente: retorna na hora
+    uint32_t start = micros();
+#if SCHED_FIXED_TICK_MS > 0
+    delay(waitMs);
+#else
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+#endif
+    idleUs += micros() - start;
+}
+
+float TaskScheduler::getBusyPercent() const {
+    uint64_t total = esp_timer_get_time() - startUs;
+    if (total == 0 || idleUs > total) return 0;
+    return 100.0f * (total - idleUs) / total;
+}
+
+void TaskScheduler::printStats() const {
+    LOG_KV("Loop ocupado", String(getBusyPercent(), 1) + "%" +
+           (SCHED_FIXED_TICK_MS > 0 ? " (tick fixo " + String(SCHED_FIXED_TICK_MS) + "ms)" : String("")));
+
+    for (uint8_t i = 0; i < count; i++) {
+        const TaskStats& s = tasks[i].stats;
+        uint32_t avg = s.runs ? (uint32_t)(s.totalUs / s.runs) : 0;
+        LOG_KV(tasks[i].name, String(s.runs) + " exec (" + String(s.wakeups) + " por evento), média " +
+               String(avg) + "µs, máx " + String(s.maxUs) + "µs");
+    }
+}
@@ -0,0 +1,155 @@
+// feed_calibration.cpp
+#include "hardware/feed_calibration.h"
+#include "config.h"
+
+FeedCalibration::FeedCalibration() : nvsNamespace(NVS_FEED_CAL_NAMESPACE), count(0) {}
+
+bool FeedCalibration::load() {
+    count = 0;
+    if (!prefs.begin(nvsNamespace, true)) {
+        return false;
+    }
+
+    uint8_t stored = prefs.getUChar("count", 0);
+    if (stored > FEED_CAL_POINTS ||
+        prefs.getBytesLength("points") != stored * sizeof(Point)) {
+        stored = 0;
+    }
+    if (stored > 0) {
+        prefs.getBytes("points", points, stored * sizeof(Point));
+    }
+    count = stored;
+
+    prefs.end();
+    return count > 0;
+}
+
+bool FeedCalibration::save() {
+    if (!prefs.begin(nvsNamespace, false)) {
+        LOG_ERROR("Erro ao abrir NVS para salvar calibração");
+        return false;
+    }
+
+    prefs.putUChar("count", count);
+    if (count > 0) {
+        prefs.putBytes("points", points, count * sizeof(Point));
+    } else {
+        prefs.remove("points");
+    }
+
+    prefs.end();
+    return true;
+}
+
+void FeedCalibration::clear() {
+    count = 0;
+    save();
+}
+
+bool FeedCalibration::addPoint(uint32_t ms, uint16_t grams, uint16_t pulses) {
+    if (ms == 0 || grams == 0) return false;
+
+    // Mesmo tempo: a nova medição substitui a anterior
+    for (uint8_t i = 0; i < count; i++) {
+        if (points[i].ms == ms) {
+            points[i].grams = grams;
+            points[i].pulses = pulses;
+            return true;
+        }
+    }
+
+    // Tabela cheia: descarta o ponto mais próximo do novo (mantém a faixa coberta)
+    if (count == FEED_CAL_POINTS) {
+        uint8_t nearest = 0;
+        uint32_t best = UINT32_MAX;
+        for (uint8_t i = 0; i < count; i++) {
+            uint32_t d = points[i].ms > ms ? points[i].ms - ms : ms - points[i].ms;
+            if (d < best) {
+                best = d;
+                nearest = i;
+            }
+        }
+        for (uint8_t i = nearest; i + 1 < count; i++) points[i] = points[i + 1];
+        count--;
+    }
+
+    int pos = count;
+    while (pos > 0 && points[pos - 1].ms > ms) {
+        points[pos] = points[pos - 1];
+        pos--;
+    }
+    points[pos].ms = ms;
+    points[pos].grams = grams;
+    points[pos].pulses = pulses;
+    count++;
+    return true;
+}
+
+uint32_t FeedCalibration::msForGrams(uint16_t grams) const {
+    if (count == 0) {
+        return (uint32_t)grams * 1000 / FEED_DEFAULT_GRAMS_PER_SEC;
+    }
+
+    // Trecho que contém grams (o primeiro parte da origem)
+    uint32_t ms0 = 0, g0 = 0;
+    uint8_t i = 0;
+    while (i < count - 1 && points[i].grams < grams) {
+        ms0 = points[i].ms;
+        g0 = points[i].grams;
+        i++;
+    }
+
+    // Curva não crescente (medição ruim): usa a vazão média do ponto
+    if (points[i].grams <= g0) {
+        return (uint32_t)((uint64_t)grams * points[i].ms / points[i].grams);
+    }
+
+    int64_t ms = ms0 + ((int64_t)grams - g0) * (int64_t)(points[i].ms - ms0) / (int64_t)(points[i].grams - g0);
+    return ms > 0 ? (uint32_t)ms : 0;
+}
+
+uint16_t FeedCalibration::gramsForMs(uint32_t ms) const {
+    if (count == 0) {
+        uint32_t g = ms * FEED_DEFAULT_GRAMS_PER_SEC / 1000;
+        return g > UINT16_MAX ? UINT16_MAX : (uint16_t)g;
+    }
+
+    uint32_t ms0 = 0, g0 = 0;
+    uint8_t i = 0;
+    while (i < count - 1 && points[i].ms < ms) {
+        ms0 = points[i].ms;
+        g0 = points[i].grams;
+        i++;
+    }
+
+    int64_t g = g0 + ((int64_t)ms - ms0) * ((int64_t)points[i].grams - g0) / (int64_t)(points[i].ms - ms0);
+    return (uint16_t)constrain(g, (int64_t)0, (int64_t)UINT16_MAX);
+}
+
+uint32_t FeedCalibration::mgPerPulse() const {
+    uint32_t grams = 0, pulses = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (points[i].pulses == 0) continue;
+        grams += points[i].grams;
+        pulses += points[i].pulses;
+    }
+    return pulses > 0 ? grams * 1000 / pulses : 0;
+}
+
+void FeedCalibration::print() const {
+    if (count == 0) {
+        LOG_KV("Calibração", "padrão (" + String(FEED_DEFAULT_GRAMS_PER_SEC) + " g/s)");
+        return;
+    }
+
+    LOG_INFO("Calibração do dispensador:");
+    for (uint8_t i = 0; i < count; i++) {
+        String info = String(points[i].grams) + "g";
+        if (points[i].pulses > 0) info += " (" + String(points[i].pulses) + " pulsos)";
+        LOG_KV(String(points[i].ms) + "ms", info);
+    }
+    uint32_t mg = mgPerPulse();
+    if (mg > 0) {
+        LOG_KV("Gramas por pulso", String(mg / 1000.0f, 2));
+    }
+}
@@ -0,0 +1,417 @@
+// feeder_channel.cpp
+#include "hardware/feeder_channel.h"
+#include "config.h"
+#include "services/log_service.h"
+#include "core/ClockService.h"
+#include "comm/mqtt_service.h"
+#include "core/task_scheduler.h"
+
+// Calibração por reservatório; o 0 mantém o namespace de antes dos reservatórios
+static const char* const CAL_NAMESPACES[] = {
+    NVS_FEED_CAL_NAMESPACE, "feedcal1", "feedcal2", "feedcal3",
+    "feedcal4", "feedcal5", "feedcal6", "feedcal7"
+};
+
+FeederChannel::FeederChannel() :
+    index(0),
+    hallPin(-1),
+    testing(false),
+    pulseCount(0),
+    clock(nullptr),
+    log(nullptr),
+    dispensing(false),
+    calibrating(false),
+    dispenseStartTime(0),
+    targetMs(0),
+    limitMs(0),
+    current(),
+    queue(),
+    queueCount(0),
+    queueSeq(0),
+    queueStats(),
+    calRunMs(0),
+    calRunPulses(0),
+    lastDurationMs(0),
+    lastDeliveredGrams(0),
+    lastErrorPct(0)
+{}
+
+void IRAM_ATTR FeederChannel::onPulse(void* arg) {
+    static_cast<FeederChannel*>(arg)->pulseCount++;
+}
+
+bool FeederChannel::begin(uint8_t idx, int8_t servoPin, int8_t hall,
+                          ClockService* clockSvc, LogService* logSvc, ServoMotion::WakeFn wake, void* wakeArg) {
+    index = idx;
+    hallPin = hall;
+    clock = clockSvc;
+    log = logSvc;
+
+    if (index >= sizeof(CAL_NAMESPACES) / sizeof(CAL_NAMESPACES[0])) {
+        LOG_ERROR("Reservatório " + String(index) + " acima do máximo suportado");
+        return false;
+    }
+
+    if (hallPin >= 0) {
+        // Pulsos do rotor: realimentação da quantidade dispensada
+        pinMode(hallPin, INPUT_PULLUP);
+        attachInterruptArg(digitalPinToInterrupt(hallPin), onPulse, this, FALLING);
+    }
+
+    // Servo PDI 6221MG (180°) num canal LEDC próprio, partindo do centro (90° = 1500μs)
+    pwm = LedcPwm(SERVO_LEDC_CHANNEL + index);
+    if (!motion.begin(&pwm, servoPin, 1500)) {
+        LOG_ERROR("Falha ao configurar PWM do servo do reservatório " + String(index));
+        return false;
+    }
+    motion.setWakeup(wake, wakeArg);
+
+    calibration.setNamespace(CAL_NAMESPACES[index]);
+    calibration.load();
+
+    LOG_KV("Reservatório " + String(index), "servo no pino " + String(servoPin) +
+           (hasFeedback() ? ", sensor de pulsos (malha fechada)" : ", modelo de tempo"));
+    calibration.print();
+    return true;
+}
+
+bool FeederChannel::dispense(uint16_t quantity, const char* source, uint32_t reqId, FeedPriority priority) {
+    if (quantity == 0 || quantity > MAX_FEED_QUANTITY) {
+        LOG_ERROR("Quantidade inválida: " + String(quantity) + "g");
+        return false;
+    }
+
+    if (!enqueue(quantity, source, reqId, priority)) {
+        queueStats.rejected++;
+        LOG_WARN("Fila do reservatório " + String(index) + " cheia (" + String(FEEDER_QUEUE_SIZE) +
+                 " pedidos) - " + String(quantity) + "g recusados");
+        return false;
+    }
+
+    if (!dispensing && !testing) {
+        startNext(false);
+    } else {
+        queueStats.queued++;
+        LOG_INFO("Reservatório " + String(index) + " ocupado - " + String(quantity) + "g na fila (" +
+                 String(queueCount) + "/" + String(FEEDER_QUEUE_SIZE) + ")");
+    }
+    return true;
+}
+
+bool FeederChannel::enqueue(uint16_t quantity, const char* source, uint32_t reqId, FeedPriority priority) {
+    uint32_t now = millis();
+    FeedRequest::Part part = { reqId, quantity, now };
+
+    // Funde com um pedido recente da mesma fonte que ainda não começou
+    for (uint8_t i = 0; i < queueCount; i++) {
+        FeedRequest& req = queue[i];
+        if (req.priority != priority || strcmp(req.source, source) != 0) continue;
+        if (now - req.lastMergeAt > FEEDER_COALESCE_MS) continue;
+        if (req.partCount >= FEEDER_MERGE_MAX || req.quantity + quantity > MAX_FEED_QUANTITY) continue;
+
+        req.parts[req.partCount++] = part;
+        req.quantity += quantity;
+        req.lastMergeAt = now;
+        queueStats.merged++;
+        LOG_INFO("Pedido de " + String(quantity) + "g unido ao anterior (" + String(req.quantity) + "g)");
+        return true;
+    }
+
+    if (queueCount >= FEEDER_QUEUE_SIZE) return false;
+
+    FeedRequest& req = queue[queueCount++];
+    req.quantity = quantity;
+    req.priority = priority;
+    req.source = source;
+    req.seq = queueSeq++;
+    req.lastMergeAt = now;
+    req.partCount = 1;
+    req.parts[0] = part;
+    return true;
+}
+
+void FeederChannel::startNext(bool servoOpen) {
+    // Maior prioridade primeiro; na mesma prioridade, ordem de chegada
+    uint8_t best = 0;
+    for (uint8_t i = 1; i < queueCount; i++) {
+        if (queue[i].priority > queue[best].priority ||
+            (queue[i].priority == queue[best].priority && (int32_t)(queue[i].seq - queue[best].seq) < 0)) {
+            best = i;
+        }
+    }
+
+    current = queue[best];
+    queue[best] = queue[--queueCount];
+
+    uint32_t now = millis();
+    uint32_t wait = now - current.parts[0].queuedAt;
+    queueStats.lastWaitMs = wait;
+    if (wait > queueStats.maxWaitMs) queueStats.maxWaitMs = wait;
+
+    // Tempo de acionamento pelo modelo calibrado; com sensor, o tempo é
+    // só um limite e a parada vem da quantidade medida
+    targetMs = calibration.msForGrams(current.quantity);
+    limitMs = hasFeedback() ? targetMs * FEEDER_FEEDBACK_MAX_PCT / 100 : targetMs;
+
+    LOG_SUBSECTION("🍖 ALIMENTAÇÃO");
+    LOG_KV("Reservatório", String(index));
+    LOG_KV("Quantidade", String(current.quantity) + "g" +
+           (current.partCount > 1 ? " (" + String(current.partCount) + " pedidos)" : String("")));
+    LOG_KV("Fonte", current.source);
+    LOG_KV("Tempo previsto", String(targetMs) + "ms");
+    if (wait > 0) {
+        LOG_KV("Espera na fila", String(wait) + "ms");
+    }
+    LOG_START("Dispensação de ração");
+
+    dispensing = true;
+    calibrating = false;
+    pulseCount = 0;
+    dispenseStartTime = now;
+
+    // Em sequência a saída já está aberta: sem rampa de fechar e reabrir
+    if (!servoOpen) moveServo(current.quantity);
+}
+
+uint32_t FeederChannel::getOldestWaitMs() const {
+    uint32_t now = millis();
+    uint32_t oldest = 0;
+    for (uint8_t i = 0; i < queueCount; i++) {
+        uint32_t wait = now - queue[i].parts[0].queuedAt;
+        if (wait > oldest) oldest = wait;
+    }
+    return oldest;
+}
+
+uint32_t FeederChannel::loop() {
+    motion.update();
+
+    // Pedidos que chegaram durante o teste do servo ou a calibração
+    if (!dispensing) {
+        if (queueCount == 0 || testing) return TaskScheduler::IDLE;
+        startNext(false);
+        return nextDeadline(0);
+    }
+
+    uint32_t elapsed = millis() - dispenseStartTime;
+    uint32_t pulses = pulseCount;
+
+    if (calibrating) {
+        if (elapsed < targetMs) return targetMs - elapsed;
+        finishCalibrationRun(elapsed, pulses);
+        return queueCount > 0 ? 0 : TaskScheduler::IDLE;
+    }
+
+    bool reached = hasFeedback()
+        ? (uint64_t)pulses * calibration.mgPerPulse() >= (uint64_t)current.quantity * 1000
+        : elapsed >= targetMs;
+
+    if (!reached && elapsed < limitMs) return nextDeadline(elapsed);
+
+    finishDispense(elapsed, pulses);
+
+    // Próximo da fila emendado aqui mesmo, sem voltar ao loop nem fechar a saída
+    if (queueCount > 0) {
+        startNext(true);
+        return nextDeadline(0);
+    }
+
+    moveServo(0);
+    return TaskScheduler::IDLE;
+}
+
+uint32_t FeederChannel::nextDeadline(uint32_t elapsed) const {
+    // Sem sensor o prazo é exato (fim do tempo do modelo); com sensor, consulta os pulsos
+    uint32_t left = limitMs > elapsed ? limitMs - elapsed : 0;
+    return (hasFeedback() && left > FEEDER_FEEDBACK_POLL_MS) ? FEEDER_FEEDBACK_POLL_MS : left;
+}
+
+void FeederChannel::finishDispense(uint32_t elapsed, uint32_t pulses) {
+    // A saída fica aberta: quem chama fecha ou emenda o próximo pedido
+    dispensing = false;
+
+    // Entregue: medido pelos pulsos ou estimado pelo modelo
+    uint16_t delivered = calibration.gramsForMs(elapsed);
+    if (hasFeedback()) {
+        uint64_t measured = (uint64_t)pulses * calibration.mgPerPulse() / 1000;
+        delivered = measured > UINT16_MAX ? UINT16_MAX : (uint16_t)measured;
+    }
+
+    lastDurationMs = elapsed;
+    lastDeliveredGrams = delivered;
+    lastErrorPct = (int16_t)(((int32_t)delivered - current.quantity) * 100 / current.quantity);
+
+    LOG_KV("Tempo de dispensação", String(elapsed / 1000.0, 1) + "s (previsto " +
+           String(targetMs / 1000.0, 1) + "s)");
+    LOG_KV("Entregue", String(delivered) + "g (" + (lastErrorPct >= 0 ? "+" : "") +
+           String(lastErrorPct) + "%" + (hasFeedback() ? ", medido)" : ", modelo)"));
+
+    bool success = checkSensor(delivered);
+
+    // Parou pelo limite sem atingir a quantidade: rotor travado ou sem ração
+    const char* source = (!success && elapsed >= limitMs) ? "timeout" : current.source;
+
+    // Log e confirmação por pedido; em pedidos fundidos, o entregue é rateado
+    uint32_t startedAt = dispenseStartTime;
+    for (uint8_t i = 0; i < current.partCount; i++) {
+        const FeedRequest::Part& part = current.parts[i];
+        uint16_t share = (uint16_t)((uint32_t)delivered * part.quantity / current.quantity);
+
+        if (log && clock) {
+            log->addLog(
+                clock->getTimestamp(),
+                part.quantity,
+                success,
+                source,
+                index
+            );
+        }
+
+        mqttService.publishFeedAck(part.quantity, success, source, elapsed, share,
+                                   part.reqId, startedAt - part.queuedAt, index);
+    }
+
+    if (success) {
+        LOG_COMPLETE("Dispensação de ração");
+        LOG_SUCCESS("Alimentação concluída: " + String(delivered) + "g");
+    } else {
+        LOG_FAILED("Dispensação de ração");
+        LOG_ERROR("Quantidade fora da tolerância de " + String(FEEDER_TOLERANCE_PCT) + "%");
+    }
+    LOG_SEPARATOR();
+}
+
+void FeederChannel::moveServo(uint16_t quantity) {
+    // Rampa em S: o movimento é gerado pelo timer, moveServo() não bloqueia
+    if (quantity == 0) {
+        // Parar: posição central (90° = 1500μs)
+        motion.moveToMicros(1500, FEEDER_SERVO_RAMP_MS);
+        LOG_DEBUG("Servo " + String(index) + " -> PARADO (90° / 1500μs)");
+    } else {
+        // Ângulo absoluto de 30°; a quantidade vem do tempo nessa posição
+        int targetAngle = 30;
+        motion.moveTo(targetAngle, FEEDER_SERVO_RAMP_MS);
+        LOG_DEBUG("Servo " + String(index) + " -> " + String(targetAngle) + "° (" +
+                  String(ServoMotion::angleToMicros(targetAngle)) + "μs) para " + String(quantity) + "g");
+    }
+}
+
+bool FeederChannel::checkSensor(uint16_t delivered) {
+    // Sem sensor de pulsos a quantidade é só a do modelo: não há o que conferir
+    if (!hasFeedback()) {
+        LOG_KV("Sensor", "sem realimentação (modelo calibrado)");
+        return true;
+    }
+
+    int32_t error = (int32_t)delivered - current.quantity;
+    if (error < 0) error = -error;
+    bool withinTolerance = error * 100 <= (int32_t)current.quantity * FEEDER_TOLERANCE_PCT;
+
+    LOG_KV("Sensor de pulsos", withinTolerance ? "✓ DENTRO DA TOLERÂNCIA" : "✗ FORA DA TOLERÂNCIA");
+
+    return withinTolerance;
+}
+
+// ========== CALIBRAÇÃO ==========
+
+bool FeederChannel::startCalibrationRun(uint32_t ms) {
+    if (dispensing || testing) {
+        LOG_WARN("Reservatório " + String(index) + " em uso, aguarde");
+        return false;
+    }
+
+    if (ms == 0 || ms > FEEDER_CAL_MAX_MS) {
+        LOG_ERROR("Tempo de calibração inválido: " + String(ms) + "ms (máx " + String(FEEDER_CAL_MAX_MS) + "ms)");
+        return false;
+    }
+
+    LOG_SUBSECTION("⚖️ CALIBRAÇÃO");
+    LOG_KV("Reservatório", String(index));
+    LOG_KV("Acionamento", String(ms) + "ms");
+    LOG_INFO("Coloque um recipiente vazio sob a saída");
+
+    dispensing = true;
+    calibrating = true;
+    targetMs = ms;
+    limitMs = ms;
+    current.quantity = 0;
+    current.partCount = 0;
+    calRunMs = 0;
+    pulseCount = 0;
+    dispenseStartTime = millis();
+
+    moveServo(1);
+    return true;
+}
+
+void FeederChannel::finishCalibrationRun(uint32_t elapsed, uint32_t pulses) {
+    moveServo(0);
+    dispensing = false;
+    calibrating = false;
+
+    calRunMs = elapsed;
+    calRunPulses = pulses;
+
+    LOG_KV("Acionamento real", String(elapsed) + "ms");
+    if (hallPin >= 0) {
+        LOG_KV("Pulsos", String(pulses));
+    }
+    LOG_INFO("Pese a ração e envie {\"cmd\":\"CALIBRATE\",\"step\":\"record\",\"grams\":N,\"channel\":" +
+             String(index) + "}");
+    LOG_SEPARATOR();
+}
+
+bool FeederChannel::recordCalibration(uint16_t grams) {
+    if (calRunMs == 0) {
+        LOG_ERROR("Nenhuma rodada de calibração para registrar no reservatório " + String(index));
+        return false;
+    }
+
+    uint16_t pulses = 0;
+    if (hallPin >= 0) {
+        pulses = calRunPulses > UINT16_MAX ? UINT16_MAX : (uint16_t)calRunPulses;
+    }
+    if (!calibration.addPoint(calRunMs, grams, pulses) || !calibration.save()) {
+        LOG_ERROR("Falha ao registrar ponto de calibração");
+        return false;
+    }
+
+    LOG_SUCCESS("Ponto registrado: " + String(calRunMs) + "ms → " + String(grams) + "g");
+    calRunMs = 0;
+    calibration.print();
+    return true;
+}
+
+void FeederChannel::clearCalibration() {
+    calibration.clear();
+    calRunMs = 0;
+    LOG_SUCCESS("Calibração do reservatório " + String(index) + " apagada - usando vazão padrão");
+}
+
+void FeederChannel::testServo() {
+    if (dispensing || testing) {
+        LOG_WARN("Servo ocupado, teste ignorado");
+        return;
+    }
+
+    // 0° -> 60° (alimentação) -> 90° -> 120° -> 180° -> centro, 2s em cada
+    static const ServoMotion::Step TEST_STEPS[] = {
+        { ServoMotion::angleToMicros(0),   800, 2000 },
+        { ServoMotion::angleToMicros(60),  800, 2000 },
+        { ServoMotion::angleToMicros(90),  800, 2000 },
+        { ServoMotion::angleToMicros(120), 800, 2000 },
+        { ServoMotion::angleToMicros(180), 800, 2000 },
+        { ServoMotion::angleToMicros(90),  800, 0 },
+    };
+
+    LOG_SUBSECTION("🧪 TESTE DO SERVO");
+    LOG_KV("Reservatório", String(index));
+    LOG("Percorrendo 0° → 60° → 90° → 120° → 180° → 90° com rampas");
+
+    testing = true;
+    motion.runSequence(TEST_STEPS, sizeof(TEST_STEPS) / sizeof(TEST_STEPS[0]), [this]() {
+        testing = false;
+        LOG_SUCCESS("Teste concluído!");
+        LOG_SEPARATOR();
+    });
+}
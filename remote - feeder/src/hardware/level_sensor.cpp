@@ -0,0 +1,215 @@
+// level_sensor.cpp
+#include "hardware/level_sensor.h"
+#include "config.h"
+#include "core/task_scheduler.h"
+
+LevelSensor levelSensor;
+
+// Eco mais longo que isso = nada na frente (~4 m), a medição é descartada
+static const uint32_t ECHO_TIMEOUT_US = 30000;
+
+LevelSensor::LevelSensor() :
+    echoRiseUs(0),
+    echoFallUs(0),
+    echoDone(false),
+    waiting(false),
+    triggerUs(0),
+    lastSample(0),
+    task(TaskScheduler::NONE),
+    window(),
+    windowCount(0),
+    windowIndex(0),
+    filteredCm(NAN),
+    filterReady(false),
+    level(FeedLevel::UNKNOWN),
+    percent(0),
+    reportedPercent(0),
+    reportedLevel(FeedLevel::UNKNOWN),
+    changed(false),
+    confirmCount(0),
+    crossSince(0),
+    lastDetectMs(0),
+    samples(0),
+    invalid(0)
+{}
+
+bool LevelSensor::begin() {
+    if (!isPresent()) {
+        LOG_INFO("Sensor de nível ausente - telemetria fixa em OK");
+        return false;
+    }
+
+    pinMode(LEVEL_TRIG_PIN, OUTPUT);
+    digitalWrite(LEVEL_TRIG_PIN, LOW);
+    pinMode(LEVEL_ECHO_PIN, INPUT);
+    attachInterruptArg(digitalPinToInterrupt(LEVEL_ECHO_PIN), onEcho, this, CHANGE);
+    task = scheduler.add("level", runTask, this);
+
+    LOG("✅ Sensor de nível inicializado");
+    LOG_KV("Faixa", String(LEVEL_FULL_CM) + "cm (cheio) a " + String(LEVEL_EMPTY_CM) + "cm (vazio)");
+    return true;
+}
+
+void IRAM_ATTR LevelSensor::onEcho(void* arg) {
+    LevelSensor* self = static_cast<LevelSensor*>(arg);
+    if (digitalRead(LEVEL_ECHO_PIN)) {
+        self->echoRiseUs = micros();
+    } else if (self->echoRiseUs != 0) {
+        self->echoFallUs = micros();
+        self->echoDone = true;
+        scheduler.wakeFromISR(self->task);
+    }
+}
+
+uint32_t LevelSensor::runTask(void* arg) {
+    return static_cast<LevelSensor*>(arg)->loop();
+}
+
+uint32_t LevelSensor::loop() {
+    if (!isPresent()) return TaskScheduler::IDLE;
+
+    uint32_t now = millis();
+
+    // Medição em andamento: só consulta o resultado da ISR
+    if (waiting) {
+        uint32_t waitedUs = micros() - triggerUs;
+        if (echoDone) {
+            waiting = false;
+            addSample((echoFallUs - echoRiseUs) / 58.0f, now);
+        } else if (waitedUs > ECHO_TIMEOUT_US + 10000) {
+            waiting = false;
+            addSample(NAN, now);
+        } else {
+            return (ECHO_TIMEOUT_US + 10000 - waitedUs) / 1000 + 1;   // Eco perdido
+        }
+        return LEVEL_SAMPLE_MS - (millis() - lastSample);
+    }
+
+    if (now - lastSample < LEVEL_SAMPLE_MS) return LEVEL_SAMPLE_MS - (now - lastSample);
+    lastSample = now;
+
+    // Pulso de 10 µs no TRIG; o eco chega pela interrupção
+    echoRiseUs = 0;
+    echoDone = false;
+    digitalWrite(LEVEL_TRIG_PIN, HIGH);
+    delayMicroseconds(10);
+    digitalWrite(LEVEL_TRIG_PIN, LOW);
+    triggerUs = micros();
+    waiting = true;
+    return (ECHO_TIMEOUT_US + 10000) / 1000 + 1;
+}
+
+void LevelSensor::addSample(float cm, uint32_t nowMs) {
+    samples++;
+
+    // Fora do alcance útil do HC-SR04 (2 cm a 4 m): eco perdido ou espúrio
+    if (isnan(cm) || cm < 2.0f || cm > 400.0f) {
+        invalid++;
+        return;
+    }
+
+    window[windowIndex] = cm;
+    windowIndex = (windowIndex + 1) % LEVEL_MEDIAN_WINDOW;
+    if (windowCount < LEVEL_MEDIAN_WINDOW) windowCount++;
+
+    float med = median();
+    if (!filterReady) {
+        filteredCm = med;
+        filterReady = true;
+    } else {
+        float step = constrain(med - filteredCm, -(float)LEVEL_MAX_STEP_CM, (float)LEVEL_MAX_STEP_CM);
+        filteredCm += step * (LEVEL_EMA_PCT / 100.0f);
+    }
+
+    // Latência de detecção: desde a 1ª medição bruta que já cairia em outra faixa
+    FeedLevel raw = classify(percentFor(cm), level);
+    if (raw == level) {
+        crossSince = 0;
+    } else if (crossSince == 0) {
+        crossSince = nowMs;
+    }
+
+    percent = percentFor(filteredCm);
+    FeedLevel next = classify(percent, level);
+
+    // Primeira classificação é imediata; as trocas pedem confirmação
+    if (next == level) {
+        confirmCount = 0;
+    } else if (level != FeedLevel::UNKNOWN && ++confirmCount < LEVEL_CONFIRM_SAMPLES) {
+        next = level;
+    }
+
+    if (next != level) {
+        confirmCount = 0;
+        lastDetectMs = crossSince != 0 ? nowMs - crossSince : 0;
+        crossSince = 0;
+        if (level == FeedLevel::UNKNOWN) {
+            LOG_INFO("Nível de ração: " + String(levelName(next)) + " (" + String(percent) + "%)");
+        } else {
+            LOG_INFO("Nível de ração: " + String(levelName(level)) + " -> " + String(levelName(next)) +
+                     " (" + String(percent) + "%, detectado em " + String(lastDetectMs / 1000) + "s)");
+        }
+        level = next;
+    }
+
+    int step = (int)percent - (int)reportedPercent;
+    if (level != reportedLevel || step >= LEVEL_REPORT_STEP_PCT || -step >= LEVEL_REPORT_STEP_PCT) {
+        changed = true;
+    }
+}
+
+bool LevelSensor::takeChange() {
+    if (!changed) return false;
+    changed = false;
+    reportedLevel = level;
+    reportedPercent = percent;
+    return true;
+}
+
+FeedLevel LevelSensor::classify(uint8_t pct, FeedLevel current) const {
+    // Descer de faixa no limite; subir só com a histerese acima dele
+    switch (current) {
+        case FeedLevel::EMPTY:
+            if (pct < LEVEL_EMPTY_PCT + LEVEL_HYSTERESIS_PCT) return FeedLevel::EMPTY;
+            break;
+        case FeedLevel::LOW_FEED:
+            if (pct < LEVEL_EMPTY_PCT) return FeedLevel::EMPTY;
+            if (pct < LEVEL_LOW_PCT + LEVEL_HYSTERESIS_PCT) return FeedLevel::LOW_FEED;
+            return FeedLevel::OK;
+        default:
+            break;
+    }
+
+    if (pct < LEVEL_EMPTY_PCT) return FeedLevel::EMPTY;
+    if (pct < LEVEL_LOW_PCT) return FeedLevel::LOW_FEED;
+    return FeedLevel::OK;
+}
+
+uint8_t LevelSensor::percentFor(float cm) {
+    if (cm <= LEVEL_FULL_CM) return 100;
+    if (cm >= LEVEL_EMPTY_CM) return 0;
+    return (uint8_t)lroundf((LEVEL_EMPTY_CM - cm) * 100.0f / (LEVEL_EMPTY_CM - LEVEL_FULL_CM));
+}
+
+float LevelSensor::median() const {
+    float sorted[LEVEL_MEDIAN_WINDOW];
+    for (uint8_t i = 0; i < windowCount; i++) {
+        // Inserção: janela pequena
+        float v = window[i];
+        int j = i - 1;
+        while (j >= 0 && sorted[j] > v) {
+            sorted[j + 1] = sorted[j];
+            j--;
+        }
+        sorted[j + 1] = v;
+    }
+    return sorted[windowCount / 2];
+}
+
+const char* LevelSensor::levelName(FeedLevel level) {
+    switch (level) {
+        case FeedLevel::LOW_FEED: return "LOW";
+        case FeedLevel::EMPTY:    return "EMPTY";
+        default:                  return "OK";   // A Central só conhece OK/LOW/EMPTY
+    }
+}
@@ -0,0 +1,65 @@
+// rtc_source.cpp
+#include "hardware/rtc_source.h"
+#include "config.h"
+#include <Wire.h>
+#include <RTClib.h>
+
+#ifndef RTC_SDA_PIN
+#define RTC_SDA_PIN SDA
+#endif
+#ifndef RTC_SCL_PIN
+#define RTC_SCL_PIN SCL
+#endif
+
+// Qualquer hora anterior a 2024 é considerada inválida (RTC nunca ajustado)
+static const uint32_t RTC_MIN_VALID_UTC = 1704067200UL;
+
+#ifdef RTC_MODEL_DS1307
+static RTC_DS1307 rtc;
+#else
+static RTC_DS3231 rtc;
+#endif
+
+HardwareRtc::HardwareRtc() : present(false) {}
+
+bool HardwareRtc::begin() {
+    Wire.begin(RTC_SDA_PIN, RTC_SCL_PIN);
+    present = rtc.begin(&Wire);
+
+    if (!present) {
+        LOG_WARN(String(name()) + " não encontrado no barramento I2C");
+    }
+    return present;
+}
+
+bool HardwareRtc::read(uint32_t& utcSeconds) {
+    if (!present) return false;
+
+#ifdef RTC_MODEL_DS1307
+    if (!rtc.isrunning()) return false;
+#else
+    if (rtc.lostPower()) return false;
+#endif
+
+    uint32_t now = rtc.now().unixtime();
+    if (now < RTC_MIN_VALID_UTC) return false;
+
+    utcSeconds = now;
+    return true;
+}
+
+bool HardwareRtc::write(uint32_t utcSeconds) {
+    if (!present) return false;
+
+    // adjust() também limpa a flag de perda de energia
+    rtc.adjust(DateTime(utcSeconds));
+    return true;
+}
+
+const char* HardwareRtc::name() const {
+#ifdef RTC_MODEL_DS1307
+    return "DS1307";
+#else
+    return "DS3231";
+#endif
+}
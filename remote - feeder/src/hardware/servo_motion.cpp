@@ -0,0 +1,216 @@
+// servo_motion.cpp
+#include "hardware/servo_motion.h"
+
+// ========== LEDC ==========
+
+LedcPwm::LedcPwm(uint8_t ch) : channel(ch) {}
+
+bool LedcPwm::begin(uint8_t pin) {
+    if (ledcSetup(channel, 50, 16) == 0) {
+        return false;
+    }
+    ledcAttachPin(pin, channel);
+    return true;
+}
+
+void LedcPwm::writeMicros(uint16_t us) {
+    ledcWrite(channel, dutyForMicros(us));
+}
+
+uint32_t LedcPwm::dutyForMicros(uint16_t us) {
+    // Período de 20000 µs em 16 bits
+    return ((uint32_t)us * 65535 + 10000) / 20000;
+}
+
+// ========== MOVIMENTO ==========
+
+ServoMotion::ServoMotion() :
+    output(nullptr),
+    timer(nullptr),
+    mux(portMUX_INITIALIZER_UNLOCKED),
+    moving(false),
+    donePending(false),
+    currentUs(1500),
+    startUs(1500),
+    targetUs(1500),
+    startTime(0),
+    durationUs(0),
+    profile(Profile::S_CURVE),
+    sequence(nullptr),
+    sequenceCount(0),
+    sequenceIndex(0),
+    wakeFn(nullptr),
+    wakeArg(nullptr) {}
+
+bool ServoMotion::begin(PwmOutput* out, uint8_t pin, uint16_t initialMicros) {
+    output = out;
+    if (!output || !output->begin(pin)) {
+        return false;
+    }
+
+    esp_timer_create_args_t args = {};
+    args.callback = onTimer;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "servo";
+    if (esp_timer_create(&args, &timer) != ESP_OK) {
+        return false;
+    }
+
+    currentUs = initialMicros;
+    output->writeMicros(initialMicros);
+    return true;
+}
+
+void ServoMotion::onTimer(void* arg) {
+    static_cast<ServoMotion*>(arg)->tick(esp_timer_get_time());
+}
+
+bool ServoMotion::moveTo(int angle, uint32_t durationMs, DoneCallback done, Profile p) {
+    return moveToMicros(angleToMicros(angle), durationMs, done, p);
+}
+
+bool ServoMotion::moveToMicros(uint16_t us, uint32_t durationMs, DoneCallback done, Profile p) {
+    // Movimento avulso cancela a sequência em andamento
+    sequence = nullptr;
+    sequenceDone = nullptr;
+    return startMove(us, durationMs, done, p);
+}
+
+bool ServoMotion::startMove(uint16_t us, uint32_t durationMs, DoneCallback done, Profile p) {
+    if (!output || !timer) return false;
+
+    esp_timer_stop(timer);  // Ignora erro: pode já estar parado
+
+    portENTER_CRITICAL(&mux);
+    startUs = currentUs;
+    targetUs = constrain(us, 500, 2500);
+    startTime = esp_timer_get_time();
+    durationUs = durationMs * 1000;
+    profile = p;
+    moving = true;
+    donePending = false;
+    portEXIT_CRITICAL(&mux);
+
+    onDone = done;
+
+    if (durationUs == 0) {
+        tick(startTime);
+        return true;
+    }
+    return esp_timer_start_periodic(timer, SERVO_MOTION_TICK_US) == ESP_OK;
+}
+
+bool ServoMotion::runSequence(const Step* steps, uint8_t count, DoneCallback done) {
+    if (!steps || count == 0) return false;
+
+    sequence = steps;
+    sequenceCount = count;
+    sequenceIndex = 0;
+    sequenceDone = done;
+    runNextStep();
+    return true;
+}
+
+void ServoMotion::runNextStep() {
+    if (!sequence) return;
+
+    if (sequenceIndex >= sequenceCount) {
+        sequence = nullptr;
+        DoneCallback done = sequenceDone;
+        sequenceDone = nullptr;
+        if (done) done();
+        return;
+    }
+
+    const Step& step = sequence[sequenceIndex++];
+    startMove(step.micros, step.rampMs, [this, step]() {
+        if (step.holdMs == 0) {
+            runNextStep();
+            return;
+        }
+        // Parado na posição pelo tempo do passo (rampa de percurso zero)
+        startMove(step.micros, step.holdMs, [this]() { runNextStep(); }, Profile::TRAPEZOID);
+    }, Profile::S_CURVE);
+}
+
+void ServoMotion::stop() {
+    if (timer) esp_timer_stop(timer);
+
+    portENTER_CRITICAL(&mux);
+    moving = false;
+    donePending = false;
+    portEXIT_CRITICAL(&mux);
+
+    onDone = nullptr;
+    sequence = nullptr;
+    sequenceDone = nullptr;
+}
+
+void ServoMotion::jumpToMicros(uint16_t us) {
+    stop();
+    currentUs = constrain(us, 500, 2500);
+    if (output) output->writeMicros(currentUs);
+}
+
+void ServoMotion::tick(int64_t nowUs) {
+    bool finished = false;
+    uint16_t us;
+
+    portENTER_CRITICAL(&mux);
+    if (!moving) {
+        portEXIT_CRITICAL(&mux);
+        return;
+    }
+
+    int64_t elapsed = nowUs - startTime;
+    if (durationUs == 0 || elapsed >= (int64_t)durationUs) {
+        finished = true;
+        us = targetUs;
+        moving = false;
+        donePending = true;
+    } else {
+        float s = elapsed > 0 ? (float)elapsed / durationUs : 0.0f;
+        float travel = (float)((int)targetUs - (int)startUs) * profilePosition(profile, s);
+        us = (uint16_t)((int)startUs + (int)lroundf(travel));
+    }
+    currentUs = us;
+    portEXIT_CRITICAL(&mux);
+
+    output->writeMicros(us);
+    if (finished) {
+        if (timer) esp_timer_stop(timer);
+        if (wakeFn) wakeFn(wakeArg);   // update() no loop sem esperar o próximo ciclo
+    }
+}
+
+void ServoMotion::setWakeup(WakeFn fn, void* arg) {
+    wakeFn = fn;
+    wakeArg = arg;
+}
+
+void ServoMotion::update() {
+    if (!donePending) return;
+    donePending = false;
+
+    DoneCallback done = onDone;
+    onDone = nullptr;
+    if (done) done();
+}
+
+float ServoMotion::profilePosition(Profile p, float s) {
+    if (s <= 0.0f) return 0.0f;
+    if (s >= 1.0f) return 1.0f;
+
+    if (p == Profile::S_CURVE) {
+        // 10s³ - 15s⁴ + 6s⁵: velocidade e aceleração nulas nas pontas
+        return s * s * s * (10.0f + s * (-15.0f + 6.0f * s));
+    }
+
+    // Trapezoidal: acelera em a, cruza a v = 1/(1-a), desacelera em a
+    const float a = SERVO_TRAPEZOID_ACCEL_PCT / 100.0f;
+    const float v = 1.0f / (1.0f - a);
+    if (s < a) return 0.5f * v / a * s * s;
+    if (s > 1.0f - a) return 1.0f - 0.5f * v / a * (1.0f - s) * (1.0f - s);
+    return v * (s - 0.5f * a);
+}
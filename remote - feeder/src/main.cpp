@@ -3,12 +3,27 @@
 #include "models.h"
 
 #include "core/ClockService.h"
+#include "hardware/rtc_source.h"
 #include "services/schedule_service.h"
 #include "services/log_service.h"
 #include "hardware/feeder_service.h"
+#include "hardware/level_sensor.h"
 #include "comm/mqtt_service.h"
+#include "services/power_service.h"
+#include "services/ota_service.h"
+#include "core/task_scheduler.h"
+#include "core/psram_alloc.h"
 
 ClockService clockService;
+HardwareRtc hardwareRtc;
+
+// Aplica a sincronização do SNTP e verifica a ressincronização periódica
+static const uint32_t CLOCK_UPDATE_MS = 1000;
+
+static uint32_t runClock(void*) {
+    clockService.update();
+    return CLOCK_UPDATE_MS;
+}
 
 void setup() {
     Serial.begin(115200);
@@ -23,17 +38,19 @@ void setup() {
     LOG_KV("Firmware", "v1.0.0");
     LOG_SEPARATOR();
 
-    // MQTT (conecta WiFi primeiro)
-    LOG_SUBSECTION("🌐 Inicializando Comunicação e WiFi");
-    mqttService.begin(&clockService, &logService);
+    // Cada serviço registra a sua tarefa no begin(); o loop só roda o agendador
+    scheduler.begin();
 
-    // CLOCK SERVICE (após WiFi conectado)
-    LOG_SUBSECTION("⏱ Inicializando ClockService (NTP)");
-    if (!clockService.init()) {
-        LOG_WARN("Clock rodando sem NTP — modo não sincronizado");
+    // RTC (hora disponível em milissegundos, sem depender da rede)
+    LOG_SUBSECTION("⏱ Inicializando ClockService (RTC)");
+    if (clockService.beginRTC(&hardwareRtc)) {
+        LOG_SUCCESS("Hora do RTC em uso - agendamentos ativos sem rede");
+    } else if (PowerService::isWarmWake() && clockService.resumeFromSleep()) {
+        LOG_SUCCESS("Hora mantida durante o deep sleep - agendamentos ativos sem rede");
     } else {
-        LOG_SUCCESS("Clock inicializado");
+        LOG_WARN("RTC indisponível - agendamentos aguardam NTP");
     }
+    scheduler.add("clock", runClock);
 
     // LOG SERVICE
     LOG_SUBSECTION("📝 Inicializando Logs");
@@ -43,21 +60,31 @@ void setup() {
     LOG_SUBSECTION("🍖 Inicializando Alimentador");
     feederService.begin(&clockService, &logService);
 
+    // OTA (confere se esta é uma imagem nova ainda em teste)
+    LOG_SUBSECTION("📦 Inicializando OTA");
+    otaService.begin(&feederService);
+
+    // NÍVEL DE RAÇÃO
+    LOG_SUBSECTION("📏 Inicializando Sensor de Nível");
+    levelSensor.begin();
+
     // SCHEDULE
     LOG_SUBSECTION("📅 Inicializando Agendamentos");
     scheduleService.begin(&clockService, &feederService, &logService);
 
+    // ENERGIA - sobe WiFi/MQTT e NTP (ao acordar do deep sleep, só após a refeição)
+    LOG_SUBSECTION("🔋 Inicializando Energia");
+    powerService.begin(&clockService, &scheduleService, &feederService, &logService);
+
+    LOG_SUBSECTION("🧠 Memória");
+    PsramAllocator::printStats();
+
     LOG_SEPARATOR_DOUBLE();
     LOG_SUCCESS("Sistema 100% inicializado!");
     LOG_SEPARATOR_DOUBLE();
 }
 
 void loop() {
-    clockService.update();
-    mqttService.loop();
-    scheduleService.loop();
-    feederService.loop();
-    logService.loop();
-
-    delay(50);
+    // Roda as tarefas vencidas e bloqueia até o próximo prazo ou evento
+    scheduler.run();
 }
@@ -3,102 +3,568 @@
 #include "config.h"
 #include "core/ClockService.h"
 #include "comm/mqtt_service.h"
+#include "core/task_scheduler.h"
+#include "core/psram_alloc.h"
 #include <ArduinoJson.h>
+#include <LittleFS.h>
+#include <esp_rom_crc.h>
+#include <mbedtls/base64.h>
 
 LogService logService;
 
+// Lote + tópico + cabeçalho MQTT precisam caber no buffer do PubSubClient
+static_assert(LOG_BATCH_MAX_BYTES + 64 <= MQTT_BUFFER_SIZE,
+              "LOG_BATCH_MAX_BYTES não cabe em MQTT_BUFFER_SIZE");
+
 LogService::LogService() :
-    logCount(0),
-    hasPendingLogs(false),
-    clock(nullptr) {}
+    clock(nullptr),
+    fsReady(false),
+    journalBytes(0),
+    lastWriteMicros(0),
+    journalId(0),
+    compactedBytes(0),
+    journalBlock{ false, 0, 0 },
+    compactDue(false),
+    compactBlock{ false, 0, 0 },
+    compactSeq(0),
+    compactTail(0),
+    compactOverflow(0),
+    draining(false),
+    drainStartMs(0),
+    drainSent(0),
+    drainBatches(0),
+    sendSeq(0),
+    sentHigh(0),
+    lastAckMs(0),
+    ackRetries(0),
+    resentLogs(0),
+    resentBytes(0),
+    lastDrainMs(0),
+    batch(nullptr),
+    lastTryMs(0),
+    retryInterval(LOG_SEND_RETRY_INTERVAL),
+    task(TaskScheduler::NONE),
+    logs(internalLogs),
+    ringMask(LOG_RING_SIZE - 1),
+    maxLogs(LOG_RING_LOGS),
+    ringInPsram(false),
+    head(0),
+    tail(0),
+    overflowCount(0),
+    peakPending(0),
+    hasPendingLogs(false) {}
+
+// Restante de um intervalo (0 se já venceu)
+static uint32_t msLeft(uint32_t since, uint32_t interval) {
+    return since >= interval ? 0 : interval - since;
+}
 
 bool LogService::begin(ClockService* clock) {
     this->clock = clock;
 
+    // Formata na primeira vez (partição vazia ou corrompida)
+    fsReady = LittleFS.begin(true);
+    if (!fsReady) {
+        LOG("❌ LittleFS indisponível - logs só em RAM");
+    }
+
+    allocateBuffers();
     loadLogs();
+    ensureJournalId();
+    migrateFromNVS();
+
+    task = scheduler.add("log", runTask, this);
 
     LOG("✅ Log Service inicializado");
-    LOG("📊 Logs pendentes: " + String(logCount));
+    LOG("📊 Logs pendentes: " + String(getPendingLogsCount()) + " (capacidade " + String(maxLogs) +
+        (ringInPsram ? ", PSRAM)" : ")"));
     return true;
 }
 
-void LogService::addLog(uint32_t timestamp, uint16_t qty, bool delivered, const char* source) {
+void LogService::allocateBuffers() {
+    // Lote: PSRAM, ou heap interno sem ela
+    batch = (BatchBuffers*)PsramAllocator::alloc(sizeof(BatchBuffers));
+
+    // Sem PSRAM fica o ring interno (LOG_RING_LOGS), como sempre
+    if (!PsramAllocator::available()) return;
+
+    bool inPsram = false;
+    FeedLog* ring = (FeedLog*)PsramAllocator::alloc(LOG_RING_PSRAM_LOGS * sizeof(FeedLog), &inPsram);
+    if (ring && inPsram) {
+        logs = ring;
+        ringMask = LOG_RING_PSRAM_LOGS - 1;
+        maxLogs = LOG_RING_PSRAM_LOGS;
+        ringInPsram = true;
+    } else {
+        free(ring);  // Grande demais para a RAM interna
+        LOG("⚠️ PSRAM sem espaço para o ring de logs - usando " + String(LOG_RING_LOGS) + " na RAM interna");
+    }
+}
+
+void LogService::addLog(uint32_t timestamp, uint16_t qty, bool delivered, const char* source, uint8_t channel) {
     if (timestamp == 0) {
         LOG("⚠️ Clock sem horário válido — log registrado com ts=0");
     }
 
-    if (logCount >= MAX_LOGS) {
-        LOG("⚠️ Buffer de logs cheio! Sobrescrevendo log mais antigo.");
-        for (int i = 0; i < MAX_LOGS - 1; i++) {
-            logs[i] = logs[i + 1];
-        }
-        logCount = MAX_LOGS - 1;
+    if (head - tail >= maxLogs) {
+        // Descarta o mais antigo avançando o tail (O(1), sem deslocar o array)
+        tail++;
+        overflowCount++;
+        if ((int32_t)(sendSeq - tail) < 0) sendSeq = tail;
+        LOG("⚠️ Buffer de logs cheio! Sobrescrevendo log mais antigo (descartados: " +
+            String(overflowCount) + ")");
     }
 
-    logs[logCount].timestamp = timestamp;
-    logs[logCount].qty = qty;
-    logs[logCount].delivered = delivered;
-    strncpy(logs[logCount].source, source, sizeof(logs[logCount].source) - 1);
-    logs[logCount].source[sizeof(logs[logCount].source) - 1] = '\0';
+    FeedLog& entry = logAt(head);
+    entry.timestamp = timestamp;
+    entry.qty = qty;
+    entry.delivered = delivered;
+    entry.channel = channel;
+    entry.source = FeedLogCodec::sourceFromName(source);
+
+    // ENTRY de 8 B (mais um BASE de 16 B quando o bloco de timestamps muda)
+    uint8_t record[BASE_RECORD_SIZE + ENTRY_RECORD_SIZE];
+    size_t size = encodeEntry(record, head, journalBlock);
+    uint32_t seq = head;
 
-    logCount++;
+    head++;
     hasPendingLogs = true;
+    if (head - tail > peakPending) peakPending = head - tail;
+    scheduler.wake(task);
 
     LOG("📝 Log adicionado: " +
         String(qty) + "g - " +
         (delivered ? "✓ OK" : "✗ FAIL") +
-        " - src=" + String(source));
+        " - src=" + String(source) +
+        (channel > 0 ? " - reservatório " + String(channel) : String("")));
 
-    saveLogs();
+    // Uma única escrita pequena por evento (antes: 4 chaves NVS por log pendente)
+    if (appendBytes(record, size)) {
+        LOG("💾 Journal: " + String(size) + " B em " +
+            String(lastWriteMicros) + " us (seq=" + String(seq) + ")");
+    }
+
+    // A reescrita fica para a tarefa do log (compactStep), em fatias
+    if (needsCompaction()) {
+        compactDue = true;
+    }
 }
 
-void LogService::saveLogs() {
-    if (!prefs.begin(NVS_LOGS_NAMESPACE, false)) {
-        LOG("❌ Erro ao abrir NVS para salvar logs");
-        return;
+static void put32(uint8_t* out, uint32_t value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+    out[2] = (value >> 16) & 0xFF;
+    out[3] = value >> 24;
+}
+
+static uint32_t get32(const uint8_t* in) {
+    return in[0] | (in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// Journal do firmware anterior: registros de 32 B (little-endian)
+//   magic "LF" (2) | tipo | entregue | seq | timestamp | valor | source[12] | CRC32
+// ENTRY: timestamp e quantidade do log. ACK: total descartado e id do journal
+static const uint16_t LEGACY_MAGIC = 0x464C;
+static const uint8_t LEGACY_ENTRY = 1;
+static const uint8_t LEGACY_ACK = 2;
+static const size_t LEGACY_RECORD_SIZE = 32;
+
+size_t LogService::recordSize(uint8_t tag) {
+    switch (tag) {
+        case TAG_ENTRY: return ENTRY_RECORD_SIZE;
+        case TAG_BASE:  return BASE_RECORD_SIZE;
+        case TAG_ACK:   return ACK_RECORD_SIZE;
+        default:        return 0;
     }
+}
 
-    prefs.putInt("logCount", logCount);
+size_t LogService::encodeEntry(uint8_t* out, uint32_t seq, JournalBlock& block) {
+    const FeedLog& entry = logAt(seq);
+    size_t size = 0;
 
-    for (int i = 0; i < logCount; i++) {
-        String prefix = "log" + String(i);
-        prefs.putUInt((prefix + "_timestamp").c_str(), logs[i].timestamp);
-        prefs.putUShort((prefix + "_qty").c_str(), logs[i].qty);
-        prefs.putBool((prefix + "_delivered").c_str(), logs[i].delivered);
-        prefs.putString((prefix + "_source").c_str(), logs[i].source);
+    // Novo bloco quando a sequência não continua o arquivo ou o timestamp
+    // não cabe no delta de 24 bits
+    if (!block.hasBase || block.seq != seq || !FeedLogCodec::fits(block.base, entry.timestamp)) {
+        if (entry.timestamp != 0 || !block.hasBase) block.base = entry.timestamp;
+
+        memset(out, 0, BASE_RECORD_SIZE);
+        out[0] = TAG_BASE;
+        put32(out + 4, seq);
+        put32(out + 8, block.base);
+        put32(out + 12, esp_rom_crc32_le(0, out, 12));
+
+        block.hasBase = true;
+        size = BASE_RECORD_SIZE;
     }
 
-    prefs.end();
-    LOG("💾 Logs salvos: " + String(logCount));
+    uint8_t* rec = out + size;
+    rec[0] = TAG_ENTRY;
+    FeedLogCodec::encode(rec + 1, block.base, entry.timestamp, entry.qty, entry.delivered, entry.source,
+                         entry.channel);
+    rec[7] = esp_rom_crc8_le(0, rec, 7);
+
+    block.seq = seq + 1;
+    return size + ENTRY_RECORD_SIZE;
+}
+
+size_t LogService::encodeAck(uint8_t* out) {
+    memset(out, 0, ACK_RECORD_SIZE);
+    out[0] = TAG_ACK;
+    put32(out + 4, tail);
+    put32(out + 8, overflowCount);
+    put32(out + 12, journalId);
+    put32(out + 16, esp_rom_crc32_le(0, out, 16));
+    return ACK_RECORD_SIZE;
+}
+
+bool LogService::appendBytes(const uint8_t* data, size_t size) {
+    if (!fsReady) return false;
+
+    uint32_t start = micros();
+
+    File file = LittleFS.open(LOG_JOURNAL_PATH, FILE_APPEND);
+    if (!file) {
+        LOG("❌ Erro ao abrir journal de logs");
+        return false;
+    }
+
+    size_t written = file.write(data, size);
+    file.close();
+
+    lastWriteMicros = micros() - start;
+
+    if (written != size) {
+        LOG("❌ Escrita incompleta no journal de logs");
+        return false;
+    }
+
+    journalBytes += size;
+    return true;
+}
+
+void LogService::appendAck() {
+    uint8_t record[ACK_RECORD_SIZE];
+    appendBytes(record, encodeAck(record));
+
+    if (needsCompaction()) {
+        compactDue = true;
+    }
+}
+
+bool LogService::needsCompaction() const {
+    // Com milhares de pendentes o journal compactado já passa do limite;
+    // só reescreve depois de dobrar, senão compactaria a cada log
+    return journalBytes >= LOG_JOURNAL_COMPACT_BYTES && journalBytes >= 2 * compactedBytes;
+}
+
+// Reescreve em arquivo temporário (ACK do tail + pendentes) e troca por
+// rename, que é atômico no LittleFS: uma queda no meio mantém o journal antigo
+static const char* TMP_PATH = LOG_JOURNAL_PATH ".tmp";
+
+bool LogService::compactJournal() {
+    // Inteira, de uma vez: boot, recuperação e clearLogs (só um ACK)
+    abortCompaction();
+    if (!beginCompaction()) return false;
+
+    while (compactSeq != head) {
+        if (!copyPending()) {
+            LOG("❌ Falha ao compactar journal de logs");
+            abortCompaction();
+            return false;
+        }
+    }
+    return finishCompaction();
+}
+
+bool LogService::compactStep() {
+    // Uma fatia por chamada de loop(); addLog e onAck continuam gravando no
+    // journal atual e o que chegar entra no .tmp antes do rename
+    if (!compactFile && !beginCompaction()) {
+        compactDue = false;
+        return false;
+    }
+
+    uint32_t start = millis();
+    while (compactSeq != head && millis() - start < LOG_COMPACT_BUDGET_MS) {
+        if (!copyPending()) {
+            LOG("❌ Falha ao compactar journal de logs");
+            abortCompaction();
+            return false;
+        }
+    }
+    if (compactSeq != head) return true;
+
+    finishCompaction();
+    return false;
+}
+
+bool LogService::beginCompaction() {
+    if (!fsReady) return false;
+
+    compactFile = LittleFS.open(TMP_PATH, FILE_WRITE);
+    if (!compactFile) {
+        LOG("❌ Erro ao criar journal temporário");
+        return false;
+    }
+
+    // O arquivo novo começa sem bloco
+    compactDue = true;
+    compactBlock.hasBase = false;
+    compactSeq = tail;
+    compactTail = tail;
+    compactOverflow = overflowCount;
+
+    uint8_t record[ACK_RECORD_SIZE];
+    size_t size = encodeAck(record);
+    if (compactFile.write(record, size) != size) {
+        LOG("❌ Falha ao compactar journal de logs");
+        abortCompaction();
+        return false;
+    }
+    return true;
+}
+
+bool LogService::copyPending() {
+    uint8_t chunk[LOG_COMPACT_SLICE_BYTES];
+    size_t used = 0;
+
+    while (compactSeq != head && used + BASE_RECORD_SIZE + ENTRY_RECORD_SIZE <= sizeof(chunk)) {
+        // Ring cheio durante a compactação: os mais antigos ainda não copiados
+        // foram sobrescritos. Um ACK leva o tail adiante no replay e a cópia
+        // segue do tail atual (o BASE seguinte recomeça o bloco)
+        if ((int32_t)(compactSeq - tail) < 0) {
+            used += encodeAck(chunk + used);
+            compactSeq = tail;
+            compactTail = tail;
+            compactOverflow = overflowCount;
+            continue;
+        }
+        used += encodeEntry(chunk + used, compactSeq++, compactBlock);
+    }
+    return compactFile.write(chunk, used) == used;
+}
+
+bool LogService::finishCompaction() {
+    // ACKs gravados no journal atual durante a cópia
+    bool ok = true;
+    if (compactTail != tail || compactOverflow != overflowCount) {
+        uint8_t record[ACK_RECORD_SIZE];
+        size_t size = encodeAck(record);
+        ok = compactFile.write(record, size) == size;
+    }
+
+    uint32_t newBytes = compactFile.size();
+    compactFile.close();
+    compactDue = false;
+
+    if (!ok || !LittleFS.rename(TMP_PATH, LOG_JOURNAL_PATH)) {
+        LOG("❌ Falha ao compactar journal de logs");
+        LittleFS.remove(TMP_PATH);
+        return false;
+    }
+
+    LOG("🗜 Journal compactado: " + String(journalBytes) + " → " + String(newBytes) + " B");
+    journalBlock = compactBlock;
+    journalBytes = newBytes;
+    compactedBytes = newBytes;
+    return true;
+}
+
+void LogService::abortCompaction() {
+    compactDue = false;
+    if (!compactFile) return;
+
+    compactFile.close();
+    LittleFS.remove(TMP_PATH);
 }
 
 void LogService::loadLogs() {
-    if (!prefs.begin(NVS_LOGS_NAMESPACE, true)) {
-        LOG("❌ Erro ao abrir NVS para carregar logs");
+    head = 0;
+    tail = 0;
+    hasPendingLogs = false;
+    journalBlock.hasBase = false;
+
+    if (!fsReady) return;
+
+    // Sobra de uma compactação interrompida: o journal original continua válido
+    LittleFS.remove(LOG_JOURNAL_PATH ".tmp");
+
+    File file = LittleFS.open(LOG_JOURNAL_PATH, FILE_READ);
+    if (!file) {
+        LOG("📂 Journal de logs vazio");
+        return;
+    }
+
+    uint32_t fileBytes = file.size();
+    uint32_t validBytes = 0;
+    bool first = true;
+    uint8_t rec[ACK_RECORD_SIZE];
+
+    // Nenhum tag começa com o byte baixo do magic antigo
+    bool legacy = file.peek() == (LEGACY_MAGIC & 0xFF);
+    if (legacy) validBytes = loadLegacyJournal(file);
+
+    // Reproduz o journal até o primeiro registro inválido (escrita interrompida)
+    while (!legacy && file.read(rec, 1) == 1) {
+        size_t size = recordSize(rec[0]);
+        if (size == 0 || file.read(rec + 1, size - 1) != size - 1) break;
+
+        if (rec[0] == TAG_ENTRY) {
+            if (rec[7] != esp_rom_crc8_le(0, rec, 7) || !journalBlock.hasBase) break;
+
+            FeedLog& entry = logAt(journalBlock.seq);
+            bool delivered;
+            uint8_t channel;
+            FeedLogCodec::decode(rec + 1, journalBlock.base, entry.timestamp, entry.qty,
+                                 delivered, entry.source, channel);
+            entry.delivered = delivered;
+            entry.channel = channel;
+
+            head = ++journalBlock.seq;
+            if (head - tail > maxLogs) {
+                overflowCount += (head - tail) - maxLogs;
+                tail = head - maxLogs;
+            }
+        } else {
+            if (get32(rec + size - 4) != esp_rom_crc32_le(0, rec, size - 4)) break;
+
+            uint32_t seq = get32(rec + 4);
+            if (first) {
+                head = seq;
+                tail = seq;
+            }
+
+            if (rec[0] == TAG_BASE) {
+                if (seq != head) break;  // Sequência não continua: corrompido
+                journalBlock.hasBase = true;
+                journalBlock.seq = seq;
+                journalBlock.base = get32(rec + 8);
+            } else {
+                if ((int32_t)(seq - tail) > 0) tail = seq;
+                if ((int32_t)(head - tail) < 0) head = tail;
+                overflowCount = get32(rec + 8);
+                journalId = get32(rec + 12);
+            }
+        }
+
+        first = false;
+        validBytes += size;
+    }
+
+    file.close();
+    journalBytes = fileBytes;
+    compactedBytes = 0;        // Primeira compactação pelo limite absoluto
+    hasPendingLogs = (head != tail);
+    peakPending = head - tail;
+
+    LOG("📂 Logs carregados: " + String(getPendingLogsCount()) +
+        " (journal " + String(fileBytes) + " B, seq " + String(tail) + "→" + String(head) + ")");
+
+    // Descarta a cauda corrompida reescrevendo só o que foi validado
+    if (validBytes != fileBytes) {
+        LOG("⚠️ Journal com " + String(fileBytes - validBytes) + " B inválidos - recuperando");
+    }
+    if (legacy) {
+        LOG("🔄 Journal de 32 B por registro convertido para o formato compacto");
+    }
+    if (legacy || validBytes != fileBytes) {
+        compactJournal();
+    }
+}
+
+uint32_t LogService::loadLegacyJournal(File& file) {
+    uint32_t validBytes = 0;
+    bool first = true;
+    uint8_t rec[LEGACY_RECORD_SIZE];
+
+    // Mesma reprodução do firmware anterior; os logs entram no ring e o
+    // compactJournal() de loadLogs regrava tudo no formato novo
+    while (file.read(rec, sizeof(rec)) == sizeof(rec)) {
+        uint16_t magic = rec[0] | (rec[1] << 8);
+        if (magic != LEGACY_MAGIC || get32(rec + 28) != esp_rom_crc32_le(0, rec, 28)) break;
+
+        uint32_t seq = get32(rec + 4);
+        if (first) {
+            head = seq;
+            tail = seq;
+            first = false;
+        }
+
+        if (rec[2] == LEGACY_ACK) {
+            if ((int32_t)(seq - tail) > 0) tail = seq;
+            if ((int32_t)(head - tail) < 0) head = tail;
+            overflowCount = get32(rec + 8);
+            journalId = get32(rec + 12);
+        } else if (rec[2] == LEGACY_ENTRY) {
+            if ((int32_t)(seq - head) < 0) break;  // Sequência regrediu: corrompido
+
+            char source[13];
+            memcpy(source, rec + 16, 12);
+            source[12] = '\0';
+
+            FeedLog& entry = logAt(seq);
+            entry.timestamp = get32(rec + 8);
+            entry.qty = (uint16_t)get32(rec + 12);
+            entry.delivered = rec[3] != 0;
+            entry.channel = 0;
+            entry.source = FeedLogCodec::sourceFromName(source);
+
+            head = seq + 1;
+            if (head - tail > maxLogs) {
+                overflowCount += (head - tail) - maxLogs;
+                tail = head - maxLogs;
+            }
+        }
+
+        validBytes += sizeof(rec);
+    }
+
+    return validBytes;
+}
+
+void LogService::ensureJournalId() {
+    if (journalId != 0) return;
+
+    // Journal novo (ou de firmware sem id): a Central usa o id para saber
+    // quando a sequência recomeçou e descartar o que já tinha confirmado
+    do {
+        journalId = esp_random();
+    } while (journalId == 0);
+
+    compactJournal();
+    LOG("🆔 Journal de logs id=" + String(journalId));
+}
+
+void LogService::migrateFromNVS() {
+    // Firmwares anteriores guardavam os logs como chaves NVS (log<i>_campo)
+    if (!prefs.begin(NVS_LOGS_NAMESPACE, true)) return;
+
+    int logCount = constrain(prefs.getInt("logCount", 0), 0, MAX_LOGS);
+    if (logCount == 0) {
+        prefs.end();
         return;
     }
 
-    logCount = prefs.getInt("logCount", 0);
-    logCount = constrain(logCount, 0, MAX_LOGS);
+    LOG("🔄 Migrando " + String(logCount) + " logs do NVS para o journal");
 
     for (int i = 0; i < logCount; i++) {
         String prefix = "log" + String(i);
-        logs[i].timestamp = prefs.getUInt((prefix + "_timestamp").c_str(), 0);
-        logs[i].qty = prefs.getUShort((prefix + "_qty").c_str(), 0);
-        logs[i].delivered = prefs.getBool((prefix + "_delivered").c_str(), false);
         String source = prefs.getString((prefix + "_source").c_str(), "unknown");
-        strncpy(logs[i].source, source.c_str(), sizeof(logs[i].source) - 1);
-        logs[i].source[sizeof(logs[i].source) - 1] = '\0';
+        addLog(prefs.getUInt((prefix + "_timestamp").c_str(), 0),
+               prefs.getUShort((prefix + "_qty").c_str(), 0),
+               prefs.getBool((prefix + "_delivered").c_str(), false),
+               source.c_str());
     }
-
-    hasPendingLogs = (logCount > 0);
     prefs.end();
 
-    LOG("📂 Logs carregados: " + String(logCount));
+    if (prefs.begin(NVS_LOGS_NAMESPACE, false)) {
+        prefs.clear();
+        prefs.end();
+    }
 }
 
 void LogService::sendPendingLogsMQTT() {
-    if (logCount == 0) {
+    if (head == tail) {
         hasPendingLogs = false;
         LOG("📊 Nenhum log pendente para enviar");
         return;
@@ -109,66 +575,218 @@ void LogService::sendPendingLogsMQTT() {
         return;
     }
 
-    LOG("📤 Enviando " + String(logCount) + " logs via MQTT...");
+    if (draining) return;
+
+    // Só inicia o envio; os lotes saem aos poucos em loop() (não bloqueia).
+    // Retoma sempre do último seq confirmado pela Central (tail)
+    draining = true;
+    drainStartMs = millis();
+    drainSent = 0;
+    drainBatches = 0;
+    sendSeq = tail;
+    lastAckMs = millis();
+    ackRetries = 0;
+
+    LOG("📤 Enviando " + String(getPendingLogsCount()) + " logs via MQTT em lotes (seq " +
+        String(tail) + ")...");
+    scheduler.wake(task);
+}
 
-    for (int i = 0; i < logCount; i++) {
-        JsonDocument doc;
-        doc["deviceId"] = DEVICE_ID;
-        doc["timestamp"] = logs[i].timestamp;
-        doc["qty"] = logs[i].qty;
-        doc["delivered"] = logs[i].delivered;
-        doc["source"] = logs[i].source;
+uint16_t LogService::publishBatch() {
+    // Logs no mesmo formato compacto do journal (FeedLogCodec), em base64
+    if (!batch) return 0;
+    uint8_t* raw = batch->raw;
+
+    JsonDocument doc(&psramAllocator);
+    doc["deviceId"] = DEVICE_ID;
+    doc["remoteId"] = REMOTE_ID;
+    doc["jid"] = journalId;
+    doc["tail"] = tail;        // Anteriores a isto já foram descartados (ACK ou overflow)
+    doc["seq"] = sendSeq;      // seq do primeiro log do lote; os demais são consecutivos
+    doc["base"] = 0UL;
+    doc["data"] = "";
+
+    // Limites: bytes do payload, janela de ACK e alcance do delta de timestamp
+    size_t header = measureJson(doc) + 10;  // dígitos de "base"
+    uint32_t limit = (LOG_BATCH_MAX_BYTES - header) / 8;
+    if (limit > BATCH_MAX_ENTRIES) limit = BATCH_MAX_ENTRIES;
+    if (limit > head - sendSeq) limit = head - sendSeq;
+    if (limit > LOG_ACK_WINDOW - (sendSeq - tail)) limit = LOG_ACK_WINDOW - (sendSeq - tail);
+
+    uint32_t base = 0;
+    for (uint32_t i = 0; i < limit; i++) {
+        if (logAt(sendSeq + i).timestamp != 0) {
+            base = logAt(sendSeq + i).timestamp;
+            break;
+        }
+    }
 
-        String payload;
-        serializeJson(doc, payload);
+    uint16_t count = 0;
+    while (count < limit) {
+        const FeedLog& entry = logAt(sendSeq + count);
+        if (!FeedLogCodec::fits(base, entry.timestamp)) break;
 
-        mqttService.publishLog(payload.c_str());
+        FeedLogCodec::encode(raw + count * FeedLogCodec::ENTRY_SIZE, base, entry.timestamp,
+                             entry.qty, entry.delivered, entry.source, entry.channel);
+        count++;
+    }
 
-        LOG("  Log " + String(i + 1) +
-            " | ts=" + String(logs[i].timestamp) +
-            " | qty=" + String(logs[i].qty) +
-            " | ok=" + String(logs[i].delivered) +
-            " | src=" + logs[i].source);
+    if (count == 0) return 0;
 
-        delay(80);
+    size_t encodedLen = 0;
+    mbedtls_base64_encode(reinterpret_cast<unsigned char*>(batch->encoded), sizeof(batch->encoded), &encodedLen,
+                          raw, count * FeedLogCodec::ENTRY_SIZE);
+
+    doc["base"] = base;
+    doc["data"] = batch->encoded;
+    size_t size = serializeJson(doc, batch->payload, sizeof(batch->payload));
+
+    if (!mqttService.publishLog(batch->payload)) return 0;
+
+    if ((int32_t)(sentHigh - sendSeq) > 0) {
+        uint32_t resentCount = sentHigh - sendSeq;
+        if (resentCount > count) resentCount = count;
+        resentLogs += resentCount;
+        resentBytes += resentCount * 8;
     }
+    if ((int32_t)(sendSeq + count - sentHigh) > 0) sentHigh = sendSeq + count;
 
-    LOG("✅ Todos os logs enviados");
-    clearLogs();
+    LOG("  Lote " + String(drainBatches + 1) + " | " + String(count) + " logs | " +
+        String(size) + " B | seq " + String(sendSeq) + "-" + String(sendSeq + count - 1));
+    return count;
 }
 
-void LogService::clearLogs() {
-    logCount = 0;
-    hasPendingLogs = false;
+void LogService::drainStep() {
+    // Janela cheia ou tudo enviado: aguarda o ACK da Central; sem resposta,
+    // volta ao tail e reenvia (QoS 0 não garante entrega)
+    if (sendSeq == head || sendSeq - tail >= LOG_ACK_WINDOW) {
+        if (millis() - lastAckMs < LOG_ACK_TIMEOUT_MS) return;
+
+        if (++ackRetries > LOG_ACK_MAX_RETRIES) {
+            // Central fora do ar: a janela não sai de novo a cada 30 s para sempre
+            draining = false;
+            lastTryMs = millis();
+            retryInterval = retryInterval >= LOG_RETRY_BACKOFF_MAX_MS / 2 ? LOG_RETRY_BACKOFF_MAX_MS
+                                                                           : retryInterval * 2;
+            LOG("⚠️ Central não confirmou os logs - " + String(getPendingLogsCount()) +
+                " mantidos, nova tentativa em " + String(retryInterval / 1000) + "s");
+            return;
+        }
+
+        LOG("🔁 Sem ACK da Central - reenviando a partir do seq " + String(tail));
+        sendSeq = tail;
+        lastAckMs = millis();
+    }
+
+    // Orçamento por chamada de loop(): agendamento e feeder seguem rodando
+    uint32_t start = millis();
 
-    if (!prefs.begin(NVS_LOGS_NAMESPACE, false)) {
-        LOG("❌ Erro ao abrir NVS para limpar logs");
+    while (sendSeq != head && sendSeq - tail < LOG_ACK_WINDOW &&
+           millis() - start < LOG_DRAIN_BUDGET_MS) {
+        uint16_t sent = publishBatch();
+
+        // Falha no publish: interrompe e retoma do tail na próxima tentativa
+        if (sent == 0) {
+            draining = false;
+            LOG("⚠️ Envio interrompido - " + String(getPendingLogsCount()) + " logs mantidos");
+            return;
+        }
+
+        sendSeq += sent;
+        drainBatches++;
+    }
+}
+
+void LogService::onAck(uint32_t ackJournalId, uint32_t ackSeq) {
+    if (ackJournalId != journalId) {
+        LOG("⚠️ ACK de logs ignorado (journal " + String(ackJournalId) + ")");
         return;
     }
 
-    prefs.clear();
-    prefs.end();
+    // Só avança: ACK antigo, repetido ou além do que existe é ignorado
+    if ((int32_t)(ackSeq - tail) <= 0 || (int32_t)(ackSeq - head) > 0) return;
+
+    uint32_t acked = ackSeq - tail;
+    tail = ackSeq;
+    drainSent += acked;
+    if ((int32_t)(sendSeq - tail) < 0) sendSeq = tail;
+    lastAckMs = millis();
+    ackRetries = 0;
+    retryInterval = LOG_SEND_RETRY_INTERVAL;
+    scheduler.wake(task);
+
+    LOG("📬 Central confirmou logs até seq " + String(ackSeq - 1) + " (" +
+        String(getPendingLogsCount()) + " pendentes)");
+
+    if (tail != head) {
+        // Espaço liberado só até o confirmado: um ACK no journal
+        appendAck();
+        return;
+    }
+
+    lastDrainMs = millis() - drainStartMs;
+    if (draining) {
+        LOG("✅ " + String(drainSent) + " logs confirmados em " + String(drainBatches) +
+            " lotes (" + String(lastDrainMs) + "ms, reenviados " + String(resentBytes) + " B)");
+    }
+    draining = false;
+    clearLogs();
+}
+
+void LogService::clearLogs() {
+    // A sequência continua crescendo; só o tail alcança o head
+    tail = head;
+    hasPendingLogs = false;
+
+    // Journal reduzido a um único ACK
+    compactJournal();
 
     LOG("🧹 Logs apagados");
 }
 
-void LogService::loop() {
-    static uint32_t lastTry = 0;
+uint32_t LogService::runTask(void* arg) {
+    return static_cast<LogService*>(arg)->loop();
+}
 
-    if (!hasPendingLogs) return;
+uint32_t LogService::loop() {
+    // Compactação pendente: uma fatia por chamada, sem atrasar o envio
+    bool compacting = compactDue && compactStep();
+    uint32_t next = drainLoop();
+    return compacting ? 0 : next;
+}
 
-    if (millis() - lastTry < LOG_SEND_RETRY_INTERVAL) return;
+uint32_t LogService::drainLoop() {
+    if (draining) {
+        if (!mqttService.isConnected()) {
+            draining = false;
+            LOG("⚠️ MQTT caiu durante o envio - " + String(getPendingLogsCount()) + " logs mantidos");
+            return msLeft(millis() - lastTryMs, retryInterval);
+        }
+        drainStep();
 
-    lastTry = millis();
+        // Janela cheia ou tudo enviado: dorme até o timeout do ACK (onAck acorda antes)
+        if (draining && (sendSeq == head || sendSeq - tail >= LOG_ACK_WINDOW)) {
+            return msLeft(millis() - lastAckMs, LOG_ACK_TIMEOUT_MS);
+        }
+        if (draining) return 0;
+    }
+
+    if (!hasPendingLogs) return TaskScheduler::IDLE;
+
+    uint32_t since = millis() - lastTryMs;
+    if (since < retryInterval) return retryInterval - since;
+
+    lastTryMs = millis();
 
     if (!mqttService.isConnected()) {
         LOG("⏳ MQTT off — aguardando para enviar logs...");
-        return;
+        return LOG_SEND_RETRY_INTERVAL;
     }
 
     sendPendingLogsMQTT();
+    return 0;
 }
 
 int LogService::getPendingLogsCount() {
-    return logCount;
+    return (int)(head - tail);
 }
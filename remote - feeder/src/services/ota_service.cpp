@@ -0,0 +1,347 @@
+// ota_service.cpp
+#include "services/ota_service.h"
+#include "config.h"
+#include "comm/mqtt_service.h"
+#include "hardware/feeder_service.h"
+#include "core/task_scheduler.h"
+
+OtaService otaService;
+
+// Com rollback no bootloader, o Arduino só marca a imagem como válida no boot
+// se esta função devolver false; aqui quem marca é o confirm()
+extern "C" bool verifyRollbackLater() {
+    return true;
+}
+
+static void toHex(const uint8_t* data, size_t len, char* out) {
+    static const char DIGITS[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        out[i * 2] = DIGITS[data[i] >> 4];
+        out[i * 2 + 1] = DIGITS[data[i] & 0x0F];
+    }
+    out[len * 2] = '\0';
+}
+
+static bool fromHex(const char* hex, uint8_t* out, size_t len) {
+    if (strlen(hex) != len * 2) return false;
+    for (size_t i = 0; i < len * 2; i++) {
+        char c = tolower(hex[i]);
+        uint8_t v = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : 0xFF;
+        if (v == 0xFF) return false;
+        out[i / 2] = (out[i / 2] << 4) | v;
+    }
+    return true;
+}
+
+OtaService::OtaService() :
+    feeder(nullptr),
+    state(State::IDLE),
+    task(TaskScheduler::NONE),
+    pendingVerify(false),
+    bootMs(0),
+    connectTask(nullptr),
+    httpCode(0),
+    connectDone(false),
+    stream(nullptr),
+    rxPos(0),
+    rxLen(0),
+    patch(readBase, writeImage, this),
+    running(nullptr),
+    target(nullptr),
+    handle(0),
+    otaStarted(false),
+    startMs(0),
+    lastDataMs(0),
+    reportedPct(0) {
+    runningHash[0] = '\0';
+    url[0] = '\0';
+}
+
+bool OtaService::begin(FeederService* feeder) {
+    this->feeder = feeder;
+    running = esp_ota_get_running_partition();
+    bootMs = millis();
+
+    uint8_t hash[DeltaPatch::HASH_SIZE];
+    if (esp_partition_get_sha256(running, hash) == ESP_OK) {
+        toHex(hash, sizeof(hash), runningHash);
+    }
+
+    esp_ota_img_states_t imgState;
+    pendingVerify = esp_ota_get_state_partition(running, &imgState) == ESP_OK &&
+                    imgState == ESP_OTA_IMG_PENDING_VERIFY;
+
+    task = scheduler.add("ota", runTask, this, pendingVerify ? OTA_CONFIRM_TIMEOUT_MS : TaskScheduler::IDLE);
+
+    LOG("✅ OTA Service inicializado");
+    LOG_KV("Partição", String(running->label));
+    LOG_KV("Imagem", String(runningHash).substring(0, 16) + "...");
+    if (pendingVerify) {
+        LOG_WARN("Imagem nova em teste - confirma ao conectar ao broker");
+    }
+    return true;
+}
+
+bool OtaService::start(const char* requestUrl, const char* sha256Hex) {
+    if (state != State::IDLE) {
+        LOG_ERROR("Atualização já em andamento");
+        return false;
+    }
+    if (pendingVerify) {
+        LOG_ERROR("Imagem atual ainda não confirmada - atualização recusada");
+        return false;
+    }
+    if (!fromHex(sha256Hex, expectedHash, sizeof(expectedHash))) {
+        LOG_ERROR("SHA-256 inválido");
+        return false;
+    }
+
+    // Sem A/B (ex.: huge_app.csv) não há onde gravar a imagem nova
+    target = esp_ota_get_next_update_partition(nullptr);
+    if (!target) {
+        LOG_ERROR("Tabela de partições sem slot OTA");
+        return false;
+    }
+
+    if (strlen(requestUrl) >= sizeof(url)) {
+        LOG_ERROR("URL longa demais");
+        return false;
+    }
+
+    // Prioridade 1 no núcleo 0, como a conexão MQTT: o loop segue no núcleo 1
+    if (!connectTask &&
+        xTaskCreatePinnedToCore(connectTaskMain, "ota_conn", OTA_CONNECT_STACK, this, 1, &connectTask, 0) != pdPASS) {
+        connectTask = nullptr;
+        LOG_ERROR("Falha ao criar a tarefa de download OTA");
+        return false;
+    }
+
+    strlcpy(url, requestUrl, sizeof(url));
+    patch.reset();
+    otaStarted = false;
+    reportedPct = 0;
+    startMs = millis();
+    connectDone = false;
+    state = State::CONNECTING;
+
+    LOG_START("Atualização OTA");
+    LOG_KV("URL", url);
+    LOG_KV("Destino", String(target->label));
+    xTaskNotifyGive(connectTask);
+    return true;
+}
+
+void OtaService::connectTaskMain(void* arg) {
+    // Guiada pelo estado: a notificação só avisa que há um download pedido
+    OtaService* self = static_cast<OtaService*>(arg);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (self->state == State::CONNECTING && !self->connectDone) {
+            self->connect();
+            scheduler.wake(self->task);
+        }
+    }
+}
+
+void OtaService::connect() {
+    // Transporte sem verificação: a integridade vem do SHA-256 do comando
+    bool https = strncmp(url, "https://", 8) == 0;
+    if (https) tlsClient.setInsecure();
+    WiFiClient& client = https ? static_cast<WiFiClient&>(tlsClient) : plainClient;
+
+    http.setTimeout(OTA_STALL_TIMEOUT_MS);
+    httpCode = http.begin(client, url) ? http.GET() : 0;
+    connectDone = true;
+}
+
+uint32_t OtaService::onConnected() {
+    int code = httpCode;
+    if (code != HTTP_CODE_OK) {
+        if (code == 0) {
+            LOG_ERROR("URL inválida: " + String(url));
+        } else {
+            LOG_ERROR("Download do patch falhou: " + String(code) + " " + HTTPClient::errorToString(code));
+        }
+        http.end();
+        state = State::IDLE;
+        report("failed", code == 0 ? "url" : "download");
+        return TaskScheduler::IDLE;
+    }
+
+    stream = http.getStreamPtr();
+    rxPos = 0;
+    rxLen = 0;
+    lastDataMs = millis();
+    state = State::DOWNLOADING;
+
+    LOG_KV("Patch", String(http.getSize()) + " B");
+    LOG_KV("Conexão", String(lastDataMs - startMs) + "ms");
+    report("downloading");
+    return 0;
+}
+
+uint32_t OtaService::runTask(void* arg) {
+    return static_cast<OtaService*>(arg)->loop();
+}
+
+uint32_t OtaService::loop() {
+    switch (state) {
+        case State::CONNECTING:
+            // A tarefa de download acorda o loop quando o GET responder
+            return connectDone ? onConnected() : TaskScheduler::IDLE;
+
+        case State::DOWNLOADING:
+            return step();
+
+        case State::REBOOT_PENDING:
+            // Não corta uma dispensação no meio
+            if (feeder && feeder->isDispensing()) return 500;
+            LOG_WARN("Reiniciando na imagem nova");
+            mqttService.shutdown();
+            ESP.restart();
+            return TaskScheduler::IDLE;
+
+        case State::IDLE:
+            break;
+    }
+
+    // Imagem em teste que não chegou ao broker no prazo: volta para a anterior
+    if (pendingVerify) {
+        uint32_t elapsed = millis() - bootMs;
+        if (elapsed < OTA_CONFIRM_TIMEOUT_MS) return OTA_CONFIRM_TIMEOUT_MS - elapsed;
+
+        LOG_ERROR("Imagem nova sem conexão ao broker - voltando à anterior");
+        esp_ota_mark_app_invalid_rollback_and_reboot();
+        pendingVerify = false;   // Sem rollback no bootloader: segue nesta
+    }
+    return TaskScheduler::IDLE;
+}
+
+uint32_t OtaService::step() {
+    uint32_t start = millis();
+    DeltaPatch::Result result = DeltaPatch::Result::OK;
+
+    // Orçamento por chamada, conferido entre fatias: a gravação na flash e o
+    // SHA-256 da base são o que mais pesam
+    while (result == DeltaPatch::Result::OK && millis() - start < OTA_STEP_BUDGET_MS) {
+        if (patch.pending()) {
+            // SHA-256 da base ou trecho igual de uma COPY
+            result = patch.resume(OTA_SLICE_BYTES);
+            lastDataMs = millis();      // Parado por nossa conta, não do servidor
+            continue;
+        }
+
+        if (rxPos == rxLen) {
+            int available = stream->available();
+            if (available <= 0) break;
+
+            int n = stream->read(rxBuf, available < (int)sizeof(rxBuf) ? available : sizeof(rxBuf));
+            if (n <= 0) break;
+            rxPos = 0;
+            rxLen = n;
+            lastDataMs = millis();
+        }
+
+        // Para no byte que deixa trabalho pendente; o resto do buffer espera
+        size_t used;
+        result = patch.write(rxBuf + rxPos, rxLen - rxPos, &used);
+        rxPos += used;
+
+        // O patch precisa gerar a imagem pedida no comando, não só uma coerente
+        if (patch.headerReady() && memcmp(patch.getTargetHash(), expectedHash, sizeof(expectedHash)) != 0) {
+            abort("sha256");
+            return TaskScheduler::IDLE;
+        }
+    }
+
+    // Servidor fechou ou parou de mandar: o patch precisa estar completo
+    if (result == DeltaPatch::Result::OK && !patch.pending() && rxPos == rxLen && stream->available() <= 0 &&
+        (!http.connected() || millis() - lastDataMs >= OTA_STALL_TIMEOUT_MS)) {
+        result = patch.finish();
+    }
+
+    if (result == DeltaPatch::Result::DONE) {
+        finishUpdate();
+        return 0;
+    }
+    if (result != DeltaPatch::Result::OK) {
+        abort(DeltaPatch::resultName(result));
+        return TaskScheduler::IDLE;
+    }
+
+    if (patch.headerReady()) {
+        uint8_t pct = (uint64_t)patch.getWritten() * 100 / patch.getTargetSize();
+        if (pct >= reportedPct + 10) {
+            reportedPct = pct - pct % 10;
+            LOG_KV("OTA", String(reportedPct) + "% (" + String(patch.getPatchBytes()) + " B de patch)");
+            report("downloading");
+        }
+    }
+
+    // Com trabalho ou dados na fila volta logo; senão espera o servidor
+    return patch.pending() || rxPos < rxLen || stream->available() > 0 ? 0 : 10;
+}
+
+void OtaService::finishUpdate() {
+    http.end();
+
+    esp_err_t err = esp_ota_end(handle);
+    otaStarted = false;
+    if (err == ESP_OK) err = esp_ota_set_boot_partition(target);
+    if (err != ESP_OK) {
+        state = State::IDLE;
+        LOG_ERROR("Falha ao ativar a imagem nova: " + String(esp_err_to_name(err)));
+        report("failed", esp_err_to_name(err));
+        return;
+    }
+
+    uint32_t elapsed = millis() - startMs;
+    LOG_COMPLETE("Imagem nova gravada");
+    LOG_KV("Patch", String(patch.getPatchBytes()) + " B para " + String(patch.getTargetSize()) + " B");
+    LOG_KV("Duração", String(elapsed) + "ms");
+    LOG_SEPARATOR();
+    report("applied");
+
+    state = State::REBOOT_PENDING;
+}
+
+void OtaService::abort(const char* reason) {
+    http.end();
+    if (otaStarted) esp_ota_abort(handle);
+    otaStarted = false;
+    state = State::IDLE;
+
+    LOG_ERROR("Atualização abortada: " + String(reason));
+    report("failed", reason);
+}
+
+void OtaService::confirm() {
+    if (!pendingVerify) return;
+
+    pendingVerify = false;
+    esp_ota_mark_app_valid_cancel_rollback();
+    LOG_SUCCESS("Imagem nova confirmada");
+    report("confirmed");
+}
+
+void OtaService::report(const char* status, const char* detail) {
+    mqttService.publishOtaStatus(status, patch.getWritten(), patch.getTargetSize(), detail);
+}
+
+bool OtaService::readBase(void* ctx, uint32_t offset, uint8_t* buf, size_t len) {
+    OtaService* self = static_cast<OtaService*>(ctx);
+    return esp_partition_read(self->running, offset, buf, len) == ESP_OK;
+}
+
+bool OtaService::writeImage(void* ctx, const uint8_t* data, size_t len) {
+    OtaService* self = static_cast<OtaService*>(ctx);
+
+    if (!self->otaStarted) {
+        if (self->patch.getTargetSize() > self->target->size) return false;
+
+        // Apaga setor a setor conforme grava, em vez da partição inteira de uma vez
+        if (esp_ota_begin(self->target, OTA_WITH_SEQUENTIAL_WRITES, &self->handle) != ESP_OK) return false;
+        self->otaStarted = true;
+    }
+    return esp_ota_write(self->handle, data, len) == ESP_OK;
+}
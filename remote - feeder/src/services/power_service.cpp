@@ -0,0 +1,247 @@
+// power_service.cpp
+#include "services/power_service.h"
+#include "config.h"
+#include "core/ClockService.h"
+#include "services/schedule_service.h"
+#include "services/log_service.h"
+#include "hardware/feeder_service.h"
+#include "comm/mqtt_service.h"
+#include "services/ota_service.h"
+#include "core/task_scheduler.h"
+#include <esp_sleep.h>
+
+PowerService powerService;
+
+// Contabilidade na memória RTC: sobrevive ao deep sleep, zera no boot completo
+struct PowerStats {
+    uint32_t magic;
+    uint32_t wakeCount;
+    uint64_t awakeMs;
+    uint64_t sleepMs;
+    uint32_t targetDeadline;   // Refeição para a qual o despertar foi agendado
+};
+
+static const uint32_t POWER_MAGIC = 0x50575231;
+RTC_DATA_ATTR static PowerStats rtcStats;
+
+PowerService::PowerService() :
+    clock(nullptr),
+    schedule(nullptr),
+    feeder(nullptr),
+    log(nullptr),
+    phase(Phase::AWAKE),
+    networkUp(false),
+    phaseStart(0),
+    targetDeadline(0) {}
+
+bool PowerService::isWarmWake() {
+    return esp_reset_reason() == ESP_RST_DEEPSLEEP && rtcStats.magic == POWER_MAGIC;
+}
+
+bool PowerService::begin(ClockService* clockSvc, ScheduleService* scheduleSvc,
+                         FeederService* feederSvc, LogService* logSvc) {
+    this->clock = clockSvc;
+    this->schedule = scheduleSvc;
+    this->feeder = feederSvc;
+    this->log = logSvc;
+
+#if REMOTE_LOW_POWER
+    scheduler.add("power", runTask, this);
+
+    if (isWarmWake()) {
+        rtcStats.wakeCount++;
+        targetDeadline = rtcStats.targetDeadline;
+        LOG_SUCCESS("Acordou do deep sleep em " + String(millis()) + "ms (despertar " +
+                    String(rtcStats.wakeCount) + ")");
+        reportStats();
+
+        // Rede só depois da refeição: a dispensação não espera WiFi/TLS
+        enterPhase(targetDeadline != 0 ? Phase::WAIT_MEAL : Phase::SYNC);
+        if (phase == Phase::SYNC) startNetwork();
+        return true;
+    }
+
+    rtcStats.magic = POWER_MAGIC;
+    rtcStats.wakeCount = 0;
+    rtcStats.awakeMs = 0;
+    rtcStats.sleepMs = 0;
+    rtcStats.targetDeadline = 0;
+
+    LOG_INFO("Modo de baixo consumo ativo - dorme entre refeições após " +
+             String(POWER_BOOT_AWAKE_MS / 1000) + "s");
+    enterPhase(Phase::BOOT);
+#else
+    enterPhase(Phase::AWAKE);
+#endif
+
+    startNetwork();
+    return true;
+}
+
+void PowerService::startNetwork() {
+    if (networkUp) return;
+    networkUp = true;
+
+    // MQTT (conecta WiFi primeiro)
+    LOG_SUBSECTION("🌐 Inicializando Comunicação e WiFi");
+    mqttService.begin(clock, log);
+
+    // NTP (após WiFi conectado) - disciplina o RTC quando sincroniza
+    LOG_SUBSECTION("⏱ Inicializando ClockService (NTP)");
+    if (!clock->init()) {
+        LOG_WARN("Clock rodando sem NTP — modo não sincronizado");
+    } else {
+        LOG_SUCCESS("Clock inicializado (NTP sincroniza em segundo plano)");
+    }
+}
+
+void PowerService::enterPhase(Phase next) {
+    phase = next;
+    phaseStart = millis();
+}
+
+uint32_t PowerService::runTask(void* arg) {
+    return static_cast<PowerService*>(arg)->loop();
+}
+
+uint32_t PowerService::loop() {
+#if REMOTE_LOW_POWER
+    uint32_t elapsed = millis() - phaseStart;
+
+    switch (phase) {
+        case Phase::BOOT:
+            if (elapsed < POWER_BOOT_AWAKE_MS) return POWER_BOOT_AWAKE_MS - elapsed;
+            trySleep();
+            break;
+
+        case Phase::WAIT_MEAL: {
+            // Hora perdida no sono: só o NTP resolve, sobe a rede já
+            if (!clock->isInitialized()) {
+                startNetwork();
+                break;
+            }
+
+            // Servida quando o próximo horário avança (ou a janela de
+            // recuperação passa e o ScheduleService a registra como perdida)
+            bool served = schedule->getNextDeadline() != targetDeadline;
+            bool expired = clock->getLocalTimestamp() > targetDeadline + SCHEDULE_CATCHUP_SEC;
+            if ((served || expired) && !feeder->isDispensing()) {
+                targetDeadline = 0;
+                startNetwork();
+                enterPhase(Phase::SYNC);
+            }
+            break;
+        }
+
+        case Phase::SYNC: {
+            bool synced = mqttService.isConnected() &&
+                          log->getPendingLogsCount() == 0 && !log->isDraining();
+            if ((synced && elapsed >= POWER_SYNC_MIN_MS) || elapsed >= POWER_SYNC_WINDOW_MS) {
+                trySleep();
+            }
+            break;
+        }
+
+        case Phase::AWAKE:
+            // Sem hora válida não há como agendar o despertar: espera o NTP
+            if (clock->isInitialized()) trySleep();
+            break;
+    }
+    return POWER_POLL_MS;
+#else
+    return TaskScheduler::IDLE;
+#endif
+}
+
+void PowerService::trySleep() {
+    if (feeder->isDispensing()) return;
+
+    // Atualizando, ou imagem nova ainda sem confirmar (o deep sleep é um reset)
+    if (otaService.isBusy() || otaService.isPendingVerify()) return;
+
+    if (!clock->isInitialized()) {
+        if (phase != Phase::AWAKE) {
+            LOG_WARN("Sem hora válida - permanecendo acordado até o NTP");
+            enterPhase(Phase::AWAKE);
+        }
+        return;
+    }
+
+    uint32_t deadline = schedule->getNextDeadline();
+    uint32_t seconds = POWER_MAX_SLEEP_SEC;
+
+    if (deadline != 0) {
+        uint32_t toMeal = schedule->getSecondsToNextMeal();
+
+        // Refeição próxima: não compensa dormir, aguarda acordado
+        if (toMeal < POWER_WAKE_LEAD_SEC + POWER_MIN_SLEEP_SEC) {
+            targetDeadline = deadline;
+            enterPhase(Phase::WAIT_MEAL);
+            return;
+        }
+
+        if (toMeal - POWER_WAKE_LEAD_SEC < seconds) {
+            seconds = toMeal - POWER_WAKE_LEAD_SEC;
+        } else {
+            deadline = 0;  // Despertar só para sincronizar
+        }
+    }
+
+    enterSleep(seconds, deadline);
+}
+
+void PowerService::enterSleep(uint32_t seconds, uint32_t deadline) {
+    LOG_SEPARATOR();
+    LOG_SECTION("🌙 DEEP SLEEP");
+    LOG_KV("Duração", String(seconds / 60) + " min");
+    LOG_KV("Próxima refeição", deadline != 0 ? String(schedule->getNextSlot()) : String("-"));
+
+    rtcStats.awakeMs += millis();
+    rtcStats.sleepMs += (uint64_t)seconds * 1000;
+    rtcStats.targetDeadline = deadline;
+
+    // Logs já estão no journal; pendentes seguem no próximo despertar
+    if (networkUp) mqttService.shutdown();
+    clock->prepareSleep();
+
+    Serial.flush();
+    esp_sleep_enable_timer_wakeup((uint64_t)seconds * 1000000ULL);
+    esp_deep_sleep_start();
+}
+
+void PowerService::reportStats() {
+    LOG_KV("Ciclo ativo", String(getDutyCyclePercent(), 2) + "%");
+    LOG_KV("Consumo médio", String(getAverageCurrentMa(), 2) + " mA");
+    LOG_KV("Autonomia estimada", String(getEstimatedBatteryDays(), 1) + " dias (" +
+           String(POWER_BATTERY_MAH) + " mAh)");
+}
+
+// ========== CONTABILIDADE ==========
+
+uint32_t PowerService::getWakeCount() const {
+    return rtcStats.magic == POWER_MAGIC ? rtcStats.wakeCount : 0;
+}
+
+uint64_t PowerService::getAwakeMs() const {
+    return (rtcStats.magic == POWER_MAGIC ? rtcStats.awakeMs : 0) + millis();
+}
+
+uint64_t PowerService::getSleepMs() const {
+    return rtcStats.magic == POWER_MAGIC ? rtcStats.sleepMs : 0;
+}
+
+float PowerService::getDutyCyclePercent() const {
+    uint64_t awake = getAwakeMs();
+    uint64_t total = awake + getSleepMs();
+    return total > 0 ? 100.0f * awake / total : 100.0f;
+}
+
+float PowerService::getAverageCurrentMa() const {
+    float duty = getDutyCyclePercent() / 100.0f;
+    return duty * POWER_AWAKE_MA + (1.0f - duty) * (POWER_SLEEP_UA / 1000.0f);
+}
+
+float PowerService::getEstimatedBatteryDays() const {
+    float avg = getAverageCurrentMa();
+    return avg > 0 ? POWER_BATTERY_MAH / avg / 24.0f : 0;
+}
@@ -4,16 +4,47 @@
 #include "core/ClockService.h"
 #include "hardware/feeder_service.h"
 #include "services/log_service.h"
+#include "core/task_scheduler.h"
 
 ScheduleService scheduleService;
 
-ScheduleService::ScheduleService() : lastFeedDay(0), lastFeedIndex(255) {}
+// Agenda e disparos do dia sobrevivem ao deep sleep na memória RTC.
+// Só bytes: um construtor (o de Meal) rodaria a cada boot e apagaria a cópia
+struct ScheduleSnapshot {
+    uint32_t magic;
+    uint8_t meals[SCHEDULE_SLOTS * sizeof(Meal)];
+    uint32_t firedDay;
+    uint32_t firedMask;
+};
+
+static const uint32_t SNAPSHOT_MAGIC = 0x5C4ED002;   // Muda junto com o layout de Meal
+RTC_DATA_ATTR static ScheduleSnapshot rtcSnapshot;
+
+ScheduleService::ScheduleService() :
+    clock(nullptr),
+    feeder(nullptr),
+    log(nullptr),
+    orderCount(0),
+    firedDay(0),
+    firedMask(0),
+    nextDeadline(0),
+    nextSlot(0),
+    lastLocalNow(0),
+    wakeAt(0),
+    ready(false),
+    task(TaskScheduler::NONE) {}
 
 bool ScheduleService::begin(ClockService* clockSvc, FeederService* feederSvc, LogService* logSvc) {
     this->clock = clockSvc;
     this->feeder = feederSvc;
     this->log = logSvc;
 
+    task = scheduler.add("schedule", runTask, this);
+
+    if (restoreSnapshot()) {
+        return true;
+    }
+
     if (!load()) {
         LOG_WARN("Não foi possível carregar agendamentos");
         LOG_INFO("Criando agendamentos padrão");
@@ -21,6 +52,9 @@ bool ScheduleService::begin(ClockService* clockSvc, FeederService* feederSvc, Lo
         setMeal(0, 8, 0, 100, true);   // Café: 08:00 - 100g
         setMeal(1, 13, 0, 150, true);  // Almoço: 13:00 - 150g
         setMeal(2, 18, 0, 120, true);  // Jantar: 18:00 - 120g
+        for (uint8_t i = 3; i < SCHEDULE_SLOTS; i++) {
+            setMeal(i, 0, 0, 100, false);
+        }
         save();
     }
     return true;
@@ -32,15 +66,23 @@ bool ScheduleService::load() {
         return false;
     }
 
-    for (int i = 0; i < 3; i++) {
+    for (int i = 0; i < SCHEDULE_SLOTS; i++) {
         String prefix = "meal" + String(i);
         meals[i].hour = prefs.getUChar((prefix + "_hour").c_str(), 0);
         meals[i].minute = prefs.getUChar((prefix + "_minute").c_str(), 0);
         meals[i].qty = prefs.getUShort((prefix + "_qty").c_str(), 100);
-        meals[i].enabled = prefs.getBool((prefix + "_enabled").c_str(), true);
+        meals[i].enabled = prefs.getBool((prefix + "_enabled").c_str(), i < 3);
+        meals[i].days = prefs.getUChar((prefix + "_days").c_str(), MEAL_ALL_DAYS);
+        meals[i].channel = prefs.getUChar((prefix + "_ch").c_str(), 0);
+        if (meals[i].channel >= FEEDER_CHANNELS) meals[i].channel = 0;   // Firmware com menos reservatórios
     }
 
+    firedDay = prefs.getUInt("firedDay", 0);
+    firedMask = prefs.getUInt("firedMask", 0);
+
     prefs.end();
+    rebuildOrder();
+    storeSnapshot();
     LOG_SUCCESS("Agendamentos carregados da NVS");
     printMeals();
     return true;
@@ -52,12 +94,14 @@ bool ScheduleService::save() {
         return false;
     }
 
-    for (int i = 0; i < 3; i++) {
+    for (int i = 0; i < SCHEDULE_SLOTS; i++) {
         String prefix = "meal" + String(i);
         prefs.putUChar((prefix + "_hour").c_str(), meals[i].hour);
         prefs.putUChar((prefix + "_minute").c_str(), meals[i].minute);
         prefs.putUShort((prefix + "_qty").c_str(), meals[i].qty);
         prefs.putBool((prefix + "_enabled").c_str(), meals[i].enabled);
+        prefs.putUChar((prefix + "_days").c_str(), meals[i].days);
+        prefs.putUChar((prefix + "_ch").c_str(), meals[i].channel);
     }
 
     prefs.end();
@@ -65,92 +109,280 @@ bool ScheduleService::save() {
     return true;
 }
 
-void ScheduleService::loop() {
-    static uint32_t lastCheck = 0;
-    
-    if (millis() - lastCheck < 1000) return;
-    lastCheck = millis();
-    
+uint32_t ScheduleService::runTask(void* arg) {
+    return static_cast<ScheduleService*>(arg)->loop();
+}
+
+uint32_t ScheduleService::loop() {
+    // Dorme até o próximo horário (ou SCHEDULE_MAX_SLEEP_MS) em vez de
+    // consultar o relógio a cada segundo
+    int32_t left = (int32_t)(wakeAt - millis());
+    if (left > 0) return (uint32_t)left;
+
     checkMeals();
+
+    left = (int32_t)(wakeAt - millis());
+    return left > 0 ? (uint32_t)left : 0;
 }
 
 bool ScheduleService::checkMeals() {
     if (!clock || !clock->isInitialized()) {
-        static unsigned long lastWarn = 0;
+        static uint32_t lastWarn = 0;
         if (millis() - lastWarn > 60000) {  // Avisar apenas a cada 1 min
             LOG_WARN("RTC não sincronizado - verificação de refeições desabilitada");
             lastWarn = millis();
         }
+        wakeAt = millis() + 1000;
+        return false;
+    }
+
+    if (!ready) {
+        ready = true;
+        LOG_SUCCESS("Agendamentos prontos em " + String(millis()) + "ms (fonte: " +
+                    ClockService::timeSourceName(clock->getTimeSource()) + ")");
+    }
+
+    uint32_t now = clock->getLocalTimestamp();
+
+    // Relógio voltou (correção por salto): o próximo horário pode ter mudado
+    if (now < lastLocalNow) nextDeadline = 0;
+    lastLocalNow = now;
+
+    if (nextDeadline == 0) {
+        nextDeadline = findNextDeadline(now, nextSlot);
+    }
+
+    if (nextDeadline == 0 || now < nextDeadline) {
+        scheduleWake(now);
         return false;
     }
 
-    uint32_t today = clock->getTimestamp() / 86400;
+    uint8_t i = nextSlot;
+    uint32_t day = nextDeadline / 86400;
+    uint32_t late = now - nextDeadline;
+
+    if (late > SCHEDULE_CATCHUP_SEC) {
+        LOG_WARN("Refeição " + String(i) + " perdida (" + String(late / 60) +
+                 " min de atraso, janela " + String(SCHEDULE_CATCHUP_SEC / 60) + " min)");
+        markFired(day, i);
+        nextDeadline = 0;
+        wakeAt = millis();
+        return false;
+    }
+
+    LOG_SEPARATOR();
+    LOG_SECTION("⏰ REFEIÇÃO AGENDADA");
+    LOG_KV("Refeição", String(i));
+    LOG_KV("Horário", String(meals[i].hour) + ":" + (meals[i].minute < 10 ? "0" : "") + String(meals[i].minute));
+    LOG_KV("Quantidade", String(meals[i].qty) + "g");
+    if (FEEDER_CHANNELS > 1) {
+        LOG_KV("Reservatório", String(meals[i].channel));
+    }
+    if (late >= 60) {
+        LOG_KV("Atraso", String(late / 60) + " min (recuperada)");
+    }
+
+    // O FeederService registra o log com o resultado real (fonte "schedule");
+    // aqui só se registra quando o pedido nem entra na fila. Com outra
+    // dispensação em andamento, a refeição passa à frente dos pedidos manuais.
+    // Refeições de reservatórios diferentes no mesmo minuto saem em paralelo
+    if (feeder && !feeder->dispense(meals[i].qty, "schedule", 0, FeedPriority::URGENT, meals[i].channel) && log) {
+        log->addLog(
+            clock->getTimestamp(),
+            meals[i].qty,
+            false,
+            "schedule",  // FONTE: agendamento automático
+            meals[i].channel
+        );
+    }
+
+    markFired(day, i);
+    nextDeadline = 0;
+    wakeAt = millis();  // Pode haver outra refeição no mesmo minuto
+    return true;
+}
+
+void ScheduleService::rebuildOrder() {
+    // Inserção ordenada: só roda quando a agenda muda
+    orderCount = 0;
+    for (uint8_t i = 0; i < SCHEDULE_SLOTS; i++) {
+        if (!meals[i].enabled || meals[i].days == 0) continue;
+
+        uint16_t minute = meals[i].hour * 60 + meals[i].minute;
+        int pos = orderCount;
+        while (pos > 0 && orderMinute[pos - 1] > minute) {
+            order[pos] = order[pos - 1];
+            orderMinute[pos] = orderMinute[pos - 1];
+            pos--;
+        }
+        order[pos] = i;
+        orderMinute[pos] = minute;
+        orderCount++;
+    }
+
+    nextDeadline = 0;
+    wakeAt = millis();
+    scheduler.wake(task);   // Agenda alterada por comando: recalcula já
+}
+
+uint32_t ScheduleService::findNextDeadline(uint32_t now, uint8_t& slot) {
+    if (orderCount == 0) return 0;
 
+    uint32_t today = now / 86400;
+    uint32_t secOfDay = now % 86400;
 
-    for (uint8_t i = 0; i < 3; i++) {
-        if (!meals[i].enabled) continue;
+    // Hoje: a partir do primeiro horário ainda dentro da janela de recuperação
+    // (a recuperação não atravessa a meia-noite)
+    uint32_t fromSec = secOfDay > SCHEDULE_CATCHUP_SEC ? secOfDay - SCHEDULE_CATCHUP_SEC : 0;
+    uint16_t fromMinute = (fromSec + 59) / 60;
 
-        if (shouldFeedNow(meals[i].hour, meals[i].minute)) {
-            if (today != lastFeedDay || i != lastFeedIndex) {
-                LOG_SEPARATOR();
-                LOG_SECTION("⏰ REFEIÇÃO AGENDADA");
-                LOG_KV("Refeição", String(i));
-                LOG_KV("Horário", String(meals[i].hour) + ":" + (meals[i].minute < 10 ? "0" : "") + String(meals[i].minute));
-                LOG_KV("Quantidade", String(meals[i].qty) + "g");
+    int lo = 0, hi = orderCount;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (orderMinute[mid] < fromMinute) lo = mid + 1;
+        else hi = mid;
+    }
 
-                if (log) {
-                    log->addLog(
-                        clock->getTimestamp(),
-                        meals[i].qty,
-                        true,  // assumindo sucesso - será atualizado pelo feeder
-                        "schedule"  // FONTE: agendamento automático
-                    );
-                }
+    uint8_t weekday = (today + 4) % 7;
+    for (int k = lo; k < orderCount; k++) {
+        uint8_t i = order[k];
+        if (!(meals[i].days & (1 << weekday)) || isFired(today, i)) continue;
+
+        slot = i;
+        return today * 86400 + orderMinute[k] * 60;
+    }
 
-                if (feeder) {
-                    feeder->dispense(meals[i].qty, "schedule");
-                }
+    // Próximos dias: primeiro horário cujo dia da semana bate
+    for (uint32_t d = 1; d <= 7; d++) {
+        weekday = (today + d + 4) % 7;
+        for (int k = 0; k < orderCount; k++) {
+            uint8_t i = order[k];
+            if (!(meals[i].days & (1 << weekday))) continue;
 
-                lastFeedDay = today;
-                lastFeedIndex = i;
-                return true;
-            }
+            slot = i;
+            return (today + d) * 86400 + orderMinute[k] * 60;
         }
     }
 
-    return false;
+    return 0;
+}
+
+bool ScheduleService::isFired(uint32_t day, uint8_t slot) const {
+    return day == firedDay && (firedMask & (1UL << slot));
+}
+
+void ScheduleService::markFired(uint32_t day, uint8_t slot) {
+    if (day != firedDay) {
+        firedDay = day;
+        firedMask = 0;
+    }
+    firedMask |= (1UL << slot);
+    storeSnapshot();
+
+    // Persistido para um reboot não repetir nem perder a refeição do dia
+    if (prefs.begin(NVS_SCHEDULE_NAMESPACE, false)) {
+        prefs.putUInt("firedDay", firedDay);
+        prefs.putUInt("firedMask", firedMask);
+        prefs.end();
+    }
+}
+
+void ScheduleService::scheduleWake(uint32_t now) {
+    uint32_t sleepMs = SCHEDULE_MAX_SLEEP_MS;
+    if (nextDeadline != 0 && (nextDeadline - now) * 1000UL < sleepMs) {
+        sleepMs = (nextDeadline - now) * 1000UL;
+    }
+    wakeAt = millis() + sleepMs;
+}
+
+bool ScheduleService::restoreSnapshot() {
+    if (esp_reset_reason() != ESP_RST_DEEPSLEEP || rtcSnapshot.magic != SNAPSHOT_MAGIC) {
+        rtcSnapshot.magic = 0;
+        return false;
+    }
+
+    memcpy(meals, rtcSnapshot.meals, sizeof(meals));
+    firedDay = rtcSnapshot.firedDay;
+    firedMask = rtcSnapshot.firedMask;
+    rebuildOrder();
+
+    LOG_SUCCESS("Agendamentos restaurados da memória RTC (deep sleep)");
+    return true;
 }
 
+void ScheduleService::storeSnapshot() {
+    memcpy(rtcSnapshot.meals, meals, sizeof(meals));
+    rtcSnapshot.firedDay = firedDay;
+    rtcSnapshot.firedMask = firedMask;
+    rtcSnapshot.magic = SNAPSHOT_MAGIC;
+}
+
+uint32_t ScheduleService::getNextDeadline() {
+    if (!clock || !clock->isInitialized()) return 0;
+
+    if (nextDeadline == 0) {
+        nextDeadline = findNextDeadline(clock->getLocalTimestamp(), nextSlot);
+    }
+    return nextDeadline;
+}
 
-bool ScheduleService::shouldFeedNow(uint8_t hour, uint8_t minute) {
-    if (!clock) return false;
+int ScheduleService::getNextSlot() {
+    return getNextDeadline() != 0 ? nextSlot : -1;
+}
 
-    return (clock->getHour() == hour && clock->getMinute() == minute);
+uint32_t ScheduleService::getSecondsToNextMeal() {
+    uint32_t deadline = getNextDeadline();
+    if (deadline == 0) return 0;
 
+    uint32_t now = clock->getLocalTimestamp();
+    return deadline > now ? deadline - now : 0;
 }
 
-bool ScheduleService::setMeal(uint8_t index, uint8_t hour, uint8_t minute, uint16_t qty, bool enabled) {
-    if (index >= 3) return false;
-    
+bool ScheduleService::setMeal(uint8_t index, uint8_t hour, uint8_t minute, uint16_t qty, bool enabled,
+                              uint8_t days, uint8_t channel) {
+    if (index >= SCHEDULE_SLOTS || channel >= FEEDER_CHANNELS) return false;
+
+    bool timeChanged = meals[index].hour != hour || meals[index].minute != minute;
+
     meals[index].hour = hour;
     meals[index].minute = minute;
     meals[index].qty = qty;
     meals[index].enabled = enabled;
-    
+    meals[index].days = days & MEAL_ALL_DAYS;
+    meals[index].channel = channel;
+
+    // Só um horário novo ainda à frente hoje pode disparar de novo; a mesma
+    // configuração reenviada não repete a refeição já servida
+    if (timeChanged && clock && clock->isInitialized()) {
+        uint32_t minuteOfDay = clock->getLocalTimestamp() % 86400 / 60;
+        if (hour * 60U + minute > minuteOfDay) firedMask &= ~(1UL << index);
+    }
+    rebuildOrder();
+    storeSnapshot();
+
     return true;
 }
 
 Meal ScheduleService::getMeal(uint8_t index) {
-    if (index >= 3) return Meal();
+    if (index >= SCHEDULE_SLOTS) return Meal();
     return meals[index];
 }
 
 void ScheduleService::printMeals() {
+    static const char DAY_LETTERS[] = "DSTQQSS";
+
     LOG_INFO("Agendamentos configurados:");
-    for (int i = 0; i < 3; i++) {
+    for (int i = 0; i < SCHEDULE_SLOTS; i++) {
         String time = String(meals[i].hour) + ":" + (meals[i].minute < 10 ? "0" : "") + String(meals[i].minute);
-        String info = time + " → " + String(meals[i].qty) + "g " +
+        String days;
+        for (int d = 0; d < 7; d++) {
+            days += (meals[i].days & (1 << d)) ? DAY_LETTERS[d] : '-';
+        }
+        String info = time + " → " + String(meals[i].qty) + "g " + days + " " +
                      (meals[i].enabled ? "[ATIVA]" : "[INATIVA]");
+        if (FEEDER_CHANNELS > 1) {
+            info += " reservatório " + String(meals[i].channel);
+        }
         LOG_KV("Refeição " + String(i), info);
     }
 }
@@ -0,0 +1,440 @@
+// fdelta.cpp - gera, aplica e mede patches de OTA (core/delta_patch) no host
+//
+//   g++ -O2 -std=c++17 -I../../include fdelta.cpp ../../src/core/delta_patch.cpp -o fdelta
+//
+//   fdelta diff  <base.bin> <nova.bin> <patch.fdp>   patch contra a imagem em campo
+//   fdelta full  <nova.bin> <patch.fdp>              imagem completa (sem base)
+//   fdelta apply <base.bin> <patch.fdp> <saida.bin>  aplica em pedaços de 512 B
+//   fdelta bench [<base.bin> <nova.bin>]             tamanho e tempo; sem
+//                                                    argumentos usa imagens sintéticas
+#include "core/delta_patch.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+static const uint32_t MIN_MATCH = 8;        // Menor COPY exata que compensa
+static const uint32_t HASH_BITS = 20;
+static const uint32_t MAX_CHAIN = 32;       // Candidatos examinados por posição
+static const uint32_t EXTEND_SLACK = 64;    // Extensão aproximada para sem melhora nisso
+static const uint32_t DIFF_GAP = 3;         // Iguais que encerram um trecho de deltas
+
+// ========== ARQUIVOS ==========
+
+static bool readFile(const char* path, Bytes& data) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    data.resize(ftell(f));
+    fseek(f, 0, SEEK_SET);
+    bool ok = fread(data.data(), 1, data.size(), f) == data.size();
+    fclose(f);
+    return ok;
+}
+
+static bool writeFile(const char* path, const Bytes& data) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    fclose(f);
+    return ok;
+}
+
+static void sha256(const Bytes& data, uint8_t out[DeltaPatch::HASH_SIZE]) {
+    DeltaPatch::Sha256 sha;
+    sha.update(data.data(), data.size());
+    sha.finish(out);
+}
+
+// ========== GERAÇÃO ==========
+
+static void putVarint(Bytes& out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+static void put32(Bytes& out, uint32_t v) {
+    for (int i = 0; i < 4; i++) out.push_back((uint8_t)(v >> (i * 8)));
+}
+
+static uint32_t hash8(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return (uint32_t)((v * 0x9E3779B97F4A7C15ull) >> (64 - HASH_BITS));
+}
+
+class Differ {
+public:
+    Differ(const Bytes& base, const Bytes& target) : base(base), target(target) {
+        head.assign(1u << HASH_BITS, UINT32_MAX);
+        prev.assign(base.size(), UINT32_MAX);
+        for (uint32_t i = 0; i + MIN_MATCH <= base.size(); i++) {
+            uint32_t h = hash8(&base[i]);
+            prev[i] = head[h];
+            head[h] = i;
+        }
+    }
+
+    Bytes run() {
+        Bytes patch;
+        header(patch, base.size());
+
+        uint32_t t = 0;
+        uint32_t literal = 0;   // Início do trecho ainda sem operação
+        uint32_t lastEnd = 0;   // Fim da COPY anterior na base
+        int64_t lastAlign = 0;  // base - alvo da COPY anterior
+
+        while (t < target.size()) {
+            uint32_t s, len;
+            if (!findMatch(t, lastAlign, s, len)) {
+                t++;
+                continue;
+            }
+
+            // Recua sobre o literal pendente e avança além da parte exata
+            // enquanto a maioria dos bytes bate (ponteiros realocados)
+            uint32_t back = extend(s, t, literal, -1);
+            uint32_t fwd = extend(s, t, (uint32_t)target.size(), +1);
+            s -= back;
+            t -= back;
+
+            if (t > literal) insert(patch, literal, t);
+            copy(patch, s, t, back + fwd, lastEnd);
+
+            lastAlign = (int64_t)s - t;
+            t += back + fwd;
+            lastEnd = s + back + fwd;
+            literal = t;
+        }
+
+        if (literal < target.size()) insert(patch, literal, (uint32_t)target.size());
+        return patch;
+    }
+
+private:
+    const Bytes& base;
+    const Bytes& target;
+    std::vector<uint32_t> head;
+    std::vector<uint32_t> prev;
+
+    void header(Bytes& patch, uint32_t baseSize) {
+        uint8_t hash[DeltaPatch::HASH_SIZE];
+        patch.insert(patch.end(), { 'F', 'D', 'P', '1' });
+        put32(patch, baseSize);
+        put32(patch, (uint32_t)target.size());
+        sha256(base, hash);
+        patch.insert(patch.end(), hash, hash + sizeof(hash));
+        sha256(target, hash);
+        patch.insert(patch.end(), hash, hash + sizeof(hash));
+    }
+
+    uint32_t exactLen(uint32_t s, uint32_t t) const {
+        uint32_t n = 0;
+        while (s + n < base.size() && t + n < target.size() && base[s + n] == target[t + n]) n++;
+        return n;
+    }
+
+    bool findMatch(uint32_t t, int64_t align, uint32_t& bestS, uint32_t& bestLen) const {
+        if (t + MIN_MATCH > target.size()) return false;
+        bestLen = 0;
+
+        // Mesmo alinhamento da COPY anterior primeiro: código deslocado
+        int64_t aligned = (int64_t)t + align;
+        if (aligned >= 0 && aligned < (int64_t)base.size()) {
+            uint32_t n = exactLen((uint32_t)aligned, t);
+            if (n >= MIN_MATCH) {
+                bestS = (uint32_t)aligned;
+                bestLen = n;
+            }
+        }
+
+        uint32_t chain = 0;
+        for (uint32_t s = head[hash8(&target[t])]; s != UINT32_MAX && chain < MAX_CHAIN; s = prev[s], chain++) {
+            uint32_t n = exactLen(s, t);
+            if (n > bestLen + 4) {   // Outro alinhamento só se for claramente melhor
+                bestS = s;
+                bestLen = n;
+            }
+        }
+        return bestLen >= MIN_MATCH;
+    }
+
+    // Como no bsdiff: maior extensão com 2 * iguais - tamanho máximo
+    uint32_t extend(uint32_t s, uint32_t t, uint32_t limit, int dir) const {
+        int64_t score = 0, bestScore = 0;
+        uint32_t best = 0;
+        for (uint32_t i = dir > 0 ? 0 : 1; ; i++) {
+            int64_t bs = (int64_t)s + dir * (int64_t)i;
+            int64_t bt = (int64_t)t + dir * (int64_t)i;
+            if (bs < 0 || bs >= (int64_t)base.size()) break;
+            if (dir > 0 ? bt >= limit : bt < (int64_t)limit) break;
+            if (i - best > EXTEND_SLACK) break;
+
+            score += base[bs] == target[bt] ? 1 : -1;
+            if (score > bestScore) {
+                bestScore = score;
+                best = dir > 0 ? i + 1 : i;
+            }
+        }
+        return best;
+    }
+
+    void insert(Bytes& patch, uint32_t from, uint32_t to) {
+        patch.push_back((uint8_t)DeltaPatch::OP_INSERT);
+        putVarint(patch, to - from);
+        patch.insert(patch.end(), target.begin() + from, target.begin() + to);
+    }
+
+    void copy(Bytes& patch, uint32_t s, uint32_t t, uint32_t len, uint32_t lastEnd) {
+        int32_t delta = (int32_t)(s - lastEnd);
+        patch.push_back((uint8_t)DeltaPatch::OP_COPY);
+        putVarint(patch, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+        putVarint(patch, len);
+
+        uint32_t i = 0;
+        while (i < len) {
+            uint32_t same = 0;
+            while (i + same < len && base[s + i + same] == target[t + i + same]) same++;
+            i += same;
+
+            // Deltas até DIFF_GAP iguais seguidos (um segmento custa 2+ bytes)
+            uint32_t diff = 0, run = 0;
+            while (i + diff < len && run < DIFF_GAP) {
+                run = base[s + i + diff] == target[t + i + diff] ? run + 1 : 0;
+                diff++;
+            }
+            if (run == DIFF_GAP) diff -= run;
+            else if (i + diff == len) diff -= run;
+
+            putVarint(patch, same);
+            putVarint(patch, diff);
+            for (uint32_t k = 0; k < diff; k++) {
+                patch.push_back((uint8_t)(target[t + i + k] - base[s + i + k]));
+            }
+            i += diff;
+        }
+    }
+};
+
+static Bytes makeFull(const Bytes& target) {
+    static const Bytes empty;
+    Differ differ(empty, target);
+    return differ.run();
+}
+
+// ========== APLICAÇÃO ==========
+
+struct ApplyCtx {
+    const Bytes* base;
+    Bytes out;
+};
+
+static bool readBase(void* ctx, uint32_t offset, uint8_t* buf, size_t len) {
+    const Bytes& base = *static_cast<ApplyCtx*>(ctx)->base;
+    if (offset + len > base.size()) return false;
+    memcpy(buf, base.data() + offset, len);
+    return true;
+}
+
+static bool writeOut(void* ctx, const uint8_t* data, size_t len) {
+    Bytes& out = static_cast<ApplyCtx*>(ctx)->out;
+    out.insert(out.end(), data, data + len);
+    return true;
+}
+
+// Mesmo caminho da remota: pedaços do tamanho do buffer de rede
+static DeltaPatch::Result apply(const Bytes& base, const Bytes& patch, Bytes& out) {
+    static const size_t NET_CHUNK = 512;
+    ApplyCtx ctx = { &base, {} };
+    DeltaPatch delta(readBase, writeOut, &ctx);
+
+    DeltaPatch::Result result = DeltaPatch::Result::OK;
+    for (size_t pos = 0; pos < patch.size() && result == DeltaPatch::Result::OK; pos += NET_CHUNK) {
+        size_t n = patch.size() - pos < NET_CHUNK ? patch.size() - pos : NET_CHUNK;
+        result = delta.write(patch.data() + pos, n);
+    }
+    if (result == DeltaPatch::Result::OK) result = delta.finish();
+
+    out.swap(ctx.out);
+    return result;
+}
+
+// ========== IMAGENS SINTÉTICAS ==========
+
+// Imagem parecida com um app do ESP32: funções (bytes de instrução) seguidas
+// de literal pools com endereços absolutos de outras funções, depois strings.
+// Mudar o tamanho de uma função desloca as seguintes e altera os ponteiros.
+struct Image {
+    std::vector<Bytes> code;
+    std::vector<std::vector<uint32_t>> refs;   // Índices das funções referenciadas
+    Bytes strings;
+
+    Bytes build() const {
+        static const uint32_t BASE_ADDR = 0x400D0000;
+        std::vector<uint32_t> addr(code.size());
+        uint32_t pos = 0;
+        for (size_t i = 0; i < code.size(); i++) {
+            addr[i] = BASE_ADDR + pos;
+            pos += code[i].size() + refs[i].size() * 4;
+        }
+
+        Bytes out;
+        for (size_t i = 0; i < code.size(); i++) {
+            out.insert(out.end(), code[i].begin(), code[i].end());
+            for (uint32_t r : refs[i]) put32(out, addr[r]);
+        }
+        out.insert(out.end(), strings.begin(), strings.end());
+
+        // Digest SHA-256 no fim, como o esptool anexa
+        uint8_t hash[DeltaPatch::HASH_SIZE];
+        sha256(out, hash);
+        out.insert(out.end(), hash, hash + sizeof(hash));
+        return out;
+    }
+};
+
+static Bytes randomCode(std::mt19937& rng, size_t size) {
+    // Poucos opcodes frequentes, como código compilado
+    static const uint8_t COMMON[] = { 0x0c, 0x1d, 0x20, 0x22, 0x28, 0x38, 0x81, 0xa0, 0xc0, 0xe5, 0xf0 };
+    Bytes out(size);
+    for (auto& b : out) b = rng() % 3 ? COMMON[rng() % sizeof(COMMON)] : (uint8_t)rng();
+    return out;
+}
+
+static Image makeImage(std::mt19937& rng, size_t functions) {
+    Image img;
+    for (size_t i = 0; i < functions; i++) {
+        img.code.push_back(randomCode(rng, 64 + rng() % 960));
+        std::vector<uint32_t> r(rng() % 8);
+        for (auto& x : r) x = rng() % functions;
+        img.refs.push_back(r);
+    }
+    for (int i = 0; i < 6000; i++) {
+        std::string s = "msg_" + std::to_string(rng() % 100000) + " ";
+        img.strings.insert(img.strings.end(), s.begin(), s.end());
+    }
+    return img;
+}
+
+// ========== COMANDOS ==========
+
+static double ms(std::chrono::steady_clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+static bool bench(const char* name, const Bytes& base, const Bytes& target) {
+    auto t0 = std::chrono::steady_clock::now();
+    Differ differ(base, target);
+    Bytes patch = differ.run();
+    auto t1 = std::chrono::steady_clock::now();
+
+    Bytes out;
+    DeltaPatch::Result result = apply(base, patch, out);
+    auto t2 = std::chrono::steady_clock::now();
+
+    bool ok = result == DeltaPatch::Result::DONE && out == target;
+    printf("%-22s %9zu B %8zu B %6.2f%% %9.1f ms %8.1f ms  %s\n", name, target.size(), patch.size(),
+           100.0 * patch.size() / target.size(), ms(t1 - t0), ms(t2 - t1),
+           ok ? "ok" : DeltaPatch::resultName(result));
+    return ok;
+}
+
+static int benchSynthetic() {
+    std::mt19937 rng(48);
+    Image v1 = makeImage(rng, 1800);        // ~1 MB, como o app da remota
+    Bytes base = v1.build();
+
+    printf("%-22s %11s %10s %7s %12s %11s\n", "cenário", "imagem", "patch", "", "gerar", "aplicar");
+
+    bool ok = true;
+    ok &= bench("(imagem completa)", Bytes(), base);
+
+    // Constante alterada (ex.: um #define de tempo)
+    Image c = v1;
+    c.code[900][40] ^= 0x5A;
+    ok &= bench("constante", base, c.build());
+
+    // Função reescrita em parte e maior: tudo depois dela se desloca
+    Image f = v1;
+    Bytes& fn = f.code[700];
+    Bytes patchCode = randomCode(rng, 120);
+    std::copy(patchCode.begin(), patchCode.end(), fn.begin() + 16);
+    Bytes grow = randomCode(rng, 64);
+    fn.insert(fn.begin() + fn.size() / 2, grow.begin(), grow.end());
+    ok &= bench("função alterada", base, f.build());
+
+    // Novo módulo (4 KB de código + strings) no meio da imagem
+    Image m = v1;
+    for (int i = 0; i < 4; i++) {
+        m.code.insert(m.code.begin() + 1000, randomCode(rng, 1024));
+        m.refs.insert(m.refs.begin() + 1000, std::vector<uint32_t>{ 10, 20, 30 });
+    }
+    for (auto& r : m.refs) {
+        for (auto& x : r) if (x >= 1000) x += 4;
+    }
+    const char* extra = "novo modulo: status detalhado do reservatorio ";
+    for (int i = 0; i < 40; i++) m.strings.insert(m.strings.begin() + 100, extra, extra + strlen(extra));
+    ok &= bench("novo módulo", base, m.build());
+
+    // Atualização de biblioteca: 5% das funções mudam de tamanho e conteúdo
+    Image l = v1;
+    for (size_t i = 0; i < l.code.size(); i += 20) l.code[i] = randomCode(rng, l.code[i].size() + rng() % 64);
+    ok &= bench("biblioteca (5%)", base, l.build());
+
+    printf("\nRAM do aplicador: %zu B (sem malloc); tempos de aplicação no host, sem a gravação na flash\n",
+           sizeof(DeltaPatch));
+    return ok ? 0 : 1;
+}
+
+static int usage() {
+    fprintf(stderr, "uso: fdelta diff <base> <nova> <patch> | full <nova> <patch> | "
+                    "apply <base> <patch> <saida> | bench [<base> <nova>]\n");
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) return usage();
+    std::string cmd = argv[1];
+    Bytes a, b;
+
+    if (cmd == "diff" && argc == 5) {
+        if (!readFile(argv[2], a) || !readFile(argv[3], b)) return perror("leitura"), 1;
+        Differ differ(a, b);
+        Bytes patch = differ.run();
+        if (!writeFile(argv[4], patch)) return perror("escrita"), 1;
+        printf("patch: %zu B (%.2f%% de %zu B)\n", patch.size(), 100.0 * patch.size() / b.size(), b.size());
+        return 0;
+    }
+
+    if (cmd == "full" && argc == 4) {
+        if (!readFile(argv[2], b)) return perror("leitura"), 1;
+        if (!writeFile(argv[3], makeFull(b))) return perror("escrita"), 1;
+        return 0;
+    }
+
+    if (cmd == "apply" && argc == 5) {
+        Bytes out;
+        if (!readFile(argv[2], a) || !readFile(argv[3], b)) return perror("leitura"), 1;
+        DeltaPatch::Result result = apply(a, b, out);
+        printf("%s\n", DeltaPatch::resultName(result));
+        if (result != DeltaPatch::Result::DONE) return 1;
+        return writeFile(argv[4], out) ? 0 : 1;
+    }
+
+    if (cmd == "bench" && argc == 4) {
+        if (!readFile(argv[2], a) || !readFile(argv[3], b)) return perror("leitura"), 1;
+        return bench(argv[3], a, b) ? 0 : 1;
+    }
+
+    if (cmd == "bench" && argc == 2) return benchSynthetic();
+    return usage();
+}
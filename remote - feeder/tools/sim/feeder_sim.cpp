@@ -0,0 +1,859 @@
+// feeder_sim.cpp - firmware da remota no host, com relógio virtual
+//
+//   (na pasta "remote - feeder", com o config.h do firmware em include/)
+//   g++ -O2 -std=gnu++17 -Itools/sim/shim -Iinclude -I.pio/libdeps/esp32dev/ArduinoJson/src
+//       src/*.cpp src/*/*.cpp tools/sim/*.cpp -o tools/sim/feeder_sim
+//
+//   feeder_sim [-v] [-d dias] <cenario.txt>
+//
+//   -v       imprime a serial do firmware com a hora do mundo
+//   -d dias  sobrepõe o "days" do cenário
+//
+// O setup()/loop() de main.cpp roda sem alterações sobre os shims de
+// tools/sim/shim; WiFi, broker, Central, NTP, DS3231, NVS e LittleFS são
+// modelos (sim_world, sim_platform). O relatório confere cada refeição
+// contra o journal e o servo (perdida, duplicada, adiantada, falha), conta
+// as gravações na flash e mostra as distribuições de latência.
+#include "sim_world.h"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "models.h"
+#include "comm/CommandRegistry.h"
+#include "comm/mqtt_service.h"
+#include "core/ClockService.h"
+#include "core/FeedLogCodec.h"
+#include "core/psram_alloc.h"
+#include "core/task_scheduler.h"
+#include "hardware/feeder_service.h"
+#include "hardware/level_sensor.h"
+#include "hardware/rtc_source.h"
+#include "hardware/servo_motion.h"
+#include "services/log_service.h"
+#include "services/ota_service.h"
+#include "services/power_service.h"
+#include "services/schedule_service.h"
+
+#include <chrono>
+#include <unistd.h>
+#include <new>
+#include <vector>
+
+using namespace sim;
+
+// Globais de main.cpp (sem extern nos headers)
+extern ClockService clockService;
+extern HardwareRtc hardwareRtc;
+
+void setup();
+void loop();
+
+// 2025-01-06 (segunda-feira) 00:00 no fuso do firmware
+static const int64_t SCENARIO_EPOCH = 1736121600LL - NTP_TIMEZONE_OFFSET * 3600LL;
+static const int FIRST_WEEKDAY = 1;
+
+static const Us MEAL_EARLY = 5 * SEC;           // Antes disso a refeição saiu adiantada
+static const Us MEAL_WINDOW_BEFORE = 5 * MINUTE;
+static const Us MEAL_WINDOW_AFTER = SCHEDULE_CATCHUP_SEC * SEC + 2 * MINUTE;
+static const Us EPISODE_LOG_SLACK = 5 * SEC;    // Log gravado depois de fechar o servo
+static const Us SAMPLE_INTERVAL = 10 * MINUTE;
+
+// Duty de 1400 µs: abaixo disso o servo está abrindo a saída
+static const uint32_t SERVO_OPEN_DUTY = (1400UL * 65535 + 10000) / 20000;
+
+static bool verbose = false;
+
+static const char* fmtTime(Us t) {
+    static char text[4][32];
+    static int next = 0;
+    char* out = text[next++ % 4];
+    Us ms = t / MS;
+    snprintf(out, 32, "%lldd%02lld:%02lld:%02lld.%03lld", (long long)(ms / 86400000), (long long)(ms / 3600000 % 24),
+             (long long)(ms / 60000 % 60), (long long)(ms / 1000 % 60), (long long)(ms % 1000));
+    return out;
+}
+
+static const char* fmtDuration(Us us) {
+    static char text[4][32];
+    static int next = 0;
+    char* out = text[next++ % 4];
+    if (us < 10 * SEC) snprintf(out, 32, "%.1f ms", us / 1000.0);
+    else if (us < 10 * MINUTE) snprintf(out, 32, "%.1f s", us / 1e6);
+    else if (us < 2 * DAY) snprintf(out, 32, "%.1f h", us / 3.6e9);
+    else snprintf(out, 32, "%.1f d", us / 8.64e10);
+    return out;
+}
+
+// ========== FIRMWARE ==========
+
+static bool setupDone = false;
+
+// Chip acordado ou em deep sleep (o relatório de consumo soma os trechos)
+static bool sleeping = false;
+static Us powerSince = 0;
+static Us awakeUs = 0;
+static Us sleepUs = 0;
+static uint32_t deepSleeps = 0;
+static Histogram awakeSpan;
+
+static void setPowerState(bool sleep) {
+    Us spent = now() - powerSince;
+    if (sleeping) {
+        sleepUs += spent;
+    } else {
+        awakeUs += spent;
+        if (sleep) awakeSpan.add(spent);
+    }
+    sleeping = sleep;
+    powerSince = now();
+}
+
+static void firmwareMain(void*) {
+    setPowerState(false);
+    setup();
+    setupDone = true;
+    for (;;) loop();
+}
+
+// No chip o reset zera a RAM e os construtores rodam de novo no boot; aqui
+// os globais do firmware são destruídos e reconstruídos na ordem do link
+template <typename T>
+static void destroy(T& object) {
+    object.~T();
+}
+
+template <typename T>
+static void construct(T& object) {
+    new (&object) T();
+}
+
+static void rebuildGlobals() {
+    destroy(scheduleService);
+    destroy(powerService);
+    destroy(otaService);
+    destroy(logService);
+    destroy(levelSensor);
+    destroy(feederService);
+    destroy(scheduler);
+    destroy(psramAllocator);
+    destroy(mqttService);
+    destroy(hardwareRtc);
+    destroy(clockService);
+
+    construct(clockService);
+    construct(hardwareRtc);
+    construct(mqttService);
+    construct(psramAllocator);
+    construct(scheduler);
+    construct(feederService);
+    construct(levelSensor);
+    construct(logService);
+    construct(otaService);
+    construct(powerService);
+    construct(scheduleService);
+}
+
+// ========== ORÁCULO ==========
+
+struct JournalEntry {
+    Us at;                  // Mundo, quando o ENTRY foi gravado
+    uint32_t timestamp;     // Firmware (UTC); 0 = sem hora
+    bool timestampKnown;    // Base do bloco vista
+    uint16_t qty;
+    bool delivered;
+    FeedSource source;
+    uint8_t channel;
+    bool matched;
+};
+
+struct ServoEpisode {
+    uint8_t channel;
+    Us start;
+    Us end;                 // -1 = aberto
+    bool logged;
+    bool matched;
+};
+
+struct ScheduleSnapshot {
+    Us from;
+    Meal meals[SCHEDULE_SLOTS];
+};
+
+static std::vector<JournalEntry> journal;
+static std::vector<ServoEpisode> episodes;
+static std::vector<ScheduleSnapshot> schedules;
+static uint32_t journalBase = 0;
+static bool journalBaseKnown = false;
+
+static Histogram mealDelay;         // Horário da refeição -> servo abre
+static Histogram clockError;        // |hora do firmware - hora real| (amostras)
+static Us clockErrorMax = 0;
+static uint32_t clockSamples = 0;
+static uint32_t clockUnset = 0;     // Amostras sem hora válida
+static Histogram logTimestampError;
+static uint32_t logsWithoutTime = 0;
+
+static ServoEpisode* openEpisode(uint8_t channel) {
+    for (auto it = episodes.rbegin(); it != episodes.rend(); ++it) {
+        if (it->channel == channel && it->end < 0) return &*it;
+    }
+    return nullptr;
+}
+
+static void onLedc(uint8_t ledcChannel, uint32_t duty) {
+    int servo = (int)ledcChannel - SERVO_LEDC_CHANNEL;
+    if (servo < 0 || servo >= FEEDER_CHANNELS) return;
+    uint8_t channel = servo;
+
+    bool open = duty > 0 && duty < SERVO_OPEN_DUTY;
+    ServoEpisode* episode = openEpisode(channel);
+    if (open && !episode) {
+        episodes.push_back(ServoEpisode{ channel, now(), -1, false, false });
+    } else if (!open && episode) {
+        episode->end = now();
+    }
+}
+
+static void onAppend(const std::string& path, const uint8_t* data, size_t len) {
+    if (path != "/feedlog.jnl") return;
+
+    // Registros inteiros por append: [BASE 16 B] ENTRY 8 B, ou ACK 20 B
+    size_t pos = 0;
+    while (pos < len) {
+        uint8_t tag = data[pos];
+        if (tag == 0xB1 && pos + 16 <= len) {
+            const uint8_t* p = data + pos + 8;
+            journalBase = p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+            journalBaseKnown = true;
+            pos += 16;
+        } else if (tag == 0xE1 && pos + 8 <= len) {
+            JournalEntry entry = {};
+            FeedLogCodec::decode(data + pos + 1, journalBase, entry.timestamp, entry.qty, entry.delivered,
+                                 entry.source, entry.channel);
+            entry.at = now();
+            entry.timestampKnown = journalBaseKnown;
+            journal.push_back(entry);
+
+            if (entry.timestamp == 0) {
+                logsWithoutTime++;
+            } else if (entry.timestampKnown) {
+                Us truth = trueUtcMicros(now()) / SEC;
+                logTimestampError.add(llabs((Us)entry.timestamp - truth) * SEC);
+            }
+            pos += 8;
+        } else if (tag == 0xA1) {
+            pos += 20;
+        } else {
+            break;
+        }
+    }
+}
+
+static void sampleSchedule() {
+    if (setupDone) {
+        ScheduleSnapshot snapshot;
+        snapshot.from = now();
+        for (uint8_t i = 0; i < SCHEDULE_SLOTS; i++) snapshot.meals[i] = scheduleService.getMeal(i);
+
+        bool changed = schedules.empty();
+        for (uint8_t i = 0; !changed && i < SCHEDULE_SLOTS; i++) {
+            const Meal& a = schedules.back().meals[i];
+            const Meal& b = snapshot.meals[i];
+            changed = a.hour != b.hour || a.minute != b.minute || a.qty != b.qty || a.enabled != b.enabled ||
+                      a.days != b.days || a.channel != b.channel;
+        }
+        if (changed) schedules.push_back(snapshot);
+    }
+    at(now() + MINUTE, sampleSchedule);
+}
+
+static void sampleClock() {
+    // No meio do segundo real: getTimestamp() trunca
+    if (setupDone) {
+        if (!clockService.isInitialized()) {
+            clockUnset++;
+        } else {
+            Us truth = trueUtcMicros(now());
+            Us error = llabs((Us)clockService.getTimestamp() * SEC + SEC / 2 - truth);
+            clockError.add(error);
+            clockErrorMax = std::max(clockErrorMax, error);
+            clockSamples++;
+        }
+    }
+    Us next = now() + SAMPLE_INTERVAL;
+    next += SEC / 2 - trueUtcMicros(next) % SEC;
+    at(next, sampleClock);
+}
+
+static void onChipReset(esp_reset_reason_t reason) {
+    // Sem PWM o servo para onde está; para o oráculo, o episódio acabou
+    for (ServoEpisode& episode : episodes) {
+        if (episode.end < 0) episode.end = now();
+    }
+    setupDone = false;
+    if (reason == ESP_RST_DEEPSLEEP) deepSleeps++;
+    setPowerState(reason == ESP_RST_DEEPSLEEP);
+
+    platformOnReset(reason);
+    worldOnReset();
+    rebuildGlobals();
+}
+
+// ========== CENÁRIO ==========
+
+struct Action {
+    Us at;
+    std::vector<std::string> words;
+    int line;
+};
+
+struct Scenario {
+    uint64_t seed = 1;
+    int days = 7;
+    double driftPpm = 0;
+    RtcChip rtc = RtcChip::OK;
+    bool wifi = true;
+    bool broker = true;
+    bool ntp = true;
+    bool ack = true;
+    bool lowPower = false;      // Exige build com -DREMOTE_LOW_POWER=1
+    Us maxLoopPass = 0;         // Volta do loop() a partir daqui falha o cenário
+    int64_t maxLogDuplicates = -1;  // Logs reenviados à Central acima disso falham o cenário
+    std::vector<Meal> meals;
+    std::vector<Action> actions;
+};
+
+static std::vector<std::string> splitWords(const std::string& line) {
+    std::vector<std::string> words;
+    size_t pos = 0;
+    while (pos < line.size()) {
+        size_t start = line.find_first_not_of(" \t", pos);
+        if (start == std::string::npos) break;
+        size_t end = line.find_first_of(" \t", start);
+        if (end == std::string::npos) end = line.size();
+        words.push_back(line.substr(start, end - start));
+        pos = end;
+    }
+    return words;
+}
+
+// 1d, 6h, 30m, 45s, 250ms
+static bool parseDuration(const std::string& text, Us& out) {
+    char* end;
+    double value = strtod(text.c_str(), &end);
+    std::string unit(end);
+    Us scale = unit == "d" ? DAY : unit == "h" ? HOUR : unit == "m" ? MINUTE : unit == "s" ? SEC : unit == "ms" ? MS : 0;
+    if (end == text.c_str() || scale == 0) return false;
+    out = (Us)(value * scale);
+    return true;
+}
+
+// <D>d<HH:MM[:SS]>, hora local do cenário
+static bool parseWhen(const std::string& text, Us& out) {
+    int day, hour, minute, second = 0;
+    if (sscanf(text.c_str(), "%dd%d:%d:%d", &day, &hour, &minute, &second) < 3) return false;
+    out = day * DAY + hour * HOUR + minute * MINUTE + second * SEC;
+    return true;
+}
+
+static bool parseClock(const std::string& text, uint8_t& hour, uint8_t& minute) {
+    int h, m;
+    if (sscanf(text.c_str(), "%d:%d", &h, &m) != 2 || h < 0 || h > 23 || m < 0 || m > 59) return false;
+    hour = h;
+    minute = m;
+    return true;
+}
+
+static bool parseUpDown(const std::string& text, bool& out) {
+    if (text == "up" || text == "on") out = true;
+    else if (text == "down" || text == "off") out = false;
+    else return false;
+    return true;
+}
+
+static bool parseRtc(const std::string& text, RtcChip& out) {
+    if (text == "ok") out = RtcChip::OK;
+    else if (text == "lost") out = RtcChip::LOST;
+    else if (text == "none") out = RtcChip::NONE;
+    else return false;
+    return true;
+}
+
+static bool parseMeal(const std::vector<std::string>& w, size_t first, Meal& meal, uint8_t& slot) {
+    if (w.size() < first + 3) return false;
+    int index = atoi(w[first].c_str());
+    if (index < 0 || index >= SCHEDULE_SLOTS) return false;
+    slot = index;
+    if (!parseClock(w[first + 1], meal.hour, meal.minute)) return false;
+    meal.qty = atoi(w[first + 2].c_str());
+    meal.channel = w.size() > first + 3 ? atoi(w[first + 3].c_str()) : 0;
+    meal.enabled = true;
+    meal.days = MEAL_ALL_DAYS;
+    return meal.qty > 0 && meal.channel < FEEDER_CHANNELS;
+}
+
+static bool validAction(const std::vector<std::string>& w) {
+    const std::string& verb = w[0];
+    bool flag;
+    RtcChip chip;
+    Meal meal;
+    uint8_t slot;
+    Us unused;
+    if (verb == "wifi" || verb == "broker" || verb == "ntp" || verb == "ack") return w.size() == 2 && parseUpDown(w[1], flag);
+    if (verb == "rtc") return w.size() == 2 && parseRtc(w[1], chip);
+    if (verb == "reboot" || verb == "crash") return w.size() == 1;
+    if (verb == "brownout" || verb == "blackhole") return w.size() == 2 && parseDuration(w[1], unused);
+    if (verb == "feed") return w.size() >= 2 && atoi(w[1].c_str()) > 0;
+    if (verb == "meal") return parseMeal(w, 1, meal, slot);
+    if (verb == "drift") return w.size() == 2;
+    if (verb == "cmd") return w.size() >= 2;
+    return false;
+}
+
+static bool loadScenario(const char* path, Scenario& scenario) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Não abriu %s\n", path);
+        return false;
+    }
+
+    char buf[512];
+    int lineNo = 0;
+    bool ok = true;
+    while (fgets(buf, sizeof(buf), f)) {
+        lineNo++;
+        std::string line(buf);
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.resize(hash);
+        line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+        line.erase(std::remove(line.begin(), line.end(), '\n'), line.end());
+        std::vector<std::string> w = splitWords(line);
+        if (w.empty()) continue;
+
+        Us when;
+        bool good = true;
+        if (parseWhen(w[0], when)) {
+            // <quando> ação [args] [x<vezes>/<intervalo>]
+            int count = 1;
+            Us every = 0;
+            if (w.size() > 2 && w.back()[0] == 'x') {
+                size_t slash = w.back().find('/');
+                count = atoi(w.back().c_str() + 1);
+                good = slash != std::string::npos && count > 0 && parseDuration(w.back().substr(slash + 1), every);
+                w.pop_back();
+            }
+            w.erase(w.begin());
+            good = good && !w.empty() && validAction(w);
+            for (int i = 0; good && i < count; i++) scenario.actions.push_back(Action{ when + i * every, w, lineNo });
+        } else if (w[0] == "seed" && w.size() == 2) {
+            scenario.seed = strtoull(w[1].c_str(), nullptr, 10);
+        } else if (w[0] == "days" && w.size() == 2) {
+            scenario.days = atoi(w[1].c_str());
+        } else if (w[0] == "drift" && w.size() == 2) {
+            scenario.driftPpm = atof(w[1].c_str());
+        } else if (w[0] == "rtc" && w.size() == 2) {
+            good = parseRtc(w[1], scenario.rtc);
+        } else if (w[0] == "wifi" && w.size() == 2) {
+            good = parseUpDown(w[1], scenario.wifi);
+        } else if (w[0] == "broker" && w.size() == 2) {
+            good = parseUpDown(w[1], scenario.broker);
+        } else if (w[0] == "ntp" && w.size() == 2) {
+            good = parseUpDown(w[1], scenario.ntp);
+        } else if (w[0] == "ack" && w.size() == 2) {
+            good = parseUpDown(w[1], scenario.ack);
+        } else if (w[0] == "low_power" && w.size() == 1) {
+            scenario.lowPower = true;
+        } else if (w[0] == "max_loop_pass" && w.size() == 2) {
+            good = parseDuration(w[1], scenario.maxLoopPass) && scenario.maxLoopPass > 0;
+        } else if (w[0] == "max_log_duplicates" && w.size() == 2) {
+            scenario.maxLogDuplicates = strtoll(w[1].c_str(), nullptr, 10);
+            good = scenario.maxLogDuplicates >= 0;
+        } else if (w[0] == "meal") {
+            Meal meal;
+            uint8_t slot;
+            good = parseMeal(w, 1, meal, slot);
+            if (good) {
+                if (scenario.meals.size() <= slot) scenario.meals.resize(slot + 1);
+                scenario.meals[slot] = meal;
+            }
+        } else {
+            good = false;
+        }
+
+        if (!good) {
+            fprintf(stderr, "%s:%d: linha inválida: %s\n", path, lineNo, buf);
+            ok = false;
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+// Agenda gravada na NVS antes do primeiro boot (remota já configurada);
+// horários não listados ficam desligados
+static void provisionMeals(const Scenario& scenario) {
+    Preferences prefs;
+    prefs.begin(NVS_SCHEDULE_NAMESPACE, false);
+    for (uint8_t i = 0; i < SCHEDULE_SLOTS; i++) {
+        bool listed = i < scenario.meals.size() && scenario.meals[i].qty > 0;
+        Meal meal = listed ? scenario.meals[i] : Meal();
+        String prefix = "meal" + String(i);
+        prefs.putUChar((prefix + "_hour").c_str(), meal.hour);
+        prefs.putUChar((prefix + "_minute").c_str(), meal.minute);
+        prefs.putUShort((prefix + "_qty").c_str(), meal.qty);
+        prefs.putBool((prefix + "_enabled").c_str(), listed);
+        prefs.putUChar((prefix + "_days").c_str(), meal.days);
+        prefs.putUChar((prefix + "_ch").c_str(), meal.channel);
+    }
+    prefs.end();
+}
+
+static uint32_t nextReqId = 1;
+
+template <typename Args>
+static void sendArgs(const Args& args) {
+    JsonDocument doc;
+    CommandRegistry::encode(args, doc);
+    std::string json;
+    serializeJson(doc, json);
+    sendCommand(json);
+}
+
+static void perform(const Action& action) {
+    const std::vector<std::string>& w = action.words;
+    const std::string& verb = w[0];
+    bool flag = false;
+
+    if (verbose) {
+        std::string text;
+        for (const std::string& word : w) text += " " + word;
+        printf("%s ***%s\n", fmtTime(now()), text.c_str());
+    }
+
+    if (verb == "wifi") {
+        parseUpDown(w[1], flag);
+        setAccessPoint(flag);
+    } else if (verb == "broker") {
+        parseUpDown(w[1], flag);
+        setBroker(flag);
+    } else if (verb == "ntp") {
+        parseUpDown(w[1], flag);
+        setNtp(flag);
+    } else if (verb == "ack") {
+        parseUpDown(w[1], flag);
+        setAutoAck(flag);
+    } else if (verb == "rtc") {
+        RtcChip chip = RtcChip::OK;
+        parseRtc(w[1], chip);
+        setRtcChip(chip);
+    } else if (verb == "drift") {
+        setCrystalPpm(atof(w[1].c_str()));
+    } else if (verb == "reboot") {
+        reset(ESP_RST_POWERON, 2 * SEC);
+    } else if (verb == "crash") {
+        reset(ESP_RST_PANIC, 0);
+    } else if (verb == "brownout") {
+        Us off = 0;
+        parseDuration(w[1], off);
+        reset(ESP_RST_BROWNOUT, off);
+    } else if (verb == "blackhole") {
+        Us duration = 0;
+        parseDuration(w[1], duration);
+        setBlackhole(duration);
+    } else if (verb == "feed") {
+        FeedArgs args;
+        args.quantity = atoi(w[1].c_str());
+        args.reqId = nextReqId++;
+        args.channel = w.size() > 2 ? atoi(w[2].c_str()) : 0;
+        sendArgs(args);
+    } else if (verb == "meal") {
+        Meal meal;
+        uint8_t slot = 0;
+        parseMeal(w, 1, meal, slot);
+        MealConfigArgs args;
+        args.remoteId = 0;
+        args.meal = slot;
+        args.hour = meal.hour;
+        args.minute = meal.minute;
+        args.quantity = meal.qty;
+        args.days = meal.days;
+        args.channel = meal.channel;
+        sendArgs(args);
+    } else if (verb == "cmd") {
+        std::string json;
+        for (size_t i = 1; i < w.size(); i++) json += (i > 1 ? " " : "") + w[i];
+        sendCommand(json);
+    }
+}
+
+// ========== RELATÓRIO ==========
+
+struct MealReport {
+    uint32_t due;
+    uint32_t served;
+    uint32_t missed;
+    uint32_t duplicate;
+    uint32_t early;
+    uint32_t failed;
+    uint32_t interrupted;       // Servo abriu e o reset veio antes do log
+    uint32_t offSchedule;       // Logs de agenda fora de qualquer janela
+    uint32_t unlogged;          // Servo abriu sem log (reset no meio)
+    uint32_t manual;
+};
+
+static bool isScheduleSource(FeedSource source) {
+    return source == FeedSource::SCHEDULE || source == FeedSource::RTC_AUTO || source == FeedSource::TIMEOUT;
+}
+
+static const ScheduleSnapshot* scheduleAt(Us t) {
+    const ScheduleSnapshot* found = schedules.empty() ? nullptr : &schedules.front();
+    for (const ScheduleSnapshot& s : schedules) {
+        if (s.from <= t) found = &s;
+    }
+    return found;
+}
+
+static MealReport checkMeals(Us end) {
+    MealReport report = {};
+
+    // Episódio do servo com log (de qualquer origem) gravado até logo depois
+    for (ServoEpisode& episode : episodes) {
+        Us close = episode.end < 0 ? end : episode.end;
+        for (const JournalEntry& entry : journal) {
+            if (entry.channel == episode.channel && entry.at >= episode.start && entry.at <= close + EPISODE_LOG_SLACK) {
+                episode.logged = true;
+                break;
+            }
+        }
+        if (!episode.logged) report.unlogged++;
+    }
+
+    for (int day = 0; (Us)day * DAY < end; day++) {
+        int weekday = (FIRST_WEEKDAY + day) % 7;
+        for (uint8_t slot = 0; slot < SCHEDULE_SLOTS; slot++) {
+            Us deadline = day * DAY;
+            const ScheduleSnapshot* snapshot = scheduleAt(deadline + 12 * HOUR);
+            if (!snapshot) continue;
+            const Meal& meal = snapshot->meals[slot];
+            deadline += meal.hour * HOUR + meal.minute * MINUTE;
+            snapshot = scheduleAt(deadline - MEAL_WINDOW_BEFORE);
+            if (!snapshot) continue;
+            const Meal& active = snapshot->meals[slot];
+            if (!active.enabled || !(active.days & (1 << weekday))) continue;
+            if (active.hour != meal.hour || active.minute != meal.minute) continue;
+            if (deadline + MEAL_WINDOW_AFTER > end) continue;
+
+            Us from = deadline - MEAL_WINDOW_BEFORE;
+            Us to = deadline + MEAL_WINDOW_AFTER;
+            report.due++;
+
+            uint32_t logged = 0;
+            uint32_t unlogged = 0;
+            Us first = NEVER;
+            for (JournalEntry& entry : journal) {
+                if (entry.matched || !isScheduleSource(entry.source) || entry.channel != active.channel) continue;
+                if (entry.at < from || entry.at > to) continue;
+                entry.matched = true;
+                logged++;
+                if (!entry.delivered) report.failed++;
+            }
+            for (ServoEpisode& episode : episodes) {
+                if (episode.channel != active.channel || episode.start < from || episode.start > to) continue;
+                if (!episode.logged) unlogged++;
+                first = std::min(first, episode.start);
+            }
+
+            if (logged == 0) {
+                if (unlogged) report.interrupted++;
+                else report.missed++;
+                if (verbose) {
+                    printf("Refeição %u do dia %d (%02u:%02u) %s\n", slot, day, meal.hour, meal.minute,
+                           unlogged ? "interrompida" : "perdida");
+                }
+            } else {
+                report.served++;
+            }
+            if (logged + unlogged > 1) {
+                report.duplicate += logged + unlogged - 1;
+                if (verbose) printf("Refeição %u do dia %d saiu %u vezes\n", slot, day, logged + unlogged);
+            }
+            if (first != NEVER) {
+                if (first < deadline - MEAL_EARLY) report.early++;
+                mealDelay.add(std::max<Us>(first - deadline, 0));
+            }
+        }
+    }
+
+    for (const JournalEntry& entry : journal) {
+        if (isScheduleSource(entry.source) && !entry.matched && entry.at <= end - MEAL_WINDOW_AFTER) {
+            report.offSchedule++;
+        }
+        if (!isScheduleSource(entry.source)) report.manual++;
+    }
+    return report;
+}
+
+static void printReport(const Scenario& scenario, Us end, double wallSeconds) {
+    finishStats();
+    MealReport meals = checkMeals(end);
+    double days = end / (double)DAY;
+
+    printf("\n==================== RELATÓRIO ====================\n");
+    printf("Simulados %.1f dias em %.2f s (%.0fx), %u boots, deriva do cristal %.1f ppm\n", days, wallSeconds,
+           end / 1e6 / wallSeconds, bootCount(), scenario.driftPpm);
+
+    printf("\n--- Refeições ---\n");
+    printf("Previstas %u, servidas %u, perdidas %u, interrompidas %u, duplicadas %u, adiantadas %u, falhas %u\n",
+           meals.due, meals.served, meals.missed, meals.interrupted, meals.duplicate, meals.early, meals.failed);
+    printf("Logs de agenda fora do horário %u, servo sem log %u, manuais %u\n", meals.offSchedule, meals.unlogged,
+           meals.manual);
+    mealDelay.print("Atraso horário -> servo");
+
+    printf("\n--- Relógio ---\n");
+    printf("Amostras %u (sem hora %u), erro máx %s\n", clockSamples, clockUnset, fmtDuration(clockErrorMax));
+    clockError.print("Erro do relógio (±0,5 s)");
+    printf("Logs sem hora %u\n", logsWithoutTime);
+    logTimestampError.print("Erro do timestamp nos logs (±1 s)");
+
+    printf("\n--- Flash ---\n");
+    printf("NVS: %llu puts, %llu gravações (%.1f/dia), %llu B\n", (unsigned long long)flashStats.nvsPuts,
+           (unsigned long long)flashStats.nvsWrites, flashStats.nvsWrites / days,
+           (unsigned long long)flashStats.nvsBytes);
+    printf("LittleFS: %llu aberturas, %llu escritas (%.1f/dia), %llu B, %llu renomeações, %llu remoções\n",
+           (unsigned long long)flashStats.fsOpens, (unsigned long long)flashStats.fsWrites,
+           flashStats.fsWrites / days, (unsigned long long)flashStats.fsBytes,
+           (unsigned long long)flashStats.fsRenames, (unsigned long long)flashStats.fsRemoves);
+
+    printf("\n--- Loop ---\n");
+    loopPass.print("Volta do loop()");
+    if (loopPassLimit > 0) {
+        printf("Limite %s: %llu voltas acima", fmtDuration(loopPassLimit), (unsigned long long)loopPassOver);
+        if (loopPassOver) printf(" (a primeira começou em %s)", fmtTime(loopPassFirstOver));
+        printf("\n");
+    }
+
+    printf("\n--- MQTT ---\n");
+    printf("Conexões %u (falhas %u), online %.1f%% do tempo, associado %.1f%%\n", linkStats.connects,
+           linkStats.connectFailures, 100.0 * linkStats.onlineUs / end, 100.0 * linkStats.associatedUs / end);
+    printf("Quedas: WiFi %u, broker %u, keepalive no broker %u, PINGRESP %u, TCP %u, reset %u, fechada %u\n",
+           linkStats.lossWifi, linkStats.lossBroker, linkStats.lossKeepalive, linkStats.lossClientTimeout,
+           linkStats.lossTcp, linkStats.lossReset, linkStats.lossClosed);
+    printf("Publicações %llu (%llu B, %.1f/h), PINGREQs %llu (%.1f/h)\n",
+           (unsigned long long)linkStats.publishes, (unsigned long long)linkStats.publishBytes,
+           linkStats.publishes / (end / (double)HOUR), (unsigned long long)linkStats.pings,
+           linkStats.pings / (end / (double)HOUR));
+    for (auto& topic : linkStats.byTopic) {
+        printf("  %-32s %llu\n", topic.first.c_str(), (unsigned long long)topic.second);
+    }
+    printf("Comandos: enviados %u, entregues %u, perdidos %u\n", linkStats.commandsSent,
+           linkStats.commandsDelivered, linkStats.commandsLost);
+    linkStats.commandLatency.print("Latência de comando (Central -> firmware)");
+    linkStats.reconnect.print("Queda -> reconexão");
+    linkStats.deadLink.print("Blackhole -> firmware perceber");
+
+    static const char* const modes[] = { "sem modem sleep", "modem sleep por DTIM", "modem sleep por listen interval" };
+    printf("\n--- Rádio ---\n");
+    printf("%s", modes[linkStats.powerSave]);
+    if (linkStats.powerSave == WIFI_PS_MAX_MODEM) printf(" (%u beacons)", linkStats.listenInterval);
+    printf(", keepalive %us: ligado %.2f%% do tempo associado (%.1f s/h)\n",
+           (unsigned)MQTT_KEEPALIVE_S,
+           linkStats.associatedUs ? 100.0 * linkStats.radioOnUs / linkStats.associatedUs : 0.0,
+           linkStats.associatedUs ? linkStats.radioOnUs / 1e6 / (linkStats.associatedUs / (double)HOUR) : 0.0);
+
+    // Autonomia com as correntes do power_service.h (as mesmas da estimativa
+    // que o firmware imprime a cada despertar), aplicadas ao tempo medido aqui.
+    // Sempre acordado a corrente depende do modem sleep (ver Rádio)
+    setPowerState(sleeping);
+    double awakeShare = awakeUs / (double)(awakeUs + sleepUs);
+    double averageMa = awakeShare * POWER_AWAKE_MA + (1 - awakeShare) * POWER_SLEEP_UA / 1000.0;
+    printf("\n--- Consumo ---\n");
+    printf("%s: acordado %.2f%% do tempo, deep sleep %.2f%% (%u, %.1f/dia); rádio ligado %.2f%%\n",
+           REMOTE_LOW_POWER ? "REMOTE_LOW_POWER" : "Sempre acordado", 100 * awakeShare, 100 * (1 - awakeShare),
+           deepSleeps, deepSleeps / days, 100.0 * linkStats.radioOnUs / end);
+    if (REMOTE_LOW_POWER) {
+        printf("Corrente média %.2f mA (%d mA acordado, %d µA dormindo): %d mAh duram %.1f dias\n", averageMa,
+               (int)POWER_AWAKE_MA, (int)POWER_SLEEP_UA, (int)POWER_BATTERY_MAH, POWER_BATTERY_MAH / averageMa / 24);
+        awakeSpan.print("Acordado por despertar", "s");
+    }
+
+    printf("\n--- Logs na Central ---\n");
+    printf("Lotes %llu, recebidos %llu, duplicados %llu, descartados na remota %llu, ACKs %llu\n",
+           (unsigned long long)logStats.batches, (unsigned long long)logStats.received,
+           (unsigned long long)logStats.duplicates, (unsigned long long)logStats.lost,
+           (unsigned long long)logStats.acks);
+    if (scenario.maxLogDuplicates >= 0) {
+        printf("Limite de %lld duplicados: %s\n", (long long)scenario.maxLogDuplicates,
+               logStats.duplicates > (uint64_t)scenario.maxLogDuplicates ? "ultrapassado" : "ok");
+    }
+
+    if (isRunning() && setupDone) {
+        printf("\n--- TaskScheduler (boot atual) ---\n");
+        observer.serialLine = [](const char* line) { printf("%s\n", line); };
+        scheduler.printStats();
+    }
+}
+
+// ========== MAIN ==========
+
+int main(int argc, char** argv) {
+    const char* path = nullptr;
+    int daysOverride = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) verbose = true;
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) daysOverride = atoi(argv[++i]);
+        else path = argv[i];
+    }
+    if (!path) {
+        fprintf(stderr, "uso: feeder_sim [-v] [-d dias] <cenario.txt>\n");
+        return 2;
+    }
+
+    Scenario scenario;
+    if (!loadScenario(path, scenario)) return 2;
+    if (daysOverride > 0) scenario.days = daysOverride;
+    if (scenario.lowPower && !REMOTE_LOW_POWER) {
+        fprintf(stderr, "%s: cenário de baixo consumo - compile com -DREMOTE_LOW_POWER=1\n", path);
+        return 2;
+    }
+
+    setSeed(scenario.seed);
+    setEpoch(SCENARIO_EPOCH);
+    setCrystalPpm(scenario.driftPpm);
+    setRtcChip(scenario.rtc);
+    setAccessPoint(scenario.wifi);
+    setBroker(scenario.broker);
+    setNtp(scenario.ntp);
+    setAutoAck(scenario.ack);
+    provisionMeals(scenario);
+    flashStats = FlashStats();
+    loopPassLimit = scenario.maxLoopPass;
+
+    observer.ledc = onLedc;
+    observer.append = onAppend;
+    if (verbose) {
+        observer.serialLine = [](const char* line) { printf("%s %s\n", fmtTime(now()), line); };
+    }
+
+    onReset(onChipReset);
+    setFirmware(firmwareMain);
+    for (const Action& action : scenario.actions) {
+        atKernel(action.at, [action] { perform(action); });
+    }
+    at(MINUTE, sampleSchedule);
+    at(SEC / 2, sampleClock);
+
+    Us end = scenario.days * DAY;
+    auto wallStart = std::chrono::steady_clock::now();
+    powerOn();
+    run(end);
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    printReport(scenario, end, wall);
+
+    // Sem destrutores estáticos: no chip os globais nunca são destruídos, e a
+    // ordem entre os do firmware e os do modelo não é garantida
+    fflush(stdout);
+    bool tooManyDuplicates = scenario.maxLogDuplicates >= 0 && logStats.duplicates > (uint64_t)scenario.maxLogDuplicates;
+    _exit(loopPassOver || tooManyDuplicates ? 1 : 0);
+}
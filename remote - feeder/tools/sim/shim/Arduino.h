@@ -0,0 +1,242 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+// Núcleo Arduino do simulador (tools/sim): só o que o firmware da remota usa.
+// Tempo, tarefas e E/S vão para o relógio virtual e o modelo do mundo
+// (sim_kernel, sim_world); nada aqui toca o relógio ou a rede do host.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <string>
+
+#include "esp_err.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Relógio do sistema (SNTP, deep sleep) no lugar do relógio do host
+int simGettimeofday(struct timeval* tv, void* tz);
+int simSettimeofday(const struct timeval* tv, const void* tz);
+#define gettimeofday simGettimeofday
+#define settimeofday simSettimeofday
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+#define SDA 21
+#define SCL 22
+
+#define IRAM_ATTR
+#define PROGMEM
+#define F(s) (s)
+
+// Memória RTC numa seção própria: o simulador a preserva ou restaura
+// conforme o motivo do reset (só o despertar do deep sleep a mantém)
+#define RTC_DATA_ATTR __attribute__((section("rtc_data")))
+#define RTC_NOINIT_ATTR __attribute__((section("rtc_noinit")))
+
+using std::min;
+using std::max;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#if !defined(__GLIBC__) || __GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38)
+size_t strlcpy(char* dst, const char* src, size_t size);
+#endif
+
+// ========== STRING ==========
+
+class String {
+public:
+    String(const char* cstr = "") : s(cstr ? cstr : "") {}
+    String(const String& other) = default;
+    String(String&& other) = default;
+    explicit String(char c) : s(1, c) {}
+    explicit String(unsigned char value, unsigned char base = 10) : String((unsigned long)value, base) {}
+    explicit String(int value, unsigned char base = 10) : String((long)value, base) {}
+    explicit String(unsigned int value, unsigned char base = 10) : String((unsigned long)value, base) {}
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimals = 2) : String((double)value, decimals) {}
+    explicit String(double value, unsigned int decimals = 2);
+
+    String& operator=(const String& other) = default;
+    String& operator=(String&& other) = default;
+    String& operator=(const char* cstr) {
+        s = cstr ? cstr : "";
+        return *this;
+    }
+
+    const char* c_str() const { return s.c_str(); }
+    unsigned int length() const { return s.size(); }
+    bool isEmpty() const { return s.empty(); }
+    bool reserve(unsigned int size) { s.reserve(size); return true; }
+
+    bool concat(const String& other) { s += other.s; return true; }
+    bool concat(const char* cstr) { if (!cstr) return false; s += cstr; return true; }
+    bool concat(char c) { s += c; return true; }
+    String& operator+=(const String& other) { concat(other); return *this; }
+    String& operator+=(const char* cstr) { concat(cstr); return *this; }
+    String& operator+=(char c) { concat(c); return *this; }
+
+    char charAt(unsigned int index) const { return index < s.size() ? s[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    String substring(unsigned int from) const { return substring(from, s.size()); }
+    String substring(unsigned int from, unsigned int to) const;
+    int indexOf(char c, unsigned int from = 0) const;
+    int indexOf(const String& str, unsigned int from = 0) const;
+    bool startsWith(const String& prefix) const { return s.compare(0, prefix.s.size(), prefix.s) == 0; }
+    bool endsWith(const String& suffix) const;
+    bool equals(const String& other) const { return s == other.s; }
+    bool operator==(const String& other) const { return s == other.s; }
+    bool operator==(const char* cstr) const { return s == (cstr ? cstr : ""); }
+    bool operator!=(const String& other) const { return s != other.s; }
+    bool operator!=(const char* cstr) const { return !(*this == cstr); }
+    bool operator<(const String& other) const { return s < other.s; }
+    long toInt() const { return strtol(s.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(s.c_str(), nullptr); }
+    void trim();
+    void toUpperCase();
+    void toLowerCase();
+
+private:
+    std::string s;
+};
+
+// Resultado de uma concatenação (o ArduinoJson também o reconhece)
+class StringSumHelper : public String {
+public:
+    StringSumHelper(const String& s) : String(s) {}
+    StringSumHelper(const char* p) : String(p) {}
+};
+
+StringSumHelper operator+(const String& lhs, const String& rhs);
+StringSumHelper operator+(const String& lhs, const char* rhs);
+StringSumHelper operator+(const char* lhs, const String& rhs);
+StringSumHelper operator+(const String& lhs, char c);
+StringSumHelper operator+(const String& lhs, int value);
+StringSumHelper operator+(const String& lhs, unsigned int value);
+StringSumHelper operator+(const String& lhs, long value);
+StringSumHelper operator+(const String& lhs, unsigned long value);
+StringSumHelper operator+(const String& lhs, long long value);
+StringSumHelper operator+(const String& lhs, unsigned long long value);
+StringSumHelper operator+(const String& lhs, double value);
+
+// ========== SERIAL ==========
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* str) { return str ? write((const uint8_t*)str, strlen(str)) : 0; }
+
+    size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+    size_t print(const char* str) { return write(str); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(unsigned int value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(long value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(unsigned long value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(double value, int digits = 2) { return print(String(value, (unsigned int)digits)); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T& value) { return print(value) + println(); }
+    template <typename T>
+    size_t println(const T& value, int format) { return print(value, format) + println(); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+// UART0 a 115200: FIFO de 128 B; cheio, quem escreve espera (ver sim_platform)
+class HardwareSerial : public Print {
+public:
+    void begin(unsigned long baud) { this->baud = baud; }
+    void end() {}
+    int available() { return 0; }
+    int read() { return -1; }
+    void flush();
+    operator bool() const { return true; }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+private:
+    unsigned long baud = 115200;
+};
+
+extern HardwareSerial Serial;
+
+// ========== TEMPO ==========
+
+// 32 bits como no ESP32 (o long de lá), também em host de 64 bits: micros()
+// dá a volta a cada 71 min e millis() a cada 49,7 dias sem reset, e o código
+// que subtrai tempos precisa aguentar a volta aqui também
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1,
+                const char* server2 = nullptr, const char* server3 = nullptr);
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
+
+// ========== GPIO / LEDC ==========
+
+#define digitalPinToInterrupt(p) (p)
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void attachInterruptArg(uint8_t pin, void (*fn)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+uint32_t ledcSetup(uint8_t channel, uint32_t freq, uint8_t resolutionBits);
+void ledcAttachPin(uint8_t pin, uint8_t channel);
+void ledcWrite(uint8_t channel, uint32_t duty);
+
+// ========== DIVERSOS ==========
+
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+bool psramFound();
+
+class EspClass {
+public:
+    void restart();
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getFreePsram();
+    uint32_t getPsramSize();
+};
+
+extern EspClass ESP;
+
+#endif
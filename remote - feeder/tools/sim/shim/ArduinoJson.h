@@ -0,0 +1,15 @@
+#ifndef SIM_ARDUINOJSON_H
+#define SIM_ARDUINOJSON_H
+
+// ArduinoJson de verdade (o da .pio/libdeps) com o String do simulador;
+// sem Stream/Print/PROGMEM, que a remota não usa com o JSON
+#include <Arduino.h>
+
+#define ARDUINOJSON_ENABLE_ARDUINO_STRING 1
+#define ARDUINOJSON_ENABLE_ARDUINO_STREAM 0
+#define ARDUINOJSON_ENABLE_ARDUINO_PRINT 0
+#define ARDUINOJSON_ENABLE_PROGMEM 0
+
+#include_next <ArduinoJson.h>
+
+#endif
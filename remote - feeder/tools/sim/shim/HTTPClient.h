@@ -0,0 +1,60 @@
+#ifndef SIM_HTTPCLIENT_H
+#define SIM_HTTPCLIENT_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+#include <string>
+#include <vector>
+
+#define HTTP_CODE_OK 200
+#define HTTP_CODE_NOT_FOUND 404
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+// Corpo de sim::servePatch() chegando na banda do link; some com o WiFi
+class SimHttpStream : public WiFiClient {
+public:
+    SimHttpStream() : body(nullptr), pos(0), since(0) {}
+
+    void open(const std::vector<uint8_t>* data);
+    bool connected() override;
+    void stop() override { body = nullptr; }
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+
+private:
+    const std::vector<uint8_t>* body;
+    size_t pos;
+    int64_t since;          // Mundo no fim dos cabeçalhos
+};
+
+// Servidor de patches do modelo (sim::servePatch). GET bloqueia pelo DNS e
+// handshake como no arduino-esp32; sem WiFi, conexão recusada
+class HTTPClient {
+public:
+    bool begin(WiFiClient& client, const String& url) {
+        (void)client;
+        target = url.c_str();
+        return true;
+    }
+    int GET();
+    int getSize() { return size; }
+    WiFiClient* getStreamPtr() { return &stream; }
+    bool connected() { return stream.connected(); }
+    void end() {
+        stream.stop();
+        size = -1;
+    }
+    void setTimeout(uint16_t ms) { timeoutMs = ms; }
+    static String errorToString(int error);
+
+private:
+    std::string target;
+    int size = -1;
+    uint16_t timeoutMs = 5000;
+    SimHttpStream stream;
+};
+
+#endif
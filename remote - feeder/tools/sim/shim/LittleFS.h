@@ -0,0 +1,61 @@
+#ifndef SIM_LITTLEFS_H
+#define SIM_LITTLEFS_H
+
+#include <Arduino.h>
+#include <memory>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+struct SimFile;
+
+// Arquivos em memória, persistentes entre reboots simulados; cada operação
+// custa o tempo medido na flash do ESP32 (sim_platform) e é contada
+class File : public Print {
+public:
+    File() {}
+    explicit File(std::shared_ptr<SimFile> file) : file(file) {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buf, size_t size) override;
+    using Print::write;
+    int read();
+    size_t read(uint8_t* buf, size_t size);
+    int available();
+    int peek();
+    bool seek(uint32_t pos);
+    size_t position() const;
+    size_t size() const;
+    void flush() {}
+    void close();
+    const char* name() const;
+    operator bool() const { return file != nullptr; }
+
+private:
+    std::shared_ptr<SimFile> file;
+};
+
+class LittleFSFS {
+public:
+    bool begin(bool formatOnFail = false, const char* basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+               const char* partitionLabel = "spiffs");
+    void end() {}
+    bool format();
+    File open(const char* path, const char* mode = FILE_READ, bool create = false);
+    File open(const String& path, const char* mode = FILE_READ, bool create = false) {
+        return open(path.c_str(), mode, create);
+    }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* from, const char* to);
+    bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+    size_t totalBytes();
+    size_t usedBytes();
+};
+
+extern LittleFSFS LittleFS;
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef SIM_PUBSUBCLIENT_H
+#define SIM_PUBSUBCLIENT_H
+
+#include <Arduino.h>
+#include <functional>
+#include <WiFiClient.h>
+
+// Mesma interface e mesmos códigos do PubSubClient 2.8
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+
+#define MQTT_MAX_PACKET_SIZE 256
+#define MQTT_KEEPALIVE 15
+#define MQTT_SOCKET_TIMEOUT 15
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
+
+// Cliente MQTT contra o broker do modelo, com o comportamento do 2.8 que o
+// firmware sente: loop() lê um pacote por chamada, manda PINGREQ quando
+// entrada ou saída ficam paradas por keepAlive e derruba a conexão se o
+// PINGRESP não vier; publish() falha acima do bufferSize; o payload recebido
+// fica no buffer interno, logo após o tópico
+class PubSubClient {
+public:
+    PubSubClient();
+    explicit PubSubClient(Client& client);
+    ~PubSubClient();
+
+    PubSubClient& setServer(const char* domain, uint16_t port);
+    PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE);
+    PubSubClient& setClient(Client& client);
+    PubSubClient& setKeepAlive(uint16_t keepAlive);
+    PubSubClient& setSocketTimeout(uint16_t timeout);
+    bool setBufferSize(uint16_t size);
+    uint16_t getBufferSize() { return bufferSize; }
+
+    bool connect(const char* id);
+    bool connect(const char* id, const char* user, const char* pass);
+    void disconnect();
+
+    bool publish(const char* topic, const char* payload);
+    bool publish(const char* topic, const char* payload, bool retained);
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length);
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained);
+
+    bool subscribe(const char* topic);
+    bool subscribe(const char* topic, uint8_t qos);
+    bool unsubscribe(const char* topic);
+
+    bool loop();
+    bool connected();
+    int state() { return _state; }
+
+private:
+    WiFiClient* client;
+    std::function<void(char*, uint8_t*, unsigned int)> callback;
+    uint8_t* buffer;
+    uint16_t bufferSize;
+    uint16_t keepAlive;
+    uint16_t socketTimeout;
+    unsigned long lastOutActivity;
+    unsigned long lastInActivity;
+    bool pingOutstanding;
+    int _state;
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef SIM_RTCLIB_H
+#define SIM_RTCLIB_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+class DateTime {
+public:
+    DateTime(uint32_t t = 0) : t(t) {}
+    uint32_t unixtime() const { return t; }
+
+private:
+    uint32_t t;
+};
+
+// DS3231 do modelo: segundos inteiros, deriva própria, pode faltar no
+// barramento ou ter perdido a hora (bateria) conforme o cenário
+class RTC_DS3231 {
+public:
+    bool begin(TwoWire* wire = &Wire);
+    bool lostPower();
+    DateTime now();
+    void adjust(const DateTime& dt);
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+#include <Arduino.h>
+#include "esp_wifi.h"
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+    WIFI_OFF,
+    WIFI_STA,
+    WIFI_AP,
+    WIFI_AP_STA
+} wifi_mode_t;
+
+class IPAddress {
+public:
+    IPAddress(uint32_t addr = 0) : addr(addr) {}
+    String toString() const;
+
+private:
+    uint32_t addr;
+};
+
+// Estação ligada ao ponto de acesso do modelo (sim_world): associa com
+// atraso, cai quando o AP some e reconecta sozinha quando ele volta
+class WiFiClass {
+public:
+    wl_status_t begin(const char* ssid, const char* password = nullptr, int32_t channel = 0,
+                      const uint8_t* bssid = nullptr, bool connect = true);
+    wl_status_t status();
+    bool isConnected() { return status() == WL_CONNECTED; }
+    bool reconnect();
+    bool disconnect(bool wifiOff = false, bool eraseAp = false);
+    bool mode(wifi_mode_t mode);
+    wifi_mode_t getMode();
+    bool setAutoReconnect(bool autoReconnect);
+    bool setSleep(bool enabled);
+    bool setSleep(wifi_ps_type_t type);
+    wifi_ps_type_t getSleep();
+    bool setHostname(const char* hostname) { (void)hostname; return true; }
+    void persistent(bool persistent) { (void)persistent; }
+
+    IPAddress localIP();
+    int8_t RSSI();
+    String macAddress();
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef SIM_WIFI_CLIENT_H
+#define SIM_WIFI_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+struct SimSocket;
+
+class Client : public Print {
+public:
+    virtual int connect(const char* host, uint16_t port) = 0;
+    virtual bool connected() = 0;
+    virtual void stop() = 0;
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int read(uint8_t* buf, size_t size) = 0;
+};
+
+// Socket para o broker do modelo. Bytes de aplicação não trafegam: o
+// PubSubClient do simulador troca pacotes inteiros com o broker, e o socket
+// só dá o descritor (select) e quantos bytes há para ler
+class WiFiClient : public Client {
+public:
+    WiFiClient();
+    ~WiFiClient();
+
+    int connect(const char* host, uint16_t port) override;
+    bool connected() override;
+    void stop() override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buf, size_t size) override;
+    using Print::write;
+
+    void setTimeout(uint32_t seconds) { timeoutS = seconds; }
+    int fd() const;
+
+    SimSocket* socket() const { return sock; }
+
+protected:
+    SimSocket* sock;
+    uint32_t timeoutS;
+};
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef SIM_WIFI_CLIENT_SECURE_H
+#define SIM_WIFI_CLIENT_SECURE_H
+
+#include <WiFiClient.h>
+
+// O handshake TLS vira um atraso na conexão (modelo do broker)
+class WiFiClientSecure : public WiFiClient {
+public:
+    void setCACert(const char* rootCa) { (void)rootCa; }
+    void setInsecure() {}
+    void setHandshakeTimeout(unsigned long seconds) { (void)seconds; }
+};
+
+#endif
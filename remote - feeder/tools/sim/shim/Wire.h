@@ -0,0 +1,17 @@
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include <Arduino.h>
+
+class TwoWire {
+public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) {
+        (void)sda; (void)scl; (void)frequency;
+        return true;
+    }
+    void setClock(uint32_t frequency) { (void)frequency; }
+};
+
+extern TwoWire Wire;
+
+#endif
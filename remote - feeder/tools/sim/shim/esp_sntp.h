@@ -0,0 +1,24 @@
+#ifndef SIM_ESP_SNTP_H
+#define SIM_ESP_SNTP_H
+
+#include <stdint.h>
+#include <sys/time.h>
+
+// Cliente SNTP contra o servidor NTP do modelo (sim_world): sem rede ou com
+// o servidor fora, tenta de novo a cada 15 s como o do lwIP
+
+typedef void (*sntp_sync_time_cb_t)(struct timeval* tv);
+
+typedef enum {
+    SNTP_SYNC_STATUS_RESET,
+    SNTP_SYNC_STATUS_COMPLETED,
+    SNTP_SYNC_STATUS_IN_PROGRESS
+} sntp_sync_status_t;
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback);
+void sntp_set_sync_interval(uint32_t intervalMs);
+uint32_t sntp_get_sync_interval();
+bool sntp_restart();
+sntp_sync_status_t sntp_get_sync_status();
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef SIM_ESP_WIFI_H
+#define SIM_ESP_WIFI_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum {
+    WIFI_PS_NONE,
+    WIFI_PS_MIN_MODEM,
+    WIFI_PS_MAX_MODEM
+} wifi_ps_type_t;
+
+typedef enum {
+    WIFI_IF_STA,
+    WIFI_IF_AP
+} wifi_interface_t;
+
+typedef struct {
+    struct {
+        uint8_t ssid[32];
+        uint8_t password[64];
+        uint16_t listen_interval;   // Em beacons (102,4 ms); 0 = padrão (3)
+    } sta;
+} wifi_config_t;
+
+esp_err_t esp_wifi_connect();
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type);
+esp_err_t esp_wifi_get_ps(wifi_ps_type_t* type);
+esp_err_t esp_wifi_get_config(wifi_interface_t iface, wifi_config_t* config);
+esp_err_t esp_wifi_set_config(wifi_interface_t iface, wifi_config_t* config);
+
+#endif
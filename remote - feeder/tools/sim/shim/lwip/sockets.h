@@ -0,0 +1,12 @@
+#ifndef SIM_LWIP_SOCKETS_H
+#define SIM_LWIP_SOCKETS_H
+
+#include <sys/select.h>
+#include <sys/time.h>
+
+// select() sobre os descritores do modelo: bloqueia a tarefa no relógio
+// virtual até chegar um pacote ou vencer o timeout
+int simSelect(int nfds, fd_set* readfds, fd_set* writefds, fd_set* exceptfds, struct timeval* timeout);
+#define select simSelect
+
+#endif
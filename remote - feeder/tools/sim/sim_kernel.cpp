@@ -0,0 +1,474 @@
+// sim_kernel.cpp - relógio virtual, tarefas e reset do chip simulado
+#include "sim_kernel.h"
+#include <freertos/task.h>
+#include <ucontext.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <deque>
+#include <queue>
+#include <vector>
+
+struct SimTask {
+    const char* name;
+    void (*fn)(void*);
+    void* arg;
+    uint32_t declaredStack;     // O que o firmware pediu (a pilha no host é maior)
+    ucontext_t ctx;
+    uint8_t* stack;
+    bool dead;
+    bool waiting;
+    bool woken;
+    bool waitNotify;            // Bloqueada em ulTaskNotifyTake
+    uint64_t waitGen;           // Descarta o timeout de uma espera anterior
+    uint32_t notify;
+};
+
+namespace sim {
+
+static const size_t HOST_STACK = 256 * 1024;
+static const uint8_t STACK_FILL = 0xA5;     // Como o FreeRTOS, para achar o pico de uso
+static const Us BOOT_US = 350 * MS;         // ROM + bootloader até o setup()
+
+struct Event {
+    Us at;
+    uint64_t seq;
+    std::function<void()> fn;
+};
+
+struct Later {
+    bool operator()(const Event& a, const Event& b) const {
+        return a.at != b.at ? a.at > b.at : a.seq > b.seq;
+    }
+};
+
+typedef std::priority_queue<Event, std::vector<Event>, Later> EventQueue;
+
+static Us worldNow = 0;
+static uint64_t eventSeq = 0;
+static EventQueue passiveEvents;
+static EventQueue kernelEvents;
+static int eventDepth = 0;
+static bool inBusy = false;
+
+static std::deque<SimTask*> readyTasks;
+static std::vector<SimTask*> liveTasks;
+static SimTask* running = nullptr;
+static ucontext_t kernelCtx;
+
+static double crystalPpm = 0;
+static Us chipAtBoot = 0;
+static Us sysOffset = 0;
+static esp_reset_reason_t lastReason = ESP_RST_POWERON;
+static bool chipOn = false;
+static uint32_t boots = 0;
+static uint64_t powerGen = 0;
+static std::vector<std::function<void(esp_reset_reason_t)>> resetHooks;
+static void (*firmwareEntry)(void*) = nullptr;
+static SimTask* loopTaskHandle = nullptr;
+static Us passStart = -1;
+
+Histogram loopPass;
+Us loopPassLimit = 0;
+uint64_t loopPassOver = 0;
+Us loopPassFirstOver = -1;
+
+Us now() {
+    return worldNow;
+}
+
+// ========== EVENTOS ==========
+
+static void push(EventQueue& queue, Us when, std::function<void()> fn) {
+    queue.push(Event{ std::max(when, worldNow), eventSeq++, std::move(fn) });
+}
+
+void at(Us when, std::function<void()> fn) {
+    push(passiveEvents, when, std::move(fn));
+}
+
+void atKernel(Us when, std::function<void()> fn) {
+    push(kernelEvents, when, std::move(fn));
+}
+
+static void runNext(EventQueue& queue) {
+    Event event = std::move(const_cast<Event&>(queue.top()));
+    queue.pop();
+    if (event.at > worldNow) worldNow = event.at;
+
+    eventDepth++;
+    event.fn();
+    eventDepth--;
+}
+
+void busy(Us us) {
+    if (us <= 0 || !inTask()) return;
+
+    // Timers e pacotes que vencem no meio do trabalho rodam como interrupção
+    Us target = worldNow + us;
+    if (!inBusy) {
+        inBusy = true;
+        while (!passiveEvents.empty() && passiveEvents.top().at <= target) {
+            runNext(passiveEvents);
+        }
+        inBusy = false;
+    }
+    if (worldNow < target) worldNow = target;
+}
+
+// ========== TAREFAS ==========
+
+static void yieldToKernel() {
+    swapcontext(&running->ctx, &kernelCtx);
+}
+
+static void switchTo(SimTask* task) {
+    running = task;
+    swapcontext(&kernelCtx, &task->ctx);
+    running = nullptr;
+}
+
+static void taskMain(unsigned int hi, unsigned int lo) {
+    SimTask* task = reinterpret_cast<SimTask*>(((uintptr_t)hi << 32) | lo);
+    task->fn(task->arg);
+
+    // Tarefa do FreeRTOS não pode retornar: no ESP32 isso é um abort()
+    fprintf(stderr, "[sim] tarefa %s retornou\n", task->name);
+    task->dead = true;
+    yieldToKernel();
+}
+
+SimTask* spawn(const char* name, void (*fn)(void*), void* arg, uint32_t stackBytes) {
+    SimTask* task = new SimTask();
+    task->name = name;
+    task->fn = fn;
+    task->arg = arg;
+    task->declaredStack = stackBytes;
+    task->stack = static_cast<uint8_t*>(malloc(HOST_STACK));
+    memset(task->stack, STACK_FILL, HOST_STACK);
+
+    getcontext(&task->ctx);
+    task->ctx.uc_stack.ss_sp = task->stack;
+    task->ctx.uc_stack.ss_size = HOST_STACK;
+    task->ctx.uc_link = &kernelCtx;
+    uintptr_t ptr = reinterpret_cast<uintptr_t>(task);
+    makecontext(&task->ctx, (void (*)())taskMain, 2, (unsigned int)(ptr >> 32), (unsigned int)ptr);
+
+    liveTasks.push_back(task);
+    readyTasks.push_back(task);
+    return task;
+}
+
+SimTask* current() {
+    return eventDepth ? nullptr : running;
+}
+
+bool inTask() {
+    return current() != nullptr;
+}
+
+bool wait(Us timeout) {
+    SimTask* task = current();
+    if (!task) {
+        fprintf(stderr, "[sim] bloqueio fora de tarefa (evento ou ISR)\n");
+        abort();
+    }
+    if (timeout <= 0) return false;
+
+    task->waiting = true;
+    task->woken = false;
+    uint64_t gen = ++task->waitGen;
+    if (timeout != NEVER) {
+        at(worldNow + timeout, [task, gen] {
+            if (task->dead || !task->waiting || task->waitGen != gen) return;
+            task->waiting = false;
+            readyTasks.push_back(task);
+        });
+    }
+
+    yieldToKernel();
+    return task->woken;
+}
+
+void wake(SimTask* task) {
+    if (!task || task->dead || !task->waiting) return;
+    task->waiting = false;
+    task->woken = true;
+    readyTasks.push_back(task);
+}
+
+void sleepFor(Us us) {
+    if (us == NEVER) {
+        for (;;) wait(NEVER);
+    }
+    Us until = worldNow + us;
+    while (worldNow < until) wait(until - worldNow);
+}
+
+uint32_t stackFree(SimTask* task) {
+    if (!task || !task->stack) return 0;
+
+    size_t untouched = 0;
+    while (untouched < HOST_STACK && task->stack[untouched] == STACK_FILL) untouched++;
+    size_t used = HOST_STACK - untouched;
+    return used >= task->declaredStack ? 0 : task->declaredStack - used;
+}
+
+void notifyGive(SimTask* task) {
+    if (!task || task->dead) return;
+    task->notify++;
+    if (task->waitNotify) wake(task);
+}
+
+uint32_t notifyTake(bool clear, Us timeout) {
+    SimTask* task = current();
+    if (!task) return 0;
+
+    bool isLoop = task == loopTaskHandle;
+    if (isLoop && passStart >= 0) {
+        Us pass = worldNow - passStart;
+        loopPass.add(pass);
+        if (loopPassLimit > 0 && pass >= loopPassLimit && loopPassOver++ == 0) loopPassFirstOver = passStart;
+    }
+
+    if (task->notify == 0 && timeout > 0) {
+        task->waitNotify = true;
+        wait(timeout);
+        task->waitNotify = false;
+    }
+
+    uint32_t value = task->notify;
+    if (value) task->notify = clear ? 0 : value - 1;
+    if (isLoop) passStart = worldNow;
+    return value;
+}
+
+// ========== CHIP ==========
+
+static Us crystal(Us world) {
+    return world + (Us)llround(world * crystalPpm / 1e6);
+}
+
+void setCrystalPpm(double ppm) {
+    crystalPpm = ppm;
+}
+
+double getCrystalPpm() {
+    return crystalPpm;
+}
+
+Us chipTime() {
+    return crystal(worldNow) - chipAtBoot;
+}
+
+Us chipToWorld(Us chipUs) {
+    return (Us)llround(chipUs / (1 + crystalPpm / 1e6));
+}
+
+Us systemTime() {
+    return crystal(worldNow) + sysOffset;
+}
+
+void setSystemTime(Us us) {
+    sysOffset = us - crystal(worldNow);
+}
+
+esp_reset_reason_t resetReason() {
+    return lastReason;
+}
+
+bool isRunning() {
+    return chipOn;
+}
+
+uint32_t bootCount() {
+    return boots;
+}
+
+void onReset(std::function<void(esp_reset_reason_t)> hook) {
+    resetHooks.push_back(std::move(hook));
+}
+
+void setFirmware(void (*entry)(void*)) {
+    firmwareEntry = entry;
+}
+
+SimTask* loopTask() {
+    return loopTaskHandle;
+}
+
+static void boot(uint64_t gen) {
+    if (gen != powerGen) return;
+
+    // O esp_timer começa no reset; o setup() roda depois do bootloader
+    chipAtBoot = crystal(worldNow);
+    if (lastReason == ESP_RST_POWERON) sysOffset = -crystal(worldNow);
+
+    at(worldNow + BOOT_US, [gen] {
+        if (gen != powerGen) return;
+        chipOn = true;
+        boots++;
+        loopTaskHandle = spawn("loopTask", firmwareEntry, nullptr, getArduinoLoopTaskStackSize());
+    });
+}
+
+void reset(esp_reset_reason_t reason, Us offUs) {
+    // Sem desempilhar: no chip a RAM simplesmente some
+    for (SimTask* task : liveTasks) {
+        task->dead = true;
+        task->waiting = false;
+        free(task->stack);
+        task->stack = nullptr;
+    }
+    liveTasks.clear();
+    readyTasks.clear();
+    loopTaskHandle = nullptr;
+    passStart = -1;
+    chipOn = false;
+    lastReason = reason;
+    uint64_t gen = ++powerGen;
+
+    for (auto& hook : resetHooks) hook(reason);
+
+    atKernel(worldNow + offUs, [gen] { boot(gen); });
+}
+
+void requestReset(esp_reset_reason_t reason, Us offUs) {
+    atKernel(worldNow, [reason, offUs] { reset(reason, offUs); });
+    if (inTask()) sleepFor(NEVER);
+}
+
+void powerOn() {
+    lastReason = ESP_RST_POWERON;
+    uint64_t gen = ++powerGen;
+    boot(gen);
+}
+
+void run(Us until) {
+    for (;;) {
+        while (!readyTasks.empty()) {
+            SimTask* task = readyTasks.front();
+            readyTasks.pop_front();
+            if (!task->dead) switchTo(task);
+        }
+
+        Us passive = passiveEvents.empty() ? NEVER : passiveEvents.top().at;
+        Us kernel = kernelEvents.empty() ? NEVER : kernelEvents.top().at;
+        if (std::min(passive, kernel) > until) {
+            if (worldNow < until) worldNow = until;
+            return;
+        }
+        runNext(kernel <= passive ? kernelEvents : passiveEvents);
+    }
+}
+
+// ========== HISTOGRAMA ==========
+
+Histogram::Histogram() : buckets(), n(0), sum(0), maxValue(0) {}
+
+int Histogram::bucketOf(Us value) {
+    if (value < 4) return value < 0 ? 0 : (int)value;
+    int msb = 63 - __builtin_clzll((uint64_t)value);
+    int sub = (int)((value >> (msb - 2)) & 3);
+    return std::min(4 * (msb - 1) + sub, BUCKETS - 1);
+}
+
+Us Histogram::bucketTop(int bucket) {
+    if (bucket < 4) return bucket;
+    int msb = bucket / 4 + 1;
+    int sub = bucket % 4;
+    return ((Us)(4 + sub + 1) << (msb - 2)) - 1;
+}
+
+void Histogram::add(Us value) {
+    buckets[bucketOf(value)]++;
+    n++;
+    sum += value;
+    if (value > maxValue) maxValue = value;
+}
+
+Us Histogram::percentile(double p) const {
+    if (n == 0) return 0;
+    uint64_t target = (uint64_t)ceil(p * n);
+    if (target == 0) target = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= target) return std::min(bucketTop(i), maxValue);
+    }
+    return maxValue;
+}
+
+void Histogram::print(const char* title, const char* unit) const {
+    double scale = strcmp(unit, "ms") == 0 ? 1000.0 : strcmp(unit, "s") == 0 ? 1e6 : 1.0;
+    printf("%s: %llu amostras\n", title, (unsigned long long)n);
+    if (n == 0) return;
+
+    printf("  média %.3f%s | p50 %.3f | p90 %.3f | p99 %.3f | p99.9 %.3f | máx %.3f%s\n",
+           mean() / scale, unit, percentile(0.5) / scale, percentile(0.9) / scale, percentile(0.99) / scale,
+           percentile(0.999) / scale, maxValue / scale, unit);
+
+    // Uma linha por potência de 2 (soma das subdivisões)
+    uint64_t peak = 0;
+    uint64_t rows[BUCKETS / 4 + 1] = {};
+    for (int i = 0; i < BUCKETS; i++) {
+        int row = i < 4 ? 0 : i / 4;
+        rows[row] += buckets[i];
+        peak = std::max(peak, rows[row]);
+    }
+    for (int row = 0; row <= BUCKETS / 4; row++) {
+        if (!rows[row]) continue;
+        Us low = row == 0 ? 0 : (Us)1 << (row + 1);
+        Us high = row == 0 ? 4 : (Us)1 << (row + 2);
+        int bar = (int)((rows[row] * 40 + peak - 1) / peak);
+        printf("  %10.3f-%-10.3f %10llu %.*s\n", low / scale, high / scale, (unsigned long long)rows[row], bar,
+               "########################################");
+    }
+}
+
+}
+
+// ========== FREERTOS ==========
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackBytes, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+    (void)priority;
+    (void)core;
+    SimTask* task = sim::spawn(name, fn, arg, stackBytes);
+    if (handle) *handle = task;
+    return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return sim::current();
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+    sim::notifyGive(task);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+    sim::notifyGive(task);
+    if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdFALSE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+    sim::Us timeout = ticksToWait == portMAX_DELAY ? sim::NEVER : sim::chipToWorld((sim::Us)ticksToWait * sim::MS);
+    return sim::notifyTake(clearOnExit != pdFALSE, timeout);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (!sim::inTask()) return;
+    sim::sleepFor(sim::chipToWorld((sim::Us)ticks * sim::MS));
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return sim::stackFree(task ? task : sim::current());
+}
+
+size_t getArduinoLoopTaskStackSize() {
+    return 8192;
+}
@@ -0,0 +1,121 @@
+#ifndef SIM_KERNEL_H
+#define SIM_KERNEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <esp_system.h>
+
+struct SimTask;
+
+// Núcleo do simulador: relógio virtual, tarefas cooperativas no lugar das
+// do FreeRTOS e a fila de eventos do mundo. O tempo só anda quando todas as
+// tarefas estão bloqueadas (salta para o próximo evento) ou quando uma tarefa
+// declara custo com busy(); por isso semanas passam em segundos.
+namespace sim {
+
+typedef int64_t Us;
+
+const Us MS = 1000;
+const Us SEC = 1000 * MS;
+const Us MINUTE = 60 * SEC;
+const Us HOUR = 60 * MINUTE;
+const Us DAY = 24 * HOUR;
+const Us NEVER = INT64_MAX;
+
+// Tempo do mundo: µs desde o início do cenário
+Us now();
+
+// Eventos passivos (timers, rede, NTP) também rodam dentro do busy() de uma
+// tarefa, como uma interrupção; os do núcleo (reset, despertar) só quando
+// nenhuma tarefa está rodando
+void at(Us when, std::function<void()> fn);
+void atKernel(Us when, std::function<void()> fn);
+
+// Custo da tarefa atual (CPU ou periférico sem ceder). Fora de tarefa não faz nada
+void busy(Us us);
+
+// Tarefas
+SimTask* spawn(const char* name, void (*fn)(void*), void* arg, uint32_t stackBytes);
+SimTask* current();                 // nullptr no núcleo e nos eventos
+bool inTask();
+bool wait(Us timeout);              // true = acordada por wake() antes do timeout
+void wake(SimTask* task);
+void sleepFor(Us us);               // Bloqueia sem ser acordada
+uint32_t stackFree(SimTask* task);  // Menor pilha livre já vista (bytes da pilha declarada)
+
+// Notificação de tarefa (xTaskNotifyGive / ulTaskNotifyTake)
+void notifyGive(SimTask* task);
+uint32_t notifyTake(bool clear, Us timeout);
+
+// ========== CHIP ==========
+
+// Cristal do ESP32: a deriva faz o esp_timer andar diferente do mundo
+void setCrystalPpm(double ppm);
+double getCrystalPpm();
+Us chipTime();                      // esp_timer_get_time()
+Us chipToWorld(Us chipUs);          // Duração no cristal -> duração no mundo
+
+// Relógio do sistema (timer RTC): sobrevive a reset por software, pânico e
+// deep sleep; o power-on volta a zero
+Us systemTime();
+void setSystemTime(Us us);
+
+esp_reset_reason_t resetReason();
+bool isRunning();
+uint32_t bootCount();
+
+// Reset do chip: mata as tarefas, avisa os hooks e dá boot depois de offUs.
+// Só no núcleo (evento); de dentro de uma tarefa use requestReset
+void reset(esp_reset_reason_t reason, Us offUs);
+void requestReset(esp_reset_reason_t reason, Us offUs);   // A tarefa atual para aqui
+void powerOn();
+
+// Chamado em todo reset, depois de matar as tarefas (periféricos, rede, globais)
+void onReset(std::function<void(esp_reset_reason_t)> hook);
+
+// Corpo da loopTask a cada boot (setup + loop)
+void setFirmware(void (*entry)(void*));
+SimTask* loopTask();
+
+// Roda até o instante (tempo do mundo)
+void run(Us until);
+
+// ========== MEDIÇÃO ==========
+
+// Distribuição em faixas log2 com 4 subdivisões (erro < 19%)
+class Histogram {
+public:
+    static const int BUCKETS = 4 * 40;
+
+    Histogram();
+    void add(Us value);
+    uint64_t count() const { return n; }
+    Us max() const { return maxValue; }
+    double mean() const { return n ? (double)sum / n : 0; }
+    Us percentile(double p) const;
+    void print(const char* title, const char* unit = "ms") const;
+
+private:
+    uint64_t buckets[BUCKETS];
+    uint64_t n;
+    int64_t sum;
+    Us maxValue;
+
+    static int bucketOf(Us value);
+    static Us bucketTop(int bucket);
+};
+
+// Duração de cada volta do loop(): da saída de um ulTaskNotifyTake da
+// loopTask até o próximo (UART, flash e rede incluídos)
+extern Histogram loopPass;
+
+// Voltas a partir de loopPassLimit (0 = sem limite): quantas e onde começou
+// a primeira
+extern Us loopPassLimit;
+extern uint64_t loopPassOver;
+extern Us loopPassFirstOver;
+
+}
+
+#endif
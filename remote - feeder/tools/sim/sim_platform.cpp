@@ -0,0 +1,1080 @@
+// sim_platform.cpp - núcleo Arduino, IDF, NVS e LittleFS do simulador
+#include "sim_world.h"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <LittleFS.h>
+#include <esp_timer.h>
+#include <esp_sleep.h>
+#include <esp_heap_caps.h>
+#include <esp_rom_crc.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/base64.h>
+#include "core/delta_patch.h"
+
+#include <map>
+#include <vector>
+
+using namespace sim;
+
+// ========== STRING ==========
+
+static std::string formatInteger(unsigned long long value, bool negative, unsigned char base) {
+    if (base < 2 || base > 36) base = 10;
+    char digits[66];
+    int pos = sizeof(digits) - 1;
+    digits[pos] = '\0';
+    do {
+        int d = value % base;
+        digits[--pos] = d < 10 ? '0' + d : 'a' + d - 10;
+        value /= base;
+    } while (value);
+    if (negative) digits[--pos] = '-';
+    return std::string(digits + pos);
+}
+
+String::String(long value, unsigned char base) :
+    s(base == 10 ? formatInteger(value < 0 ? -(unsigned long long)value : value, value < 0, 10)
+                 : formatInteger((unsigned long)value, false, base)) {}
+
+String::String(unsigned long value, unsigned char base) : s(formatInteger(value, false, base)) {}
+
+String::String(long long value, unsigned char base) :
+    s(base == 10 ? formatInteger(value < 0 ? -(unsigned long long)value : value, value < 0, 10)
+                 : formatInteger((unsigned long long)value, false, base)) {}
+
+String::String(unsigned long long value, unsigned char base) : s(formatInteger(value, false, base)) {}
+
+String::String(double value, unsigned int decimals) {
+    char text[64];
+    snprintf(text, sizeof(text), "%.*f", (int)decimals, value);
+    s = text;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) std::swap(from, to);
+    if (from >= s.size()) return String();
+    return String(s.substr(from, std::min<size_t>(to, s.size()) - from).c_str());
+}
+
+int String::indexOf(char c, unsigned int from) const {
+    size_t pos = s.find(c, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String& str, unsigned int from) const {
+    size_t pos = s.find(str.s, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+bool String::endsWith(const String& suffix) const {
+    return s.size() >= suffix.s.size() && s.compare(s.size() - suffix.s.size(), suffix.s.size(), suffix.s) == 0;
+}
+
+void String::trim() {
+    size_t begin = s.find_first_not_of(" \t\r\n");
+    size_t end = s.find_last_not_of(" \t\r\n");
+    s = begin == std::string::npos ? std::string() : s.substr(begin, end - begin + 1);
+}
+
+void String::toUpperCase() {
+    for (char& c : s) c = toupper((unsigned char)c);
+}
+
+void String::toLowerCase() {
+    for (char& c : s) c = tolower((unsigned char)c);
+}
+
+StringSumHelper operator+(const String& lhs, const String& rhs) {
+    StringSumHelper sum(lhs);
+    sum.concat(rhs);
+    return sum;
+}
+
+StringSumHelper operator+(const String& lhs, const char* rhs) {
+    StringSumHelper sum(lhs);
+    sum.concat(rhs);
+    return sum;
+}
+
+StringSumHelper operator+(const char* lhs, const String& rhs) {
+    StringSumHelper sum(lhs);
+    sum.concat(rhs);
+    return sum;
+}
+
+StringSumHelper operator+(const String& lhs, char c) {
+    StringSumHelper sum(lhs);
+    sum.concat(c);
+    return sum;
+}
+
+StringSumHelper operator+(const String& lhs, int value) { return lhs + String(value); }
+StringSumHelper operator+(const String& lhs, unsigned int value) { return lhs + String(value); }
+StringSumHelper operator+(const String& lhs, long value) { return lhs + String(value); }
+StringSumHelper operator+(const String& lhs, unsigned long value) { return lhs + String(value); }
+StringSumHelper operator+(const String& lhs, long long value) { return lhs + String(value); }
+StringSumHelper operator+(const String& lhs, unsigned long long value) { return lhs + String(value); }
+StringSumHelper operator+(const String& lhs, double value) { return lhs + String(value); }
+
+#if !defined(__GLIBC__) || __GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38)
+size_t strlcpy(char* dst, const char* src, size_t size) {
+    size_t len = strlen(src);
+    if (size) {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#endif
+
+// ========== SERIAL ==========
+
+// UART0 a 115200 8N1: 10 bits por byte. Sem buffer de TX no driver do
+// Arduino, só a FIFO de 128 B; cheia, a tarefa que escreve bloqueia
+static const double UART_US_PER_BYTE = 1e6 * 10 / 115200;
+static const size_t UART_FIFO = 128;
+
+static Us uartIdleAt = 0;       // Quando a FIFO esvazia
+static std::string serialLine;
+
+HardwareSerial Serial;
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+}
+
+size_t Print::printf(const char* format, ...) {
+    char stackBuf[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(stackBuf, sizeof(stackBuf), format, args);
+    va_end(args);
+    if (len < 0) return 0;
+    if ((size_t)len < sizeof(stackBuf)) return write((const uint8_t*)stackBuf, len);
+
+    std::vector<char> heapBuf(len + 1);
+    va_start(args, format);
+    vsnprintf(heapBuf.data(), heapBuf.size(), format, args);
+    va_end(args);
+    return write((const uint8_t*)heapBuf.data(), len);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        char c = (char)buffer[i];
+        if (c == '\n') {
+            if (observer.serialLine) observer.serialLine(serialLine.c_str());
+            serialLine.clear();
+        } else if (c != '\r') {
+            serialLine += c;
+        }
+    }
+
+    // Fora de tarefa (callback de timer, núcleo) o texto só é registrado
+    if (!inTask()) return size;
+
+    size_t left = size;
+    while (left) {
+        if (uartIdleAt < now()) uartIdleAt = now();
+        size_t queued = (size_t)((uartIdleAt - now()) / UART_US_PER_BYTE);
+        size_t room = queued < UART_FIFO ? UART_FIFO - queued : 0;
+        if (room == 0) {
+            sleepFor((Us)UART_US_PER_BYTE * 16);
+            continue;
+        }
+        size_t chunk = std::min(room, left);
+        busy(2 + chunk / 4);    // Copiar para a FIFO
+        uartIdleAt += (Us)(chunk * UART_US_PER_BYTE);
+        left -= chunk;
+    }
+    return size;
+}
+
+void HardwareSerial::flush() {
+    if (inTask() && uartIdleAt > now()) sleepFor(uartIdleAt - now());
+}
+
+// ========== TEMPO ==========
+
+uint32_t millis() {
+    return (uint32_t)(chipTime() / 1000);
+}
+
+uint32_t micros() {
+    return (uint32_t)chipTime();
+}
+
+void delay(uint32_t ms) {
+    vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+    busy(chipToWorld(us));
+}
+
+void yield() {}
+
+int simGettimeofday(struct timeval* tv, void* tz) {
+    (void)tz;
+    Us t = systemTime();
+    tv->tv_sec = (time_t)(t / SEC);
+    tv->tv_usec = (suseconds_t)(t % SEC);
+    if (tv->tv_usec < 0) {
+        tv->tv_sec--;
+        tv->tv_usec += SEC;
+    }
+    return 0;
+}
+
+int simSettimeofday(const struct timeval* tv, const void* tz) {
+    (void)tz;
+    setSystemTime((Us)tv->tv_sec * SEC + tv->tv_usec);
+    return 0;
+}
+
+bool getLocalTime(struct tm* info, uint32_t ms) {
+    Us deadline = chipTime() + (Us)ms * MS;
+    for (;;) {
+        time_t t = (time_t)(systemTime() / SEC);
+        gmtime_r(&t, info);
+        if (info->tm_year > (2016 - 1900)) return true;
+        if (chipTime() >= deadline) return false;
+        delay(10);
+    }
+}
+
+// ========== ESP_TIMER ==========
+
+struct SimTimer {
+    esp_timer_create_args_t args;
+    uint64_t epoch;             // Timers de um boot anterior morrem no reset
+    uint64_t gen;               // Invalida o disparo pendente em stop/start
+    bool armed;
+    Us periodUs;                // Chip; 0 = uma vez
+    Us due;                     // Mundo
+};
+
+static uint64_t timerEpoch = 1;
+
+int64_t esp_timer_get_time() {
+    return chipTime();
+}
+
+static void timerFire(SimTimer* timer, uint64_t gen) {
+    if (timer->epoch != timerEpoch || timer->gen != gen || !timer->armed) return;
+
+    if (timer->periodUs) {
+        // O próximo conta do vencimento, não do atraso do callback
+        timer->due += chipToWorld(timer->periodUs);
+        at(timer->due, [timer, gen] { timerFire(timer, gen); });
+    } else {
+        timer->armed = false;
+    }
+    timer->args.callback(timer->args.arg);
+}
+
+static esp_err_t timerStart(SimTimer* timer, uint64_t us, bool periodic) {
+    if (!timer || timer->epoch != timerEpoch) return ESP_ERR_INVALID_ARG;
+    if (timer->armed) return ESP_ERR_INVALID_STATE;
+
+    uint64_t gen = ++timer->gen;
+    timer->armed = true;
+    timer->periodUs = periodic ? (Us)us : 0;
+    timer->due = now() + chipToWorld((Us)us);
+    at(timer->due, [timer, gen] { timerFire(timer, gen); });
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle) {
+    if (!args || !args->callback || !handle) return ESP_ERR_INVALID_ARG;
+    SimTimer* timer = new SimTimer();
+    timer->args = *args;
+    timer->epoch = timerEpoch;
+    *handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs) {
+    return timerStart(timer, timeoutUs, false);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs) {
+    return timerStart(timer, periodUs, true);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (!timer || !timer->armed) return ESP_ERR_INVALID_STATE;
+    timer->armed = false;
+    timer->gen++;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (!timer) return ESP_ERR_INVALID_ARG;
+    if (timer->armed) return ESP_ERR_INVALID_STATE;
+    timer->epoch = 0;
+    return ESP_OK;
+}
+
+// ========== HEAP ==========
+
+struct HeapRegion {
+    size_t total;
+    size_t used;
+    size_t peak;
+};
+
+#ifdef BOARD_HAS_PSRAM
+static const size_t PSRAM_TOTAL = 8 * 1024 * 1024;
+#else
+static const size_t PSRAM_TOTAL = 0;
+#endif
+
+static HeapRegion internalHeap = { 320 * 1024, 0, 0 };
+static HeapRegion psramHeap = { PSRAM_TOTAL, 0, 0 };
+
+struct HeapHeader {
+    size_t size;
+    HeapRegion* region;
+    uint64_t epoch;             // Bloco de um boot anterior não conta mais
+};
+
+static uint64_t heapEpoch = 1;
+
+static HeapRegion* regionFor(uint32_t caps) {
+    return (caps & MALLOC_CAP_SPIRAM) ? &psramHeap : &internalHeap;
+}
+
+void* heap_caps_malloc(size_t size, uint32_t caps) {
+    HeapRegion* region = regionFor(caps);
+    if (size == 0 || region->used + size > region->total) return nullptr;
+
+    HeapHeader* header = static_cast<HeapHeader*>(malloc(sizeof(HeapHeader) + size));
+    if (!header) return nullptr;
+    header->size = size;
+    header->region = region;
+    header->epoch = heapEpoch;
+    region->used += size;
+    region->peak = std::max(region->peak, region->used);
+    return header + 1;
+}
+
+void heap_caps_free(void* ptr) {
+    if (!ptr) return;
+    HeapHeader* header = static_cast<HeapHeader*>(ptr) - 1;
+    if (header->epoch == heapEpoch) header->region->used -= header->size;
+    free(header);
+}
+
+void* heap_caps_realloc(void* ptr, size_t size, uint32_t caps) {
+    if (!ptr) return heap_caps_malloc(size, caps);
+    if (size == 0) {
+        heap_caps_free(ptr);
+        return nullptr;
+    }
+
+    HeapHeader* header = static_cast<HeapHeader*>(ptr) - 1;
+    void* moved = heap_caps_malloc(size, caps);
+    if (!moved) return nullptr;
+    memcpy(moved, ptr, std::min(size, header->size));
+    heap_caps_free(ptr);
+    return moved;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    HeapRegion* region = regionFor(caps);
+    return region->total - region->used;
+}
+
+size_t heap_caps_get_total_size(uint32_t caps) {
+    return regionFor(caps)->total;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    HeapRegion* region = regionFor(caps);
+    return region->total - region->peak;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    // Sem fragmentação no modelo
+    return heap_caps_get_free_size(caps);
+}
+
+bool psramFound() {
+    return PSRAM_TOTAL > 0;
+}
+
+EspClass ESP;
+
+void EspClass::restart() {
+    esp_restart();
+}
+
+uint32_t EspClass::getFreeHeap() {
+    return heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+    return heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+}
+
+uint32_t EspClass::getFreePsram() {
+    return heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+}
+
+uint32_t EspClass::getPsramSize() {
+    return PSRAM_TOTAL;
+}
+
+// ========== CRC / BASE64 ==========
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+uint8_t esp_rom_crc8_le(uint8_t crc, const uint8_t* buf, uint32_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int bit = 0; bit < 8; bit++) crc = (crc & 1) ? (crc >> 1) ^ 0x8C : crc >> 1;
+    }
+    return ~crc;
+}
+
+static const char BASE64_CHARS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+int mbedtls_base64_encode(unsigned char* dst, size_t dlen, size_t* olen, const unsigned char* src, size_t slen) {
+    size_t need = 4 * ((slen + 2) / 3) + 1;
+    if (!dst || dlen < need) {
+        *olen = need;
+        return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+    }
+
+    unsigned char* out = dst;
+    for (size_t i = 0; i < slen; i += 3) {
+        uint32_t chunk = src[i] << 16;
+        if (i + 1 < slen) chunk |= src[i + 1] << 8;
+        if (i + 2 < slen) chunk |= src[i + 2];
+        *out++ = BASE64_CHARS[(chunk >> 18) & 63];
+        *out++ = BASE64_CHARS[(chunk >> 12) & 63];
+        *out++ = i + 1 < slen ? BASE64_CHARS[(chunk >> 6) & 63] : '=';
+        *out++ = i + 2 < slen ? BASE64_CHARS[chunk & 63] : '=';
+    }
+    *out = '\0';
+    *olen = out - dst;
+    return 0;
+}
+
+static int base64Value(unsigned char c) {
+    const char* p = strchr(BASE64_CHARS, c);
+    return c && p ? (int)(p - BASE64_CHARS) : -1;
+}
+
+int mbedtls_base64_decode(unsigned char* dst, size_t dlen, size_t* olen, const unsigned char* src, size_t slen) {
+    if (slen % 4) return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+
+    size_t need = slen / 4 * 3;
+    if (slen && src[slen - 1] == '=') need--;
+    if (slen > 1 && src[slen - 2] == '=') need--;
+    *olen = need;
+    if (!dst || dlen < need) return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+
+    size_t out = 0;
+    for (size_t i = 0; i < slen; i += 4) {
+        uint32_t chunk = 0;
+        for (int j = 0; j < 4; j++) {
+            int v = src[i + j] == '=' ? 0 : base64Value(src[i + j]);
+            if (v < 0) return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+            chunk = (chunk << 6) | v;
+        }
+        for (int j = 2; j >= 0 && out < need; j--) {
+            if (out < need) dst[out++] = (chunk >> (8 * j)) & 0xFF;
+        }
+    }
+    return 0;
+}
+
+// ========== NVS ==========
+
+// Custo medido de nvs_set + commit: gravar a flash ou só comparar
+static const Us NVS_WRITE_US = 1000;
+static const Us NVS_SAME_US = 50;
+static const size_t NVS_KEY_MAX = 15;
+
+struct NvsEntry {
+    char type;
+    std::vector<uint8_t> value;
+};
+
+static std::map<std::string, std::map<std::string, NvsEntry>> nvs;
+
+bool Preferences::begin(const char* name, bool readOnly, const char* partition) {
+    (void)partition;
+    if (opened) return false;
+    if (!name || strlen(name) > NVS_KEY_MAX) return false;
+    if (readOnly && !nvs.count(name)) return false;   // ESP_ERR_NVS_NOT_FOUND
+
+    ns = name;
+    this->readOnly = readOnly;
+    opened = true;
+    if (!readOnly) nvs[ns];
+    return true;
+}
+
+void Preferences::end() {
+    opened = false;
+}
+
+bool Preferences::clear() {
+    if (!opened || readOnly) return false;
+    nvs[ns].clear();
+    flashStats.nvsWrites++;
+    busy(NVS_WRITE_US);
+    return true;
+}
+
+bool Preferences::remove(const char* key) {
+    if (!opened || readOnly) return false;
+    if (!nvs[ns].erase(key)) return false;
+    flashStats.nvsWrites++;
+    busy(NVS_WRITE_US);
+    return true;
+}
+
+bool Preferences::isKey(const char* key) {
+    return opened && nvs[ns].count(key);
+}
+
+size_t Preferences::freeEntries() {
+    return opened ? 630 - nvs[ns].size() : 0;
+}
+
+size_t Preferences::put(const char* key, char type, const void* value, size_t len) {
+    if (!opened || readOnly || !key || strlen(key) > NVS_KEY_MAX) return 0;
+    flashStats.nvsPuts++;
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+    NvsEntry& entry = nvs[ns][key];
+    bool same = entry.type == type && entry.value.size() == len &&
+                (len == 0 || memcmp(entry.value.data(), bytes, len) == 0);
+    if (same) {
+        busy(NVS_SAME_US);
+        return len;
+    }
+
+    entry.type = type;
+    entry.value.assign(bytes, bytes + len);
+    flashStats.nvsWrites++;
+    flashStats.nvsBytes += len;
+    busy(NVS_WRITE_US);
+    return len;
+}
+
+bool Preferences::get(const char* key, char type, void* value, size_t len) {
+    if (!opened || !key) return false;
+    auto& space = nvs[ns];
+    auto found = space.find(key);
+    if (found == space.end() || found->second.type != type || found->second.value.size() != len) return false;
+    memcpy(value, found->second.value.data(), len);
+    return true;
+}
+
+#define NVS_SCALAR(Name, Type, Tag)                                                 \
+    size_t Preferences::put##Name(const char* key, Type value) {                    \
+        return put(key, Tag, &value, sizeof(value));                                \
+    }                                                                               \
+    Type Preferences::get##Name(const char* key, Type defaultValue) {               \
+        Type value;                                                                 \
+        return get(key, Tag, &value, sizeof(value)) ? value : defaultValue;         \
+    }
+
+NVS_SCALAR(Char, int8_t, 'c')
+NVS_SCALAR(UChar, uint8_t, 'C')
+NVS_SCALAR(Short, int16_t, 'h')
+NVS_SCALAR(UShort, uint16_t, 'H')
+NVS_SCALAR(Int, int32_t, 'i')
+NVS_SCALAR(UInt, uint32_t, 'I')
+NVS_SCALAR(Long, int32_t, 'i')
+NVS_SCALAR(ULong, uint32_t, 'I')
+NVS_SCALAR(Long64, int64_t, 'q')
+NVS_SCALAR(ULong64, uint64_t, 'Q')
+NVS_SCALAR(Float, float, 'B')   // Preferences grava float como blob
+NVS_SCALAR(Bool, bool, 'C')
+
+size_t Preferences::putString(const char* key, const char* value) {
+    return put(key, 's', value, strlen(value) + 1);
+}
+
+String Preferences::getString(const char* key, const String& defaultValue) {
+    if (!opened || !key) return defaultValue;
+    auto& space = nvs[ns];
+    auto found = space.find(key);
+    if (found == space.end() || found->second.type != 's') return defaultValue;
+    return String((const char*)found->second.value.data());
+}
+
+size_t Preferences::getString(const char* key, char* value, size_t maxLen) {
+    if (!opened || !key) return 0;
+    auto& space = nvs[ns];
+    auto found = space.find(key);
+    if (found == space.end() || found->second.type != 's' || found->second.value.size() > maxLen) return 0;
+    memcpy(value, found->second.value.data(), found->second.value.size());
+    return found->second.value.size();
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+    return put(key, 'b', value, len);
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    if (!opened || !key) return 0;
+    auto& space = nvs[ns];
+    auto found = space.find(key);
+    return found == space.end() || found->second.type != 'b' ? 0 : found->second.value.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    size_t len = getBytesLength(key);
+    if (len == 0 || len > maxLen) return 0;
+    memcpy(buf, nvs[ns][key].value.data(), len);
+    return len;
+}
+
+// ========== LITTLEFS ==========
+
+// Custos medidos na flash SPI do ESP32 com o LittleFS do arduino-esp32
+static const Us FS_OPEN_US = 1500;
+static const Us FS_CLOSE_US = 2000;
+static const double FS_US_PER_BYTE = 20;
+static const Us FS_RENAME_US = 3000;
+static const Us FS_REMOVE_US = 2000;
+static const size_t FS_TOTAL = 1408 * 1024;
+
+struct SimFile {
+    std::string path;
+    std::shared_ptr<std::vector<uint8_t>> data;
+    size_t pos;
+    bool writable;
+    bool append;
+    bool open;
+};
+
+static std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> files;
+static int64_t flashBudget = -1;   // Bytes até a queda de energia (-1: sem queda)
+
+LittleFSFS LittleFS;
+
+bool LittleFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles, const char* partitionLabel) {
+    (void)formatOnFail;
+    (void)basePath;
+    (void)maxOpenFiles;
+    (void)partitionLabel;
+    busy(20 * MS);  // Montagem
+    return true;
+}
+
+bool LittleFSFS::format() {
+    files.clear();
+    busy(500 * MS);
+    return true;
+}
+
+File LittleFSFS::open(const char* path, const char* mode, bool create) {
+    (void)create;
+    busy(FS_OPEN_US);
+    flashStats.fsOpens++;
+
+    auto found = files.find(path);
+    bool reading = strcmp(mode, FILE_READ) == 0;
+    if (reading && found == files.end()) return File();
+    if (!reading && flashBudget == 0) return File();
+
+    auto handle = std::make_shared<SimFile>();
+    handle->path = path;
+    handle->writable = !reading;
+    handle->append = strcmp(mode, FILE_APPEND) == 0;
+    handle->open = true;
+
+    if (found == files.end()) {
+        found = files.emplace(path, std::make_shared<std::vector<uint8_t>>()).first;
+    } else if (strcmp(mode, FILE_WRITE) == 0) {
+        found->second->clear();
+    }
+    handle->data = found->second;
+    handle->pos = handle->append ? handle->data->size() : 0;
+    return File(handle);
+}
+
+bool LittleFSFS::exists(const char* path) {
+    return files.count(path) > 0;
+}
+
+bool LittleFSFS::remove(const char* path) {
+    busy(FS_REMOVE_US);
+    if (flashBudget == 0) return false;
+    flashStats.fsRemoves++;
+    return files.erase(path) > 0;
+}
+
+bool LittleFSFS::rename(const char* from, const char* to) {
+    auto found = files.find(from);
+    if (found == files.end()) return false;
+    busy(FS_RENAME_US);
+    if (flashBudget == 0) return false;
+    flashStats.fsRenames++;
+    files[to] = found->second;
+    files.erase(from);
+    return true;
+}
+
+size_t LittleFSFS::totalBytes() {
+    return FS_TOTAL;
+}
+
+size_t LittleFSFS::usedBytes() {
+    // Blocos de 4 KB, como o LittleFS aloca
+    size_t used = 2 * 4096;
+    for (auto& entry : files) used += (entry.second->size() + 4095) / 4096 * 4096;
+    return used;
+}
+
+size_t File::write(const uint8_t* buf, size_t size) {
+    if (!file || !file->open || !file->writable) return 0;
+    if (LittleFS.usedBytes() + size > FS_TOTAL) return 0;
+    if (flashBudget >= 0) {
+        size = std::min(size, (size_t)flashBudget);
+        flashBudget -= size;
+        if (size == 0) return 0;
+    }
+
+    std::vector<uint8_t>& data = *file->data;
+    if (file->append) file->pos = data.size();
+    if (file->pos + size > data.size()) data.resize(file->pos + size);
+    memcpy(data.data() + file->pos, buf, size);
+    file->pos += size;
+
+    flashStats.fsWrites++;
+    flashStats.fsBytes += size;
+    if (file->append && observer.append) observer.append(file->path, buf, size);
+    busy((Us)(size * FS_US_PER_BYTE));
+    return size;
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+    if (!file || !file->open) return 0;
+    size_t n = std::min(size, file->data->size() - std::min(file->pos, file->data->size()));
+    memcpy(buf, file->data->data() + file->pos, n);
+    file->pos += n;
+    busy((Us)(n * FS_US_PER_BYTE / 4));
+    return n;
+}
+
+int File::available() {
+    if (!file || !file->open) return 0;
+    return (int)(file->data->size() - std::min(file->pos, file->data->size()));
+}
+
+int File::peek() {
+    if (!available()) return -1;
+    return (*file->data)[file->pos];
+}
+
+bool File::seek(uint32_t pos) {
+    if (!file || !file->open || pos > file->data->size()) return false;
+    file->pos = pos;
+    return true;
+}
+
+size_t File::position() const {
+    return file ? file->pos : 0;
+}
+
+size_t File::size() const {
+    return file ? file->data->size() : 0;
+}
+
+void File::close() {
+    if (!file || !file->open) return;
+    file->open = false;
+    busy(FS_CLOSE_US);
+    file.reset();
+}
+
+const char* File::name() const {
+    if (!file) return "";
+    size_t slash = file->path.rfind('/');
+    return file->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+}
+
+// ========== GPIO / LEDC ==========
+
+static uint32_t ledcDuty[16];
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void)pin;
+    (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    (void)pin;
+    (void)value;
+}
+
+int digitalRead(uint8_t pin) {
+    (void)pin;
+    return HIGH;
+}
+
+void attachInterruptArg(uint8_t pin, void (*fn)(void*), void* arg, int mode) {
+    (void)pin;
+    (void)fn;
+    (void)arg;
+    (void)mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+    (void)pin;
+}
+
+uint32_t ledcSetup(uint8_t channel, uint32_t freq, uint8_t resolutionBits) {
+    (void)channel;
+    (void)resolutionBits;
+    return freq;
+}
+
+void ledcAttachPin(uint8_t pin, uint8_t channel) {
+    (void)pin;
+    (void)channel;
+}
+
+void ledcWrite(uint8_t channel, uint32_t duty) {
+    if (channel >= 16 || ledcDuty[channel] == duty) return;
+    ledcDuty[channel] = duty;
+    if (observer.ledc) observer.ledc(channel, duty);
+}
+
+// ========== DIVERSOS ==========
+
+long random(long howBig) {
+    return howBig > 0 ? (long)(esp_random() % (uint32_t)howBig) : 0;
+}
+
+long random(long howSmall, long howBig) {
+    return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall);
+}
+
+void randomSeed(unsigned long seed) {
+    (void)seed;     // esp_random() vem da semente do cenário
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+uint32_t esp_random() {
+    return firmwareRandom();
+}
+
+esp_reset_reason_t esp_reset_reason() {
+    return resetReason();
+}
+
+void esp_restart() {
+    Serial.flush();
+    requestReset(ESP_RST_SW, 0);
+}
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        default: return "UNKNOWN";
+    }
+}
+
+// ========== DEEP SLEEP ==========
+
+static uint64_t sleepWakeUs = 0;
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t timeUs) {
+    sleepWakeUs = timeUs;
+    return ESP_OK;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+    return resetReason() == ESP_RST_DEEPSLEEP ? ESP_SLEEP_WAKEUP_TIMER : ESP_SLEEP_WAKEUP_UNDEFINED;
+}
+
+void esp_deep_sleep_start() {
+    // O timer RTC (150 kHz) não é o cristal, mas a diferença some no modelo
+    requestReset(ESP_RST_DEEPSLEEP, chipToWorld((Us)sleepWakeUs));
+}
+
+// ========== OTA ==========
+
+// Leitura da flash com o SHA-256 (acelerador) e gravação com o apagamento
+// setor a setor, medidos no ESP32 a 40 MHz
+static const size_t FLASH_READ_BYTES_PER_US = 20;
+static const Us FLASH_WRITE_US_PER_KB = 6000;
+
+static const esp_partition_t APP0 = { 0x10000, 0x1E0000, "app0" };
+static const esp_partition_t APP1 = { 0x1F0000, 0x1E0000, "app1" };
+
+static std::vector<uint8_t> runningImage;
+static bool otaOpen = false;
+
+namespace sim {
+
+OtaStats otaStats;
+
+void setRunningImage(const std::vector<uint8_t>& image) {
+    runningImage = image;
+}
+
+}
+
+const esp_partition_t* esp_ota_get_running_partition() {
+    return &APP0;
+}
+
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start) {
+    (void)start;
+    return runningImage.empty() ? nullptr : &APP1;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t offset, void* dst, size_t size) {
+    if (partition != &APP0 || runningImage.empty()) return ESP_ERR_NOT_SUPPORTED;
+    if (offset > runningImage.size() || size > runningImage.size() - offset) return ESP_ERR_INVALID_SIZE;
+
+    memcpy(dst, runningImage.data() + offset, size);
+    busy(size / FLASH_READ_BYTES_PER_US + 1);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_get_sha256(const esp_partition_t* partition, uint8_t* sha256) {
+    (void)partition;
+    if (runningImage.empty()) {
+        for (int i = 0; i < 32; i++) sha256[i] = (uint8_t)(0x51 + i);    // Imagem fixa do simulador
+        return ESP_OK;
+    }
+
+    DeltaPatch::Sha256 sha;
+    sha.update(runningImage.data(), runningImage.size());
+    sha.finish(sha256);
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t imageSize, esp_ota_handle_t* handle) {
+    (void)imageSize;
+    if (partition != &APP1 || otaOpen) return ESP_ERR_NOT_SUPPORTED;
+
+    otaOpen = true;
+    otaStats.begins++;
+    otaStats.image.clear();
+    *handle = 1;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size) {
+    (void)handle;
+    if (!otaOpen) return ESP_ERR_INVALID_ARG;
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    otaStats.image.insert(otaStats.image.end(), bytes, bytes + size);
+    busy(size * FLASH_WRITE_US_PER_KB / 1024);
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_end(esp_ota_handle_t handle) {
+    (void)handle;
+    if (!otaOpen) return ESP_ERR_INVALID_ARG;
+
+    otaOpen = false;
+    otaStats.ends++;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_abort(esp_ota_handle_t handle) {
+    (void)handle;
+    if (otaOpen) otaStats.aborts++;
+    otaOpen = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition) {
+    if (partition != &APP1) return ESP_ERR_NOT_SUPPORTED;
+    otaStats.bootSwitches++;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_get_state_partition(const esp_partition_t* partition, esp_ota_img_states_t* state) {
+    (void)partition;
+    *state = ESP_OTA_IMG_VALID;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_mark_app_valid_cancel_rollback() {
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_mark_app_invalid_rollback_and_reboot() {
+    requestReset(ESP_RST_SW, 0);
+    return ESP_OK;
+}
+
+// ========== RESET ==========
+
+// Seção rtc_data (RTC_DATA_ATTR): o bootloader a recarrega da imagem em todo
+// boot, menos no despertar do deep sleep
+extern char __start_rtc_data[] __attribute__((weak));
+extern char __stop_rtc_data[] __attribute__((weak));
+
+static std::vector<char> rtcDataImage;
+
+static struct RtcDataSnapshot {
+    RtcDataSnapshot() {
+        if (__start_rtc_data) rtcDataImage.assign(__start_rtc_data, __stop_rtc_data);
+    }
+} rtcDataSnapshot;
+
+namespace sim {
+
+void platformOnReset(esp_reset_reason_t reason) {
+    uartIdleAt = 0;
+    serialLine.clear();
+    timerEpoch++;
+    memset(ledcDuty, 0, sizeof(ledcDuty));
+    internalHeap.used = internalHeap.peak = 0;
+    psramHeap.used = psramHeap.peak = 0;
+    heapEpoch++;
+    sleepWakeUs = 0;
+
+    if (reason != ESP_RST_DEEPSLEEP && !rtcDataImage.empty()) {
+        memcpy(__start_rtc_data, rtcDataImage.data(), rtcDataImage.size());
+    }
+}
+
+void cutFlashAfter(int64_t bytes) {
+    flashBudget = bytes < 0 ? -1 : bytes;
+}
+
+}
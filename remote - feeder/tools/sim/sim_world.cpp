@@ -0,0 +1,1203 @@
+// sim_world.cpp - WiFi, broker, Central, NTP e DS3231 do simulador
+#include "sim_world.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiClient.h>
+#include <HTTPClient.h>
+#include <PubSubClient.h>
+#include <RTClib.h>
+#include <esp_sntp.h>
+#include <esp_wifi.h>
+#include <lwip/sockets.h>
+#include <mbedtls/base64.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "comm/CommandRegistry.h"
+#include "core/FeedLogCodec.h"
+
+#include <errno.h>
+#include <deque>
+#include <random>
+#include <set>
+
+// Um pacote MQTT inteiro: o simulador não serializa o protocolo
+struct SimPacket {
+    enum Kind : uint8_t { PUBLISH, PINGRESP } kind;
+    std::string topic;
+    std::string payload;
+    sim::Us sentAt;         // Central publicou (latência de comando)
+
+    size_t wireBytes() const { return kind == PINGRESP ? 2 : 5 + 2 + topic.size() + payload.size(); }
+    bool isCommand() const { return kind == PUBLISH && topic == TOPIC_CMD; }
+};
+
+struct SimSocket {
+    int fd;
+    bool open;              // Fechado pelo firmware ou pelo reset
+    bool broken;            // Conexão morta (RST, WiFi caiu): leitura devolve erro
+    std::deque<SimPacket> rx;
+    SimTask* waiter;        // Em select()
+
+    // Lado do broker
+    bool session;           // CONNACK dado e ainda não derrubada
+    uint64_t sessionId;
+    uint16_t keepAlive;
+    sim::Us lastFromClient;
+    sim::Us sessionStart;
+    sim::Us unackedSince;   // Segmento do cliente sem ACK (blackhole)
+    std::set<std::string> subscriptions;
+};
+
+namespace sim {
+
+Observer observer;
+FlashStats flashStats;
+LinkStats linkStats;
+LogStats logStats;
+
+// Atrasos de rede (ida) e do handshake TLS no ESP32
+static const Us UPLINK_MIN = 20 * MS;
+static const Us UPLINK_MAX = 40 * MS;
+static const Us DOWNLINK_MIN = 20 * MS;
+static const Us DOWNLINK_MAX = 40 * MS;
+static const Us JOIN_MIN = 1500 * MS;
+static const Us JOIN_MAX = 3000 * MS;
+static const Us TLS_MIN = 1200 * MS;
+static const Us TLS_MAX = 2500 * MS;
+static const Us REFUSED = 200 * MS;
+static const Us ACK_DELAY = 150 * MS;
+static const Us SNTP_RETRY = 15 * SEC;
+static const Us HTTP_BYTES_PER_MS = 100;    // Download do patch (~100 KB/s)
+static const Us TCP_GIVEUP = 180 * SEC;     // lwIP: TCP_MAXRTX (12) com o backoff do RTO
+static const int FIRST_FD = 48;             // lwIP começa os sockets em LWIP_SOCKET_OFFSET
+
+static std::mt19937_64 worldRng(1);
+static std::mt19937_64 firmwareRng(2);
+static int64_t epochUtc = 0;
+
+static bool apOnline = true;
+static bool brokerOnline = true;
+static bool autoAck = true;
+static Us blackholeFrom = -1;
+static Us blackholeUntil = -1;
+static bool blackholeNoticed = true;
+
+void setSeed(uint64_t seed) {
+    worldRng.seed(seed);
+    firmwareRng.seed(seed ^ 0x9E3779B97F4A7C15ULL);
+}
+
+Us uniform(Us low, Us high) {
+    return high <= low ? low : low + (Us)(worldRng() % (uint64_t)(high - low + 1));
+}
+
+uint32_t firmwareRandom() {
+    return (uint32_t)firmwareRng();
+}
+
+void setEpoch(int64_t utcSeconds) {
+    epochUtc = utcSeconds;
+}
+
+Us trueUtcMicros(Us world) {
+    return epochUtc * SEC + world;
+}
+
+// ========== ESTAÇÃO WIFI ==========
+
+enum class Station : uint8_t { OFF, JOINING, CONNECTED, LOST };
+
+static Station station = Station::OFF;
+static bool stationWanted = false;      // begin() chamado e modo não desligado
+static uint64_t joinGen = 0;
+static Us associatedSince = -1;
+static wifi_ps_type_t powerSave = WIFI_PS_MIN_MODEM;   // Padrão do arduino-esp32
+static uint16_t configuredListen = 3;                   // esp_wifi_set_config
+static uint16_t listenInterval = 3;                     // Da associação atual
+
+static void endAllSessions(int cause);
+
+// ========== RÁDIO (MODEM SLEEP) ==========
+
+// Beacon de 100 TU; o AP avisa no TIM o que guardou para a estação
+static const Us BEACON = 102400;
+static const int AP_DTIM = 1;
+static const Us BEACON_RX = 3 * MS;         // Acorda, recebe o beacon e volta a dormir
+static const Us ACTIVE_HOLD = 30 * MS;      // Ligado depois de cada quadro
+
+static Us radioMark = 0;
+static Us awakeUntil = -1;
+
+static Us listenPeriod() {
+    int beacons = powerSave == WIFI_PS_MAX_MODEM ? std::max<int>(listenInterval, AP_DTIM) : AP_DTIM;
+    return beacons * BEACON;
+}
+
+// Fecha o tempo desde a última mudança de estado: associando ou sem modem
+// sleep o rádio fica ligado; dormindo, só os beacons escutados
+static void radioAccount() {
+    Us elapsed = now() - radioMark;
+    radioMark = now();
+    if (station == Station::JOINING || (station == Station::CONNECTED && powerSave == WIFI_PS_NONE)) {
+        linkStats.radioOnUs += elapsed;
+    } else if (station == Station::CONNECTED) {
+        linkStats.radioOnUs += elapsed * BEACON_RX / listenPeriod();
+    }
+}
+
+// Tráfego acorda o rádio até `until`; sem modem sleep já estava ligado
+static void radioActive(Us until) {
+    if (station != Station::CONNECTED || powerSave == WIFI_PS_NONE) return;
+    Us from = std::max(now(), awakeUntil);
+    if (until > from) linkStats.radioOnUs += until - from;
+    awakeUntil = std::max(awakeUntil, until);
+}
+
+// Quadro para a estação: acordada, entra já; dormindo, espera o próximo
+// beacon escutado (TIM) e o PS-Poll
+static Us radioDeliverAt(Us arrival) {
+    if (station != Station::CONNECTED || powerSave == WIFI_PS_NONE || arrival <= awakeUntil) return arrival;
+    Us period = listenPeriod();
+    Us phase = (arrival - associatedSince) % period;
+    return arrival - phase + period + BEACON_RX;
+}
+
+static void startJoin() {
+    radioAccount();
+    uint64_t gen = ++joinGen;
+    if (!apOnline) {
+        station = Station::LOST;
+        return;
+    }
+    station = Station::JOINING;
+    at(now() + uniform(JOIN_MIN, JOIN_MAX), [gen] {
+        if (gen != joinGen || !apOnline || !stationWanted) return;
+        radioAccount();
+        station = Station::CONNECTED;
+        associatedSince = now();
+        awakeUntil = -1;
+        listenInterval = configuredListen;   // Vai no pedido de associação
+        linkStats.powerSave = powerSave;
+        linkStats.listenInterval = listenInterval;
+    });
+}
+
+static void dropStation(Station next, int cause) {
+    radioAccount();
+    if (associatedSince >= 0) {
+        linkStats.associatedUs += now() - associatedSince;
+        associatedSince = -1;
+    }
+    joinGen++;
+    station = next;
+    endAllSessions(cause);
+}
+
+static bool stationUp() {
+    return station == Station::CONNECTED;
+}
+
+void setAccessPoint(bool up) {
+    if (up == apOnline) return;
+    apOnline = up;
+
+    if (!up) {
+        if (station == Station::CONNECTED || station == Station::JOINING) dropStation(Station::LOST, 0);
+    } else if (stationWanted && station == Station::LOST) {
+        startJoin();   // Reconexão automática do arduino-esp32
+    }
+}
+
+bool accessPointUp() {
+    return apOnline;
+}
+
+void setBlackhole(Us duration) {
+    blackholeFrom = now();
+    blackholeUntil = now() + duration;
+    blackholeNoticed = false;
+}
+
+static bool blackholed() {
+    return now() < blackholeUntil;
+}
+
+// Firmware viu a conexão cair: mede quanto o blackhole levou para ser notado
+static void clientNoticedLoss() {
+    if (blackholeNoticed || now() < blackholeFrom) return;
+    blackholeNoticed = true;
+    linkStats.deadLink.add(now() - blackholeFrom);
+}
+
+// ========== SOCKETS E SESSÃO MQTT ==========
+
+enum LossCause { LOSS_WIFI, LOSS_BROKER, LOSS_KEEPALIVE, LOSS_CLIENT_TIMEOUT, LOSS_TCP, LOSS_RESET, LOSS_CLOSED };
+
+static std::map<int, SimSocket*> sockets;
+static int nextFd = FIRST_FD;
+static uint64_t nextSessionId = 1;
+static Us sessionLostAt = -1;
+
+static void countLostCommands(SimSocket* sock) {
+    for (const SimPacket& packet : sock->rx) {
+        if (packet.isCommand()) linkStats.commandsLost++;
+    }
+    sock->rx.clear();
+}
+
+static void endSession(SimSocket* sock, int cause) {
+    if (!sock->session) return;
+    sock->session = false;
+    linkStats.onlineUs += now() - sock->sessionStart;
+    if (sessionLostAt < 0) sessionLostAt = now();
+
+    switch (cause) {
+        case LOSS_WIFI: linkStats.lossWifi++; break;
+        case LOSS_BROKER: linkStats.lossBroker++; break;
+        case LOSS_KEEPALIVE: linkStats.lossKeepalive++; break;
+        case LOSS_CLIENT_TIMEOUT: linkStats.lossClientTimeout++; break;
+        case LOSS_TCP: linkStats.lossTcp++; break;
+        case LOSS_RESET: linkStats.lossReset++; break;
+        default: linkStats.lossClosed++; break;
+    }
+}
+
+// Conexão morta do lado da rede: o firmware descobre ao ler ou no select()
+static void breakSocket(SimSocket* sock, int cause) {
+    endSession(sock, cause);
+    if (!sock->open || sock->broken) return;
+    sock->broken = true;
+    countLostCommands(sock);
+    wake(sock->waiter);
+}
+
+static void endAllSessions(int cause) {
+    for (auto& entry : sockets) breakSocket(entry.second, cause);
+}
+
+static SimSocket* openSocket() {
+    SimSocket* sock = new SimSocket();
+    sock->fd = nextFd++;
+    sock->open = true;
+    sock->broken = false;
+    sock->waiter = nullptr;
+    sock->session = false;
+    sock->sessionId = 0;
+    sock->keepAlive = 0;
+    sock->lastFromClient = now();
+    sock->sessionStart = now();
+    sock->unackedSince = -1;
+    sockets[sock->fd] = sock;
+    return sock;
+}
+
+// Fechado pelo firmware: o objeto fica (o WiFiClient pode ainda apontar)
+static void closeSocket(SimSocket* sock, int cause) {
+    if (!sock || !sock->open) return;
+    endSession(sock, cause);
+    countLostCommands(sock);
+    sock->open = false;
+    sockets.erase(sock->fd);
+    wake(sock->waiter);
+}
+
+// Keepalive no broker (1,5x, como o Mosquitto): sem pacote do cliente, derruba
+static void armKeepalive(SimSocket* sock, uint64_t id) {
+    if (sock->keepAlive == 0) return;
+    Us limit = sock->keepAlive * SEC * 3 / 2;
+    at(sock->lastFromClient + limit, [sock, id, limit] {
+        if (!sock->session || sock->sessionId != id) return;
+        if (now() - sock->lastFromClient >= limit) {
+            // No blackhole o FIN do broker não chega: o cliente segue achando que está online
+            if (blackholed()) endSession(sock, LOSS_KEEPALIVE);
+            else breakSocket(sock, LOSS_KEEPALIVE);
+        } else {
+            armKeepalive(sock, id);
+        }
+    });
+}
+
+static void centralReceive(const std::string& topic, const std::string& payload);
+
+// Segmento sem ACK: o lwIP desiste depois das retransmissões e fecha o socket
+static void armTcpGiveup(SimSocket* sock) {
+    if (sock->unackedSince >= 0) return;
+    sock->unackedSince = now();
+    int fd = sock->fd;
+    at(now() + TCP_GIVEUP, [sock, fd] {
+        if (!sockets.count(fd) || sockets[fd] != sock || sock->unackedSince < 0) return;
+        if (now() - sock->unackedSince < TCP_GIVEUP) return;
+        breakSocket(sock, LOSS_TCP);
+    });
+}
+
+// Cliente -> broker (publish, subscribe, PINGREQ)
+static void uplink(SimSocket* sock, std::function<void(SimSocket*)> deliver) {
+    radioActive(now() + ACTIVE_HOLD);
+    if (blackholed()) {
+        armTcpGiveup(sock);
+        return;
+    }
+    sock->unackedSince = -1;
+
+    uint64_t id = sock->sessionId;
+    at(now() + uniform(UPLINK_MIN, UPLINK_MAX), [sock, id, deliver] {
+        if (!sock->session || sock->sessionId != id) {
+            // Broker já derrubou a sessão (keepalive no blackhole): responde com RST
+            if (sock->open && !sock->broken && sock->sessionId == id) breakSocket(sock, LOSS_KEEPALIVE);
+            return;
+        }
+        sock->lastFromClient = now();
+        deliver(sock);
+    });
+}
+
+// Broker -> cliente: entra no socket (no próximo beacon escutado, com o
+// rádio dormindo) e acorda quem espera no select()
+static void downlink(SimSocket* sock, SimPacket packet) {
+    uint64_t id = sock->sessionId;
+    auto lost = [packet] {
+        if (packet.isCommand()) linkStats.commandsLost++;
+    };
+    if (blackholed()) {
+        lost();
+        return;
+    }
+
+    at(now() + uniform(DOWNLINK_MIN, DOWNLINK_MAX), [sock, id, packet, lost] {
+        if (!sock->session || sock->sessionId != id || sock->broken || !stationUp()) {
+            lost();
+            return;
+        }
+        at(radioDeliverAt(now()), [sock, id, packet, lost] {
+            if (!sock->open || sock->sessionId != id || sock->broken || !stationUp()) {
+                lost();
+                return;
+            }
+            radioActive(now() + ACTIVE_HOLD);
+            sock->rx.push_back(packet);
+            wake(sock->waiter);
+        });
+    });
+}
+
+// Broker entrega a quem assina o tópico (comandos da Central e o eco das
+// publicações da própria remota)
+static int brokerRoute(const std::string& topic, const std::string& payload, Us sentAt) {
+    int delivered = 0;
+    for (auto& entry : sockets) {
+        SimSocket* sock = entry.second;
+        if (sock->session && sock->subscriptions.count(topic)) {
+            downlink(sock, SimPacket{ SimPacket::PUBLISH, topic, payload, sentAt });
+            delivered++;
+        }
+    }
+    return delivered;
+}
+
+void setBroker(bool up) {
+    brokerOnline = up;
+    if (!up) endAllSessions(LOSS_BROKER);
+}
+
+bool brokerUp() {
+    return brokerOnline;
+}
+
+void sendCommand(const std::string& json) {
+    linkStats.commandsSent++;
+    if (brokerRoute(TOPIC_CMD, json, now()) == 0) {
+        linkStats.commandsLost++;   // QoS 0 com sessão limpa: o broker não guarda
+    }
+}
+
+// ========== CENTRAL ==========
+
+struct JournalView {
+    uint32_t next;          // Próximo seq esperado
+};
+
+static std::map<uint32_t, JournalView> journals;
+
+void setAutoAck(bool on) {
+    autoAck = on;
+}
+
+static void sendLogAck(uint32_t jid, uint32_t seq) {
+    LogAckArgs args;
+    args.jid = jid;
+    args.seq = seq;
+    JsonDocument doc;
+    CommandRegistry::encode(args, doc);
+    std::string json;
+    serializeJson(doc, json);
+    logStats.acks++;
+    sendCommand(json);
+}
+
+static void centralLogs(const std::string& payload) {
+    JsonDocument doc;
+    if (deserializeJson(doc, payload)) return;
+
+    uint32_t jid = doc["jid"] | 0UL;
+    uint32_t tail = doc["tail"] | 0UL;
+    uint32_t seq = doc["seq"] | 0UL;
+    const char* data = doc["data"] | "";
+
+    uint8_t raw[1024];
+    size_t rawLen = 0;
+    if (mbedtls_base64_decode(raw, sizeof(raw), &rawLen, (const uint8_t*)data, strlen(data)) != 0) return;
+    uint32_t count = rawLen / FeedLogCodec::ENTRY_SIZE;
+
+    logStats.batches++;
+    auto found = journals.find(jid);
+    if (found == journals.end()) found = journals.emplace(jid, JournalView{ tail }).first;
+    JournalView& view = found->second;
+
+    // Descartados na remota antes de chegarem aqui
+    if ((int32_t)(tail - view.next) > 0) {
+        logStats.lost += tail - view.next;
+        view.next = tail;
+    }
+
+    // Lote à frente do esperado (anterior perdido): a remota reenvia do tail
+    if ((int32_t)(seq - view.next) <= 0) {
+        uint32_t end = seq + count;
+        uint32_t already = (int32_t)(end - view.next) > 0 ? view.next - seq : count;
+        logStats.duplicates += already;
+        if ((int32_t)(end - view.next) > 0) {
+            logStats.received += end - view.next;
+            view.next = end;
+        }
+    }
+
+    if (autoAck) {
+        uint32_t ackSeq = view.next;
+        at(now() + ACK_DELAY, [jid, ackSeq] { sendLogAck(jid, ackSeq); });
+    }
+}
+
+static void centralReceive(const std::string& topic, const std::string& payload) {
+    linkStats.publishes++;
+    linkStats.publishBytes += payload.size();
+    linkStats.byTopic[topic]++;
+    if (observer.published) observer.published(topic, payload);
+
+    if (topic == TOPIC_LOGS) centralLogs(payload);
+}
+
+void finishStats() {
+    radioAccount();
+    if (associatedSince >= 0) {
+        linkStats.associatedUs += now() - associatedSince;
+        associatedSince = now();
+    }
+    for (auto& entry : sockets) {
+        SimSocket* sock = entry.second;
+        if (sock->session) {
+            linkStats.onlineUs += now() - sock->sessionStart;
+            sock->sessionStart = now();
+        }
+    }
+}
+
+// ========== NTP ==========
+
+static bool ntpServerOnline = true;
+static bool sntpRunning = false;
+static uint64_t sntpGen = 0;
+static uint32_t sntpIntervalMs = 3600000;
+static sntp_sync_time_cb_t sntpCallback = nullptr;
+static sntp_sync_status_t sntpStatus = SNTP_SYNC_STATUS_RESET;
+
+static void sntpAttempt(uint64_t gen) {
+    if (gen != sntpGen || !sntpRunning) return;
+
+    if (!stationUp() || !ntpServerOnline || blackholed()) {
+        at(now() + SNTP_RETRY, [gen] { sntpAttempt(gen); });
+        return;
+    }
+
+    // Resposta chega depois de um RTT; a hora vem com alguns ms de erro
+    at(now() + uniform(20 * MS, 80 * MS), [gen] {
+        if (gen != sntpGen || !sntpRunning) return;
+        if (!stationUp()) {
+            at(now() + SNTP_RETRY, [gen] { sntpAttempt(gen); });
+            return;
+        }
+        setSystemTime(trueUtcMicros(now()) + uniform(-2 * MS, 2 * MS));
+        sntpStatus = SNTP_SYNC_STATUS_COMPLETED;
+
+        struct timeval tv;
+        Us sys = systemTime();
+        tv.tv_sec = (time_t)(sys / SEC);
+        tv.tv_usec = (suseconds_t)(sys % SEC);
+        if (sntpCallback) sntpCallback(&tv);
+
+        at(now() + chipToWorld((Us)sntpIntervalMs * MS), [gen] { sntpAttempt(gen); });
+    });
+}
+
+void sntpStart() {
+    sntpRunning = true;
+    uint64_t gen = ++sntpGen;
+    at(now() + uniform(0, 50 * MS), [gen] { sntpAttempt(gen); });
+}
+
+void setNtp(bool up) {
+    ntpServerOnline = up;
+}
+
+bool ntpUp() {
+    return ntpServerOnline;
+}
+
+// ========== DS3231 ==========
+
+static const double RTC_CHIP_PPM = 2.0;     // TCXO do DS3231
+
+static RtcChip rtcState = RtcChip::OK;
+static Us rtcSetAt = 0;                     // Mundo no último ajuste
+static Us rtcSetValue = 0;                  // UTC (µs) gravado nele
+
+void setRtcChip(RtcChip state) {
+    rtcState = state;
+    rtcSetAt = now();
+    rtcSetValue = state == RtcChip::OK ? trueUtcMicros(now()) : 0;
+}
+
+static uint32_t rtcChipSeconds() {
+    Us elapsed = now() - rtcSetAt;
+    return (uint32_t)((rtcSetValue + elapsed + (Us)(elapsed * RTC_CHIP_PPM / 1e6)) / SEC);
+}
+
+// ========== RESET ==========
+
+void worldOnReset() {
+    // Sessão morre sem DISCONNECT; para as contas, caiu no reset
+    for (auto& entry : sockets) {
+        SimSocket* sock = entry.second;
+        endSession(sock, LOSS_RESET);
+        countLostCommands(sock);
+        sock->open = false;
+        sock->waiter = nullptr;
+    }
+    sockets.clear();
+
+    stationWanted = false;
+    if (station != Station::OFF) dropStation(Station::OFF, LOSS_RESET);
+    powerSave = WIFI_PS_MIN_MODEM;
+    configuredListen = 3;
+    listenInterval = 3;
+
+    sntpRunning = false;
+    sntpGen++;
+    sntpCallback = nullptr;
+    sntpIntervalMs = 3600000;
+    sntpStatus = SNTP_SYNC_STATUS_RESET;
+}
+
+}
+
+using namespace sim;
+
+// ========== WIFI ==========
+
+WiFiClass WiFi;
+
+String IPAddress::toString() const {
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", (unsigned)(addr >> 24), (unsigned)(addr >> 16) & 0xFF,
+             (unsigned)(addr >> 8) & 0xFF, (unsigned)addr & 0xFF);
+    return String(text);
+}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* password, int32_t channel, const uint8_t* bssid,
+                             bool connect) {
+    (void)ssid;
+    (void)password;
+    (void)channel;
+    (void)bssid;
+    stationWanted = true;
+    if (connect && station != Station::CONNECTED) startJoin();
+    return status();
+}
+
+wl_status_t WiFiClass::status() {
+    switch (station) {
+        case Station::CONNECTED: return WL_CONNECTED;
+        case Station::LOST: return apOnline ? WL_DISCONNECTED : WL_NO_SSID_AVAIL;
+        default: return WL_DISCONNECTED;
+    }
+}
+
+bool WiFiClass::reconnect() {
+    if (!stationWanted) return false;
+    if (station != Station::CONNECTED) startJoin();
+    return true;
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAp) {
+    (void)eraseAp;
+    if (wifiOff) stationWanted = false;
+    if (station != Station::OFF) dropStation(wifiOff ? Station::OFF : Station::LOST, LOSS_CLOSED);
+    return true;
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+    if (mode == WIFI_OFF) {
+        stationWanted = false;
+        if (station != Station::OFF) dropStation(Station::OFF, LOSS_CLOSED);
+    }
+    return true;
+}
+
+wifi_mode_t WiFiClass::getMode() {
+    return stationWanted ? WIFI_STA : WIFI_OFF;
+}
+
+bool WiFiClass::setAutoReconnect(bool autoReconnect) {
+    (void)autoReconnect;
+    return true;
+}
+
+bool WiFiClass::setSleep(bool enabled) {
+    return setSleep(enabled ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE);
+}
+
+bool WiFiClass::setSleep(wifi_ps_type_t type) {
+    radioAccount();
+    powerSave = type;
+    return true;
+}
+
+wifi_ps_type_t WiFiClass::getSleep() {
+    return powerSave;
+}
+
+IPAddress WiFiClass::localIP() {
+    return stationUp() ? IPAddress(0xC0A8002A) : IPAddress(0);
+}
+
+int8_t WiFiClass::RSSI() {
+    return stationUp() ? -61 : 0;
+}
+
+String WiFiClass::macAddress() {
+    return String("24:0A:C4:00:00:01");
+}
+
+esp_err_t esp_wifi_connect() {
+    if (!stationWanted) return ESP_FAIL;
+    if (station != Station::CONNECTED) startJoin();
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type) {
+    radioAccount();
+    powerSave = type;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_ps(wifi_ps_type_t* type) {
+    *type = powerSave;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_config(wifi_interface_t iface, wifi_config_t* config) {
+    (void)iface;
+    memset(config, 0, sizeof(*config));
+    config->sta.listen_interval = configuredListen;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t iface, wifi_config_t* config) {
+    (void)iface;
+    configuredListen = config->sta.listen_interval ? config->sta.listen_interval : 3;
+    return ESP_OK;
+}
+
+// ========== WIFICLIENT / SELECT ==========
+
+WiFiClient::WiFiClient() : sock(nullptr), timeoutS(3) {}
+
+WiFiClient::~WiFiClient() {
+    stop();
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+    (void)host;
+    (void)port;
+    stop();
+
+    // Sem rede o DNS falha logo; broker fora recusa; senão TCP + TLS
+    if (!stationUp()) {
+        sleepFor(50 * MS);
+        return 0;
+    }
+    if (!brokerOnline) {
+        sleepFor(REFUSED);
+        return 0;
+    }
+
+    // No blackhole o SYN some: espera o timeout inteiro
+    Us handshake = blackholed() ? NEVER : uniform(TLS_MIN, TLS_MAX);
+    Us limit = (Us)timeoutS * SEC;
+    radioActive(now() + std::min(handshake, limit) + ACTIVE_HOLD);
+    sleepFor(std::min(handshake, limit));
+    if (handshake > limit || !stationUp() || !brokerOnline) return 0;
+
+    sock = openSocket();
+    return 1;
+}
+
+bool WiFiClient::connected() {
+    return sock && sock->open && !sock->broken;
+}
+
+void WiFiClient::stop() {
+    if (sock) closeSocket(sock, LOSS_CLOSED);
+    sock = nullptr;
+}
+
+int WiFiClient::available() {
+    if (!sock || !sock->open) return 0;
+    int bytes = 0;
+    for (const SimPacket& packet : sock->rx) bytes += packet.wireBytes();
+    return bytes;
+}
+
+int WiFiClient::read() {
+    return -1;
+}
+
+int WiFiClient::read(uint8_t* buf, size_t size) {
+    (void)buf;
+    (void)size;
+    return -1;
+}
+
+size_t WiFiClient::write(const uint8_t* buf, size_t size) {
+    (void)buf;
+    return connected() ? size : 0;
+}
+
+int WiFiClient::fd() const {
+    return sock && sock->open ? sock->fd : -1;
+}
+
+// ========== HTTP (PATCHES OTA) ==========
+
+static std::map<std::string, std::vector<uint8_t>> patches;
+
+void sim::servePatch(const std::string& url, const std::vector<uint8_t>& body) {
+    patches[url] = body;
+}
+
+int HTTPClient::GET() {
+    stream.stop();
+    size = -1;
+    if (!stationUp()) {
+        sleepFor(50 * MS);
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+
+    // TCP + TLS + cabeçalhos; no blackhole espera o timeout inteiro
+    Us handshake = blackholed() ? NEVER : uniform(TLS_MIN, TLS_MAX);
+    Us limit = (Us)timeoutMs * MS;
+    radioActive(now() + std::min(handshake, limit) + ACTIVE_HOLD);
+    sleepFor(std::min(handshake, limit));
+    if (handshake > limit) return HTTPC_ERROR_READ_TIMEOUT;
+    if (!stationUp()) return HTTPC_ERROR_CONNECTION_REFUSED;
+
+    auto found = patches.find(target);
+    if (found == patches.end()) return HTTP_CODE_NOT_FOUND;
+
+    size = (int)found->second.size();
+    stream.open(&found->second);
+    radioActive(now() + size / HTTP_BYTES_PER_MS * MS + ACTIVE_HOLD);
+    return HTTP_CODE_OK;
+}
+
+String HTTPClient::errorToString(int error) {
+    switch (error) {
+        case HTTPC_ERROR_CONNECTION_REFUSED: return String("connection refused");
+        case HTTPC_ERROR_READ_TIMEOUT:       return String("read Timeout");
+        default:                             return String("error");
+    }
+}
+
+void SimHttpStream::open(const std::vector<uint8_t>* data) {
+    body = data;
+    pos = 0;
+    since = now();
+}
+
+bool SimHttpStream::connected() {
+    return body && pos < body->size() && stationUp();
+}
+
+int SimHttpStream::available() {
+    if (!body || !stationUp()) return 0;
+    size_t arrived = std::min(body->size(), (size_t)((now() - since) / MS * HTTP_BYTES_PER_MS));
+    return arrived > pos ? (int)(arrived - pos) : 0;
+}
+
+int SimHttpStream::read() {
+    uint8_t byte;
+    return read(&byte, 1) == 1 ? byte : -1;
+}
+
+int SimHttpStream::read(uint8_t* buf, size_t size) {
+    size_t n = std::min(size, (size_t)available());
+    if (n == 0) return -1;
+    memcpy(buf, body->data() + pos, n);
+    pos += n;
+    return (int)n;
+}
+
+int simSelect(int nfds, fd_set* readfds, fd_set* writefds, fd_set* exceptfds, struct timeval* timeout) {
+    (void)writefds;
+    (void)exceptfds;
+
+    std::vector<int> watched;
+    for (int fd = 0; fd < nfds; fd++) {
+        if (readfds && FD_ISSET(fd, readfds)) watched.push_back(fd);
+    }
+
+    Us deadline = timeout ? now() + chipToWorld((Us)timeout->tv_sec * SEC + timeout->tv_usec) : NEVER;
+    for (;;) {
+        std::vector<int> readable;
+        for (int fd : watched) {
+            auto found = sockets.find(fd);
+            if (found == sockets.end()) {
+                errno = EBADF;
+                return -1;
+            }
+            SimSocket* sock = found->second;
+            if (sock->broken || !sock->rx.empty()) readable.push_back(fd);
+        }
+
+        if (!readable.empty() || now() >= deadline) {
+            if (readfds) {
+                FD_ZERO(readfds);
+                for (int fd : readable) FD_SET(fd, readfds);
+            }
+            return (int)readable.size();
+        }
+
+        // Um waiter por socket (a tarefa do MQTT)
+        SimSocket* sock = sockets[watched.front()];
+        sock->waiter = current();
+        wait(deadline == NEVER ? NEVER : deadline - now());
+        if (sockets.count(watched.front())) sock->waiter = nullptr;
+    }
+}
+
+// ========== PUBSUBCLIENT ==========
+
+// Custo no ESP32: cifrar/decifrar TLS e copiar para o socket
+static const Us PUBLISH_BASE_US = 2000;
+static const Us PUBLISH_PER_BYTE_US = 5;
+static const Us READ_BASE_US = 300;
+static const Us READ_PER_BYTE_US = 2;
+
+PubSubClient::PubSubClient() :
+    client(nullptr),
+    callback(),
+    buffer(nullptr),
+    bufferSize(0),
+    keepAlive(MQTT_KEEPALIVE),
+    socketTimeout(MQTT_SOCKET_TIMEOUT),
+    lastOutActivity(0),
+    lastInActivity(0),
+    pingOutstanding(false),
+    _state(MQTT_DISCONNECTED) {
+    setBufferSize(MQTT_MAX_PACKET_SIZE);
+}
+
+PubSubClient::PubSubClient(Client& client) : PubSubClient() {
+    setClient(client);
+}
+
+PubSubClient::~PubSubClient() {
+    free(buffer);
+}
+
+PubSubClient& PubSubClient::setServer(const char* domain, uint16_t port) {
+    (void)domain;
+    (void)port;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setCallback(std::function<void(char*, uint8_t*, unsigned int)> cb) {
+    callback = cb;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setClient(Client& c) {
+    client = dynamic_cast<WiFiClient*>(&c);
+    return *this;
+}
+
+PubSubClient& PubSubClient::setKeepAlive(uint16_t seconds) {
+    keepAlive = seconds;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setSocketTimeout(uint16_t seconds) {
+    socketTimeout = seconds;
+    return *this;
+}
+
+bool PubSubClient::setBufferSize(uint16_t size) {
+    if (size == 0) return false;
+    uint8_t* resized = static_cast<uint8_t*>(realloc(buffer, size));
+    if (!resized) return false;
+    buffer = resized;
+    bufferSize = size;
+    return true;
+}
+
+bool PubSubClient::connect(const char* id) {
+    return connect(id, nullptr, nullptr);
+}
+
+bool PubSubClient::connect(const char* id, const char* user, const char* pass) {
+    (void)id;
+    (void)user;
+    (void)pass;
+    if (connected()) return true;
+
+    if (!client || !client->connect(MQTT_BROKER, MQTT_PORT)) {
+        linkStats.connectFailures++;
+        _state = MQTT_CONNECT_FAILED;
+        return false;
+    }
+
+    // CONNECT -> CONNACK: um RTT
+    sleepFor(uniform(UPLINK_MIN, UPLINK_MAX) + uniform(DOWNLINK_MIN, DOWNLINK_MAX));
+    SimSocket* sock = client->socket();
+    if (!sock || !sock->open || sock->broken || !stationUp() || !brokerOnline) {
+        linkStats.connectFailures++;
+        _state = MQTT_CONNECTION_TIMEOUT;
+        client->stop();
+        return false;
+    }
+
+    sock->session = true;
+    sock->sessionId = nextSessionId++;
+    sock->keepAlive = keepAlive;
+    sock->lastFromClient = now();
+    sock->sessionStart = now();
+    armKeepalive(sock, sock->sessionId);
+    linkStats.connects++;
+    if (sessionLostAt >= 0) {
+        linkStats.reconnect.add(now() - sessionLostAt);
+        sessionLostAt = -1;
+    }
+
+    lastInActivity = lastOutActivity = millis();
+    pingOutstanding = false;
+    _state = MQTT_CONNECTED;
+    return true;
+}
+
+void PubSubClient::disconnect() {
+    if (client) client->stop();
+    _state = MQTT_DISCONNECTED;
+    lastInActivity = lastOutActivity = millis();
+}
+
+bool PubSubClient::publish(const char* topic, const char* payload) {
+    return publish(topic, (const uint8_t*)payload, payload ? strlen(payload) : 0, false);
+}
+
+bool PubSubClient::publish(const char* topic, const char* payload, bool retained) {
+    return publish(topic, (const uint8_t*)payload, payload ? strlen(payload) : 0, retained);
+}
+
+bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int length) {
+    return publish(topic, payload, length, false);
+}
+
+bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained) {
+    (void)retained;
+    if (!connected()) return false;
+
+    // Cabeçalho (até 5) + tamanho do tópico (2) + tópico + payload no buffer
+    if (5 + 2 + strlen(topic) + length > bufferSize) return false;
+
+    busy(PUBLISH_BASE_US + PUBLISH_PER_BYTE_US * length);
+    if (!connected()) return false;
+
+    lastOutActivity = millis();
+    std::string t(topic);
+    std::string p((const char*)payload, length);
+    uplink(client->socket(), [t, p](SimSocket*) {
+        centralReceive(t, p);
+        brokerRoute(t, p, now());
+    });
+    return true;
+}
+
+bool PubSubClient::subscribe(const char* topic) {
+    return subscribe(topic, 0);
+}
+
+bool PubSubClient::subscribe(const char* topic, uint8_t qos) {
+    (void)qos;
+    if (!connected()) return false;
+
+    busy(PUBLISH_BASE_US);
+    lastOutActivity = millis();
+    std::string t(topic);
+    uplink(client->socket(), [t](SimSocket* sock) { sock->subscriptions.insert(t); });
+    return true;
+}
+
+bool PubSubClient::unsubscribe(const char* topic) {
+    if (!connected()) return false;
+
+    lastOutActivity = millis();
+    std::string t(topic);
+    uplink(client->socket(), [t](SimSocket* sock) { sock->subscriptions.erase(t); });
+    return true;
+}
+
+bool PubSubClient::connected() {
+    if (!client) return false;
+    bool ok = client->connected();
+    if (!ok && _state == MQTT_CONNECTED) {
+        clientNoticedLoss();
+        _state = MQTT_CONNECTION_LOST;
+        client->stop();
+    }
+    return ok;
+}
+
+bool PubSubClient::loop() {
+    if (!connected()) return false;
+
+    // Como o 2.8: entrada OU saída parada por keepAlive -> PINGREQ; o
+    // PINGRESP precisa chegar antes do próximo vencimento
+    unsigned long t = millis();
+    if (keepAlive && (t - lastInActivity > keepAlive * 1000UL || t - lastOutActivity > keepAlive * 1000UL)) {
+        if (pingOutstanding) {
+            SimSocket* sock = client->socket();
+            if (sock) endSession(sock, LOSS_CLIENT_TIMEOUT);
+            clientNoticedLoss();
+            _state = MQTT_CONNECTION_TIMEOUT;
+            client->stop();
+            return false;
+        }
+
+        busy(READ_BASE_US);
+        linkStats.pings++;
+        uplink(client->socket(), [](SimSocket* sock) {
+            downlink(sock, SimPacket{ SimPacket::PINGRESP, std::string(), std::string(), now() });
+        });
+        lastOutActivity = t;
+        lastInActivity = t;
+        pingOutstanding = true;
+    }
+
+    SimSocket* sock = client->socket();
+    if (sock && !sock->rx.empty()) {
+        SimPacket packet = sock->rx.front();
+        sock->rx.pop_front();
+        lastInActivity = t;
+        busy(READ_BASE_US + READ_PER_BYTE_US * packet.wireBytes());
+
+        if (packet.kind == SimPacket::PINGRESP) {
+            pingOutstanding = false;
+        } else {
+            // Layout do 2.8: tópico terminado em '\0' e o payload logo depois;
+            // pacote maior que o buffer é descartado
+            size_t topicLen = packet.topic.size();
+            size_t length = packet.payload.size();
+            if (3 + topicLen + 1 + length >= bufferSize) {
+                if (packet.isCommand()) linkStats.commandsLost++;
+                return true;
+            }
+
+            char* topic = (char*)buffer + 3;
+            memcpy(topic, packet.topic.data(), topicLen);
+            topic[topicLen] = '\0';
+            uint8_t* payload = (uint8_t*)topic + topicLen + 1;
+            memcpy(payload, packet.payload.data(), length);
+
+            if (packet.isCommand()) {
+                linkStats.commandsDelivered++;
+                linkStats.commandLatency.add(now() - packet.sentAt);
+                if (observer.commandDelivered) observer.commandDelivered(packet.payload, packet.sentAt);
+            }
+            if (callback) callback(topic, payload, length);
+        }
+    }
+    return true;
+}
+
+// ========== SNTP ==========
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1, const char* server2,
+                const char* server3) {
+    (void)gmtOffsetSec;
+    (void)daylightOffsetSec;
+    (void)server1;
+    (void)server2;
+    (void)server3;
+    sntpStart();
+}
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback) {
+    sntpCallback = callback;
+}
+
+void sntp_set_sync_interval(uint32_t intervalMs) {
+    sntpIntervalMs = intervalMs < 15000 ? 15000 : intervalMs;
+}
+
+uint32_t sntp_get_sync_interval() {
+    return sntpIntervalMs;
+}
+
+bool sntp_restart() {
+    if (!sntpRunning) return false;
+    sntpStart();
+    return true;
+}
+
+sntp_sync_status_t sntp_get_sync_status() {
+    return sntpStatus;
+}
+
+// ========== DS3231 ==========
+
+static const Us I2C_TRANSACTION_US = 400;
+
+TwoWire Wire;
+
+bool RTC_DS3231::begin(TwoWire* wire) {
+    (void)wire;
+    busy(I2C_TRANSACTION_US);
+    return rtcState != RtcChip::NONE;
+}
+
+bool RTC_DS3231::lostPower() {
+    busy(I2C_TRANSACTION_US);
+    return rtcState == RtcChip::LOST;
+}
+
+DateTime RTC_DS3231::now() {
+    busy(I2C_TRANSACTION_US);
+    return DateTime(rtcChipSeconds());
+}
+
+void RTC_DS3231::adjust(const DateTime& dt) {
+    busy(I2C_TRANSACTION_US);
+    if (rtcState == RtcChip::NONE) return;
+    rtcState = RtcChip::OK;
+    rtcSetAt = sim::now();
+    rtcSetValue = (Us)dt.unixtime() * SEC;
+}
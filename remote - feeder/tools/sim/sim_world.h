@@ -0,0 +1,157 @@
+#ifndef SIM_WORLD_H
+#define SIM_WORLD_H
+
+#include "sim_kernel.h"
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// Tudo o que fica fora do firmware: ponto de acesso, broker e Central, NTP,
+// DS3231, NVS, LittleFS e a porta serial. O cenário liga e desliga cada
+// parte; os contadores alimentam o relatório do feeder_sim.
+namespace sim {
+
+// ========== REDE ==========
+
+void setAccessPoint(bool up);
+void setBroker(bool up);
+void setNtp(bool up);
+bool accessPointUp();
+bool brokerUp();
+bool ntpUp();
+
+// Central -> remota: publica no tópico de comandos (QoS 0: offline, perde)
+void sendCommand(const std::string& json);
+
+// Internet muda por um tempo com o WiFi associado: pacotes somem nos dois
+// sentidos, sem RST. Só o keepalive ou a retransmissão TCP percebem
+void setBlackhole(Us duration);
+
+// Central confirma os lotes de logs (LOG_ACK)
+void setAutoAck(bool on);
+
+// Hora UTC real (segundos desde 1970) no instante do mundo
+Us trueUtcMicros(Us world);
+
+// Início do cenário: 00:00 local do dia 0
+void setEpoch(int64_t utcSeconds);
+
+// Semente dos atrasos do mundo e do esp_random() do firmware
+void setSeed(uint64_t seed);
+
+// ========== DS3231 ==========
+
+enum class RtcChip : uint8_t { OK, LOST, NONE };
+void setRtcChip(RtcChip state);
+
+// ========== FLASH ==========
+
+// Queda de energia no meio de uma gravação: só mais `bytes` bytes chegam ao
+// LittleFS. O write() que passa do limite grava o começo (registro rasgado);
+// depois disso open para escrita, rename e remove falham. Negativo religa
+void cutFlashAfter(int64_t bytes);
+
+// ========== OTA ==========
+
+// Servidor de patches: GET em url devolve body; outra url, 404
+void servePatch(const std::string& url, const std::vector<uint8_t>& body);
+
+// Imagem na partição em execução, base dos patches. Vazia (padrão): sem
+// partição OTA, toda atualização é recusada
+void setRunningImage(const std::vector<uint8_t>& image);
+
+struct OtaStats {
+    uint32_t begins;            // esp_ota_begin
+    uint32_t aborts;
+    uint32_t ends;
+    uint32_t bootSwitches;      // esp_ota_set_boot_partition na imagem nova
+    std::vector<uint8_t> image; // Gravado na partição nova
+};
+
+extern OtaStats otaStats;
+
+// ========== OBSERVAÇÃO ==========
+
+// Ganchos para o oráculo: nada aqui altera o comportamento do firmware
+struct Observer {
+    std::function<void(uint8_t channel, uint32_t duty)> ledc;
+    std::function<void(const std::string& path, const uint8_t* data, size_t len)> append;
+    std::function<void(const std::string& topic, const std::string& payload)> published;
+    std::function<void(const char* line)> serialLine;
+    std::function<void(const std::string& json, Us sentAt)> commandDelivered;
+};
+
+extern Observer observer;
+
+struct FlashStats {
+    uint64_t nvsPuts;           // Chamadas put*
+    uint64_t nvsWrites;         // Puts que mudaram o valor (gravam a flash)
+    uint64_t nvsBytes;
+    uint64_t fsOpens;
+    uint64_t fsWrites;          // write() em arquivos
+    uint64_t fsBytes;
+    uint64_t fsRenames;
+    uint64_t fsRemoves;
+};
+
+struct LinkStats {
+    uint32_t connects;          // CONNACKs
+    uint32_t connectFailures;
+    uint32_t lossWifi;          // Sessão caiu com o WiFi
+    uint32_t lossBroker;        // Broker fora
+    uint32_t lossKeepalive;     // Broker derrubou por keepalive vencido
+    uint32_t lossClientTimeout; // Cliente derrubou (PINGRESP não veio)
+    uint32_t lossTcp;           // Retransmissão TCP esgotada (lwIP)
+    uint32_t lossReset;         // Chip reiniciou com a sessão aberta
+    uint32_t lossClosed;        // Firmware fechou (shutdown/backoff)
+    uint64_t pings;
+    uint64_t publishes;
+    uint64_t publishBytes;
+    std::map<std::string, uint64_t> byTopic;
+    Us onlineUs;                // Sessão aberta
+    Us associatedUs;
+    uint32_t commandsSent;
+    uint32_t commandsDelivered;
+    uint32_t commandsLost;      // Enviados sem sessão (ou caíram com ela)
+    Histogram commandLatency;   // Central publica -> callback no firmware
+    Histogram reconnect;        // Queda da sessão -> próximo CONNACK
+    Histogram deadLink;         // Início do blackhole -> firmware perceber
+
+    // Rádio: ligado o tempo todo sem modem sleep; com ele, um beacon a cada
+    // DTIM/listen interval mais as janelas depois de cada quadro
+    Us radioOnUs;
+    int powerSave;              // wifi_ps_type_t na última associação
+    uint16_t listenInterval;
+};
+
+struct LogStats {
+    uint64_t batches;
+    uint64_t received;          // Logs novos na Central
+    uint64_t duplicates;        // Reenvios de logs já recebidos
+    uint64_t lost;              // Descartados na remota (buffer cheio)
+    uint64_t acks;
+};
+
+extern FlashStats flashStats;
+extern LinkStats linkStats;
+extern LogStats logStats;
+
+// Chamado no fim para fechar os tempos acumulados
+void finishStats();
+
+// ========== INTERNO (sim_platform / sim_world) ==========
+
+// Reset do chip: sockets, WiFi e SNTP (mundo); UART, timers, LEDC e
+// memória RTC (plataforma)
+void worldOnReset();
+void platformOnReset(esp_reset_reason_t reason);
+void sntpStart();
+
+Us uniform(Us low, Us high);        // Atraso aleatório do mundo
+uint32_t firmwareRandom();          // esp_random()
+
+}
+
+#endif
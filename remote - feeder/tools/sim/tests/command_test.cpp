@@ -0,0 +1,106 @@
+// command_test.cpp - pior comando MQTT no pool fixo (comm/mqtt_service)
+//
+//   (na pasta "remote - feeder"; ver run.sh)
+//
+// MQTT_CMD_DOC_BYTES sai de MQTT_CMD_WORST_BYTES, calculado pelo layout do
+// ArduinoJson 7. Aqui a conta é conferida contra a biblioteca que o run.sh
+// usa (a da .pio/libdeps): cada campo de cada comando do CommandRegistry
+// recebe os payloads de MQTT_CMD_MAX_BYTES que mais gastam memória (valores,
+// números de 64 bits, strings distintas, chaves distintas, uma string longa),
+// decodificados com o mesmo filtro e limite de profundidade do MQTTService.
+// Nenhum pode falhar nem passar de MQTT_CMD_WORST_BYTES.
+#include "sim_test.h"
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "comm/CommandRegistry.h"
+#include "comm/json_pool.h"
+#include "comm/mqtt_service.h"
+
+#include <string>
+
+static uint8_t poolBuffer[MQTT_CMD_DOC_BYTES];
+static JsonPoolAllocator pool(poolBuffer, sizeof(poolBuffer));
+
+// Nomes distintos e curtos: a, b, ..., Z, aa, ab, ...
+static std::string name(int i) {
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    std::string out;
+    do {
+        out += letters[i % 52];
+        i /= 52;
+    } while (i > 0);
+    return out;
+}
+
+// {"cmd":verbo,"campo":<open>item,item,...<close>} até MQTT_CMD_MAX_BYTES
+template <typename Item>
+static std::string fill(const char* verb, const char* key, char open, char close, Item item) {
+    std::string json = std::string("{\"cmd\":\"") + verb + "\",\"" + key + "\":" + open;
+    for (int i = 0;; i++) {
+        std::string next = (i ? "," : "") + item(i);
+        if (json.size() + next.size() + 2 > MQTT_CMD_MAX_BYTES) break;
+        json += next;
+    }
+    return json + close + "}";
+}
+
+static std::string longString(const char* verb, const char* key) {
+    std::string json = std::string("{\"cmd\":\"") + verb + "\",\"" + key + "\":\"";
+    json.append(MQTT_CMD_MAX_BYTES - json.size() - 2, 'x');
+    return json + "\"}";
+}
+
+static size_t decode(const JsonDocument& filter, const std::string& json, const char* what) {
+    pool.reset();
+    JsonDocument doc(&pool);
+    DeserializationError error = deserializeJson(doc, json.c_str(), json.size(),
+                                                 DeserializationOption::Filter(filter),
+                                                 DeserializationOption::NestingLimit(MQTT_CMD_MAX_DEPTH));
+    CHECK(json.size() <= MQTT_CMD_MAX_BYTES);
+    if (error) fprintf(stderr, "%s: %s (%zu B)\n", what, error.c_str(), json.size());
+    CHECK(!error);
+    return pool.peak();
+}
+
+static void worstCommands() {
+    size_t worst = 0;
+    std::string worstCase;
+
+    for (uint8_t i = 0; i < CommandRegistry::COUNT; i++) {
+        const CommandSpec& spec = CommandRegistry::spec((CommandId)i);
+        JsonDocument filter;
+        for (uint8_t f = 0; f < spec.fieldCount; f++) filter[spec.fields[f].key] = true;
+
+        for (uint8_t f = 0; f < spec.fieldCount; f++) {
+            const char* key = spec.fields[f].key;
+            const std::string payloads[] = {
+                fill(spec.verb, key, '[', ']', [](int) { return std::string("0"); }),
+                fill(spec.verb, key, '[', ']', [](int) { return std::string("0.1"); }),
+                fill(spec.verb, key, '[', ']', [](int) { return std::string("-9e99"); }),
+                fill(spec.verb, key, '[', ']', [](int n) { return "\"" + name(n) + "\""; }),
+                fill(spec.verb, key, '{', '}', [](int n) { return "\"" + name(n) + "\":0"; }),
+                fill(spec.verb, key, '[', ']', [](int n) { return "[\"" + name(n) + "\"]"; }),
+                longString(spec.verb, key),
+            };
+            for (const std::string& json : payloads) {
+                std::string what = std::string(spec.verb) + "." + key;
+                size_t used = decode(filter, json, what.c_str());
+                if (used > worst) {
+                    worst = used;
+                    worstCase = what + " " + json.substr(json.find(':', json.find(key)) + 1, 12) + "...";
+                }
+            }
+        }
+    }
+
+    printf("Pior comando: %zu B (%s) | calculado %u B | pool %u B | ArduinoJson %d.%d\n", worst,
+           worstCase.c_str(), (unsigned)MQTT_CMD_WORST_BYTES, (unsigned)MQTT_CMD_DOC_BYTES,
+           ARDUINOJSON_VERSION_MAJOR, ARDUINOJSON_VERSION_MINOR);
+    CHECK(worst <= MQTT_CMD_WORST_BYTES);
+}
+
+int main() {
+    simtest::run([] {
+        worstCommands();
+    });
+}
@@ -0,0 +1,276 @@
+// journal_test.cpp - queda de energia e custo do journal de logs (LogService)
+//
+//   (na pasta "remote - feeder"; ver run.sh)
+//   g++ -O2 -std=gnu++17 -Itools/sim/shim -Iinclude -I.pio/libdeps/esp32dev/ArduinoJson/src
+//       src/*.cpp src/*/*.cpp tools/sim/sim_*.cpp tools/sim/tests/journal_test.cpp -o journal_test
+//
+// Cada caso corta a flash (sim::cutFlashAfter) em todos os bytes de uma
+// gravação, "reinicia" com um LogService novo sobre o mesmo LittleFS e
+// confere o que o boot recupera. No fim mede bytes gravados, tempo de
+// flash por evento e o maior bloqueio de addLog e de uma fatia da compactação.
+#include "sim_test.h"
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "config.h"
+#include "services/log_service.h"
+#include <esp_rom_crc.h>
+
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace sim;
+
+static const uint32_t T0 = 1767225600;     // 2026-01-01 00:00 UTC
+static const char* TMP_PATH = LOG_JOURNAL_PATH ".tmp";
+
+// Boot sobre o LittleFS atual. O anterior não é destruído: no chip a RAM
+// simplesmente some
+static LogService* boot() {
+    LogService* log = new LogService();
+    log->begin(nullptr);
+    return log;
+}
+
+static std::vector<uint8_t> readJournal() {
+    std::vector<uint8_t> data;
+    File file = LittleFS.open(LOG_JOURNAL_PATH, FILE_READ);
+    if (!file) return data;
+    data.resize(file.size());
+    file.read(data.data(), data.size());
+    file.close();
+    return data;
+}
+
+// O primeiro registro do journal é sempre um ACK com o id (bytes 12..15)
+static uint32_t journalId() {
+    std::vector<uint8_t> data = readJournal();
+    if (data.size() < 16) return 0;
+    return data[12] | (data[13] << 8) | ((uint32_t)data[14] << 16) | ((uint32_t)data[15] << 24);
+}
+
+// A compactação pedida por addLog/ACK roda nas chamadas seguintes da tarefa
+// do log; devolve o maior tempo de uma chamada
+static Us compact(LogService* log) {
+    Us worst = 0;
+    while (log->isCompacting()) {
+        Us start = now();
+        log->loop();
+        worst = std::max(worst, now() - start);
+    }
+    return worst;
+}
+
+static void fill(LogService* log, int count, uint32_t from) {
+    for (int i = 0; i < count; i++) log->addLog(from + i * 3600, 20 + i % 7, true, "schedule");
+}
+
+// Boot depois da queda: o journal precisa estar inteiro (sem cauda inválida)
+// e continuar aceitando logs
+static void checkRecovered(LogService* log, int pending) {
+    CHECK(log->getPendingLogsCount() == pending);
+    CHECK(log->getJournalBytes() == readJournal().size());
+    CHECK(!LittleFS.exists(TMP_PATH));
+
+    log->addLog(T0 + 400 * 86400, 33, false, "manual");
+    LogService* again = boot();
+    CHECK(again->getPendingLogsCount() == std::min(pending + 1, LOG_RING_LOGS));
+}
+
+// ========== REGISTRO RASGADO ==========
+
+static void tornEntry() {
+    // jump: o timestamp sai do delta de 24 bits e o log vira BASE + ENTRY
+    for (int jump = 0; jump < 2; jump++) {
+        uint32_t ts = jump ? T0 + 0x2000000 : T0 + 10 * 3600;
+        size_t recordBytes = jump ? 24 : 8;
+
+        for (size_t cut = 0; cut <= recordBytes; cut++) {
+            LittleFS.format();
+            LogService* log = boot();
+            fill(log, 10, T0);
+
+            cutFlashAfter(cut);
+            log->addLog(ts, 25, true, "manual");
+            cutFlashAfter(-1);
+
+            checkRecovered(boot(), cut == recordBytes ? 11 : 10);
+        }
+    }
+}
+
+static void tornAck() {
+    for (size_t cut = 0; cut <= 20; cut++) {
+        LittleFS.format();
+        LogService* log = boot();
+        fill(log, 10, T0);
+
+        // ACK parcial: grava um registro ACK de 20 B no fim do journal
+        cutFlashAfter(cut);
+        log->onAck(journalId(), 4);
+        cutFlashAfter(-1);
+
+        checkRecovered(boot(), cut == 20 ? 6 : 10);
+    }
+}
+
+// ========== COMPACTAÇÃO INTERROMPIDA ==========
+
+static void interruptedCompaction() {
+    // Enche até o ENTRY seguinte passar do limite; esse log grava só o ENTRY
+    // e a tarefa do log reescreve o .tmp (ACK + BASE + LOG_RING_LOGS entradas)
+    // em fatias antes do rename
+    const int before = (LOG_JOURNAL_COMPACT_BYTES - 36 + 7) / 8 - 1;
+    const size_t tmpBytes = 20 + 16 + LOG_RING_LOGS * 8;
+    int torn = 0, oldKept = 0, compacted = 0;
+
+    for (size_t cut = 0; cut <= 8 + tmpBytes + 1; cut++) {
+        LittleFS.format();
+        LogService* log = boot();
+        fill(log, before, T0);
+        CHECK(log->getJournalBytes() < LOG_JOURNAL_COMPACT_BYTES);
+        CHECK(log->getJournalBytes() + 8 >= LOG_JOURNAL_COMPACT_BYTES);
+
+        cutFlashAfter(cut);
+        log->addLog(T0 + before * 3600, 40, true, "schedule");
+        CHECK(!LittleFS.exists(TMP_PATH));
+        CHECK(log->isCompacting() == (cut >= 8));
+        compact(log);
+        bool tmpLeft = LittleFS.exists(TMP_PATH);
+        size_t fileBytes = readJournal().size();
+        cutFlashAfter(-1);
+
+        if (cut < 8) torn++;
+        else if (fileBytes == tmpBytes) compacted++;
+        else if (tmpLeft) oldKept++;
+
+        LogService* after = boot();
+        CHECK(after->getOverflowCount() == (uint32_t)(cut < 8 ? before - LOG_RING_LOGS : before + 1 - LOG_RING_LOGS));
+        checkRecovered(after, LOG_RING_LOGS);
+    }
+
+    // Os três desfechos aconteceram: ENTRY rasgado, .tmp largado com o
+    // journal antigo intacto e compactação completa
+    CHECK(torn > 0 && oldKept > 0 && compacted > 0);
+}
+
+static void loggingDuringCompaction() {
+    // Logs e ACKs entre as fatias: o ring cheio sobrescreve pendentes ainda
+    // não copiados e o tail anda; o .tmp precisa terminar igual ao ring
+    const int before = (LOG_JOURNAL_COMPACT_BYTES - 36 + 7) / 8;
+    for (int extra = 1; extra <= LOG_RING_LOGS; extra += 37) {
+        LittleFS.format();
+        LogService* log = boot();
+        fill(log, before, T0);
+        CHECK(log->isCompacting());
+
+        log->loop();
+        CHECK(LittleFS.exists(TMP_PATH));
+        fill(log, extra, T0 + before * 3600);
+        log->onAck(journalId(), before + extra - 10);
+        compact(log);
+        CHECK(!LittleFS.exists(TMP_PATH));
+
+        LogService* after = boot();
+        CHECK(after->getPendingLogsCount() == 10);
+        CHECK(after->getOverflowCount() == log->getOverflowCount());
+        checkRecovered(after, 10);
+    }
+}
+
+// ========== FORMATO ANTERIOR ==========
+
+// Registro de 32 B do firmware anterior (magic "LF")
+static void putLegacy(std::vector<uint8_t>& out, uint8_t type, uint32_t seq, uint32_t timestamp,
+                      uint32_t value, bool delivered, const char* source) {
+    uint8_t rec[32] = { 0x4C, 0x46, type, (uint8_t)delivered };
+    memcpy(rec + 4, &seq, 4);
+    memcpy(rec + 8, &timestamp, 4);
+    memcpy(rec + 12, &value, 4);
+    strncpy((char*)rec + 16, source, 12);
+    uint32_t crc = esp_rom_crc32_le(0, rec, 28);
+    memcpy(rec + 28, &crc, 4);
+    out.insert(out.end(), rec, rec + 32);
+}
+
+static void legacyJournal() {
+    // ACK (seq 100, 7 descartados, id 0xC0FFEE) + 40 logs, o último rasgado
+    const int logs = 40;
+    std::vector<uint8_t> data;
+    putLegacy(data, 2, 100, 7, 0xC0FFEE, false, "");
+    for (int i = 0; i < logs; i++) {
+        putLegacy(data, 1, 100 + i, T0 + i * 3600, 20 + i, i % 5 != 0, i % 2 ? "manual" : "schedule");
+    }
+    data.resize(data.size() - 10);
+
+    LittleFS.format();
+    File file = LittleFS.open(LOG_JOURNAL_PATH, FILE_WRITE);
+    file.write(data.data(), data.size());
+    file.close();
+
+    LogService* log = boot();
+    CHECK(log->getPendingLogsCount() == logs - 1);
+    CHECK(log->getOverflowCount() == 7);
+    CHECK(journalId() == 0xC0FFEE);
+
+    // Regravado no formato novo: ACK + BASE + um ENTRY por log
+    std::vector<uint8_t> journal = readJournal();
+    CHECK(journal.size() == 20 + 16 + (logs - 1) * 8);
+    CHECK(!journal.empty() && journal[0] == 0xA1);
+    checkRecovered(boot(), logs - 1);
+}
+
+static void capacity() {
+    LittleFS.format();
+    LogService* log = boot();
+    fill(log, LOG_RING_LOGS + 10, T0);
+    CHECK(log->getCapacity() == (uint32_t)LOG_RING_LOGS);
+    CHECK(log->getPendingLogsCount() == LOG_RING_LOGS);
+    CHECK(log->getOverflowCount() == 10);
+    CHECK(boot()->getPendingLogsCount() == LOG_RING_LOGS);
+}
+
+// ========== CUSTO POR EVENTO ==========
+
+static void bench(const char* title, int events, int ackEvery) {
+    LittleFS.format();
+    LogService* log = boot();
+    flashStats = FlashStats();
+
+    Histogram addTime, writeTime;
+    Us slice = 0;
+    uint32_t id = journalId();
+    uint32_t seq = 0;
+    for (int i = 0; i < events; i++) {
+        Us start = now();
+        log->addLog(T0 + i * 8 * 3600, 20 + i % 13, i % 17 != 0, i % 3 ? "schedule" : "manual");
+        addTime.add(now() - start);
+        writeTime.add(log->getLastWriteMicros());
+        seq++;
+
+        if (ackEvery && seq % ackEvery == 0) log->onAck(id, seq);
+        slice = std::max(slice, compact(log));
+    }
+
+    printf("%-24s %5d eventos | %5.1f B/evento | %4.2f gravações/evento | flash %5.0f us/evento "
+           "(máx %lld) | addLog %5.0f us, máx %lld (com serial) | fatia máx %lld us | journal %u B\n",
+           title, events, (double)flashStats.fsBytes / events, (double)flashStats.fsWrites / events,
+           writeTime.mean(), (long long)writeTime.max(), addTime.mean(), (long long)addTime.max(),
+           (long long)slice, log->getJournalBytes());
+}
+
+int main() {
+    simtest::run([] {
+        tornEntry();
+        tornAck();
+        interruptedCompaction();
+        loggingDuringCompaction();
+        legacyJournal();
+        capacity();
+
+        printf("\nLimite de compactação %d B, LOG_RING_LOGS %d\n", LOG_JOURNAL_COMPACT_BYTES, LOG_RING_LOGS);
+        bench("Central online (ACK/3)", 3000, 3);
+        bench("Central offline", 3000, 0);
+    });
+}
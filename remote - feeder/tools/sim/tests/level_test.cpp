@@ -0,0 +1,219 @@
+// level_test.cpp - filtro, faixas e publicação do LevelSensor (hardware/level_sensor)
+//
+//   (na pasta "remote - feeder"; ver run.sh)
+//
+// Um reservatório simulado por 7 dias alimenta addSample() a cada
+// LEVEL_SAMPLE_MS: três refeições por dia baixam a ração até LOW e EMPTY e uma
+// recarga no dia 5 volta a OK (passando um minuto por LOW). O HC-SR04 tem ruído gaussiano e 5% de ecos
+// perdidos ou espúrios. As publicações seguem a regra do MQTTService (mudança
+// relevante por takeChange() ou heartbeat de MQTT_DATA_HEARTBEAT_MS).
+// Confere a sequência de faixas sem oscilação, o tempo até perceber cada
+// troca, as mensagens por dia e, à parte, a mediana, a histerese na fronteira
+// e o takeChange().
+#include "sim_test.h"
+#include <Arduino.h>
+#include "hardware/level_sensor.h"
+#include "comm/mqtt_service.h"
+
+#include <math.h>
+
+#include <random>
+#include <vector>
+
+static const uint32_t SAMPLE_MS = LEVEL_SAMPLE_MS;
+static const uint32_t MINUTE_MS = 60000;
+static const uint32_t HOUR_MS = 60 * MINUTE_MS;
+static const uint32_t DAY_MS = 24 * HOUR_MS;
+static const int DAYS = 7;
+
+// Começa em 75% e cada refeição tira 2,5 cm (10 pontos) em 10 s: os níveis
+// entre refeições ficam a 5 pontos das fronteiras (LOW na 7ª refeição, EMPTY
+// na 9ª) e o fundo é a 31 cm. A recarga enche em 30 s
+static const float START_CM = 11.25f;
+static const float MEAL_CM = 2.5f;
+static const float BOTTOM_CM = 31;
+static const uint32_t MEAL_MS = 10000;
+static const uint32_t MEALS_MS[] = { 7 * HOUR_MS + 30 * MINUTE_MS, 12 * HOUR_MS, 19 * HOUR_MS };
+static const uint32_t REFILL_AT_MS = 5 * DAY_MS + 10 * HOUR_MS;
+static const uint32_t REFILL_MS = 30000;
+
+// Distância do sensor à ração no instante t (sem ruído)
+static float hopperCm(uint32_t t) {
+    float cm = START_CM;
+    uint32_t from = 0;
+    if (t >= REFILL_AT_MS) {
+        float done = std::min(1.0f, (t - REFILL_AT_MS) / (float)REFILL_MS);
+        from = REFILL_AT_MS;
+        cm = LEVEL_FULL_CM + (hopperCm(REFILL_AT_MS - 1) - LEVEL_FULL_CM) * (1 - done);
+    }
+    for (uint32_t day = 0; day * DAY_MS <= t; day++) {
+        for (uint32_t meal : MEALS_MS) {
+            uint32_t start = day * DAY_MS + meal;
+            if (start < from || start > t) continue;
+            cm += MEAL_CM * std::min(1.0f, (t - start) / (float)MEAL_MS);
+        }
+    }
+    return std::min(cm, BOTTOM_CM);
+}
+
+// Faixa do nível real (sem ruído e sem histerese), para medir a detecção
+static FeedLevel trueLevel(float cm) {
+    float pct = (LEVEL_EMPTY_CM - cm) * 100.0f / (LEVEL_EMPTY_CM - LEVEL_FULL_CM);
+    if (pct < LEVEL_EMPTY_PCT) return FeedLevel::EMPTY;
+    if (pct < LEVEL_LOW_PCT) return FeedLevel::LOW_FEED;
+    return FeedLevel::OK;
+}
+
+struct Transition {
+    FeedLevel to;
+    uint32_t at;
+    uint32_t detectMs;     // lastDetectMs do sensor
+    uint32_t sinceTrueMs;  // Desde o nível real entrar na faixa
+};
+
+struct Run {
+    std::vector<Transition> transitions;
+    uint32_t published = 0;
+    uint32_t invalid = 0;
+};
+
+static Run runHopper(float noiseCm, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0, noiseCm);
+    std::uniform_real_distribution<float> unit(0, 1);
+
+    LevelSensor sensor;
+    Run run;
+    FeedLevel reality = FeedLevel::OK;
+    uint32_t realitySince = 0;
+    uint32_t lastPublish = 0;
+
+    // 0 é "nenhum instante" para o sensor: começa em um intervalo
+    for (uint32_t t = SAMPLE_MS; t < DAYS * DAY_MS; t += SAMPLE_MS) {
+        float cm = hopperCm(t);
+        if (trueLevel(cm) != reality) {
+            reality = trueLevel(cm);
+            realitySince = t;
+        }
+
+        // 5% de ecos ruins: metade perdida, metade refletida (borda, parede)
+        float r = unit(rng);
+        float measured = cm + noise(rng);
+        if (r < 0.025f) measured = NAN;
+        else if (r < 0.05f) measured = 2 + unit(rng) * 60;
+
+        FeedLevel before = sensor.getLevel();
+        sensor.addSample(measured, t);
+        if (sensor.getLevel() != before && before != FeedLevel::UNKNOWN) {
+            run.transitions.push_back({ sensor.getLevel(), t, sensor.getLastDetectMs(), t - realitySince });
+        }
+
+        if (sensor.takeChange() || t - lastPublish >= MQTT_DATA_HEARTBEAT_MS) {
+            run.published++;
+            lastPublish = t;
+        }
+    }
+    run.invalid = sensor.getInvalidCount();
+    return run;
+}
+
+static void hopper(float noiseCm, uint32_t seed) {
+    Run run = runHopper(noiseCm, seed);
+
+    // OK -> LOW -> EMPTY na descida e EMPTY -> LOW -> OK na recarga (o nível
+    // filtrado sobe no máximo LEVEL_MAX_STEP_CM × LEVEL_EMA_PCT por medição):
+    // uma troca cada, na ordem, sem oscilar
+    static const FeedLevel expected[] = { FeedLevel::LOW_FEED, FeedLevel::EMPTY, FeedLevel::LOW_FEED,
+                                          FeedLevel::OK };
+    CHECK(run.transitions.size() == 4);
+    uint32_t dropDetect = 0;
+    uint32_t dropSinceTrue = 0;
+    uint32_t refillSinceTrue = 0;
+    for (size_t i = 0; i < run.transitions.size() && i < 4; i++) {
+        const Transition& tr = run.transitions[i];
+        CHECK(tr.to == expected[i]);
+        if (i < 2) {
+            dropDetect = std::max(dropDetect, tr.detectMs);
+            dropSinceTrue = std::max(dropSinceTrue, tr.sinceTrueMs);
+        } else {
+            refillSinceTrue = std::max(refillSinceTrue, tr.sinceTrueMs);
+        }
+    }
+
+    double perDay = run.published / (double)DAYS;
+    printf("Ruído %.1f cm: %zu trocas, %.1f mensagens/dia, queda percebida em até %u s (%u s da medição), "
+           "recarga em %u s, %u ecos perdidos\n",
+           noiseCm, run.transitions.size(), perDay, dropSinceTrue / 1000, dropDetect / 1000,
+           refillSinceTrue / 1000, run.invalid);
+
+    // 24 heartbeats/dia mais as mudanças; a cada 5 min seriam 288
+    CHECK(perDay <= 30);
+    CHECK(dropSinceTrue <= 40000);
+    CHECK(refillSinceTrue <= 150000);
+}
+
+static void medianRejectsSpikes() {
+    LevelSensor sensor;
+    uint32_t t = SAMPLE_MS;
+    for (int i = 0; i < 20; i++, t += SAMPLE_MS) sensor.addSample(10, t);
+    CHECK(sensor.getLevel() == FeedLevel::OK && sensor.getPercent() == 80);
+
+    // Dois ecos espúrios seguidos não passam da mediana de 5
+    sensor.addSample(3, t);
+    sensor.addSample(29, t + SAMPLE_MS);
+    CHECK(fabsf(sensor.getDistanceCm() - 10) < 0.01f);
+
+    // Fora do alcance não entra no filtro
+    sensor.addSample(NAN, t + 2 * SAMPLE_MS);
+    sensor.addSample(1, t + 3 * SAMPLE_MS);
+    sensor.addSample(500, t + 4 * SAMPLE_MS);
+    CHECK(sensor.getInvalidCount() == 3);
+    CHECK(fabsf(sensor.getDistanceCm() - 10) < 0.01f);
+}
+
+static void boundaryHysteresis() {
+    // Um dia parado na fronteira de LOW (30% = 22,5 cm) com 1,5 cm de ruído
+    std::mt19937 rng(3);
+    std::normal_distribution<float> noise(0, 1.5f);
+    LevelSensor sensor;
+    float boundary = LEVEL_EMPTY_CM - (LEVEL_EMPTY_CM - LEVEL_FULL_CM) * LEVEL_LOW_PCT / 100.0f;
+
+    int changes = 0;
+    FeedLevel last = FeedLevel::UNKNOWN;
+    for (uint32_t t = SAMPLE_MS; t < DAY_MS; t += SAMPLE_MS) {
+        sensor.addSample(boundary + noise(rng), t);
+        if (sensor.getLevel() != last && last != FeedLevel::UNKNOWN) changes++;
+        last = sensor.getLevel();
+    }
+    printf("Fronteira de LOW por 24 h: %d trocas\n", changes);
+    CHECK(changes <= 1);
+}
+
+static void takeChangeOnce() {
+    LevelSensor sensor;
+    uint32_t t = SAMPLE_MS;
+    CHECK(!sensor.takeChange());
+
+    // Primeira medição: faixa conhecida, uma publicação
+    sensor.addSample(10, t);
+    CHECK(sensor.takeChange());
+    CHECK(!sensor.takeChange());
+
+    // Menos de LEVEL_REPORT_STEP_PCT: nada; depois do passo, uma vez
+    for (int i = 0; i < 60; i++) sensor.addSample(11, t += SAMPLE_MS);
+    CHECK(sensor.getPercent() == 76 && !sensor.takeChange());
+    for (int i = 0; i < 60; i++) sensor.addSample(13, t += SAMPLE_MS);
+    CHECK(sensor.takeChange());
+    CHECK(!sensor.takeChange());
+    CHECK(sensor.getLevel() == FeedLevel::OK);
+}
+
+int main() {
+    simtest::run([] {
+        medianRejectsSpikes();
+        boundaryHysteresis();
+        takeChangeOnce();
+        hopper(0.6f, 1);
+        hopper(1.5f, 2);
+    });
+}
@@ -0,0 +1,394 @@
+// ota_test.cpp - patches inválidos e passos do OtaService (core/delta_patch)
+//
+//   (na pasta "remote - feeder"; ver run.sh)
+//
+// Primeiro o DeltaPatch sozinho, com base e saída em memória: patch válido
+// em pedaços, base conferida em fatias e cada tipo de patch ruim (cabeçalho,
+// operação, corte em qualquer byte, base errada, SHA-256 da imagem errado).
+// Depois o OtaService inteiro sobre a partição e o servidor HTTP simulados:
+// start() volta na hora, nenhum passo passa do orçamento, patch ruim aborta
+// a gravação sem trocar a partição de boot e o bom troca.
+#include "sim_test.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_ota_ops.h>
+#include "core/delta_patch.h"
+#include "core/task_scheduler.h"
+#include "services/ota_service.h"
+
+#include <string.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace sim;
+
+typedef std::vector<uint8_t> Bytes;
+typedef DeltaPatch::Result Result;
+
+static const size_t BASE_SIZE = 1 << 20;
+
+// ========== GERADOR DE PATCHES ==========
+
+static void put32(Bytes& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out.push_back((uint8_t)(value >> (i * 8)));
+}
+
+static void putVarint(Bytes& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+static Bytes sha256(const Bytes& data) {
+    Bytes hash(DeltaPatch::HASH_SIZE);
+    DeltaPatch::Sha256 sha;
+    sha.update(data.data(), data.size());
+    sha.finish(hash.data());
+    return hash;
+}
+
+static Bytes header(const Bytes& base, const Bytes& target) {
+    Bytes out = { 'F', 'D', 'P', '1' };
+    put32(out, base.size());
+    put32(out, target.size());
+    Bytes baseHash = base.empty() ? Bytes(DeltaPatch::HASH_SIZE) : sha256(base);
+    Bytes targetHash = sha256(target);
+    out.insert(out.end(), baseHash.begin(), baseHash.end());
+    out.insert(out.end(), targetHash.begin(), targetHash.end());
+    return out;
+}
+
+// Uma COPY da base inteira (iguais + deltas onde mudou) e um INSERT com o
+// que a imagem nova tem a mais. Basta para imagens que só trocam bytes, e
+// os trechos iguais longos (64 KB num varint) exercitam o resume()
+static Bytes makePatch(const Bytes& base, const Bytes& target) {
+    Bytes out = header(base, target);
+    size_t common = std::min(base.size(), target.size());
+
+    if (common > 0) {
+        out.push_back((uint8_t)DeltaPatch::OP_COPY);
+        putVarint(out, 0);
+        putVarint(out, common);
+    }
+    for (size_t pos = 0; pos < common;) {
+        size_t same = pos;
+        while (same < common && base[same] == target[same]) same++;
+        size_t diff = same;
+        while (diff < common && base[diff] != target[diff]) diff++;
+
+        putVarint(out, same - pos);
+        putVarint(out, diff - same);
+        for (size_t i = same; i < diff; i++) out.push_back((uint8_t)(target[i] - base[i]));
+        pos = diff;
+    }
+
+    if (target.size() > common) {
+        out.push_back((uint8_t)DeltaPatch::OP_INSERT);
+        putVarint(out, target.size() - common);
+        out.insert(out.end(), target.begin() + common, target.end());
+    }
+    return out;
+}
+
+static Bytes baseImage() {
+    std::mt19937 rng(7);
+    Bytes image(BASE_SIZE);
+    for (uint8_t& b : image) b = (uint8_t)rng();
+    return image;
+}
+
+// Base com alguns bytes trocados (um ponteiro mudou) e 2 KB de código novo
+static Bytes newImage(const Bytes& base) {
+    Bytes image = base;
+    for (size_t pos = 4096; pos < image.size(); pos += 65536) image[pos] ^= 0x5A;
+    for (int i = 0; i < 2048; i++) image.push_back((uint8_t)(i * 7));
+    return image;
+}
+
+// ========== DELTAPATCH EM MEMÓRIA ==========
+
+struct Memory {
+    const Bytes* base;
+    Bytes out;
+    uint32_t reads = 0;
+
+    static bool read(void* ctx, uint32_t offset, uint8_t* buf, size_t len) {
+        Memory* m = static_cast<Memory*>(ctx);
+        if (offset > m->base->size() || len > m->base->size() - offset) return false;
+        memcpy(buf, m->base->data() + offset, len);
+        m->reads++;
+        return true;
+    }
+    static bool write(void* ctx, const uint8_t* data, size_t len) {
+        Memory* m = static_cast<Memory*>(ctx);
+        m->out.insert(m->out.end(), data, data + len);
+        return true;
+    }
+};
+
+// Aplica em pedaços de 512 B, como o download; finish() no fim
+static Result applyPatch(const Bytes& base, const Bytes& patch, Bytes* out = nullptr) {
+    Memory mem = { &base, {} };
+    DeltaPatch delta(Memory::read, Memory::write, &mem);
+    Result result = Result::OK;
+    for (size_t pos = 0; pos < patch.size() && result == Result::OK; pos += 512) {
+        result = delta.write(patch.data() + pos, std::min<size_t>(512, patch.size() - pos));
+    }
+    if (result == Result::OK) result = delta.finish();
+    if (out) *out = mem.out;
+    return result;
+}
+
+static void validPatch(const Bytes& base, const Bytes& target, const Bytes& patch) {
+    Bytes out;
+    CHECK(applyPatch(base, patch, &out) == Result::DONE);
+    CHECK(out == target);
+
+    // Imagem completa (sem base) também
+    CHECK(applyPatch(Bytes(), makePatch(Bytes(), target), &out) == Result::DONE);
+    CHECK(out == target);
+}
+
+static void slicedSource(const Bytes& base, const Bytes& target, const Bytes& patch) {
+    // write() com `used` para depois do cabeçalho: a base fica pendente e
+    // cada fatia lê no máximo maxBytes
+    Memory mem = { &base, {} };
+    DeltaPatch delta(Memory::read, Memory::write, &mem);
+    size_t used = 0;
+    CHECK(delta.write(patch.data(), patch.size(), &used) == Result::OK);
+    CHECK(used == DeltaPatch::HEADER_SIZE && delta.pending());
+    CHECK(mem.reads == 0);
+
+    int slices = 0;
+    while (delta.pending()) {
+        uint32_t before = delta.getSourceVerified();
+        CHECK(delta.resume(4096) == Result::OK);
+        CHECK(delta.getSourceVerified() - before <= 4096);
+        slices++;
+    }
+    CHECK(slices == (int)(BASE_SIZE / 4096));
+    CHECK(delta.getSourceVerified() == BASE_SIZE && mem.out.empty());
+
+    // Resto: nenhuma chamada grava mais que o pedaço do write() (deltas e
+    // literais, 1 B por byte do patch) ou a fatia do resume()
+    size_t pos = used;
+    Result result = Result::OK;
+    size_t worst = 0;
+    while (result == Result::OK && (pos < patch.size() || delta.pending())) {
+        size_t before = delta.getWritten();
+        if (delta.pending()) {
+            result = delta.resume(4096);
+        } else {
+            size_t n = std::min<size_t>(512, patch.size() - pos);
+            result = delta.write(patch.data() + pos, n, &used);
+            pos += used;
+        }
+        worst = std::max<size_t>(worst, delta.getWritten() - before);
+    }
+    CHECK(result == Result::DONE && mem.out == target);
+    CHECK(worst <= 4096);
+}
+
+// ========== PATCHES RUINS ==========
+
+static void badHeader(const Bytes& base, const Bytes& patch) {
+    Bytes bad = patch;
+    bad[0] = 'X';
+    CHECK(applyPatch(base, bad) == Result::BAD_HEADER);
+
+    // Imagem nova de tamanho zero
+    bad = patch;
+    memset(bad.data() + 8, 0, 4);
+    CHECK(applyPatch(base, bad) == Result::BAD_HEADER);
+}
+
+static void corruptOps(const Bytes& base, const Bytes& patch) {
+    const size_t ops = DeltaPatch::HEADER_SIZE;
+    Bytes out;
+
+    // Operação desconhecida
+    Bytes bad = patch;
+    bad[ops] = 0x07;
+    CHECK(applyPatch(base, bad, &out) == Result::CORRUPT && out.empty());
+
+    // COPY além do fim da base
+    bad = Bytes(patch.begin(), patch.begin() + ops);
+    bad.push_back((uint8_t)DeltaPatch::OP_COPY);
+    putVarint(bad, 0);
+    putVarint(bad, BASE_SIZE + 1);
+    CHECK(applyPatch(base, bad, &out) == Result::CORRUPT && out.empty());
+
+    // Deslocamento para antes do começo da base
+    bad = Bytes(patch.begin(), patch.begin() + ops);
+    bad.push_back((uint8_t)DeltaPatch::OP_COPY);
+    putVarint(bad, 1);     // zigzag: -1
+    putVarint(bad, 16);
+    CHECK(applyPatch(base, bad) == Result::CORRUPT);
+
+    // Varint com mais de 32 bits
+    bad = Bytes(patch.begin(), patch.begin() + ops);
+    bad.push_back((uint8_t)DeltaPatch::OP_INSERT);
+    bad.insert(bad.end(), { 0xFF, 0xFF, 0xFF, 0xFF, 0x7F });
+    CHECK(applyPatch(base, bad) == Result::CORRUPT);
+
+    // Bytes além do fim da imagem
+    bad = patch;
+    bad.push_back((uint8_t)DeltaPatch::OP_INSERT);
+    CHECK(applyPatch(base, bad) == Result::CORRUPT);
+}
+
+static void truncated(const Bytes& base, const Bytes& patch) {
+    // Corte em cada byte do começo e do fim e em pontos espalhados no meio:
+    // nunca DONE e nunca a imagem inteira na saída
+    std::vector<size_t> cuts;
+    for (size_t cut = 0; cut < 200; cut++) cuts.push_back(cut);
+    for (size_t cut = patch.size() - 200; cut < patch.size(); cut++) cuts.push_back(cut);
+    for (size_t cut = 200; cut < patch.size() - 200; cut += 997) cuts.push_back(cut);
+
+    int bad = 0;
+    for (size_t cut : cuts) {
+        Bytes out;
+        Result result = applyPatch(base, Bytes(patch.begin(), patch.begin() + cut), &out);
+        if (result != Result::TRUNCATED || out.size() >= BASE_SIZE + 2048) bad++;
+    }
+    CHECK(bad == 0);
+}
+
+static void wrongSource(const Bytes& base, const Bytes& patch) {
+    // Um bit a menos na base: recusado antes de escrever qualquer byte
+    Bytes other = base;
+    other[BASE_SIZE / 2] ^= 0x01;
+    Bytes out;
+    CHECK(applyPatch(other, patch, &out) == Result::WRONG_SOURCE);
+    CHECK(out.empty());
+
+    // Base de outro tamanho
+    other.resize(BASE_SIZE - 1);
+    CHECK(applyPatch(other, patch, &out) == Result::READ_ERROR && out.empty());
+}
+
+static void hashMismatch(const Bytes& base, const Bytes& target, const Bytes& patch) {
+    // Operações coerentes, SHA-256 da imagem nova errado no cabeçalho
+    Bytes bad = patch;
+    bad[44] ^= 0xFF;
+    CHECK(applyPatch(base, bad) == Result::HASH_MISMATCH);
+
+    // Um delta trocado no meio: a imagem sai inteira, mas não confere
+    Bytes wrong = target;
+    wrong[4096] ^= 0x01;
+    bad = makePatch(base, wrong);
+    memcpy(bad.data() + 44, patch.data() + 44, DeltaPatch::HASH_SIZE);
+    CHECK(applyPatch(base, bad) == Result::HASH_MISMATCH);
+}
+
+// ========== OTASERVICE ==========
+
+static std::string hex(const Bytes& data) {
+    static const char DIGITS[] = "0123456789abcdef";
+    std::string out;
+    for (uint8_t b : data) {
+        out += DIGITS[b >> 4];
+        out += DIGITS[b & 0x0F];
+    }
+    return out;
+}
+
+// Orçamento mais uma fatia (a última começa antes de ele vencer). O start()
+// também: o GET sozinho levaria mais de 1,2 s (TLS)
+static const Us STEP_LIMIT = (OTA_STEP_BUDGET_MS + 8) * MS;
+
+struct Run {
+    bool started;
+    bool switched;
+    Us startUs;         // Duração do start()
+    Us worstStepUs;     // Maior execução do loop()
+    Us totalUs;
+};
+
+// Comando OTA e o loop da tarefa até o fim (ou até a imagem ser ativada:
+// REBOOT_PENDING reiniciaria o chip)
+static Run update(const std::string& url, const Bytes& target) {
+    Run run = {};
+    otaStats = OtaStats();
+
+    Us t0 = now();
+    run.started = otaService.start(url.c_str(), hex(sha256(target)).c_str());
+    run.startUs = now() - t0;
+
+    while (run.started && otaService.isBusy() && otaStats.bootSwitches == 0 && now() - t0 < 10 * MINUTE) {
+        Us before = now();
+        uint32_t next = otaService.loop();
+        run.worstStepUs = std::max(run.worstStepUs, now() - before);
+        delay(next == TaskScheduler::IDLE ? 10 : next);
+    }
+    run.switched = otaStats.bootSwitches > 0;
+    run.totalUs = now() - t0;
+    return run;
+}
+
+static void service(const Bytes& base, const Bytes& target, const Bytes& patch) {
+    WiFi.begin("ssid", "senha");
+    while (!WiFi.isConnected()) delay(100);
+
+    setRunningImage(base);
+    otaService.begin(nullptr);
+    CHECK(strcmp(otaService.getRunningHash(), hex(sha256(base)).c_str()) == 0);
+
+    Bytes bad = patch;
+    bad[DeltaPatch::HEADER_SIZE] = 0x07;
+    servePatch("http://ota/corrupt.fdp", bad);
+    servePatch("http://ota/truncated.fdp", Bytes(patch.begin(), patch.end() - 1000));
+    bad = patch;
+    bad[40] ^= 0x01;        // SHA-256 da base
+    servePatch("http://ota/wrong_source.fdp", bad);
+    Bytes wrong = target;
+    wrong[4096] ^= 0x01;
+    bad = makePatch(base, wrong);
+    memcpy(bad.data() + 44, patch.data() + 44, DeltaPatch::HASH_SIZE);
+    servePatch("http://ota/mismatch.fdp", bad);
+    servePatch("http://ota/good.fdp", patch);
+
+    // Cada patch ruim: a gravação (se começou) é abortada e o boot não muda
+    const char* rejected[] = { "corrupt", "truncated", "wrong_source", "mismatch", "missing" };
+    for (const char* name : rejected) {
+        Run run = update(std::string("http://ota/") + name + ".fdp", target);
+        CHECK(run.started && !run.switched && !otaService.isBusy());
+        CHECK(otaStats.begins == otaStats.aborts && otaStats.ends == 0);
+        CHECK(run.startUs <= STEP_LIMIT && run.worstStepUs <= STEP_LIMIT);
+        printf("%-13s rejeitado em %5lld ms | %7u B gravados | start() %lld us | maior passo %4.1f ms\n", name,
+               (long long)(run.totalUs / MS), (unsigned)otaStats.image.size(), (long long)run.startUs, run.worstStepUs / 1000.0);
+    }
+
+    // SHA-256 do comando diferente do cabeçalho: recusa no cabeçalho, nada gravado
+    Run run = update("http://ota/good.fdp", wrong);
+    CHECK(!run.switched && otaStats.begins == 0);
+
+    // Patch bom: imagem idêntica e partição de boot trocada
+    run = update("http://ota/good.fdp", target);
+    CHECK(run.switched && otaStats.ends == 1 && otaStats.aborts == 0);
+    CHECK(otaStats.image == target);
+    CHECK(run.startUs <= STEP_LIMIT && run.worstStepUs <= STEP_LIMIT);
+    printf("%-13s aplicado em  %5lld ms | start() %lld us | maior passo %.1f ms\n", "good",
+           (long long)(run.totalUs / MS), (long long)run.startUs, run.worstStepUs / 1000.0);
+}
+
+int main() {
+    simtest::run([] {
+        Bytes base = baseImage();
+        Bytes target = newImage(base);
+        Bytes patch = makePatch(base, target);
+
+        validPatch(base, target, patch);
+        slicedSource(base, target, patch);
+        badHeader(base, patch);
+        corruptOps(base, patch);
+        truncated(base, patch);
+        wrongSource(base, patch);
+        hashMismatch(base, target, patch);
+        service(base, target, patch);
+    });
+}
@@ -0,0 +1,33 @@
+#!/bin/sh
+# Compila e roda os testes de host de tools/sim/tests
+#
+#   tools/sim/tests/run.sh [nome_test ...]     (sem nomes: todos)
+#
+# Precisa do config.h em include/ e do ArduinoJson que o PlatformIO baixa
+# (ARDUINOJSON aponta outro src/; CXXFLAGS soma flags). Objetos em .pio/simtest.
+# Sai com 1 se algum teste falhou.
+set -e
+cd "$(dirname "$0")/../../.."
+
+AJ=${ARDUINOJSON:-.pio/libdeps/esp32dev/ArduinoJson/src}
+FLAGS="-O2 -std=gnu++17 -Wall -Wextra -Itools/sim/shim -Iinclude -I$AJ $CXXFLAGS"
+OUT=.pio/simtest
+mkdir -p "$OUT"
+
+# Firmware e modelos uma vez; cada teste é só o seu main
+for src in src/*.cpp src/*/*.cpp tools/sim/sim_*.cpp; do
+    g++ $FLAGS -c "$src" -o "$OUT/$(basename "$src" .cpp).o"
+done
+
+tests=${*:-$(cd tools/sim/tests && ls *_test.cpp | sed 's/\.cpp$//')}
+failed=""
+for name in $tests; do
+    g++ $FLAGS tools/sim/tests/$name.cpp "$OUT"/*.o -o "$OUT/$name"
+    echo "== $name"
+    "$OUT/$name" || failed="$failed $name"
+done
+
+if [ -n "$failed" ]; then
+    echo "Falharam:$failed"
+    exit 1
+fi
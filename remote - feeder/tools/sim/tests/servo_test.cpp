@@ -0,0 +1,244 @@
+// servo_test.cpp - rampa do ServoMotion sobre uma saída PWM falsa
+//
+//   (na pasta "remote - feeder"; ver run.sh)
+//
+// Um PwmOutput falso no lugar do LEDC guarda cada pulso escrito. Os casos
+// chamam tick() com instantes escolhidos e comparam a sequência com
+// profilePosition(): forma da rampa, pontas exatas e nenhum pulso fora do
+// percurso quando o movimento é parado ou substituído no meio. O último caso
+// deixa o esp_timer simulado gerar os passos.
+#include "sim_test.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "hardware/servo_motion.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+typedef ServoMotion::Profile Profile;
+
+static const int64_t TICK = SERVO_MOTION_TICK_US;
+
+class FakePwm : public PwmOutput {
+public:
+    std::vector<uint16_t> pulses;
+    std::vector<int64_t> times;
+
+    bool begin(uint8_t) override { return true; }
+    void writeMicros(uint16_t us) override {
+        pulses.push_back(us);
+        times.push_back(esp_timer_get_time());
+    }
+};
+
+// Pulso esperado no instante s (0..1), com o mesmo arredondamento do tick()
+static uint16_t expected(uint16_t from, uint16_t to, Profile p, float s) {
+    float travel = (float)((int)to - (int)from) * ServoMotion::profilePosition(p, s);
+    return (uint16_t)((int)from + (int)lroundf(travel));
+}
+
+static bool within(uint16_t us, uint16_t a, uint16_t b) {
+    return us >= std::min(a, b) && us <= std::max(a, b);
+}
+
+// ========== PERFIL ==========
+
+static void profileShape() {
+    const Profile profiles[] = { Profile::TRAPEZOID, Profile::S_CURVE };
+    for (Profile p : profiles) {
+        CHECK(ServoMotion::profilePosition(p, -0.5f) == 0.0f);
+        CHECK(ServoMotion::profilePosition(p, 0.0f) == 0.0f);
+        CHECK(ServoMotion::profilePosition(p, 1.0f) == 1.0f);
+        CHECK(ServoMotion::profilePosition(p, 1.5f) == 1.0f);
+        CHECK(fabsf(ServoMotion::profilePosition(p, 0.5f) - 0.5f) < 1e-6f);
+
+        // Monótono (a menos do arredondamento do float), simétrico e sem
+        // saltos (passo de 1/1000 da duração)
+        float last = 0.0f;
+        for (int i = 1; i <= 1000; i++) {
+            float s = i / 1000.0f;
+            float x = ServoMotion::profilePosition(p, s);
+            CHECK(x >= last - 1e-6f && x - last < 0.003f);
+            CHECK(fabsf(x + ServoMotion::profilePosition(p, 1.0f - s) - 1.0f) < 1e-5f);
+            last = x;
+        }
+    }
+
+    // Curva S sai e chega com velocidade nula; o trapézio acelera no
+    // primeiro trecho e cruza a 1/(1-a) no meio
+    CHECK(ServoMotion::profilePosition(Profile::S_CURVE, 0.01f) < 1e-4f);
+    const float a = SERVO_TRAPEZOID_ACCEL_PCT / 100.0f;
+    float cruise = (ServoMotion::profilePosition(Profile::TRAPEZOID, 0.55f) -
+                    ServoMotion::profilePosition(Profile::TRAPEZOID, 0.45f)) / 0.1f;
+    CHECK(fabsf(cruise - 1.0f / (1.0f - a)) < 1e-3f);
+    CHECK(ServoMotion::profilePosition(Profile::TRAPEZOID, a / 2) < 0.25f * a);
+}
+
+static void ledcDuty() {
+    // 16 bits em 20 ms: 500 e 2500 µs nas pontas, 1 µs ~ 3,3 passos
+    CHECK(LedcPwm::dutyForMicros(500) == 1638);
+    CHECK(LedcPwm::dutyForMicros(1500) == 4915);
+    CHECK(LedcPwm::dutyForMicros(2500) == 8192);
+    for (uint16_t us = 501; us <= 2500; us++) {
+        CHECK(LedcPwm::dutyForMicros(us) > LedcPwm::dutyForMicros(us - 1));
+    }
+}
+
+// ========== RAMPA ==========
+
+// Percorre from -> to em durationMs chamando tick() a cada quadro do PWM
+static void ramp(Profile p, uint16_t from, uint16_t to, uint32_t durationMs) {
+    FakePwm pwm;
+    ServoMotion servo;
+    CHECK(servo.begin(&pwm, 5, from));
+    CHECK(pwm.pulses.size() == 1 && pwm.pulses[0] == from);
+
+    int64_t t0 = esp_timer_get_time();
+    CHECK(servo.moveToMicros(to, durationMs, nullptr, p));
+    pwm.pulses.clear();
+
+    int64_t duration = durationMs * 1000LL;
+    for (int64_t t = 0; t <= duration + TICK; t += TICK) {
+        servo.tick(t0 + t);
+        if (t > duration) continue;
+        CHECK(pwm.pulses.back() == expected(from, to, p, (float)t / duration));
+    }
+
+    // Começa no ponto de partida, termina exatamente no alvo e para de
+    // escrever; nunca volta nem passa do alvo
+    CHECK(pwm.pulses.front() == from);
+    CHECK(pwm.pulses.back() == to);
+    CHECK(pwm.pulses.size() == (size_t)(duration / TICK + 1));
+    CHECK(!servo.isMoving() && servo.getMicros() == to);
+    for (size_t i = 1; i < pwm.pulses.size(); i++) {
+        CHECK(within(pwm.pulses[i], from, to));
+        CHECK(to > from ? pwm.pulses[i] >= pwm.pulses[i - 1] : pwm.pulses[i] <= pwm.pulses[i - 1]);
+    }
+
+    // Primeiro e último quadros andam pouco: a rampa não sai em degrau
+    uint16_t travel = to > from ? to - from : from - to;
+    uint16_t firstStep = abs((int)pwm.pulses[1] - (int)from);
+    uint16_t lastStep = abs((int)to - (int)pwm.pulses[pwm.pulses.size() - 2]);
+    CHECK(firstStep * 10 < travel && lastStep * 10 < travel);
+}
+
+static void ramps() {
+    ramp(Profile::S_CURVE, 1000, 2000, 500);
+    ramp(Profile::S_CURVE, 2400, 600, 1000);
+    ramp(Profile::TRAPEZOID, 1500, 2500, 400);
+    ramp(Profile::TRAPEZOID, 1500, 700, 800);
+
+    // Alvo fora da faixa é limitado a 500..2500 µs
+    FakePwm pwm;
+    ServoMotion servo;
+    servo.begin(&pwm, 5, 1500);
+    servo.moveToMicros(3000, 0);
+    CHECK(pwm.pulses.back() == 2500 && !servo.isMoving());
+    servo.moveTo(-10, 0);
+    CHECK(pwm.pulses.back() == 500);
+}
+
+// ========== INTERRUPÇÃO ==========
+
+static void abortMidMove() {
+    // stop(): fica no último pulso e os ticks seguintes não escrevem nada
+    FakePwm pwm;
+    ServoMotion servo;
+    servo.begin(&pwm, 5, 1000);
+    int64_t t0 = esp_timer_get_time();
+    servo.moveToMicros(2000, 500, nullptr, Profile::S_CURVE);
+    for (int k = 0; k <= 10; k++) servo.tick(t0 + k * TICK);
+    uint16_t held = pwm.pulses.back();
+    size_t writes = pwm.pulses.size();
+    CHECK(held > 1000 && held < 2000);
+
+    servo.stop();
+    for (int k = 11; k <= 40; k++) servo.tick(t0 + k * TICK);
+    CHECK(pwm.pulses.size() == writes);
+    CHECK(servo.getMicros() == held && !servo.isMoving());
+
+    // Novo alvo no meio do caminho: parte do pulso atual, sem degrau, e
+    // fica entre ele e o novo alvo (não termina a subida antes de voltar).
+    // O relógio simulado não andou: o movimento novo também parte de t0
+    int64_t t1 = esp_timer_get_time();
+    servo.moveToMicros(800, 300, nullptr, Profile::TRAPEZOID);
+    pwm.pulses.clear();
+    for (int64_t t = 0; t <= 300000; t += TICK) {
+        servo.tick(t1 + t);
+        CHECK(pwm.pulses.back() == expected(held, 800, Profile::TRAPEZOID, t / 300000.0f));
+        CHECK(within(pwm.pulses.back(), held, 800));
+    }
+    CHECK(pwm.pulses.front() == held && pwm.pulses.back() == 800);
+
+    // Parada de emergência: salta direto, cancela a rampa e o callback
+    bool called = false;
+    int64_t t2 = esp_timer_get_time();
+    servo.moveToMicros(2200, 500, [&called]() { called = true; }, Profile::S_CURVE);
+    servo.tick(t2 + 5 * TICK);
+    servo.jumpToMicros(1500);
+    CHECK(pwm.pulses.back() == 1500);
+    writes = pwm.pulses.size();
+    servo.tick(t2 + 30 * TICK);
+    servo.update();
+    CHECK(pwm.pulses.size() == writes && !called);
+}
+
+// ========== TIMER ==========
+
+static void timerDriven() {
+    FakePwm pwm;
+    ServoMotion servo;
+    servo.begin(&pwm, 5, 1000);
+
+    int wakes = 0, done = 0;
+    servo.setWakeup([](void* arg) { (*(int*)arg)++; }, &wakes);
+
+    int64_t t0 = esp_timer_get_time();
+    pwm.pulses.clear();
+    pwm.times.clear();
+    servo.moveToMicros(2000, 600, [&done]() { done++; }, Profile::S_CURVE);
+    delay(700);
+
+    // Um pulso por quadro, cada um no valor do perfil para o seu instante;
+    // o callback só sai no update() (loop), depois do wakeup do timer
+    CHECK(pwm.pulses.size() == 600000 / TICK);
+    for (size_t i = 0; i < pwm.pulses.size(); i++) {
+        int64_t t = pwm.times[i] - t0;
+        CHECK(i == 0 || pwm.times[i] - pwm.times[i - 1] == TICK);
+        float s = std::min(1.0f, (float)t / 600000);
+        CHECK(pwm.pulses[i] == expected(1000, 2000, Profile::S_CURVE, s));
+    }
+    CHECK(pwm.pulses.back() == 2000);
+    CHECK(wakes == 1 && done == 0);
+    servo.update();
+    CHECK(done == 1);
+    servo.update();
+    CHECK(done == 1);
+
+    // Sequência: cada passo parte de onde o anterior parou
+    static const ServoMotion::Step steps[] = { { 1800, 200, 100 }, { 1200, 200, 0 } };
+    bool finished = false;
+    pwm.pulses.clear();
+    servo.runSequence(steps, 2, [&finished]() { finished = true; });
+    for (int i = 0; i < 50 && !finished; i++) {
+        delay(20);
+        servo.update();
+    }
+    CHECK(finished && servo.getMicros() == 1200);
+    CHECK(std::find(pwm.pulses.begin(), pwm.pulses.end(), 1800) != pwm.pulses.end());
+    for (size_t i = 1; i < pwm.pulses.size(); i++) {
+        CHECK(pwm.pulses[i] <= pwm.pulses[i - 1] && pwm.pulses[i] >= 1200);
+    }
+}
+
+int main() {
+    simtest::run([] {
+        profileShape();
+        ledcDuty();
+        ramps();
+        abortMidMove();
+        timerDriven();
+    });
+}
@@ -0,0 +1,48 @@
+// sim_test.h - base dos testes de host (tools/sim/tests)
+//
+// Cada teste é um programa próprio, ligado ao firmware (src/) e aos modelos
+// de tools/sim como o feeder_sim. O corpo roda como a loopTask do chip
+// simulado, então micros(), busy() e o LittleFS avançam o relógio virtual.
+// Sai com código 1 se algum CHECK falhou.
+#ifndef SIM_TEST_H
+#define SIM_TEST_H
+
+#include "../sim_world.h"
+#include <stdio.h>
+#include <unistd.h>
+
+namespace simtest {
+
+inline int failures = 0;
+inline void (*body)() = nullptr;
+
+inline void check(bool ok, const char* expr, const char* file, int line) {
+    if (ok) return;
+    failures++;
+    fprintf(stderr, "%s:%d: falhou: %s\n", file, line, expr);
+}
+
+inline void entry(void*) {
+    body();
+    sim::sleepFor(sim::NEVER);  // Tarefa do FreeRTOS não retorna
+}
+
+// Roda o teste no chip simulado e encerra o processo. Sem destrutores
+// estáticos, como no feeder_sim
+[[noreturn]] inline void run(void (*test)()) {
+    body = test;
+    sim::setFirmware(entry);
+    sim::powerOn();
+    sim::run(365 * sim::DAY);
+
+    printf("%s\n", failures ? "FALHOU" : "OK");
+    fflush(stdout);
+    fflush(stderr);
+    _exit(failures ? 1 : 0);
+}
+
+}
+
+#define CHECK(cond) simtest::check((cond), #cond, __FILE__, __LINE__)
+
+#endif
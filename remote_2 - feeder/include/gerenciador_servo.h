@@ -2,7 +2,11 @@
 #define SERVO_CONTROL_H
 
 #include <Arduino.h>
-#include <ESP32Servo.h>
+#include "servo_motion.h"
+
+// Rampas (ms): movimento posicional e troca de velocidade na rotação
+#define SERVO_TEMPO_MOVIMENTO_MS 400
+#define SERVO_RAMPA_VELOCIDADE_MS 150
 
 class ServoControl
 {
@@ -15,14 +19,18 @@ public:
     void girarHorario(int velocidade = 100);        // versão silenciosa
     void moverPara90AntiHorario();                  // volta para neutro 90
     void parar();
-    void pararImediato();                           // para sem delay
+    void pararImediato();                           // para sem rampa
     void testar();
     bool estaAtivo();
+    bool estaMovendo();
     void moverParaAngulo(int angulo);               // Move para ângulo específico (0-180°)
     void alimentar(int porcao);                     
+    void atualizar();                               // Chamar no loop(): conclui os movimentos
 
 private:
-    Servo servo;
+    LedcPwm pwm;
+    ServoMotion movimento;
+    ServoMotion::Step passosAlimentar[2];           // Depende da porção (ver alimentar())
     int pinoServo;
     bool ativo;
     int pwmParaVelocidade(int percentual, bool horario);
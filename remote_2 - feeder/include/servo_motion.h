@@ -0,0 +1,119 @@
+#ifndef SERVO_MOTION_H
+#define SERVO_MOTION_H
+
+#include <Arduino.h>
+#include <functional>
+#include <esp_timer.h>
+
+// Canal LEDC reservado ao servo
+#ifndef SERVO_LEDC_CHANNEL
+#define SERVO_LEDC_CHANNEL 0
+#endif
+
+// Passo da rampa: um quadro do PWM de 50 Hz (atualizar mais rápido não muda o pulso)
+#ifndef SERVO_MOTION_TICK_US
+#define SERVO_MOTION_TICK_US 20000
+#endif
+
+// Perfil trapezoidal: % da duração acelerando (e o mesmo desacelerando)
+#ifndef SERVO_TRAPEZOID_ACCEL_PCT
+#define SERVO_TRAPEZOID_ACCEL_PCT 25
+#endif
+
+// Saída PWM do servo: LEDC no ESP32, substituível por uma falsa no host
+class PwmOutput {
+public:
+    virtual ~PwmOutput() {}
+    virtual bool begin(uint8_t pin) = 0;
+    virtual void writeMicros(uint16_t us) = 0;
+};
+
+// LEDC a 50 Hz e 16 bits (~0,3 µs de resolução no pulso)
+class LedcPwm : public PwmOutput {
+public:
+    explicit LedcPwm(uint8_t channel = SERVO_LEDC_CHANNEL);
+    bool begin(uint8_t pin) override;
+    void writeMicros(uint16_t us) override;
+
+    static uint32_t dutyForMicros(uint16_t us);
+
+private:
+    uint8_t channel;
+};
+
+// Movimentos do servo com rampa (trapezoidal ou curva S), gerados por um
+// esp_timer: moveTo() retorna na hora e o loop continua livre. O callback de
+// conclusão é entregue por update() no loop, não no contexto do timer.
+// Um novo movimento parte da posição atual e substitui o anterior (o
+// callback do anterior não é chamado).
+class ServoMotion {
+public:
+    enum class Profile : uint8_t {
+        TRAPEZOID,  // Aceleração constante, velocidade de cruzeiro, desaceleração
+        S_CURVE     // Mínimo jerk: sem degraus de aceleração nas pontas
+    };
+
+    typedef std::function<void()> DoneCallback;
+
+    // Passo de uma sequência: vai até micros em rampMs e fica holdMs parado
+    struct Step {
+        uint16_t micros;
+        uint16_t rampMs;
+        uint16_t holdMs;
+    };
+
+    ServoMotion();
+
+    bool begin(PwmOutput* output, uint8_t pin, uint16_t initialMicros = 1500);
+
+    bool moveTo(int angle, uint32_t durationMs, DoneCallback onDone = nullptr,
+                Profile profile = Profile::S_CURVE);
+    bool moveToMicros(uint16_t us, uint32_t durationMs, DoneCallback onDone = nullptr,
+                      Profile profile = Profile::S_CURVE);
+
+    // Executa os passos em ordem (o array precisa continuar válido até o fim)
+    bool runSequence(const Step* steps, uint8_t count, DoneCallback onDone = nullptr);
+
+    void stop();                        // Fica onde está, sem callback
+    void jumpToMicros(uint16_t us);     // Sem rampa (parada de emergência)
+
+    void update();                      // No loop(): entrega o callback de conclusão
+    void tick(int64_t nowUs);           // Um passo da rampa (timer; público para simulação)
+
+    bool isMoving() const { return moving; }
+    uint16_t getMicros() const { return currentUs; }
+
+    // 0–180° -> 500–2500 µs
+    static constexpr uint16_t angleToMicros(int angle) {
+        return (uint16_t)(500 + (angle < 0 ? 0 : angle > 180 ? 180 : angle) * 2000 / 180);
+    }
+
+    // Fração do percurso (0..1) no instante s (0..1) da duração
+    static float profilePosition(Profile profile, float s);
+
+private:
+    PwmOutput* output;
+    esp_timer_handle_t timer;
+    portMUX_TYPE mux;
+
+    volatile bool moving;
+    volatile bool donePending;
+    volatile uint16_t currentUs;
+    uint16_t startUs;
+    uint16_t targetUs;
+    int64_t startTime;
+    uint32_t durationUs;
+    Profile profile;
+    DoneCallback onDone;
+
+    const Step* sequence;
+    uint8_t sequenceCount;
+    uint8_t sequenceIndex;
+    DoneCallback sequenceDone;
+
+    bool startMove(uint16_t us, uint32_t durationMs, DoneCallback done, Profile p);
+    void runNextStep();
+    static void onTimer(void* arg);
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include "gerenciador_hcsr04.h"
 #include "config.h"
+#include "CommandRegistry.h"
 
 // Permite acesso ao sensorRacao global definido em principal.cpp
 extern GerenciadorHCSR04 sensorRacao;
@@ -72,76 +73,78 @@ void GerenciadorComunicacao::enviarConclusaoMQTT(const char* topicResposta, int
 }
 
 void GerenciadorComunicacao::processarComandoCentral(const String& payload) {
-    // Formato esperado: {"acao":"alimentar","tempo":5,"remota_id":1}
-    // ou comandos simples: STOP, STATUS, PING
-
-    if (payload == "PING") {
-        // Implementar envio de status PONG
-        Serial.println("📥 Comando PING recebido");
-        return;
-    }
-
-    if (payload == "STATUS") {
-        String statusAtual;
-        if (alimentacao->estaAtivo()) {
-            statusAtual = "ATIVO";
-        } else if (sistema->getServoTravado()) {
-            statusAtual = "INATIVO";
-        } else {
-            statusAtual = "DISPONIVEL";
+    // Verbos do CommandRegistry, em texto simples (PING, STATUS, STOP, ALIMENTAR)
+    // ou JSON: {"cmd":"ALIMENTAR","tempo":5,"remota_id":1}
+    // (o formato antigo {"acao":"alimentar",...} continua aceito)
+
+    JsonDocument doc;
+    char verbo[16];
+
+    if (payload.startsWith("{")) {
+        DeserializationError erro = deserializeJson(doc, payload);
+        if (erro) {
+            Serial.printf("❌ JSON inválido: %s\n", erro.c_str());
+            return;
         }
-
-        String statusTravamento = sistema->getServoTravado() ? "_TRAVADO" : "";
-        Serial.printf("📥 Status solicitado: %s%s\n", statusAtual.c_str(), statusTravamento.c_str());
-        return;
+        strlcpy(verbo, doc["cmd"] | (doc["acao"] | ""), sizeof(verbo));
+        for (char* c = verbo; *c; c++) *c = toupper(*c);
+    } else {
+        strlcpy(verbo, payload.c_str(), sizeof(verbo));
     }
 
-    if (payload == "STOP") {
-        if (alimentacao->estaAtivo()) {
-            alimentacao->parar();
-            Serial.println("📥 Comando STOP - Alimentação parada");
-        } else {
-            Serial.println("📥 Comando STOP - Sistema já parado");
+    CommandId id = CommandRegistry::find(verbo);
+    switch (id) {
+        case CommandId::PING:
+            // Implementar envio de status PONG
+            Serial.println("📥 Comando PING recebido");
+            return;
+
+        case CommandId::STATUS: {
+            String statusAtual;
+            if (alimentacao->estaAtivo()) {
+                statusAtual = "ATIVO";
+            } else if (sistema->getServoTravado()) {
+                statusAtual = "INATIVO";
+            } else {
+                statusAtual = "DISPONIVEL";
+            }
+
+            String statusTravamento = sistema->getServoTravado() ? "_TRAVADO" : "";
+            Serial.printf("📥 Status solicitado: %s%s\n", statusAtual.c_str(), statusTravamento.c_str());
+            return;
         }
-        return;
-    }
 
-    // Comando alimentar formato JSON
-    if (payload.indexOf("\"acao\":\"alimentar\"") > 0) {
-        Serial.println("📥 Comando 'alimentar' recebido da central");
-        
-        // Extrair tempo (se fornecido)
-        int startTempo = payload.indexOf("\"tempo\":") + 8;
-        int endTempo = payload.indexOf(",", startTempo);
-        if (endTempo == -1) endTempo = payload.indexOf("}", startTempo);
-        
-        int tempoSegundos = 5; // padrão
-        if (startTempo > 8) {
-            String tempoStr = payload.substring(startTempo, endTempo);
-            tempoSegundos = tempoStr.toInt();
-        }
-        
-        // Extrair remota_id se fornecido
-        int startId = payload.indexOf("\"remota_id\":") + 12;
-        int endId = payload.indexOf(",", startId);
-        if (endId == -1) endId = payload.indexOf("}", startId);
-        
-        int remotaId = 1; // padrão
-        if (startId > 12) {
-            String idStr = payload.substring(startId, endId);
-            remotaId = idStr.toInt();
+        case CommandId::STOP:
+            if (alimentacao->estaAtivo()) {
+                alimentacao->parar();
+                Serial.println("📥 Comando STOP - Alimentação parada");
+            } else {
+                Serial.println("📥 Comando STOP - Sistema já parado");
+            }
+            return;
+
+        case CommandId::ALIMENTAR: {
+            Serial.println("📥 Comando 'alimentar' recebido da central");
+
+            // Tempo (1 a 60 segundos, padrão 5) e remota_id (padrão 1)
+            AlimentarArgs args;
+            const CommandField* invalido = nullptr;
+            if (!CommandRegistry::decode(doc.as<JsonVariantConst>(), args, &invalido)) {
+                Serial.printf("❌ Erro: campo '%s' inválido (%lu a %lu)\n", invalido->key,
+                              (unsigned long)invalido->min, (unsigned long)invalido->max);
+                return;
+            }
+
+            Serial.printf("🎯 Comando alimentar: %d segundos para remota %d\n", args.seconds, args.remoteId);
+
+            String idComando = "ALIMENTAR_" + String(millis());
+            alimentacao->setIdComando(idComando);
+            alimentacao->iniciar(args.seconds);
+            return;
         }
-        
-        Serial.printf("🎯 Comando alimentar: %d segundos para remota %d\n", tempoSegundos, remotaId);
-        
-        // Validar tempo (1 a 60 segundos)
-        if (tempoSegundos < 1) tempoSegundos = 1;
-        if (tempoSegundos > 60) tempoSegundos = 60;
-        
-        String idComando = "ALIMENTAR_" + String(millis());
-        alimentacao->setIdComando(idComando);
-        alimentacao->iniciar(tempoSegundos);
-        return;
+
+        default:
+            break;
     }
 
     // Comando formato legado: a3, a5, etc.
@@ -10,13 +10,12 @@ void ServoControl::iniciar(int pino)
 {
     pinoServo = pino;
 
-    // Configuração simples sem alocação manual de timers
-    servo.setPeriodHertz(50);           // 50Hz padrão para servos
-    servo.attach(pinoServo);            // Deixa a biblioteca gerenciar os timers automaticamente
-
+    // PWM de 50Hz no LEDC; os movimentos rodam com rampa num timer.
     // Inicializa na posição central (90°) para servo 180°
-    servo.writeMicroseconds(1500);      // 90° = centro para servo 180°
-    delay(500); // Aguarda estabilizar
+    if (!movimento.begin(&pwm, pinoServo, 1500)) {
+        Serial.printf("❌ Falha ao configurar PWM do servo no pino %d\n", pino);
+        return;
+    }
     
     Serial.printf("🔧 Servo PDI 6221MG (180°) iniciado no pino %d (90° centro)\n", pino);
 }
@@ -42,9 +41,9 @@ void ServoControl::girarHorarioComFlag(int velocidade)
     }
 
     velocidade = constrain(velocidade, 0, 100);
-    int pwm = pwmParaVelocidade(velocidade, true);
-    servo.writeMicroseconds(pwm);
-    Serial.printf("➡️ Girando horário (%d%%) - PWM %dμs\n", velocidade, pwm);
+    int pulso = pwmParaVelocidade(velocidade, true);
+    movimento.moveToMicros(pulso, SERVO_RAMPA_VELOCIDADE_MS);
+    Serial.printf("➡️ Girando horário (%d%%) - PWM %dμs\n", velocidade, pulso);
 }
 
 void ServoControl::girarHorario(int velocidade)
@@ -53,29 +52,32 @@ void ServoControl::girarHorario(int velocidade)
         return;
 
     velocidade = constrain(velocidade, 0, 100);
-    int pwm = pwmParaVelocidade(velocidade, true);
-    servo.writeMicroseconds(pwm);
+    movimento.moveToMicros(pwmParaVelocidade(velocidade, true), SERVO_RAMPA_VELOCIDADE_MS);
 }
 
 void ServoControl::moverPara90AntiHorario()
 {
+    // Anti-horário máximo por um pequeno giro (300ms) e volta ao neutro
+    static const ServoMotion::Step PASSOS[] = {
+        { 1000, SERVO_RAMPA_VELOCIDADE_MS, 300 },
+        { 1500, SERVO_RAMPA_VELOCIDADE_MS, 0 },
+    };
+
     Serial.println("↩️ Indo para posição neutra (1520μs, anti-horário).");
-    servo.writeMicroseconds(1000); // anti-horário máximo
-    delay(300);     // pequeno giro
-    parar();
-    Serial.println("✅ Parado em neutro (1520μs).");
+    movimento.runSequence(PASSOS, 2, []() {
+        Serial.println("✅ Parado em neutro (1520μs).");
+    });
 }
 
 void ServoControl::parar()
 {
-    servo.writeMicroseconds(1500); // posição central (90°) para servo 180°
-    delay(100); // Garante que o comando foi enviado
+    movimento.moveToMicros(1500, SERVO_RAMPA_VELOCIDADE_MS); // posição central (90°) para servo 180°
     Serial.println("⏹️ Servo na posição central (90°).");
 }
 
 void ServoControl::pararImediato()
 {
-    servo.writeMicroseconds(1500); // posição central (90°) sem delay
+    movimento.jumpToMicros(1500); // posição central (90°) sem rampa
 }
 
 // Novo método para controle posicional por ângulos
@@ -91,10 +93,10 @@ void ServoControl::moverParaAngulo(int angulo)
     angulo = constrain(angulo, 0, 180);
     
     // Mapear ângulo (0-180°) para microsegundos (500-2500μs)
-    int micros = map(angulo, 0, 180, 500, 2500);
+    int micros = ServoMotion::angleToMicros(angulo);
     
-    servo.writeMicroseconds(micros);
-    Serial.printf("🔄 Servo movido para %d° (%dμs)\n", angulo, micros);
+    movimento.moveToMicros(micros, SERVO_TEMPO_MOVIMENTO_MS);
+    Serial.printf("🔄 Servo movendo para %d° (%dμs)\n", angulo, micros);
 }
 
 // Método específico para posições do alimentador
@@ -130,12 +132,13 @@ void ServoControl::alimentar(int porcao)
     }
     
     Serial.printf("🍽️ %s (%d°)\n", descricao.c_str(), angulo);
-    moverParaAngulo(angulo);
-    delay(1000); // Tempo para alimentar
-    
-    // Voltar ao centro
-    moverParaAngulo(90);
-    Serial.println("✅ Alimentação concluída - Servo no centro");
+
+    // Abre, espera 1s para alimentar e volta ao centro, sem bloquear o loop
+    passosAlimentar[0] = { ServoMotion::angleToMicros(angulo), SERVO_TEMPO_MOVIMENTO_MS, 1000 };
+    passosAlimentar[1] = { ServoMotion::angleToMicros(90), SERVO_TEMPO_MOVIMENTO_MS, 0 };
+    movimento.runSequence(passosAlimentar, 2, []() {
+        Serial.println("✅ Alimentação concluída - Servo no centro");
+    });
 }
 
 void ServoControl::testar()
@@ -143,26 +146,19 @@ void ServoControl::testar()
     Serial.println("🧪 Teste: movimento controlado...");
 
     ativar();
-    
-    // Teste horário suave
-    Serial.println("   ➡️ Testando rotação horária...");
-    servo.writeMicroseconds(1600); // Rotação suave horária
-    delay(800);
-    
-    // Para
-    servo.writeMicroseconds(1520); // Para
-    delay(500);
-    
-    // Teste anti-horário suave  
-    Serial.println("   ⬅️ Testando rotação anti-horária...");
-    servo.writeMicroseconds(1400); // Rotação suave anti-horária
-    delay(800);
-    
-    // Para definitivamente
-    servo.writeMicroseconds(1520);
-    delay(200);
 
-    Serial.println("✅ Teste concluído - Servo estabilizado.");
+    // Horário suave (800ms), para (500ms), anti-horário suave (800ms), para
+    static const ServoMotion::Step PASSOS[] = {
+        { 1600, SERVO_RAMPA_VELOCIDADE_MS, 800 },
+        { 1520, SERVO_RAMPA_VELOCIDADE_MS, 500 },
+        { 1400, SERVO_RAMPA_VELOCIDADE_MS, 800 },
+        { 1520, SERVO_RAMPA_VELOCIDADE_MS, 200 },
+    };
+
+    Serial.println("   ➡️ Rotação horária, ⬅️ depois anti-horária...");
+    movimento.runSequence(PASSOS, 4, []() {
+        Serial.println("✅ Teste concluído - Servo estabilizado.");
+    });
 }
 
 bool ServoControl::estaAtivo()
@@ -170,6 +166,16 @@ bool ServoControl::estaAtivo()
     return ativo;
 }
 
+bool ServoControl::estaMovendo()
+{
+    return movimento.isMoving();
+}
+
+void ServoControl::atualizar()
+{
+    movimento.update();
+}
+
 int ServoControl::pwmParaVelocidade(int percentual, bool horario)
 {
     // Para servo 1520μs: range 1000-2000μs
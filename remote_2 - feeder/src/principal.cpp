@@ -45,6 +45,7 @@ void setup()
 // ===== LOOP PRINCIPAL =====
 void loop()
 {
+    servo.atualizar();
     sistema.verificarConexoes();
     comunicacao.processarMensagens();
     sistema.processarBotao();